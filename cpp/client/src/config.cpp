@@ -369,7 +369,10 @@ int loadStreamParams(const Setting &s, ProducerStreamParams &params)
         {
             string threadName;
             s.lookupValue("thread", threadName);
-            params.addMediaThread(AudioThreadParams(threadName));
+
+            AudioThreadParams audioThread(threadName);
+            s.lookupValue("bundle_delay", audioThread.maxBundleDelayMs_);
+            params.addMediaThread(audioThread);
         }
 
         return EXIT_SUCCESS;
@@ -459,6 +462,7 @@ int loadStreamParams(const Setting &s, ClientMediaStreamParams &params)
 
 int loadThreadParams(const Setting &s, AudioThreadParams &params)
 {
+    s.lookupValue("bundle_delay", params.maxBundleDelayMs_);
     return s.lookupValue("name", params.threadName_);
 }
 
@@ -495,6 +499,7 @@ int loadThreadParams(const Setting &s, VideoThreadParams &params)
         lookupNumber(coderSettings, "encode_height", params.coderParams_.encodeHeight_);
         lookupNumber(coderSettings, "encode_width", params.coderParams_.encodeWidth_);
         coderSettings.lookupValue("drop_frames", params.coderParams_.dropFramesOn_);
+        coderSettings.lookupValue("codec", params.coderParams_.codec_);
     }
     return EXIT_SUCCESS;
 }
@@ -27,6 +27,7 @@
 #include "client.hpp"
 #include <ndnrtc/helpers/key-chain-manager.hpp>
 #include <ndnrtc/helpers/face-processor.hpp>
+#include <ndnrtc/event-log.hpp>
 
 using namespace std;
 using namespace ndnrtc;
@@ -36,7 +37,7 @@ using namespace ndn;
 struct Args
 {
     unsigned int runTimeSec_, samplePeriod_;
-    std::string configFile_, identity_, instance_, policy_;
+    std::string configFile_, identity_, instance_, policy_, eventLog_;
     ndnlog::NdnLoggerDetailLevel logLevel_;
 };
 
@@ -66,14 +67,14 @@ int main(int argc, char **argv)
     signal(SIGABRT, handler);
     signal(SIGSEGV, handler);
 
-    char *configFile = NULL, *identity = NULL, *instance = NULL, *policy = NULL;
+    char *configFile = NULL, *identity = NULL, *instance = NULL, *policy = NULL, *eventLog = NULL;
     int c;
     unsigned int runTimeSec = 0;           // default app run time (sec)
     unsigned int statSamplePeriodMs = 100; // default statistics sample interval (ms)
     ndnlog::NdnLoggerDetailLevel logLevel = ndnlog::NdnLoggerDetailLevelDefault;
 
     opterr = 0;
-    while ((c = getopt(argc, argv, "vn:i:t:c:s:p:")) != -1)
+    while ((c = getopt(argc, argv, "vn:i:t:c:s:p:e:")) != -1)
         switch (c)
         {
         case 'c':
@@ -97,6 +98,9 @@ int main(int argc, char **argv)
         case 'p':
             policy = optarg;
             break;
+        case 'e':
+            eventLog = optarg;
+            break;
         case '?':
             if (optopt == 'c')
                 fprintf(stderr, "Option -%c requires an argument.\n", optopt);
@@ -116,7 +120,7 @@ int main(int argc, char **argv)
         std::cout << "usage: " << argv[0] << " -c <config file> -s <signing identity> "
                                              "-p <verification policy file> "
                                              "-t <app run time in seconds> [-n <statistics sample interval in milliseconds> "
-                                             "-i <instance name> -v <verbose mode>]"
+                                             "-i <instance name> -e <binary event log file> -v <verbose mode>]"
                   << std::endl;
         exit(1);
     }
@@ -129,6 +133,7 @@ int main(int argc, char **argv)
     args.identity_ = std::string(identity);
     args.policy_ = std::string(policy);
     args.instance_ = (instance ? std::string(instance) : "client0");
+    args.eventLog_ = (eventLog ? std::string(eventLog) : "");
 
     return run(args);
 }
@@ -149,8 +154,22 @@ int run(const struct Args &args)
                 << "\n\tpolicy file: " << args.policy_
                 << "\n\tstatistics sampling: " << args.samplePeriod_
                 << "\n\tinstance name: " << args.instance_
+                << "\n\tevent log: " << args.eventLog_
                 << std::endl;
 
+    if (args.eventLog_ != "")
+    {
+        try
+        {
+            eventlog::EventLog::start(args.eventLog_);
+        }
+        catch (std::exception &e)
+        {
+            LogError("") << "couldn't start event log: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     boost::asio::io_service io;
     boost::shared_ptr<boost::asio::io_service::work> work(boost::make_shared<boost::asio::io_service::work>(io));
     boost::thread t([&io, &err]() {
@@ -223,6 +242,8 @@ int run(const struct Args &args)
 
     LogInfo("") << "Client run completed" << std::endl;
 
+    eventlog::EventLog::stop();
+
     rendererWork.reset();
     rendererThread.join();
     rendererIo.stop();
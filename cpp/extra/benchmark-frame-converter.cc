@@ -0,0 +1,80 @@
+//
+// benchmark-frame-converter.cc
+//
+//  Created by Peter Gusev on 21 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include <stdlib.h>
+#include <vector>
+#include <boost/chrono.hpp>
+
+#include "gtest/gtest.h"
+#include "../tests/tests-helpers.hpp"
+#include "frame-converter.hpp"
+#include "video-coder.hpp"
+
+using namespace ndnrtc;
+
+// compares converting captured ARGB frame and then scaling it to the first
+// simulcast layer against doing both in one pass over the source
+void runConverter(unsigned int width, unsigned int height,
+    unsigned int dstWidth, unsigned int dstHeight, int nFrames = 300)
+{
+    unsigned int size = width*height*4;
+    std::vector<uint8_t> data(size);
+    for (unsigned int i = 0; i < size; ++i)
+        data[i] = (uint8_t)(rand()%256);
+
+    ArgbRawFrameWrapper wr({width, height, data.data(), size, true});
+    RawFrameConverter conv;
+    FrameScaler scaler(dstWidth, dstHeight);
+
+    // warm up buffer pools and caches
+    for (int i = 0; i < 10; ++i)
+    {
+        WebRtcVideoFrame f = scaler(conv << wr);
+        RawFrameConverter::FramePair p = conv.convertAndDownscale(wr, dstWidth, dstHeight);
+    }
+
+    boost::chrono::high_resolution_clock::time_point start = boost::chrono::high_resolution_clock::now();
+    for (int i = 0; i < nFrames; ++i)
+    {
+        WebRtcVideoFrame frame = conv << wr;
+        WebRtcVideoFrame scaled = scaler(frame);
+    }
+    double separateUs = boost::chrono::duration_cast<boost::chrono::microseconds>(
+        boost::chrono::high_resolution_clock::now() - start).count()/(double)nFrames;
+
+    start = boost::chrono::high_resolution_clock::now();
+    for (int i = 0; i < nFrames; ++i)
+        RawFrameConverter::FramePair frames = conv.convertAndDownscale(wr, dstWidth, dstHeight);
+    double fusedUs = boost::chrono::duration_cast<boost::chrono::microseconds>(
+        boost::chrono::high_resolution_clock::now() - start).count()/(double)nFrames;
+
+    GT_PRINTF("%dx%d -> %dx%d: convert+scale %.2fus/frame, fused %.2fus/frame (x%.2f)\n",
+              width, height, dstWidth, dstHeight, separateUs, fusedUs, separateUs/fusedUs);
+}
+
+TEST(BenchmarkFrameConverter, Convert1280x720)
+{
+    runConverter(1280, 720, 640, 360);
+    runConverter(1280, 720, 320, 180);
+}
+
+TEST(BenchmarkFrameConverter, Convert1920x1080)
+{
+    runConverter(1920, 1080, 960, 540);
+    runConverter(1920, 1080, 640, 360);
+}
+
+TEST(BenchmarkFrameConverter, Convert3840x2160)
+{
+    runConverter(3840, 2160, 1920, 1080, 100);
+    runConverter(3840, 2160, 960, 540, 100);
+}
+
+int main(int argc, char **argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,147 @@
+//
+// benchmark-frame-flip.cc
+//
+//  Created by Peter Gusev on 29 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+//  Compares ndnrtcTOP frame flip kernels against the former per-pixel
+//  implementation (in-place flip followed by memcpy into TOP's memory).
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <vector>
+#include <boost/chrono.hpp>
+
+#include "gtest/gtest.h"
+#include "../ndnrtcTOP/frame-flip.hpp"
+
+// per-pixel flip, as ndnrtcTOPbase::flipFrame used to do it
+void scalarFlipFrame(int width, int height, uint8_t* buf,
+                     bool flipH, bool flipV, bool convertToArgb)
+{
+    int format = 4;
+    int stride = width * format;
+    int yStop = (flipV) ? height / 2 : height;
+    int xStop = (flipH && !(flipH && flipV)) ? width / 2 : width;
+
+    for (int y = 0; y < yStop; ++y)
+        for (int x = 0; x < xStop; ++x)
+        {
+            int xSwap = (flipH ? width - 1 - x : x);
+            int ySwap = (flipV ? height - 1 - y : y);
+            int p1Idx = y * stride + x * format;
+            int p2Idx = ySwap * stride + xSwap * format;
+
+            if (convertToArgb)
+            {
+                uint32_t temp = *(uint32_t*)(buf + p1Idx);
+                *(uint32_t*)(buf + p1Idx) = (*(uint32_t*)(buf + p2Idx)) >> 24 | (*(uint32_t*)(buf + p2Idx)) << 8;
+                *(uint32_t*)(buf + p2Idx) = temp >> 24 | temp << 8;
+            }
+            else
+            {
+                uint32_t temp = *(uint32_t*)(buf + p1Idx);
+                *(uint32_t*)(buf + p1Idx) = *(uint32_t*)(buf + p2Idx);
+                *(uint32_t*)(buf + p2Idx) = temp;
+            }
+        }
+}
+
+// expected pixel of the transformed frame
+uint32_t referencePixel(const std::vector<uint8_t>& src, int width, int height,
+                        int x, int y, bool flipH, bool flipV, bool swizzle)
+{
+    int sx = flipH ? width - 1 - x : x;
+    int sy = flipV ? height - 1 - y : y;
+    uint32_t p;
+    memcpy(&p, src.data() + 4*(sy*width + sx), 4);
+    return swizzle ? p >> 24 | p << 8 : p;
+}
+
+std::vector<uint8_t> randomFrame(int width, int height)
+{
+    std::vector<uint8_t> data(4*width*height);
+    for (auto& b:data) b = (uint8_t)(rand()%256);
+    return data;
+}
+
+void checkFlip(int width, int height, bool flipH, bool flipV, bool swizzle)
+{
+    std::vector<uint8_t> src = randomFrame(width, height);
+    std::vector<uint8_t> copied(src.size()), inplace(src);
+
+    frameflip::copyFrame(src.data(), copied.data(), width, height, flipH, flipV, swizzle);
+    frameflip::flipFrame(inplace.data(), width, height, flipH, flipV, swizzle);
+
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            uint32_t expected = referencePixel(src, width, height, x, y, flipH, flipV, swizzle);
+            uint32_t p1, p2;
+            memcpy(&p1, copied.data() + 4*(y*width + x), 4);
+            memcpy(&p2, inplace.data() + 4*(y*width + x), 4);
+            ASSERT_EQ(expected, p1) << width << "x" << height << " (" << x << "," << y << ")";
+            ASSERT_EQ(expected, p2) << width << "x" << height << " (" << x << "," << y << ")";
+        }
+}
+
+void runFlip(int width, int height, bool flipH, bool flipV, bool swizzle, int nFrames = 200)
+{
+    std::vector<uint8_t> frame = randomFrame(width, height);
+    std::vector<uint8_t> out(frame.size());
+
+    boost::chrono::high_resolution_clock::time_point start = boost::chrono::high_resolution_clock::now();
+    for (int i = 0; i < nFrames; ++i)
+    {
+        scalarFlipFrame(width, height, frame.data(), flipH, flipV, swizzle);
+        memcpy(out.data(), frame.data(), frame.size());
+    }
+    double scalarUs = boost::chrono::duration_cast<boost::chrono::microseconds>(
+        boost::chrono::high_resolution_clock::now() - start).count()/(double)nFrames;
+
+    start = boost::chrono::high_resolution_clock::now();
+    for (int i = 0; i < nFrames; ++i)
+        frameflip::copyFrame(frame.data(), out.data(), width, height, flipH, flipV, swizzle);
+    double fusedUs = boost::chrono::duration_cast<boost::chrono::microseconds>(
+        boost::chrono::high_resolution_clock::now() - start).count()/(double)nFrames;
+
+    start = boost::chrono::high_resolution_clock::now();
+    for (int i = 0; i < nFrames; ++i)
+        frameflip::flipFrame(frame.data(), width, height, flipH, flipV, swizzle);
+    double inplaceUs = boost::chrono::duration_cast<boost::chrono::microseconds>(
+        boost::chrono::high_resolution_clock::now() - start).count()/(double)nFrames;
+
+    printf("[ INFO     ] %dx%d flipH %d flipV %d swizzle %d: "
+           "per-pixel+memcpy %.2fus, fused copy %.2fus (x%.2f), in-place %.2fus\n",
+           width, height, flipH, flipV, swizzle, scalarUs, fusedUs, scalarUs/fusedUs, inplaceUs);
+}
+
+TEST(BenchmarkFrameFlip, TestCorrectness)
+{
+    // odd sizes exercise scalar tails and middle rows
+    int sizes[][2] = {{1, 1}, {3, 3}, {7, 5}, {16, 9}, {33, 17}, {320, 240}};
+
+    for (auto& s:sizes)
+        for (int flags = 0; flags < 8; ++flags)
+            checkFlip(s[0], s[1], flags & 1, flags & 2, flags & 4);
+}
+
+TEST(BenchmarkFrameFlip, Flip1920x1080)
+{
+    runFlip(1920, 1080, false, true, false);
+    runFlip(1920, 1080, false, true, true);
+    runFlip(1920, 1080, true, true, true);
+}
+
+TEST(BenchmarkFrameFlip, Flip3840x2160)
+{
+    runFlip(3840, 2160, false, true, false, 50);
+    runFlip(3840, 2160, false, true, true, 50);
+    runFlip(3840, 2160, true, true, true, 50);
+}
+
+int main(int argc, char **argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
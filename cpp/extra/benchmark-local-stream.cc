@@ -6,6 +6,7 @@
 //
 
 #include <stdlib.h>
+#include <sys/resource.h>
 
 #include <ndn-cpp/face.hpp>
 #include <ndn-cpp/security/key-chain.hpp>
@@ -36,8 +37,18 @@ using namespace ndnrtc::statistics;
 
 // #define ENABLE_LOGGING
 
+// process CPU time (user + system), in milliseconds
+double cpuTimeMs()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)*1000. +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)/1000.;
+}
+
 void runProducer(std::string sourceFile, boost::shared_ptr<RawFrame> frame,
-	MediaStreamParams msp, int runTimeMs, bool sign = true)
+	MediaStreamParams msp, int runTimeMs, bool sign = true,
+    size_t encoderQueueSize = 2, bool pinEncoderThreads = false)
 {
 #ifdef ENABLE_LOGGING
     ndnlog::new_api::Logger::initAsyncLogging();
@@ -70,6 +81,8 @@ void runProducer(std::string sourceFile, boost::shared_ptr<RawFrame> frame,
 
 	MediaStreamSettings settings(face_io, msp);
     settings.sign_ = sign;
+    settings.encoderQueueSize_ = encoderQueueSize;
+    settings.pinEncoderThreads_ = pinEncoderThreads;
 	settings.face_ = &face;
 	settings.keyChain_ = keyChain.get();
 	LocalVideoStream s(appPrefix, settings);
@@ -93,9 +106,11 @@ void runProducer(std::string sourceFile, boost::shared_ptr<RawFrame> frame,
     EXPECT_CALL(capturer, incomingArgbFrame(frame->getWidth(), frame->getHeight(), _, _))
     	.WillRepeatedly(Invoke(incomingRawFrame));
 
+    double cpuStart = cpuTimeMs();
     source.start(30);
     boost::this_thread::sleep_for(boost::chrono::milliseconds(runTimeMs));
     source.stop();
+    double cpuMs = cpuTimeMs() - cpuStart;
     face.shutdown();
 
     face_work.reset();
@@ -131,6 +146,9 @@ void runProducer(std::string sourceFile, boost::shared_ptr<RawFrame> frame,
               stat[Indicator::PublishedSegmentsNum]/stat[Indicator::PublishedNum],
               (int)stat[Indicator::SignNum], stat[Indicator::SignNum]/runTimeSec,
               stat[Indicator::EncodedNum]/runTimeSec);
+    GT_PRINTF("capture-to-publish delay: %.2fms, cpu: %.2fms/frame (%.2f%% of one core)\n",
+              stat[Indicator::PublishDelay],
+              cpuMs/stat[Indicator::CapturedNum], cpuMs/runTimeMs*100);
 }
 
 unsigned int runtime = 5000;
@@ -730,6 +748,58 @@ TEST(BenchmarkLocalStream, VideoStream1280x720_1200_500_100)
                 runtime);
 }
 
+// compares capture-to-publish delay and CPU usage of encoder workers for
+// different queue sizes and with threads pinned to cores
+TEST(BenchmarkLocalStream, VideoStream1280x720_EncoderWorkers)
+{
+    MediaStreamParams msp("camera");
+    
+    msp.type_ = MediaStreamParams::MediaStreamTypeVideo;
+    msp.synchronizedStreamName_ = "mic";
+    msp.producerParams_.freshnessMs_ = 2000;
+    msp.producerParams_.segmentSize_ = 1000;
+    
+    CaptureDeviceParams cdp;
+    cdp.deviceId_ = 10;
+    msp.captureDevice_ = cdp;
+    
+    {
+        VideoThreadParams atp("hi", sampleVideoCoderParams());
+        atp.coderParams_.encodeWidth_ = 1280;
+        atp.coderParams_.encodeHeight_ = 720;
+        atp.coderParams_.startBitrate_ = 1200;
+        atp.coderParams_.maxBitrate_ = 1200;
+        msp.addMediaThread(atp);
+    }
+    
+    {
+        VideoThreadParams atp("mid", sampleVideoCoderParams());
+        atp.coderParams_.encodeWidth_ = 640;
+        atp.coderParams_.encodeHeight_ = 360;
+        atp.coderParams_.startBitrate_ = 300;
+        atp.coderParams_.maxBitrate_ = 300;
+        msp.addMediaThread(atp);
+    }
+
+    {
+        VideoThreadParams atp("low", sampleVideoCoderParams());
+        atp.coderParams_.encodeWidth_ = 320;
+        atp.coderParams_.encodeHeight_ = 180;
+        atp.coderParams_.startBitrate_ = 100;
+        atp.coderParams_.maxBitrate_ = 100;
+        msp.addMediaThread(atp);
+    }
+
+    for (auto queueSize : { 1, 2, 4 })
+        for (auto pin : { false, true })
+        {
+            GT_PRINTF("encoder queue %d, pinned threads: %s\n", queueSize, (pin ? "yes" : "no"));
+            runProducer(test_path+"/../res/test-source-1280x720.argb",
+                        boost::make_shared<ArgbFrame>(1280,720),
+                        msp, runtime, true, queueSize, pin);
+        }
+}
+
 int main(int argc, char **argv) {
 	::testing::InitGoogleTest(&argc, argv);
 
@@ -0,0 +1,263 @@
+//
+// benchmark-packet-builder.cc
+//
+//  Created by Peter Gusev on 3 April 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+//  Compares building data packets with DataPacketBuilder against the former
+//  DataPacketT::addBlob implementation (insert before payload followed by
+//  re-parsing of all blobs).
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <vector>
+#include <boost/chrono.hpp>
+
+#include "tests-helpers.hpp"
+#include "gtest/gtest.h"
+#include "src/frame-data.hpp"
+
+using namespace ndnrtc;
+
+// data packet built with the former addBlob implementation
+class LegacyPacket
+{
+  public:
+    LegacyPacket(size_t payloadLength, const uint8_t *payload) : payloadOffset_(1)
+    {
+        data_.insert(data_.end(), payload, payload + payloadLength);
+        data_.insert(data_.begin(), 0);
+    }
+
+    void addBlob(uint16_t dataLength, const uint8_t *data)
+    {
+        if (dataLength == 0)
+            return;
+
+        data_[0]++;
+        std::vector<uint8_t>::iterator payloadBegin = data_.begin() + payloadOffset_;
+        payloadBegin = data_.insert(payloadBegin, dataLength & 0x00ff);
+        payloadBegin++;
+        payloadBegin = data_.insert(payloadBegin, (dataLength & 0xff00) >> 8);
+        payloadBegin++;
+        data_.insert(payloadBegin, data, data + dataLength);
+        reinit();
+    }
+
+    const std::vector<uint8_t> &data() const { return data_; }
+
+  private:
+    std::vector<uint8_t> data_;
+    std::vector<std::pair<size_t, size_t>> blobs_;
+    size_t payloadOffset_;
+
+    // as DataPacketT::reinit does
+    void reinit()
+    {
+        blobs_.clear();
+        size_t offset = 1;
+        for (int i = 0; i < data_[0]; ++i)
+        {
+            size_t length = data_[offset] | (data_[offset + 1] << 8);
+            blobs_.push_back(std::make_pair(offset + 2, length));
+            offset += 2 + length;
+        }
+        payloadOffset_ = offset;
+    }
+};
+
+class BuilderPacket : public DataPacket
+{
+  public:
+    BuilderPacket(const DataPacketBuilder &builder) : DataPacket(builder) {}
+    BuilderPacket(size_t payloadLength, const uint8_t *payload) : DataPacket(payloadLength, payload) {}
+
+    void addBlobs(const DataPacketBuilder &builder) { DataPacket::addBlobs(builder); }
+};
+
+std::vector<uint8_t> randomData(size_t length)
+{
+    std::vector<uint8_t> data(length);
+    for (auto &b : data)
+        b = (uint8_t)(rand() % 256);
+    return data;
+}
+
+template <typename LegacyFun, typename BuilderFun>
+void runBuild(const char *name, LegacyFun legacyBuild, BuilderFun builderBuild, int nPackets)
+{
+    // both implementations must produce the same wire format
+    ASSERT_EQ(legacyBuild(), builderBuild()) << name;
+
+    boost::chrono::high_resolution_clock::time_point start = boost::chrono::high_resolution_clock::now();
+    for (int i = 0; i < nPackets; ++i)
+        legacyBuild();
+    double legacyUs = boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+                          boost::chrono::high_resolution_clock::now() - start)
+                          .count() / 1000. / (double)nPackets;
+
+    start = boost::chrono::high_resolution_clock::now();
+    for (int i = 0; i < nPackets; ++i)
+        builderBuild();
+    double builderUs = boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+                           boost::chrono::high_resolution_clock::now() - start)
+                           .count() / 1000. / (double)nPackets;
+
+    printf("[ INFO     ] %s: addBlob %.2fus, builder %.2fus (x%.2f)\n",
+           name, legacyUs, builderUs, legacyUs / builderUs);
+}
+
+void runVideoFrame(size_t frameLength, int nThreads, int nPackets = 2000)
+{
+    uint8_t *buffer;
+    webrtc::EncodedImage frame = encodedImage(frameLength, buffer, false);
+    std::map<std::string, PacketNumber> syncList;
+    CommonHeader hdr = {30, 39936287, 1460399362};
+
+    for (int i = 0; i < nThreads; ++i)
+        syncList["/ndnrtc/stream/thread" + std::to_string(i)] = i * 100;
+
+    // frame header is the first blob of the packet
+    VideoFramePacket reference(frame);
+    const uint8_t *frameHdr = reference.getData() + 3;
+    uint16_t frameHdrLength = reference.getData()[1] | (reference.getData()[2] << 8);
+
+    char name[128];
+    sprintf(name, "video frame %zu bytes, %d sync threads", frameLength, nThreads);
+    runBuild(name,
+             [&]() {
+                 LegacyPacket p(frame._length, frame._buffer);
+                 p.addBlob(frameHdrLength, frameHdr);
+                 for (auto &it : syncList)
+                 {
+                     p.addBlob(it.first.size(), (const uint8_t *)it.first.c_str());
+                     p.addBlob(sizeof(it.second), (const uint8_t *)&it.second);
+                 }
+                 p.addBlob(sizeof(hdr), (const uint8_t *)&hdr);
+                 return p.data();
+             },
+             [&]() {
+                 VideoFramePacket p(frame);
+                 p.setSyncList(syncList);
+                 p.setHeader(hdr);
+                 return p.data();
+             },
+             nPackets);
+
+    free(buffer);
+}
+
+TEST(BenchmarkPacketBuilder, TestVideoFrame)
+{
+    runVideoFrame(3000, 1);
+    runVideoFrame(30000, 4);
+    runVideoFrame(300000, 16, 200);
+}
+
+TEST(BenchmarkPacketBuilder, TestManifest)
+{
+    // manifest packet carries SHA-256 digests of segments
+    for (int nSegments : {10, 50, 200})
+    {
+        std::vector<std::vector<uint8_t>> digests;
+        for (int i = 0; i < nSegments; ++i)
+            digests.push_back(randomData(32));
+
+        char name[128];
+        sprintf(name, "manifest of %d segments", nSegments);
+        runBuild(name,
+                 [&]() {
+                     LegacyPacket p(0, nullptr);
+                     for (auto &d : digests)
+                         p.addBlob(d.size(), d.data());
+                     return p.data();
+                 },
+                 [&]() {
+                     DataPacketBuilder builder;
+                     for (auto &d : digests)
+                         builder.addBlob(d.size(), d.data());
+                     return BuilderPacket(builder).data();
+                 },
+                 2000);
+    }
+}
+
+TEST(BenchmarkPacketBuilder, TestStreamMeta)
+{
+    uint64_t timestamp = 1554300000000;
+
+    for (int nThreads : {2, 10, 50})
+    {
+        std::vector<std::string> threads;
+        for (int i = 0; i < nThreads; ++i)
+            threads.push_back("thread" + std::to_string(i));
+
+        char name[128];
+        sprintf(name, "stream meta of %d threads", nThreads);
+        runBuild(name,
+                 [&]() {
+                     LegacyPacket p(0, nullptr);
+                     p.addBlob(sizeof(timestamp), (const uint8_t *)&timestamp);
+                     for (auto &t : threads)
+                         p.addBlob(t.size(), (const uint8_t *)t.c_str());
+                     return p.data();
+                 },
+                 [&]() {
+                     return MediaStreamMeta(timestamp, threads).data();
+                 },
+                 10000);
+    }
+}
+
+TEST(BenchmarkPacketBuilder, TestThreadMeta)
+{
+    double rate = 50;
+    uint64_t bundleNo = 1234;
+    uint32_t delay = 60;
+    std::string codec = "opus";
+
+    runBuild("audio thread meta",
+             [&]() {
+                 LegacyPacket p(0, nullptr);
+                 p.addBlob(sizeof(rate), (const uint8_t *)&rate);
+                 p.addBlob(sizeof(bundleNo), (const uint8_t *)&bundleNo);
+                 p.addBlob(codec.size(), (const uint8_t *)codec.c_str());
+                 p.addBlob(sizeof(delay), (const uint8_t *)&delay);
+                 return p.data();
+             },
+             [&]() {
+                 return AudioThreadMeta(rate, bundleNo, codec, delay).data();
+             },
+             100000);
+}
+
+TEST(BenchmarkPacketBuilder, TestBlobsOnLargePayload)
+{
+    // adding blobs one by one moves payload for every blob
+    std::vector<uint8_t> payload = randomData(100000);
+    std::vector<uint8_t> blob = randomData(16);
+
+    runBuild("16 blobs on 100KB payload",
+             [&]() {
+                 LegacyPacket p(payload.size(), payload.data());
+                 for (int i = 0; i < 16; ++i)
+                     p.addBlob(blob.size(), blob.data());
+                 return p.data();
+             },
+             [&]() {
+                 BuilderPacket p(payload.size(), payload.data());
+                 DataPacketBuilder builder;
+                 for (int i = 0; i < 16; ++i)
+                     builder.addBlob(blob.size(), blob.data());
+                 p.addBlobs(builder);
+                 return p.data();
+             },
+             500);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,500 @@
+//
+// benchmark-producer.cc
+//
+//  Created by Peter Gusev on 27 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+//  Producer throughput benchmark. Each source is benchmarked twice:
+//   - "pipeline": producer stages (convert, scale, encode, FEC, segment,
+//     sign, cache insert) are run one after another on a single thread and
+//     timed separately; content cache is a stub, KeyChain is in-memory;
+//   - "stream": frames are fed into LocalVideoStream at capture rate
+//     (face is never connected, so nothing leaves the process).
+//  Results are printed and written as JSON (--json=<file>, default
+//  benchmark-producer.json) for regression tracking.
+//
+
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <new>
+#include <sys/resource.h>
+
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+
+#include <ndn-cpp/face.hpp>
+#include <ndn-cpp/security/key-chain.hpp>
+#include <ndn-cpp/util/memory-content-cache.hpp>
+
+#include "gtest/gtest.h"
+#include "../tests/tests-helpers.hpp"
+#include "include/local-stream.hpp"
+#include "frame-converter.hpp"
+#include "video-coder.hpp"
+#include "video-thread.hpp"
+#include "frame-data.hpp"
+#include "packet-publisher.hpp"
+#include "statistics.hpp"
+#include "clock.hpp"
+
+using namespace ndnrtc;
+using namespace ndnrtc::statistics;
+using namespace ndn;
+using namespace boost::chrono;
+
+std::string test_path = "";
+std::string json_path = "benchmark-producer.json";
+
+//******************************************************************************
+// every operator new in the process is counted; allocations made by C code
+// (e.g. libvpx) through malloc are not
+static boost::atomic<uint64_t> AllocNum(0);
+
+void *operator new(size_t size)
+{
+    AllocNum.fetch_add(1, boost::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    AllocNum.fetch_add(1, boost::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+
+//******************************************************************************
+typedef std::vector<std::pair<std::string, double>> Metrics;
+
+typedef struct _BenchmarkResult
+{
+    std::string name_;
+    Metrics metrics_;
+} BenchmarkResult;
+
+std::vector<BenchmarkResult> Results;
+
+void writeJson(std::ostream &os)
+{
+    os << "{\"benchmark\": \"producer\", \"results\": [";
+    for (size_t i = 0; i < Results.size(); ++i)
+    {
+        os << (i ? ", " : "") << "{\"name\": \"" << Results[i].name_ << "\"";
+        for (auto m : Results[i].metrics_)
+            os << ", \"" << m.first << "\": " << m.second;
+        os << "}";
+    }
+    os << "]}" << std::endl;
+}
+
+// process CPU time (user + system), in milliseconds
+double cpuTimeMs()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000. +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.;
+}
+
+double elapsedUs(const high_resolution_clock::time_point &start)
+{
+    return (double)duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.;
+}
+
+//******************************************************************************
+// content cache stub: keeps published data like MemoryContentCache does,
+// but has no face and never has pending interests
+class StubContentCache
+{
+  public:
+    typedef std::vector<boost::shared_ptr<const MemoryContentCache::PendingInterest>> PendingInterests;
+
+    StubContentCache(size_t capacity = 3000) : capacity_(capacity), addUs_(0) {}
+
+    void add(const Data &data)
+    {
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+        storage_.push_back(boost::make_shared<Data>(data));
+        if (storage_.size() > capacity_)
+            storage_.pop_front();
+        addUs_ += elapsedUs(start);
+    }
+
+    void getPendingInterestsForName(const Name &, PendingInterests &) {}
+    void getPendingInterestsWithPrefix(const Name &, PendingInterests &) {}
+    void extractPendingInterestsBefore(const Name &, PendingInterests &) {}
+    void putData(const PendingInterests &, const std::vector<boost::shared_ptr<const Data>> &) {}
+
+    size_t capacity_;
+    std::deque<boost::shared_ptr<Data>> storage_;
+    double addUs_;
+};
+
+class TimedKeyChain
+{
+  public:
+    TimedKeyChain(KeyChain *keyChain) : keyChain_(keyChain), signUs_(0) {}
+
+    void sign(Data &data)
+    {
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+        keyChain_->sign(data);
+        signUs_ += elapsedUs(start);
+    }
+
+    KeyChain *keyChain_;
+    double signUs_;
+};
+
+typedef _PublisherSettings<TimedKeyChain, StubContentCache> StubPublisherSettings;
+typedef PacketPublisher<VideoFrameSegment, StubPublisherSettings> StubPublisher;
+
+//******************************************************************************
+// frame sources
+std::vector<std::vector<uint8_t>> loadArgbFrames(const std::string &path, unsigned int width,
+                                                 unsigned int height, int maxFrames)
+{
+    std::vector<std::vector<uint8_t>> frames;
+    std::ifstream f(path, std::ios::binary);
+
+    while (f.good() && (int)frames.size() < maxFrames)
+    {
+        std::vector<uint8_t> frame(width * height * 4);
+        if (f.read((char *)frame.data(), frame.size()).gcount() != (std::streamsize)frame.size())
+            break;
+        frames.push_back(frame);
+    }
+
+    return frames;
+}
+
+// moving gradient with a moving square, so that encoder has some motion
+// to deal with
+std::vector<std::vector<uint8_t>> syntheticArgbFrames(unsigned int width, unsigned int height,
+                                                      int nFrames)
+{
+    std::vector<std::vector<uint8_t>> frames;
+    unsigned int side = height / 4;
+
+    for (int n = 0; n < nFrames; ++n)
+    {
+        std::vector<uint8_t> frame(width * height * 4);
+        unsigned int sqX = (n * width / nFrames) % (width - side);
+        unsigned int sqY = (height - side) / 2;
+
+        for (unsigned int y = 0; y < height; ++y)
+            for (unsigned int x = 0; x < width; ++x)
+            {
+                uint8_t *px = &frame[(y * width + x) * 4];
+                bool inSquare = (x >= sqX && x < sqX + side && y >= sqY && y < sqY + side);
+
+                px[0] = 255;
+                px[1] = inSquare ? 255 : (uint8_t)(x + n * 4);
+                px[2] = inSquare ? 32 : (uint8_t)(y + n * 2);
+                px[3] = inSquare ? 32 : (uint8_t)(x + y);
+            }
+        frames.push_back(frame);
+    }
+
+    return frames;
+}
+
+// simulcast ladder: full, half and quarter resolutions
+MediaStreamParams producerParams(unsigned int width, unsigned int height, unsigned int bitrate)
+{
+    MediaStreamParams msp("camera");
+    msp.type_ = MediaStreamParams::MediaStreamTypeVideo;
+    msp.producerParams_.freshness_ = {10, 15, 900};
+    msp.producerParams_.segmentSize_ = 1000;
+
+    const char *names[] = {"hi", "mid", "low"};
+    for (int i = 0; i < 3; ++i)
+    {
+        VideoThreadParams vtp(names[i], sampleVideoCoderParams());
+        vtp.coderParams_.encodeWidth_ = width >> i;
+        vtp.coderParams_.encodeHeight_ = height >> i;
+        vtp.coderParams_.startBitrate_ = bitrate >> (2 * i);
+        vtp.coderParams_.maxBitrate_ = bitrate >> (2 * i);
+        msp.addMediaThread(vtp);
+    }
+
+    return msp;
+}
+
+//******************************************************************************
+void runPipeline(const std::string &name, const std::vector<std::vector<uint8_t>> &source,
+                 unsigned int width, unsigned int height, const MediaStreamParams &msp,
+                 int nFrames)
+{
+    boost::shared_ptr<KeyChain> keyChain = memoryKeyChain("/ndn/edu/ucla/remap/peter/app");
+    TimedKeyChain timedKeyChain(keyChain.get());
+    StubContentCache cache;
+    boost::shared_ptr<StatisticsStorage> statStorage(StatisticsStorage::createProducerStatistics());
+    StubPublisherSettings ps;
+    ps.keyChain_ = &timedKeyChain;
+    ps.memoryCache_ = &cache;
+    ps.statStorage_ = statStorage.get();
+    ps.segmentWireLength_ = msp.producerParams_.segmentSize_;
+    ps.freshnessPeriodMs_ = msp.producerParams_.freshness_.sampleMs_;
+    StubPublisher publisher(ps);
+
+    RawFrameConverter conv;
+    std::vector<boost::shared_ptr<VideoThread>> threads;
+    std::vector<boost::shared_ptr<FrameScaler>> scalers;
+    for (int i = 0; i < msp.getThreadNum(); ++i)
+    {
+        const VideoCoderParams &vcp = msp.getVideoThread(i)->coderParams_;
+        threads.push_back(boost::make_shared<VideoThread>(vcp));
+        scalers.push_back(boost::make_shared<FrameScaler>(vcp.encodeWidth_, vcp.encodeHeight_));
+    }
+
+    double convertUs = 0, scaleUs = 0, encodeUs = 0, fecUs = 0, publishUs = 0;
+    int nEncoded = 0, nSegments = 0;
+    uint64_t allocStart = AllocNum;
+    double cpuStart = cpuTimeMs();
+    high_resolution_clock::time_point runStart = high_resolution_clock::now();
+
+    for (int n = 0; n < nFrames; ++n)
+    {
+        const std::vector<uint8_t> &data = source[n % source.size()];
+        ArgbRawFrameWrapper wr({width, height, const_cast<uint8_t *>(data.data()),
+                                (unsigned int)data.size(), true});
+
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+        WebRtcVideoFrame frame = conv << wr;
+        convertUs += elapsedUs(start);
+
+        for (size_t t = 0; t < threads.size(); ++t)
+        {
+            start = high_resolution_clock::now();
+            WebRtcVideoFrame scaled = (*scalers[t])(frame);
+            scaleUs += elapsedUs(start);
+
+            start = high_resolution_clock::now();
+            boost::shared_ptr<VideoFramePacket> fp = threads[t]->encode(scaled);
+            encodeUs += elapsedUs(start);
+
+            if (!fp)
+                continue;
+            nEncoded++;
+
+            CommonHeader hdr;
+            hdr.sampleRate_ = 30;
+            hdr.publishTimestampMs_ = clock::millisecondTimestamp();
+            hdr.publishUnixTimestamp_ = clock::unixTimestamp();
+            fp->setHeader(hdr);
+
+            start = high_resolution_clock::now();
+            boost::shared_ptr<NetworkData> parityData =
+                fp->getParityData(VideoFrameSegment::payloadLength(ps.segmentWireLength_), 0.2);
+            fecUs += elapsedUs(start);
+
+            Name dataName("/ndn/edu/ucla/remap/peter/app/ndnrtc/camera");
+            dataName.append(msp.getVideoThread(t)->threadName_).append("d").appendSequenceNumber(n);
+
+            VideoFrameSegmentHeader segmentHdr;
+            segmentHdr.totalSegmentsNum_ = VideoFrameSegment::numSlices(*fp, ps.segmentWireLength_);
+            segmentHdr.paritySegmentsNum_ = VideoFrameSegment::numSlices(*parityData, ps.segmentWireLength_);
+            segmentHdr.playbackNo_ = n;
+
+            start = high_resolution_clock::now();
+            nSegments += publisher.publish(dataName, *fp, segmentHdr, -1, true).size();
+            nSegments += publisher.publish(Name(dataName).append("_parity"), *parityData,
+                                           segmentHdr, -1, true).size();
+            publishUs += elapsedUs(start);
+        }
+    }
+
+    double runUs = elapsedUs(runStart);
+    double cpuMs = cpuTimeMs() - cpuStart;
+    double allocsPerFrame = (double)(AllocNum - allocStart) / nFrames;
+    // segmentation is what remains of publishing after signing and caching
+    double segmentUs = publishUs - timedKeyChain.signUs_ - cache.addUs_;
+
+    BenchmarkResult r;
+    r.name_ = "pipeline-" + name;
+    r.metrics_ = {{"frames", (double)nFrames},
+                  {"encoded", (double)nEncoded},
+                  {"segments", (double)nSegments},
+                  {"fps", nFrames / (runUs / 1000000.)},
+                  {"cpuMsPerFrame", cpuMs / nFrames},
+                  {"allocsPerFrame", allocsPerFrame},
+                  {"convertUs", convertUs / nFrames},
+                  {"scaleUs", scaleUs / nFrames},
+                  {"encodeUs", encodeUs / nFrames},
+                  {"fecUs", fecUs / nFrames},
+                  {"segmentUs", segmentUs / nFrames},
+                  {"signUs", timedKeyChain.signUs_ / nFrames},
+                  {"cacheUs", cache.addUs_ / nFrames}};
+    Results.push_back(r);
+
+    GT_PRINTF("%s: %.2f fps, %.1f allocs/frame, per frame (us): convert %.1f, scale %.1f, "
+              "encode %.1f, fec %.1f, segment %.1f, sign %.1f, cache %.1f\n",
+              r.name_.c_str(), nFrames / (runUs / 1000000.), allocsPerFrame,
+              convertUs / nFrames, scaleUs / nFrames, encodeUs / nFrames, fecUs / nFrames,
+              segmentUs / nFrames, timedKeyChain.signUs_ / nFrames, cache.addUs_ / nFrames);
+}
+
+void runStream(const std::string &name, const std::vector<std::vector<uint8_t>> &source,
+               unsigned int width, unsigned int height, const MediaStreamParams &msp,
+               int runTimeMs, double captureRate = 30)
+{
+    boost::asio::io_service faceIo;
+    boost::shared_ptr<boost::asio::io_service::work> work(boost::make_shared<boost::asio::io_service::work>(faceIo));
+    boost::thread faceThread([&faceIo]() { faceIo.run(); });
+
+    // face is never connected: segments stay in stream's content cache
+    Face face("localhost");
+    std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
+    boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
+    MediaStreamSettings settings(faceIo, msp);
+    settings.face_ = &face;
+    settings.keyChain_ = keyChain.get();
+
+    StatisticsStorage stat;
+    int nCaptured = 0;
+    double runUs = 0, cpuMs = 0;
+    uint64_t allocNum = 0;
+    {
+        LocalVideoStream stream(appPrefix, settings);
+        microseconds interval((int64_t)(1000000. / captureRate));
+        uint64_t allocStart = AllocNum;
+        double cpuStart = cpuTimeMs();
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+        high_resolution_clock::time_point next = start;
+
+        while (elapsedUs(start) < runTimeMs * 1000.)
+        {
+            const std::vector<uint8_t> &data = source[nCaptured % source.size()];
+            stream.incomingArgbFrame(width, height, const_cast<uint8_t *>(data.data()), data.size());
+            nCaptured++;
+            next += interval;
+            boost::this_thread::sleep_until(next);
+        }
+
+        // let encoders and publisher drain their queues
+        boost::this_thread::sleep_for(milliseconds(500));
+        runUs = elapsedUs(start);
+        cpuMs = cpuTimeMs() - cpuStart;
+        allocNum = AllocNum - allocStart;
+        stat = stream.getStatistics();
+    }
+
+    work.reset();
+    faceIo.stop();
+    faceThread.join();
+
+    double runSec = runUs / 1000000.;
+    BenchmarkResult r;
+    r.name_ = "stream-" + name;
+    r.metrics_ = {{"captured", (double)nCaptured},
+                  {"encoded", stat[Indicator::EncodedNum]},
+                  {"dropped", stat[Indicator::DroppedNum]},
+                  {"published", stat[Indicator::PublishedNum]},
+                  {"segments", stat[Indicator::PublishedSegmentsNum]},
+                  {"fps", stat[Indicator::PublishedNum] / runSec},
+                  {"publishDelayMs", stat[Indicator::PublishDelay]},
+                  {"cpuMsPerFrame", cpuMs / nCaptured},
+                  {"allocsPerFrame", (double)allocNum / nCaptured}};
+    Results.push_back(r);
+
+    GT_PRINTF("%s: captured %d, encoded %d, dropped %d, published %d (%.2f fps), "
+              "capture-to-publish %.2fms, cpu %.2fms/frame, %.1f allocs/frame\n",
+              r.name_.c_str(), nCaptured, (int)stat[Indicator::EncodedNum],
+              (int)stat[Indicator::DroppedNum], (int)stat[Indicator::PublishedNum],
+              stat[Indicator::PublishedNum] / runSec, stat[Indicator::PublishDelay],
+              cpuMs / nCaptured, (double)allocNum / nCaptured);
+}
+
+//******************************************************************************
+TEST(BenchmarkProducer, Source320x240)
+{
+    std::vector<std::vector<uint8_t>> frames =
+        loadArgbFrames(test_path + "/../res/test-source-320x240.argb", 320, 240, 300);
+
+    if (!frames.size())
+    {
+        GT_PRINTF("test-source-320x240.argb was not found, skipping\n");
+        return;
+    }
+
+    MediaStreamParams msp("camera");
+    msp.type_ = MediaStreamParams::MediaStreamTypeVideo;
+    msp.producerParams_.freshness_ = {10, 15, 900};
+    msp.producerParams_.segmentSize_ = 1000;
+    VideoThreadParams vtp("mid", sampleVideoCoderParams());
+    vtp.coderParams_.encodeWidth_ = 320;
+    vtp.coderParams_.encodeHeight_ = 240;
+    vtp.coderParams_.startBitrate_ = 500;
+    vtp.coderParams_.maxBitrate_ = 500;
+    msp.addMediaThread(vtp);
+
+    runPipeline("320x240", frames, 320, 240, msp, 300);
+    runStream("320x240", frames, 320, 240, msp, 5000);
+}
+
+TEST(BenchmarkProducer, Synthetic1280x720)
+{
+    std::vector<std::vector<uint8_t>> frames = syntheticArgbFrames(1280, 720, 30);
+    MediaStreamParams msp = producerParams(1280, 720, 1600);
+
+    runPipeline("1280x720", frames, 1280, 720, msp, 150);
+    runStream("1280x720", frames, 1280, 720, msp, 5000);
+}
+
+TEST(BenchmarkProducer, Synthetic1920x1080)
+{
+    std::vector<std::vector<uint8_t>> frames = syntheticArgbFrames(1920, 1080, 30);
+    MediaStreamParams msp = producerParams(1920, 1080, 3200);
+
+    runPipeline("1920x1080", frames, 1920, 1080, msp, 90);
+    runStream("1920x1080", frames, 1920, 1080, msp, 5000);
+}
+
+TEST(BenchmarkProducer, Synthetic3840x2160)
+{
+    std::vector<std::vector<uint8_t>> frames = syntheticArgbFrames(3840, 2160, 10);
+    MediaStreamParams msp = producerParams(3840, 2160, 12800);
+
+    runPipeline("3840x2160", frames, 3840, 2160, msp, 30);
+    runStream("3840x2160", frames, 3840, 2160, msp, 5000);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+
+    for (int i = 1; i < argc; ++i)
+        if (std::string(argv[i]).find("--json=") == 0)
+            json_path = std::string(argv[i]).substr(7);
+
+    test_path = std::string(argv[0]);
+    std::vector<std::string> comps;
+    boost::split(comps, test_path, boost::is_any_of("/"));
+
+    test_path = "";
+    for (int i = 0; i < comps.size() - 1; ++i)
+    {
+        test_path += comps[i];
+        if (i != comps.size() - 1)
+            test_path += "/";
+    }
+
+    int res = RUN_ALL_TESTS();
+
+    std::ofstream json(json_path);
+    writeJson(json);
+    writeJson(std::cout);
+
+    return res;
+}
@@ -133,6 +133,16 @@ extern "C" {
                                    const char* frameName, 
                                    BufferAlloc bufferAllocFunc,
                                    FrameFetched frameFetchedFunc);
+
+    // fetch nFrames frames (every stride-th frame), starting from startFrameName,
+    // from local storage of the local stream. frameFetchedFunc is called for 
+    // every fetched frame in order
+    void ndnrtc_FrameFetcher_fetchRange(ndnrtc::IStream *stream,
+                                        const char* startFrameName,
+                                        unsigned int nFrames,
+                                        unsigned int stride,
+                                        BufferAlloc bufferAllocFunc,
+                                        FrameFetched frameFetchedFunc);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,174 @@
+//
+// event-log.hpp
+//
+//  Created by Peter Gusev on 1 April 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#ifndef __event_log_hpp__
+#define __event_log_hpp__
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace ndnrtc
+{
+namespace eventlog
+{
+
+/**
+ * Components that write events.
+ */
+enum class Component : uint16_t
+{
+    PipelineControl = 1,
+    Pipeliner = 2,
+    SegmentController = 3,
+    Buffer = 4,
+    RtxController = 5
+};
+
+/**
+ * Event ids. Comments list meaning of event arguments, sample class is
+ * 0 for delta and 1 for key samples.
+ */
+enum class Event : uint16_t
+{
+    // (old state id, new state id, pipeline control event type, time spent in old state, ms)
+    StateTransition = 1,
+    // (sample class, sample number, interests number, deadline)
+    SampleRequested = 10,
+    // (sample class, sample number, interests number)
+    SegmentsRerequested = 11,
+    // (sample class, sample number, segment number, is parity, payload size)
+    SegmentArrived = 20,
+    // (sample class, sample number, segment number, is parity)
+    SegmentTimeout = 21,
+    // (sample class, sample number, segment number, is parity)
+    AppNack = 22,
+    // (sample class, sample number, segment number, is parity, nack reason)
+    NetworkNack = 23,
+    // (sample class, sample number, requested segments number, slots in use)
+    SlotRequested = 30,
+    // (sample class, sample number, fetched segments number, assembled level x1000, slot state)
+    SlotAssembling = 31,
+    // (sample class, sample number, fetched segments number, longest DRD, us)
+    SlotReady = 32,
+    // (sample class, sample number, pending interests number, time to playback, ms)
+    RtxRequired = 40
+};
+
+/**
+ * Event log record. Records are of fixed size and are written into log file
+ * as is (host byte order).
+ */
+typedef struct _EventRecord
+{
+    uint64_t seqNo_;       // 1-based record number, 0 for empty or incomplete record
+    int64_t timestampUs_;  // monotonic clock
+    uint16_t component_;
+    uint16_t event_;
+    uint32_t instance_;    // differentiates component instances
+    int64_t args_[5];
+} EventRecord;
+
+static_assert(sizeof(EventRecord) == 64, "event record must be 64 bytes");
+
+/**
+ * Event log file header.
+ */
+typedef struct _EventLogHeader
+{
+    char magic_[8];
+    uint32_t version_;
+    uint32_t recordSize_;
+    uint64_t capacity_;        // number of record slots following the header
+    uint64_t writePos_;        // number of records written so far
+    int64_t startUnixUs_;      // system clock when log was started
+    int64_t startTimestampUs_; // monotonic clock when log was started
+    uint8_t reserved_[16];
+} EventLogHeader;
+
+static_assert(sizeof(EventLogHeader) == 64, "event log header must be 64 bytes");
+
+/**
+ * Binary event log for post-mortem analysis of consumer pipeline.
+ * Log file is memory-mapped and is used as a ring of fixed-size records:
+ * writers claim next slot with an atomic increment and fill it in place, so
+ * writing an event takes no locks, system calls or memory allocations and
+ * records survive application crash. Once the ring wraps around, oldest
+ * records are overwritten.
+ * Only one event log can be active in a process. When it is not active,
+ * writing an event costs one branch.
+ * Use tools/event-log-decoder to convert log into CSV or JSON.
+ */
+class EventLog
+{
+  public:
+    static const size_t DefaultCapacity = 1 << 20; // 64MB file
+
+    /**
+     * Creates (truncates) log file and makes it the active event log.
+     * Throws std::runtime_error if file can't be created or mapped, or if
+     * another event log is active (it has to be stopped first).
+     */
+    static void start(const std::string &path, size_t capacity = DefaultCapacity);
+
+    /**
+     * Deactivates and closes active event log. Components must not write
+     * events while log is being stopped (i.e. stop streams first).
+     */
+    static void stop();
+
+    static EventLog *get() { return current_.load(std::memory_order_acquire); }
+
+    void write(Component component, Event event, const void *instance,
+               int64_t a0, int64_t a1, int64_t a2, int64_t a3, int64_t a4);
+
+    uint64_t getWrittenNum() const;
+    const std::string &getPath() const { return path_; }
+
+    /**
+     * Reads complete records of event log file ordered by their sequence
+     * numbers. Throws std::runtime_error if file is not an event log or is
+     * shorter than its' header says.
+     */
+    static void read(const std::string &path, EventLogHeader &header,
+                     std::vector<EventRecord> &records);
+
+    static const char *toString(Component component);
+    static const char *toString(Event event);
+
+  private:
+    EventLog(const std::string &path, size_t capacity);
+    ~EventLog();
+    EventLog(const EventLog &) = delete;
+
+    static std::atomic<EventLog *> current_;
+
+    std::string path_;
+    int fd_;
+    size_t mappedSize_;
+    EventLogHeader *header_;
+    EventRecord *records_;
+    uint64_t mask_;
+};
+
+/**
+ * Writes event into active event log, if any.
+ */
+inline void write(Component component, Event event, const void *instance,
+                  int64_t a0 = 0, int64_t a1 = 0, int64_t a2 = 0,
+                  int64_t a3 = 0, int64_t a4 = 0)
+{
+    EventLog *log = EventLog::get();
+    if (log)
+        log->write(component, event, instance, a0, a1, a2, a3, a4);
+}
+
+} // namespace eventlog
+} // namespace ndnrtc
+
+#endif
@@ -29,6 +29,7 @@ namespace ndnrtc {
     class SlotSegment;
     class FrameFetchingTask;
     class IFetchMethod;
+    class DecodedFrameCache;
 
     class FrameFetcherImpl;
     class IFrameFetcher;
@@ -47,7 +48,12 @@ namespace ndnrtc {
                            OnBufferAllocate onBufferAllocate,
                            OnFrameFetched onFrameFetched,
                            OnFetchFailure onFetchFailure) = 0;
-        virtual const ndn::Name& getName() const = 0;
+        virtual void fetchRange(const ndn::Name& startFrameName,
+                                unsigned int nFrames, unsigned int stride,
+                                OnBufferAllocate onBufferAllocate,
+                                OnFrameFetched onFrameFetched,
+                                OnFetchFailure onFetchFailure) = 0;
+        virtual ndn::Name getName() const = 0;
         virtual ~IFrameFetcher(){}
     };
 
@@ -65,6 +71,16 @@ namespace ndnrtc {
      * frames and 1 key frame must be fetched before decoding of #20 can be 
      * started.
      * If requested frame is a Key frame, no additional frames will be fetched.
+     * Before the first frame of a thread is decoded, fetcher fetches thread
+     * meta in order to set up decoder for thread's codec.
+     * Decoded frames and decoder state of recently decoded GOPs are kept in a
+     * cache. If requested frame is in the cache, it is returned without any
+     * fetching; if the GOP's decoder has not yet passed requested frame, 
+     * only frames that haven't been decoded yet are fetched and decoded. 
+     * Several frame fetchers may share one cache (see createCache()).
+     * A range of frames can be fetched with one call (see fetchRange()) -- 
+     * in this case, frames of the whole range are fetched in a pipelined 
+     * fashion and every GOP is decoded only once.
      */
     class FrameFetcher : public IFrameFetcher,
                          public ndnlog::new_api::ILoggingObject {
@@ -79,14 +95,27 @@ namespace ndnrtc {
 
         /**
          * Fetches frames from local persistent storage.
+         * @param cache Decoded frames cache. If omitted, fetcher creates its' own.
          */
-        FrameFetcher(const boost::shared_ptr<StorageEngine>& storage);
+        FrameFetcher(const boost::shared_ptr<StorageEngine>& storage,
+                     const boost::shared_ptr<DecodedFrameCache>& cache = 
+                        boost::shared_ptr<DecodedFrameCache>());
 
         /**
          * Fetches frames by expressing interests on the provided face object.
+         * @param cache Decoded frames cache. If omitted, fetcher creates its' own.
          */ 
         FrameFetcher(const boost::shared_ptr<ndn::Face>&, 
-                     const boost::shared_ptr<ndn::KeyChain>&);
+                     const boost::shared_ptr<ndn::KeyChain>&,
+                     const boost::shared_ptr<DecodedFrameCache>& cache = 
+                        boost::shared_ptr<DecodedFrameCache>());
+
+        /**
+         * Creates decoded frames cache which can be shared between several 
+         * frame fetchers.
+         * @param capacity Maximum number of decoded frames to keep.
+         */
+        static boost::shared_ptr<DecodedFrameCache> createCache(size_t capacity = 300);
         ~FrameFetcher(){}
 
         /**
@@ -106,10 +135,50 @@ namespace ndnrtc {
                    OnFrameFetched onFrameFetched,
                    OnFetchFailure onFetchFailure);
 
+        /**
+         * Fetches range of frames of one thread, starting from the given frame.
+         * Frames are of the same type as the start frame (i.e. either Key or 
+         * Delta frames) and are taken every stride sequence numbers. 
+         * Fetching is pipelined: frames of the whole range (including all 
+         * preceding frames needed for decoding) are fetched in parallel, but 
+         * no more than in-flight budget frames at a time (see 
+         * setInFlightBudget()). Frames are decoded in order, each GOP only 
+         * once, and returned through onFrameFetched callback in order as 
+         * soon as they are decoded. Fetching of the range stops on the first
+         * failure, which is reported through onFetchFailure callback.
+         * @param startFrameName The name of the first frame of the range
+         * @param nFrames Number of frames to fetch
+         * @param stride Difference in sequence numbers of two subsequent 
+         *  frames of the range
+         */
+        void fetchRange(const ndn::Name& startFrameName,
+                        unsigned int nFrames, unsigned int stride,
+                        OnBufferAllocate onBufferAllocate,
+                        OnFrameFetched onFrameFetched,
+                        OnFetchFailure onFetchFailure);
+
+        /**
+         * Fetches range of frames from startFrameName up to (and including, if
+         * it falls on stride) endFrameName. Both frames must belong to the same
+         * thread and be of the same type.
+         * @see fetchRange(const ndn::Name&, unsigned int, unsigned int, ...)
+         */
+        void fetchRange(const ndn::Name& startFrameName,
+                        const ndn::Name& endFrameName, unsigned int stride,
+                        OnBufferAllocate onBufferAllocate,
+                        OnFrameFetched onFrameFetched,
+                        OnFetchFailure onFetchFailure);
+
+        /**
+         * Sets maximum number of frames that can be fetched simultaneously 
+         * while fetching a range of frames. Default is 30.
+         */
+        void setInFlightBudget(unsigned int budget);
+
         /**
          * Returns name of a frame that is currently being fetched.
          */
-        const ndn::Name& getName() const;
+        ndn::Name getName() const;
 
         /**
          * Returns current state of the frame fetching process. 
@@ -34,18 +34,28 @@ namespace ndnrtc
      * can copy RGB frame data. Once this data is copied, library makes
      * renderRGBFrame call and passes the same buffer with additional parameters
      * so the renderer can perform rendering operations.
+     * Renderers that can consume YUV data directly may request kI420 buffer
+     * type in getFrameBuffer call. In this case, library does not perform any
+     * conversion or copying and passes decoded frame planes to renderI420Frame
+     * call instead.
      */
     class IExternalRenderer
     {
     public:
-        enum BufferType { kARGB, kBGRA };
+        // kARGB and kBGRA: frame is converted into the buffer returned by
+        // getFrameBuffer and passed to renderFrame; null buffer skips frame
+        // kI420: returned buffer is ignored (may be null), decoded planes are
+        // passed to renderI420Frame; renderFrame is not called
+        enum BufferType { kARGB, kBGRA, kI420 };
 
         /**
          * Should return allocated buffer big enough to store RGB frame data
-         * (width*height*3) bytes.
+         * (width*height*4) bytes.
          * @param width Width of the frame (NOTE: width can change during run)
          * @param height Height of the frame (NOTE: height can change during run)
-         * @return Allocated buffer where library can copy RGB frame data
+         * @return Allocated buffer where library can copy RGB frame data or
+         * null, if renderer wants to skip this frame. If bufferType is set to
+         * kI420, returned buffer is not used and frame is never skipped
          * @param bufferType desired data format of the decoded frame
          */
         virtual uint8_t* getFrameBuffer(int width, int height, BufferType *bufferType) = 0;
@@ -63,6 +73,21 @@ namespace ndnrtc
          */
         virtual void renderFrame(const FrameInfo& frameInfo, int width, int height,
                                  const uint8_t* buffer) = 0;
+
+        /**
+         * This method is called instead of renderFrame for renderers that
+         * requested kI420 buffer type in getFrameBuffer call.
+         * Planes point directly into decoder's frame buffer and are valid only
+         * for the duration of this call.
+         * @param frameInfo Frame's info
+         * @param width Frame's width (NOTE: width can change during run)
+         * @param height Frame's height (NOTE: height can change during run)
+         * @param planes Pointers to Y, U and V planes
+         * @param strides Strides of Y, U and V planes
+         * @see getFrameBuffer
+         */
+        virtual void renderI420Frame(const FrameInfo& frameInfo, int width, int height,
+                                     const uint8_t* const planes[3], const int strides[3]) {}
     };
 
     /**
@@ -13,6 +13,7 @@
 #include "stream.hpp"
 
 #include <boost/asio.hpp>
+#include <boost/function.hpp>
 
 namespace ndn {
 	class KeyChain;
@@ -27,6 +28,24 @@ namespace ndnlog {
 }
 
 namespace ndnrtc {
+	/**
+	 * Defines what happens to encoded frames, when they are encoded faster
+	 * than they can be published (publish queue is full).
+	 */
+	enum class PublishQueuePolicy {
+		// oldest queued delta frame is dropped (oldest key frame if there
+		// are no deltas)
+		DropOldestDelta,
+		// oldest queued delta frame is dropped; key frames are never dropped
+		// and may temporarily overflow the queue
+		NeverDropKey,
+		// encoded frames are never dropped; instead, frames captured while
+		// the queue is full are coalesced: only the latest one is held (and
+		// incoming*Frame returns -1 for it), superseded ones are dropped;
+		// held frame is encoded as soon as a queued frame is published
+		Coalesce
+	};
+
 	/**
 	 * Media stream settings class unites objects, required for media streams
 	 * creation and operation
@@ -35,7 +54,10 @@ namespace ndnrtc {
 	{
 	public:
         MediaStreamSettings(boost::asio::io_service& faceIo,
-			const MediaStreamParams& params):sign_(true), faceIo_(faceIo), params_(params){}
+			const MediaStreamParams& params):sign_(true), faceIo_(faceIo), params_(params),
+            encoderQueueSize_(2), pinEncoderThreads_(false), publishQueueSize_(8),
+            publishQueuePolicy_(PublishQueuePolicy::DropOldestDelta),
+            paceFrames_(false){}
 		~MediaStreamSettings(){}
 
         bool sign_;
@@ -44,6 +66,22 @@ namespace ndnrtc {
 		ndn::Face* face_;
 		MediaStreamParams params_;
         std::string storagePath_; // do not use storage if this string is empty
+        // video threads are encoded on dedicated threads, each having a queue
+        // of captured frames of this size; oldest frames are dropped when
+        // encoder can not keep up with capture rate
+        size_t encoderQueueSize_;
+        // pin encoder threads to CPU cores (Linux only)
+        bool pinEncoderThreads_;
+        // encoded frames of all video threads wait to be published on face
+        // thread in a queue of this size
+        size_t publishQueueSize_;
+        PublishQueuePolicy publishQueuePolicy_;
+        // retime captured frames to the highest frame rate among video
+        // threads: frames captured in bursts are dropped, missing frames are
+        // duplicated; incomingFrame then returns playback number of the
+        // latest paced frame. published frames carry capture time of the
+        // pacer's tick
+        bool paceFrames_;
 	};
 
 	class VideoStreamImpl;
@@ -167,6 +205,29 @@ namespace ndnrtc {
 		 */
 		void removeThread(const std::string& threadName);
 
+		/**
+		 * Retargets video thread's bitrate and frame rate. Encoder is not
+		 * re-created: new rate applies to the next encoded frame, sequence
+		 * numbers continue and thread meta version is bumped.
+		 * @param threadName Thread name
+		 * @param bitrateKbps New target bitrate (raises max bitrate, if needed)
+		 * @param frameRate New encoding frame rate
+		 */
+		void setThreadRate(const std::string& threadName, 
+			unsigned int bitrateKbps, double frameRate);
+
+		/**
+		 * Changes video thread's encoding resolution. Thread switches to new
+		 * resolution at its' next key frame (start of the next GOP);
+		 * sequence numbers continue. Thread meta advertises new resolution
+		 * (and its' version is bumped) once this key frame is published.
+		 * @param threadName Thread name
+		 * @param width New encoding width
+		 * @param height New encoding height
+		 */
+		void setThreadResolution(const std::string& threadName, 
+			unsigned int width, unsigned int height);
+
 		/**
 		 * Encode and publish ARGB frame data.
 		 * This initiates encoding of raw frames for each video thread and
@@ -209,6 +270,24 @@ namespace ndnrtc {
 			const unsigned char* uBuffer,
 			const unsigned char* vBuffer) override;
 
+		/**
+		 * Encode and publish I420 frame data without copying it.
+		 * Frame planes are passed to scalers and encoders as is, thus caller
+		 * must keep them intact until onFrameReleased is called. Callback
+		 * is called once all video threads have finished with the frame
+		 * (usually, on one of the encoding threads) or immediately, if the
+		 * frame was not accepted for encoding.
+		 */
+		int incomingI420Frame(const unsigned int width,
+			const unsigned int height,
+			const unsigned int strideY,
+			const unsigned int strideU,
+			const unsigned int strideV,
+			const unsigned char* yBuffer,
+			const unsigned char* uBuffer,
+			const unsigned char* vBuffer,
+			boost::function<void()> onFrameReleased);
+
 		/**
 		 * Encode and publish NV21 frame data.
 		 * This initiates encoding of raw frames for each video thread and
@@ -259,6 +338,15 @@ namespace ndnrtc {
          */
         boost::shared_ptr<StorageEngine> getStorage() const;
 
+        /**
+         * Sets number of CPU cores shared by encoders of all local video
+         * streams. Cores are divided among video threads proportionally to
+         * their pixel rate (width x height x fps).
+         * @param nCores Core budget; 0 means all hardware cores (default)
+         */
+        static void setEncoderCoreBudget(unsigned int nCores);
+        static unsigned int getEncoderCoreBudget();
+
 	private:
 		LocalVideoStream(const LocalVideoStream&) = delete;
 		LocalVideoStream(LocalVideoStream&&) = delete;
@@ -120,13 +120,16 @@ namespace ndnrtc
     class AudioThreadParams : public MediaThreadParams {
     public:
         AudioThreadParams():MediaThreadParams("", FrameSegmentsInfo(1., 0., 0., 0.)),
-        codec_("g722"){}
+        codec_("g722"), maxBundleDelayMs_(60){}
         AudioThreadParams(std::string threadName):MediaThreadParams(threadName, FrameSegmentsInfo(1., 0., 0., 0.)),
-        codec_("g722"){}
+        codec_("g722"), maxBundleDelayMs_(60){}
         AudioThreadParams(std::string threadName, std::string codec):MediaThreadParams(threadName, FrameSegmentsInfo(1., 0., 0., 0.)),
-        codec_(codec){}
+        codec_(codec), maxBundleDelayMs_(60){}
         
         std::string codec_; // "g722" (SD) or "opus" (HD)
+        // bundle is published once it's full or once its first sample
+        // waited for this long; 0 - bundles are published only when full
+        unsigned int maxBundleDelayMs_;
         
         MediaThreadParams*
         copy() const
@@ -151,9 +154,11 @@ namespace ndnrtc
         unsigned int startBitrate_, maxBitrate_;
         unsigned int encodeWidth_, encodeHeight_;
         bool dropFramesOn_;
+        std::string codec_; // "vp8", "vp9" or "h264" (see VideoCodecFactory)
         
         VideoCoderParams():codecFrameRate_(30),gop_(30),startBitrate_(1000),
-        maxBitrate_(5000),encodeWidth_(1280),encodeHeight_(720),dropFramesOn_(false){}
+        maxBitrate_(5000),encodeWidth_(1280),encodeHeight_(720),dropFramesOn_(false),
+        codec_("vp9"){}
         
         void write(std::ostream& os) const
         {
@@ -163,7 +168,7 @@ namespace ndnrtc
             << startBitrate_ << " Kbit/s; Max bitrate: "
             << maxBitrate_ << " Kbit/s; "
             << encodeWidth_ << "x" << encodeHeight_ << "; Drop: "
-            << (dropFramesOn_?"YES":"NO");
+            << (dropFramesOn_?"YES":"NO") << "; Codec: " << codec_;
         }
         
         bool operator==(const VideoCoderParams& rhs) const
@@ -174,7 +179,8 @@ namespace ndnrtc
             this->maxBitrate_ == rhs.maxBitrate_ &&
             this->encodeWidth_ == rhs.encodeWidth_ &&
             this->encodeHeight_ == rhs.encodeHeight_ &&
-            this->dropFramesOn_ == rhs.dropFramesOn_;
+            this->dropFramesOn_ == rhs.dropFramesOn_ &&
+            this->codec_ == rhs.codec_;
         }
         
         bool operator!=(const VideoCoderParams& rhs) const
@@ -14,12 +14,13 @@
 
 #include <boost/asio.hpp>
 #include <boost/asio/steady_timer.hpp>
-#include <boost/lockfree/spsc_queue.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
+#include <atomic>
 #include <iostream>
+#include <streambuf>
 #include <string>
 #include <map>
 #include <fstream>
@@ -37,67 +38,74 @@
 // following macros are used for NdnRtcObject logging
 // each macro checks, whether a logger, associated with object has been
 // initialized and use it instead of global logger
+// log level is checked before log record is started, so records of disabled
+// levels cost one branch and their "<<" arguments are not evaluated
+#define NDNLOG_RECORD(isEnabled, logRecord) !(isEnabled) ? (void)0 : ndnlog::new_api::LogRecordVoidify() & logRecord
+#define NDNLOG_ENABLED(fname, lvl) ndnlog::new_api::Logger::getLogger(fname).isEnabled((ndnlog::NdnLogType)lvl)
+#define NDNLOG_ENABLED_C(lvl) (this->logger_ && this->logger_->isEnabled((ndnlog::NdnLogType)lvl))
+#define NDNLOG_DISABLED NDNLOG_RECORD(false, ndnlog::new_api::NilLogger::get())
+
 #if defined (NDN_TRACE)
 
-#define LogTrace(fname, ...) ndnlog::new_api::Logger::log(fname, (ndnlog::NdnLogType)ndnlog::NdnLoggerLevelTrace, __FUNCTION__, __LINE__, ##__VA_ARGS__)
-#define LogTraceC ((this->logger_) ? this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelTrace, this, __FUNCTION__, __LINE__) : ndnlog::new_api::NilLogger::get())
+#define LogTrace(fname, ...) NDNLOG_RECORD(NDNLOG_ENABLED(fname, ndnlog::NdnLoggerLevelTrace), ndnlog::new_api::Logger::log(fname, (ndnlog::NdnLogType)ndnlog::NdnLoggerLevelTrace, __FUNCTION__, __LINE__, ##__VA_ARGS__))
+#define LogTraceC NDNLOG_RECORD(NDNLOG_ENABLED_C(ndnlog::NdnLoggerLevelTrace), this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelTrace, this, __FUNCTION__, __LINE__))
 
 #else
 
-#define LogTrace(fname, ...) ndnlog::new_api::NilLogger::get()
-#define LogTraceC ndnlog::new_api::NilLogger::get()
+#define LogTrace(fname, ...) NDNLOG_DISABLED
+#define LogTraceC NDNLOG_DISABLED
 
 #endif
 
 #if defined (NDN_DEBUG)
 
-#define LogDebug(fname, ...) ndnlog::new_api::Logger::log(fname, ndnlog::NdnLoggerLevelDebug, __FILE__, __LINE__, ##__VA_ARGS__)
-#define LogDebugC ((this->logger_) ? this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelDebug, this, __FUNCTION__, __LINE__) : ndnlog::new_api::NilLogger::get())
+#define LogDebug(fname, ...) NDNLOG_RECORD(NDNLOG_ENABLED(fname, ndnlog::NdnLoggerLevelDebug), ndnlog::new_api::Logger::log(fname, ndnlog::NdnLoggerLevelDebug, __FILE__, __LINE__, ##__VA_ARGS__))
+#define LogDebugC NDNLOG_RECORD(NDNLOG_ENABLED_C(ndnlog::NdnLoggerLevelDebug), this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelDebug, this, __FUNCTION__, __LINE__))
 #else
 
-#define LogDebug(fmt, ...) ndnlog::new_api::NilLogger::get()
-#define LogDebugC ndnlog::new_api::NilLogger::get()
+#define LogDebug(fmt, ...) NDNLOG_DISABLED
+#define LogDebugC NDNLOG_DISABLED
 
 #endif
 
 #if defined (NDN_INFO)
 
-#define LogInfo(fname, ...) ndnlog::new_api::Logger::log(fname, ndnlog::NdnLoggerLevelInfo, __FILE__, __LINE__, ##__VA_ARGS__)
-#define LogInfoC ((this->logger_) ? this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelInfo, this, __FUNCTION__, __LINE__) : ndnlog::new_api::NilLogger::get())
+#define LogInfo(fname, ...) NDNLOG_RECORD(NDNLOG_ENABLED(fname, ndnlog::NdnLoggerLevelInfo), ndnlog::new_api::Logger::log(fname, ndnlog::NdnLoggerLevelInfo, __FILE__, __LINE__, ##__VA_ARGS__))
+#define LogInfoC NDNLOG_RECORD(NDNLOG_ENABLED_C(ndnlog::NdnLoggerLevelInfo), this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelInfo, this, __FUNCTION__, __LINE__))
 
 #else
 
-#define LogInfo(fname, ...) ndnlog::new_api::NilLogger::get()
-#define LogInfoC ndnlog::new_api::NilLogger::get()
+#define LogInfo(fname, ...) NDNLOG_DISABLED
+#define LogInfoC NDNLOG_DISABLED
 
 #endif
 
 #if defined (NDN_WARN)
 
-#define LogWarn(fname, ...) ndnlog::new_api::Logger::log(fname, ndnlog::NdnLoggerLevelWarning   , __FILE__, __LINE__, ##__VA_ARGS__)
-#define LogWarnC ((this->logger_) ? this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelWarning, this, __FUNCTION__, __LINE__) : ndnlog::new_api::NilLogger::get())
+#define LogWarn(fname, ...) NDNLOG_RECORD(NDNLOG_ENABLED(fname, ndnlog::NdnLoggerLevelWarning), ndnlog::new_api::Logger::log(fname, ndnlog::NdnLoggerLevelWarning, __FILE__, __LINE__, ##__VA_ARGS__))
+#define LogWarnC NDNLOG_RECORD(NDNLOG_ENABLED_C(ndnlog::NdnLoggerLevelWarning), this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelWarning, this, __FUNCTION__, __LINE__))
 
 #else
 
-#define LogWarn(fname, ...) ndnlog::new_api::NilLogger::get()
-#define LogWarnC ndnlog::new_api::NilLogger::get()
+#define LogWarn(fname, ...) NDNLOG_DISABLED
+#define LogWarnC NDNLOG_DISABLED
 
 #endif
 
 #if defined (NDN_ERROR)
 
-#define LogError(fname, ...) ndnlog::new_api::Logger::log(fname, ndnlog::NdnLoggerLevelError, __FILE__, __LINE__, ##__VA_ARGS__)
-#define LogErrorC ((this->logger_) ? this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelError, this, __FUNCTION__, __LINE__) : ndnlog::new_api::NilLogger::get())
+#define LogError(fname, ...) NDNLOG_RECORD(NDNLOG_ENABLED(fname, ndnlog::NdnLoggerLevelError), ndnlog::new_api::Logger::log(fname, ndnlog::NdnLoggerLevelError, __FILE__, __LINE__, ##__VA_ARGS__))
+#define LogErrorC NDNLOG_RECORD(NDNLOG_ENABLED_C(ndnlog::NdnLoggerLevelError), this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelError, this, __FUNCTION__, __LINE__))
 
 #else
 
-#define LogError(fname, ...) ndnlog::new_api::NilLogger::get()
-#define LogErrorC ndnlog::new_api::NilLogger::get()
+#define LogError(fname, ...) NDNLOG_DISABLED
+#define LogErrorC NDNLOG_DISABLED
 
 #endif
 
-#define LogStat(fname, ...) ndnlog::new_api::Logger::log(fname, (NdnLogType)NdnLoggerLevelStat, __FUNCTION__, __LINE__, ##__VA_ARGS__)
-#define LogStatC ((this->logger_) ? this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelStat, this, __FUNCTION__, __LINE__) : ndnlog::new_api::NilLogger::get())
+#define LogStat(fname, ...) NDNLOG_RECORD(NDNLOG_ENABLED(fname, NdnLoggerLevelStat), ndnlog::new_api::Logger::log(fname, (NdnLogType)NdnLoggerLevelStat, __FUNCTION__, __LINE__, ##__VA_ARGS__))
+#define LogStatC NDNLOG_RECORD(NDNLOG_ENABLED_C(ndnlog::NdnLoggerLevelStat), this->logger_->log((ndnlog::NdnLogType)ndnlog::NdnLoggerLevelStat, this, __FUNCTION__, __LINE__))
 
 #define STAT_DIV "\t"
 
@@ -111,6 +119,7 @@ namespace ndnlog {
     namespace new_api
     {
         class ILoggingObject;
+        class Logger;
         class NilLogger;
         class DefaultSink;
         class CallbackSink;
@@ -169,6 +178,83 @@ namespace ndnlog {
             }
         };
 
+        /**
+         * Bounded lock-free multiple producers - single consumer queue of log
+         * records. Records are swapped in and out of preallocated slots, so
+         * once string buffers have grown, queueing does not allocate memory.
+         */
+        class LogRecordQueue
+        {
+        public:
+            LogRecordQueue(size_t capacity);
+            ~LogRecordQueue();
+
+            /**
+             * Moves record into the queue. On success, record receives a
+             * cleared buffer that can be reused for the next record.
+             * @return false if queue is full
+             */
+            bool push(std::string& record);
+
+            /**
+             * Moves oldest record out of the queue. Must be called from one
+             * thread only.
+             * @return false if queue is empty
+             */
+            bool pop(std::string& record);
+
+        private:
+            LogRecordQueue(const LogRecordQueue&) = delete;
+
+            struct Slot {
+                std::atomic<size_t> seq_;
+                std::string record_;
+            };
+
+            Slot* slots_;
+            size_t mask_;
+            std::atomic<size_t> enqueuePos_;
+            // keeps producers and consumer positions on separate cache lines
+            char padding_[64];
+            size_t dequeuePos_;
+        };
+
+        /**
+         * Log record that is being composed on current thread. Records are
+         * formatted into thread's own buffer, without taking any locks.
+         */
+        class LogRecordBuffer : public std::streambuf
+        {
+        public:
+            LogRecordBuffer():logger_(nullptr), stream_(this) {}
+
+            std::string&
+            record() { return record_; }
+
+            std::ostream&
+            stream() { return stream_; }
+
+            const Logger* logger_; // logger which started record, if any
+
+        protected:
+            int_type overflow(int_type c)
+            {
+                if (c != traits_type::eof())
+                    record_.push_back((char)c);
+                return c;
+            }
+
+            std::streamsize xsputn(const char* s, std::streamsize n)
+            {
+                record_.append(s, (size_t)n);
+                return n;
+            }
+
+        private:
+            std::string record_;
+            std::ostream stream_;
+        };
+
         /**
          * Logger object. Performs thread-safe logging into a file or standard 
          * output.
@@ -182,6 +268,8 @@ namespace ndnlog {
             // interval at which logger is flushing data on disk (if file logging
             // was chosen)
             static unsigned int FlushIntervalMs;
+            // size of the records queue, records are dropped when it is full
+            static const size_t QueueCapacity = 1024;
             
             /**
              * Creates an instance of logger with specified logging level and 
@@ -204,13 +292,13 @@ namespace ndnlog {
             
             /**
              * Starts new logging entry with the header. Logging entry
-             * can be completed with the "endl" function or by another new call
-             * to this method (i.e. calling "<<" will append to the existing
-             * logging entry initiated by the last "log" call).
+             * can be completed with the "endl" function. Entry is composed
+             * in current thread's buffer and is queued for writing once
+             * completed.
              * @param logType Current logging type
              * @param loggingInstance Pointer to the instance of ILoggingObject
              * interface which performs logging
-             * @param locationFile Name of the source file from which logging is
+             * @param locationFunc Name of the function from which logging is
              * performed
              * @param locationLine Line number from the source file from which
              * logging is performed
@@ -219,26 +307,20 @@ namespace ndnlog {
             virtual Logger&
             log(const NdnLogType& logType,
                 const ILoggingObject* loggingInstance = 0,
-                const std::string& locationFunc = "",
+                const char* locationFunc = "",
                 const int& locationLine = -1);
             
             /**
              * Stream operator << implementation
-             * Any consequent call appends data to the previously created log 
-             * entry. Specific log entry can be created using "log" call,
-             * otherwise - if no previous log call was made, calling this 
-             * operator creates a new deafult log entry with INFO log level and 
-             * with no logging instance (set to nullptr) which results in poor 
-             * undetailed logging. However can be usfeul for system-wide logging.
+             * Any consequent call appends data to the log entry, previously
+             * started by "log" call on the same thread. If no entry was
+             * started, data is ignored.
              */
             template<typename T>
             Logger& operator<< (const T& data)
             {
-                if (isWritingLogEntry_ &&
-                    currentEntryLogType_ >= (NdnLogType)logLevel_)
-                {
-                    currentLogRecord_ << data;
-                }
+                if (currentRecord_ && currentRecord_->logger_ == this)
+                    currentRecord_->stream() << data;
                 
                 return *this;
             }
@@ -250,20 +332,20 @@ namespace ndnlog {
             virtual
             Logger& operator<< (endl_type endl)
             {
-                if (isWritingLogEntry_ &&
-                    currentEntryLogType_ >= (NdnLogType)logLevel_)
+                if (currentRecord_ && currentRecord_->logger_ == this)
                 {
-                    isWritingLogEntry_ = false;
-                    currentEntryLogType_ = NdnLoggerLevelTrace;
-                    
-                    currentLogRecord_ << endl;
-                    finalizeLogRecord();
-                    sink_->unlock();
+                    currentRecord_->logger_ = nullptr;
+                    currentRecord_->stream() << endl;
+                    finalizeLogRecord(currentRecord_->record());
                 }
                 
                 return *this;
             }
             
+            bool
+            isEnabled(const NdnLogType& logType) const
+            { return logType >= (NdnLogType)logLevel_; }
+            
             void
             setLogLevel(const NdnLoggerDetailLevel& logLevel)
             { logLevel_ = logLevel; }
@@ -289,7 +371,7 @@ namespace ndnlog {
             
             static Logger& log(const std::string &logFile,
                                const NdnLogType& logType,
-                               const std::string& locationFunc = "",
+                               const char* locationFunc = "",
                                const int& locationLine = -1,
                                const ILoggingObject* loggingInstance = 0)
             {
@@ -323,31 +405,29 @@ namespace ndnlog {
             boost::shared_ptr<ILogRecordSink> sink_;
             int64_t lastFlushTimestampMs_;
             
-            bool isWritingLogEntry_;
-            NdnLogType currentEntryLogType_;
-            pthread_t current_;
-            
             static std::map<std::string, boost::shared_ptr<Logger>> loggers_;
             static Logger* sharedInstance_;
+            static thread_local LogRecordBuffer* currentRecord_;
             
             std::atomic<bool> isProcessing_;
-            std::stringstream currentLogRecord_;
-            typedef boost::lockfree::spsc_queue<std::string, boost::lockfree::capacity<1024>> LogRecordQueue;
+            std::atomic<bool> isDrainScheduled_;
+            std::atomic<unsigned int> droppedRecordsNum_;
             LogRecordQueue recordsQueue_;
             
             void
             processLogRecords();
             
             void
-            startLogRecord();
-            
-            void
-            finalizeLogRecord();
+            finalizeLogRecord(std::string& record);
             
             int64_t
             getMillisecondTimestamp();
-            
-            // int i = 0;
+        };
+        
+        // turns log record expression into void, used by logging macros
+        struct LogRecordVoidify
+        {
+            void operator&(const Logger&) {}
         };
         
         /**
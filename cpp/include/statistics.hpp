@@ -100,6 +100,12 @@ namespace ndnrtc {
                 PublishedKeyNum,
                 InterestsReceivedNum,
                 SignNum,
+                PublishDelay,                   // VideoStreamImpl
+                PublishQueueSize,               // VideoStreamImpl
+                PublishLag,                     // VideoStreamImpl
+                PublishDroppedNum,              // VideoStreamImpl
+                PacerDroppedNum,                // VideoStreamImpl
+                PacerDuplicatedNum,             // VideoStreamImpl
                 
                 // encoder
                 // DroppedNum, // borrowed from buffer (above)
@@ -8,6 +8,7 @@
 #ifndef __storage_engine_hpp__
 #define __storage_engine_hpp__
 
+#include <vector>
 #include <boost/shared_ptr.hpp>
 #include <boost/asio.hpp>
 #include <boost/function.hpp>
@@ -21,12 +22,23 @@ namespace ndn {
 namespace ndnrtc {
     class StorageEngineImpl;
 
+    typedef boost::function<void(const uint8_t* wire, size_t wireLength)> OnWire;
+
     /**
      * This is a wrapper for the persistent key-value storage of data packets.  
      */
     class StorageEngine {
     public:
-        StorageEngine(std::string dpPath, bool readOnly = false);
+        enum Backend {
+            // RocksDB (LevelDB on Android) key-value storage
+            KeyValueBackend,
+            // append-only memory-mapped log of data packets; better suited 
+            // for write-once workloads, like stream recording and replay
+            SegmentLogBackend
+        };
+
+        StorageEngine(std::string dpPath, bool readOnly = false, 
+                      Backend backend = KeyValueBackend);
         ~StorageEngine();
 
         /**
@@ -37,6 +49,15 @@ namespace ndnrtc {
         void put(const boost::shared_ptr<const ndn::Data>& data);
         void put(const ndn::Data& data);
 
+        /**
+         * Puts a batch of data packets into the storage as a single write.
+         * This is much cheaper than putting packets one by one when many
+         * packets arrive together (for instance, all segments of one frame).
+         * The call is synchronous and thread-safe.
+         * @return true if the whole batch was written, false otherwise.
+         */
+        bool put(const std::vector<boost::shared_ptr<const ndn::Data>>& batch);
+
         /**
          * Tries to retrieve data from persistent storage. 
          * The call is synchronous. 
@@ -54,6 +75,16 @@ namespace ndnrtc {
          */
         boost::shared_ptr<ndn::Data> read(const ndn::Interest& interest);
 
+        /**
+         * Same as read(const ndn::Interest&), but returns wire encoding of the
+         * data, without decoding it, through the callback. Wire buffer is 
+         * valid only while the callback runs. For SegmentLogBackend, wire 
+         * buffer points straight into the log mapping.
+         * The call is synchronous.
+         * @return true if data was found, false otherwise.
+         */
+        bool read(const ndn::Interest& interest, OnWire onWire);
+
         /**
          * Scans DB for longest common prefixes. May take a while, depending on 
          * DB size.
@@ -73,6 +104,8 @@ namespace ndnrtc {
          */
         const size_t getKeysNum() const;
 
+        Backend getBackend() const;
+
     private:
         boost::shared_ptr<StorageEngineImpl> pimpl_;
     };
@@ -0,0 +1,161 @@
+//
+//  frame-flip.hpp
+//  ndnrtcTOP
+//
+//  Created by Peter Gusev on 29 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+//  Row-wise flip and RGBA -> ARGB swizzle of 32-bit frames. Kernels use
+//  byte shuffles (AVX2 or SSSE3, whichever is enabled at compile time) and
+//  fall back to scalar code otherwise. Header-only, so it can be benchmarked
+//  outside of TouchDesigner (see extra/benchmark-frame-flip.cc).
+//
+
+#ifndef frame_flip_hpp
+#define frame_flip_hpp
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace frameflip {
+
+// scalar reference, handles one pixel
+inline void
+copyPixel(const uint8_t* src, uint8_t* dst, bool swizzle)
+{
+    uint32_t p;
+    memcpy(&p, src, 4);
+    if (swizzle)
+        p = p >> 24 | p << 8;
+    memcpy(dst, &p, 4);
+}
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+// shuffle mask for 4 pixels: optionally reverses pixel order and rotates
+// bytes of each pixel the same way as copyPixel does
+inline void
+makeShuffleMask(bool flipH, bool swizzle, uint8_t mask[16])
+{
+    static const uint8_t rotate[4] = {3, 0, 1, 2};
+    for (int k = 0; k < 4; ++k)
+        for (int j = 0; j < 4; ++j)
+            mask[4*k + j] = 4*(flipH ? 3 - k : k) + (swizzle ? rotate[j] : j);
+}
+#endif
+
+/**
+ * Copies one row of width pixels from src to dst, mirroring it if flipH is
+ * set and converting RGBA to ARGB if swizzle is set.
+ * src and dst may be the same row only if flipH is not set.
+ */
+inline void
+copyRow(const uint8_t* src, uint8_t* dst, int width, bool flipH, bool swizzle)
+{
+    if (!flipH && !swizzle)
+    {
+        if (src != dst) memcpy(dst, src, 4*width);
+        return;
+    }
+
+    int x = 0;
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+    uint8_t m[16];
+    makeShuffleMask(flipH, swizzle, m);
+    __m128i mask128 = _mm_loadu_si128((const __m128i*)m);
+
+#if defined(__AVX2__)
+    __m256i mask256 = _mm256_broadcastsi128_si256(mask128);
+    for (; x + 8 <= width; x += 8)
+    {
+        const uint8_t* s = src + 4*(flipH ? width - x - 8 : x);
+        __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)s), mask256);
+        // shuffle works within 128-bit lanes, so lanes are swapped to
+        // complete the mirroring
+        if (flipH)
+            v = _mm256_permute2x128_si256(v, v, 0x01);
+        _mm256_storeu_si256((__m256i*)(dst + 4*x), v);
+    }
+#endif
+
+    for (; x + 4 <= width; x += 4)
+    {
+        const uint8_t* s = src + 4*(flipH ? width - x - 4 : x);
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), mask128);
+        _mm_storeu_si128((__m128i*)(dst + 4*x), v);
+    }
+#endif
+
+    for (; x < width; ++x)
+        copyPixel(src + 4*(flipH ? width - 1 - x : x), dst + 4*x, swizzle);
+}
+
+/**
+ * Copies frame from src to dst in one pass, flipping it and converting
+ * RGBA to ARGB on the way. Buffers must not overlap.
+ */
+inline void
+copyFrame(const uint8_t* src, uint8_t* dst, int width, int height,
+          bool flipH, bool flipV, bool swizzle)
+{
+    int stride = 4*width;
+
+    if (!flipH && !flipV && !swizzle)
+    {
+        memcpy(dst, src, stride*height);
+        return;
+    }
+
+    for (int y = 0; y < height; ++y)
+        copyRow(src + y*stride, dst + (flipV ? height - 1 - y : y)*stride,
+                width, flipH, swizzle);
+}
+
+/**
+ * Same as copyFrame, but flips frame in-place. Rows are swapped through a
+ * single row-sized temporary buffer.
+ */
+inline void
+flipFrame(uint8_t* buf, int width, int height,
+          bool flipH, bool flipV, bool swizzle)
+{
+    if (!flipH && !flipV && !swizzle)
+        return;
+
+    int stride = 4*width;
+    std::vector<uint8_t> row(stride);
+    int yStop = flipV ? height / 2 : 0;
+
+    for (int y = 0; y < yStop; ++y)
+    {
+        uint8_t *top = buf + y*stride, *bottom = buf + (height - 1 - y)*stride;
+
+        copyRow(top, row.data(), width, flipH, swizzle);
+        copyRow(bottom, top, width, flipH, swizzle);
+        memcpy(bottom, row.data(), stride);
+    }
+
+    // rows that stay in place (all rows, or the middle one for odd heights)
+    for (int y = yStop; y < height - yStop; ++y)
+    {
+        uint8_t* r = buf + y*stride;
+        if (flipH)
+        {
+            copyRow(r, row.data(), width, flipH, swizzle);
+            memcpy(r, row.data(), stride);
+        }
+        else
+            copyRow(r, r, width, false, swizzle);
+    }
+}
+
+}
+
+#endif /* frame_flip_hpp */
@@ -18,6 +18,8 @@
 #include <ndnrtc/name-components.hpp>
 #include <ndnrtc/statistics.hpp>
 
+#include "frame-flip.hpp"
+
 using namespace std;
 using namespace ndnrtc;
 using namespace ndnrtc::statistics;
@@ -25,6 +27,7 @@ using namespace ndnrtc::statistics;
 #define PAR_STREAM_PREFIX       "Streamprefix"
 #define PAR_LIFETIME            "Lifetime"
 #define PAR_JITTER              "Jittersize"
+#define PAR_FLIP_VERTICAL       "Flipvertical"
 
 #define GetError( )\
 {\
@@ -273,10 +276,14 @@ ndnrtcIn::execute(TOP_OutputFormatSpecs* outputFormat,
         int textureMemoryLocation = 0;
         uint8_t* mem = (uint8_t*)outputFormat->cpuPixelData[textureMemoryLocation];
         
-        streamRenderer_->readBuffer([this, outputFormat, mem](const uint8_t* activeBuffer,  const FrameInfo& finfo)
+        bool flipV = ((ndnrtcIn::Params*)params_)->flipVertical_;
+        
+        streamRenderer_->readBuffer([this, outputFormat, mem, flipV](const uint8_t* activeBuffer,  const FrameInfo& finfo)
                                     {
                                         receivedFrameInfo_ = finfo;
-                                        memcpy(mem, activeBuffer, 4*outputFormat->width*outputFormat->height);
+                                        // flipping is fused with copying, so frame is read only once
+                                        frameflip::copyFrame(activeBuffer, mem, outputFormat->width, outputFormat->height,
+                                                             false, flipV, false);
                                     });
         
         outputFormat->newCPUPixelDataLocation = textureMemoryLocation;
@@ -408,10 +415,17 @@ ndnrtcIn::setupParameters(OP_ParameterManager *manager, void *reserved1)
         reset.label = "Reset";
         reset.page = "Stream Config";
         
+        OP_NumericParameter flipVertical(PAR_FLIP_VERTICAL);
+        flipVertical.label = "Flip Vertically";
+        flipVertical.defaultValues[0] = 0;
+        flipVertical.page = "Stream Config";
+        
         OP_ParAppendResult res = manager->appendString(streamPrefix);
         assert(res == OP_ParAppendResult::Success);
         res = manager->appendPulse(reset);
         assert(res == OP_ParAppendResult::Success);
+        res = manager->appendToggle(flipVertical);
+        assert(res == OP_ParAppendResult::Success);
     }
     {
         OP_NumericParameter jitterSize(PAR_JITTER), lifetime(PAR_LIFETIME);
@@ -477,6 +491,12 @@ ndnrtcIn::checkInputs(TOP_OutputFormatSpecs* outputFormat,
         ((ndnrtcIn::Params*)params_)->jitterSize_ = inputs->getParInt(PAR_JITTER);
     }
     
+    if (((ndnrtcIn::Params*)params_)->flipVertical_ != (bool)inputs->getParInt(PAR_FLIP_VERTICAL))
+    {
+        updatedParams.insert(PAR_FLIP_VERTICAL);
+        ((ndnrtcIn::Params*)params_)->flipVertical_ = inputs->getParInt(PAR_FLIP_VERTICAL);
+    }
+    
     return updatedParams;
 }
 
@@ -29,6 +29,7 @@ public:
     typedef struct _Params : ndnrtcTOPbase::Params {
         std::string streamPrefix_;
         int jitterSize_, lifetime_;
+        bool flipVertical_;
     } Params;
 
     ndnrtcIn(const OP_NodeInfo *info);
@@ -24,6 +24,7 @@
 #include <ndnrtc/stream.hpp>
 
 #include "foundation-helpers.h"
+#include "frame-flip.hpp"
 
 using namespace std;
 //using namespace std::placeholders;
@@ -489,38 +490,9 @@ void
 ndnrtcTOPbase::flipFrame(int width, int height, uint8_t* buf,
                          bool flipH, bool flipV, bool convertToArgb)
 {
-    // this code flips image vertically (but can do it horizontally too) and
-    // converts RGBA to ARGB (can be disabled too)
-    // all this is done in-place and in one pass without additional copying
-    
-    int format = 4; // 4 bytes per pixel - ARGB32
-    int stride = width * format;
-    int yStop = (flipV) ? height / 2 : height;
-    int xStop = (flipH && !(flipH && flipV)) ? width / 2 : width;
-    
-    for (int y = 0; y < yStop; ++y)
-        for (int x = 0; x < xStop; ++x)
-        {
-            int xSwap = (flipH ? width - 1 - x : x);
-            int ySwap = (flipV ? height - 1 - y : y);
-            
-            // swap ARGB pixels
-            int p1Idx = y * stride + x * format;
-            int p2Idx = ySwap * stride + xSwap * format;
-            
-            if (convertToArgb)
-            {
-                uint32_t temp = *(uint32_t*)(buf + p1Idx);
-                *(uint32_t*)(buf + p1Idx) = (*(uint32_t*)(buf + p2Idx)) >> 24 | (*(uint32_t*)(buf + p2Idx)) << 8;
-                *(uint32_t*)(buf + p2Idx) = temp >> 24 | temp << 8;
-            }
-            else
-            {
-                uint32_t temp = *(uint32_t*)(buf + p1Idx);
-                *(uint32_t*)(buf + p1Idx) = *(uint32_t*)(buf + p2Idx);
-                *(uint32_t*)(buf + p2Idx) = temp;
-            }
-        }
+    // flips image vertically and/or horizontally and converts RGBA to ARGB
+    // in-place, row by row with vectorized kernels
+    frameflip::flipFrame(buf, width, height, flipH, flipV, convertToArgb);
 }
 
 void
@@ -10,6 +10,7 @@
 #include "clock.hpp"
 #include "name-components.hpp"
 #include "audio-controller.hpp"
+#include "producer-cache.hpp"
 
 #define BUNDLES_POOL_SIZE 10
 
@@ -124,7 +125,8 @@ void AudioStreamImpl::add(const MediaThreadParams *mp)
         boost::shared_ptr<AudioThread> thread = 
             boost::make_shared<AudioThread>(*params,
                                             p, this,
-                                            CommonSegment::payloadLength(settings_.params_.producerParams_.segmentSize_));
+                                            CommonSegment::payloadLength(settings_.params_.producerParams_.segmentSize_),
+                                            &settings_.faceIo_);
 
         // before adding new thread entry, acquire exclusive access
         {
@@ -164,31 +166,36 @@ void AudioStreamImpl::remove(const std::string &threadName)
 void AudioStreamImpl::onSampleBundle(std::string threadName, uint64_t bundleNo,
                                      boost::shared_ptr<AudioBundlePacket> packet)
 {
-    if (!bundlePool_.size())
-    {
-        LogWarnC << "Audio bundle pool is drained. This may happen due to fast capturing "
-                    "and slow publishing or too small segment size"
-                 << std::endl;
-        return;
-    }
-
     Name n(streamPrefix_);
     n.append(threadName).appendSequenceNumber(bundleNo);
     boost::shared_ptr<AudioStreamImpl> me = boost::static_pointer_cast<AudioStreamImpl>(shared_from_this());
-    boost::shared_ptr<AudioBundlePacket> bundle = bundlePool_.back();
+    boost::shared_ptr<AudioBundlePacket> bundle;
 
     double packetRate = 0;
-    bool threadRemoved = false;
     {
         boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
-        threadRemoved = (metaKeepers_.find(threadName) == metaKeepers_.end());
+
+        // thread has been removed
+        if (metaKeepers_.find(threadName) == metaKeepers_.end())
+            return;
+
+        if (!bundlePool_.size())
+        {
+            LogWarnC << "Audio bundle pool is drained. This may happen due to fast capturing "
+                        "and slow publishing or too small segment size"
+                     << std::endl;
+            return;
+        }
+
+        // swapping exchanges bundles' storage without copying, so audio
+        // thread continues with spare storage while this bundle is published
+        bundle = bundlePool_.back();
+        bundlePool_.pop_back();
         bundle->swap(*packet);
         packetRate = metaKeepers_[threadName]->getMeta().getRate();
-        bundlePool_.pop_back();
     }
 
-    if (!threadRemoved)
-        async::dispatchAsync(settings_.faceIo_, [this, packetRate, n, bundle, me]() {
+    async::dispatchAsync(settings_.faceIo_, [this, packetRate, n, bundle, me]() {
             CommonHeader packetHdr;
 
             packetHdr.sampleRate_ = packetRate;
@@ -8,12 +8,24 @@
 //  Author:  Peter Gusev
 //
 
+#include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
 #include <ndn-cpp/data.hpp>
 
 #include "audio-thread.hpp"
 #include "estimators.hpp"
 #include "frame-data.hpp"
+#include "clock.hpp"
+
+#if BOOST_ASIO_HAS_STD_CHRONO
+
+namespace lib_chrono = std::chrono;
+
+#else
+
+namespace lib_chrono = boost::chrono;
+
+#endif
 
 using namespace ndnrtc;
 using namespace webrtc;
@@ -23,7 +35,8 @@ using namespace webrtc;
 AudioThread::AudioThread(const AudioThreadParams &params,
                          const AudioCaptureParams &captureParams,
                          IAudioThreadCallback *callback,
-                         size_t bundleWireLength)
+                         size_t bundleWireLength,
+                         boost::asio::io_service *io)
     : bundleNo_(0),
       rateMeter_(boost::make_shared<estimators::TimeWindow>(250)),
       threadName_(params.threadName_),
@@ -32,15 +45,26 @@ AudioThread::AudioThread(const AudioThreadParams &params,
       bundle_(boost::make_shared<AudioBundlePacket>(bundleWireLength)),
       capturer_(captureParams.deviceId_, this,
                 (params.codec_ == "opus" ? WebrtcAudioChannel::Codec::Opus : WebrtcAudioChannel::Codec::G722)),
-      isRunning_(false)
+      isRunning_(false),
+      maxBundleDelayMs_(params.maxBundleDelayMs_),
+      bundleStartMs_(0),
+      lastRtpMs_(0),
+      rtpIntervalMs_(0),
+      bundleLock_(boost::make_shared<BundleLock>())
 {
     description_ = "athread";
+    bundleLock_->thread_ = this;
+    if (io && maxBundleDelayMs_)
+        deadlineTimer_ = boost::make_shared<boost::asio::steady_timer>(*io);
 }
 
 AudioThread::~AudioThread()
 {
     if (isRunning_)
         stop();
+
+    boost::lock_guard<boost::mutex> scopedLock(bundleLock_->mutex_);
+    bundleLock_->thread_ = nullptr;
 }
 
 void AudioThread::start()
@@ -49,6 +73,8 @@ void AudioThread::start()
         throw std::runtime_error("Audio thread already started");
     isRunning_ = true;
     bundleNo_ = 0;
+    lastRtpMs_ = 0;
+    rtpIntervalMs_ = 0;
     capturer_.startCapture();
 
     LogDebugC << "started" << std::endl;
@@ -60,6 +86,12 @@ void AudioThread::stop()
     {
         isRunning_ = false;
         capturer_.stopCapture();
+
+        if (deadlineTimer_)
+        {
+            boost::lock_guard<boost::mutex> scopedLock(bundleLock_->mutex_);
+            deadlineTimer_->cancel();
+        }
         LogDebugC << "stopped" << std::endl;
     }
 }
@@ -81,9 +113,7 @@ void AudioThread::onDeliverRtpFrame(unsigned int len, uint8_t *data)
     if (isRunning_)
     {
         LogTraceC << "delivering rtp frame" << std::endl;
-        std::vector<uint8_t> adata(data, data + len);
-        AudioBundlePacket::AudioSampleBlob blob({false}, adata.begin(), adata.end());
-        deliver(blob);
+        deliver({false}, len, data);
     }
 }
 
@@ -92,20 +122,76 @@ void AudioThread::onDeliverRtcpFrame(unsigned int len, uint8_t *data)
     if (isRunning_)
     {
         LogTraceC << "delivering rtcp frame" << std::endl;
-        std::vector<uint8_t> adata(data, data + len);
-        AudioBundlePacket::AudioSampleBlob blob({true}, adata.begin(), adata.end());
-        deliver(blob);
+        deliver({true}, len, data);
     }
 }
 
-void AudioThread::deliver(const AudioBundlePacket::AudioSampleBlob &blob)
+void AudioThread::deliver(const AudioSampleHeader &header, unsigned int len, const uint8_t *data)
 {
-    if (!bundle_->hasSpace(blob))
+    boost::lock_guard<boost::mutex> scopedLock(bundleLock_->mutex_);
+    int64_t now = clock::millisecondTimestamp();
+
+    if (!bundle_->hasSpace(len))
+        flush();
+
+    if (bundle_->getSamplesNum() == 0)
     {
-        rateMeter_.newValue(0);
-        callback_->onSampleBundle(threadName_, bundleNo_++, bundle_);
-        bundle_->clear();
+        bundleStartMs_ = now;
+        setupDeadline();
     }
+    bundle_->append(header, data, len);
+
+    if (!header.isRtcp_)
+    {
+        if (lastRtpMs_)
+            rtpIntervalMs_ = now - lastRtpMs_;
+        lastRtpMs_ = now;
+
+        // publish bundle now, if waiting for the next RTP frame would
+        // delay the first sample in the bundle for longer than allowed
+        // (deadline timer publishes it, if no frame arrives in time)
+        if (maxBundleDelayMs_ && now - bundleStartMs_ + rtpIntervalMs_ > maxBundleDelayMs_)
+            flush();
+    }
+}
 
-    *bundle_ << blob;
+void AudioThread::flush()
+{
+    rateMeter_.newValue(0);
+    // callback swaps bundle contents with an empty one
+    callback_->onSampleBundle(threadName_, bundleNo_++, bundle_);
+    bundle_->clear();
+}
+
+void AudioThread::setupDeadline()
+{
+    if (!deadlineTimer_)
+        return;
+
+    // re-arming cancels deadline of previous bundle, if it's still pending
+    deadlineTimer_->expires_from_now(lib_chrono::milliseconds(maxBundleDelayMs_));
+    deadlineTimer_->async_wait(boost::bind(&AudioThread::onDeadline,
+                                           boost::asio::placeholders::error,
+                                           bundleLock_, bundleNo_));
+}
+
+void AudioThread::onDeadline(const boost::system::error_code &e,
+                             boost::shared_ptr<BundleLock> lock, uint64_t bundleNo)
+{
+    if (e)
+        return;
+
+    boost::lock_guard<boost::mutex> scopedLock(lock->mutex_);
+    if (lock->thread_)
+        lock->thread_->checkDeadline(bundleNo);
+}
+
+void AudioThread::checkDeadline(uint64_t bundleNo)
+{
+    // bundle may have been published already (e.g. once it got full)
+    if (isRunning_ && bundleNo_ == bundleNo && bundle_->getSamplesNum())
+    {
+        LogTraceC << "bundle " << bundleNo << " deadline passed" << std::endl;
+        flush();
+    }
 }
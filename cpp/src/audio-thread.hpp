@@ -11,6 +11,8 @@
 #ifndef __ndnrtc__audio_thread__
 #define __ndnrtc__audio_thread__
 
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/thread.hpp>
 #include <ndn-cpp/data.hpp>
 
@@ -36,7 +38,8 @@ class IAudioThreadCallback
      * @param threadName Name of the audio media thread
      * @param bundleNo Sequential bundle number
      * @param packet Shared pointer for bundle packet
-     * @note This is called on audio system thread
+     * @note This is called on audio system thread or, if bundle was
+     *       published by its' deadline, on io thread of the audio thread
      * @see AudioController
      */
     virtual void onSampleBundle(std::string threadName, uint64_t bundleNo,
@@ -47,10 +50,16 @@ class AudioThread : public NdnRtcComponent,
                     public IAudioSampleConsumer
 {
   public:
+    /**
+     * @param io Io service to run bundle deadline timer on. If it's not
+     *           given, deadline is checked on RTP frame arrival only, thus
+     *           bundle may wait past it during DTX or capture stalls
+     */
     AudioThread(const AudioThreadParams &params,
                 const AudioCaptureParams &captureParams,
                 IAudioThreadCallback *callback,
-                size_t bundleWireLength = 1000);
+                size_t bundleWireLength = 1000,
+                boost::asio::io_service *io = nullptr);
     ~AudioThread();
 
     void start();
@@ -61,11 +70,20 @@ class AudioThread : public NdnRtcComponent,
     std::string getCodec() const { return codec_; }
     double getRate() const;
     uint64_t getBundleNo() const { return bundleNo_; }
+    unsigned int getMaxBundleDelay() const { return maxBundleDelayMs_; }
     void setLogger(boost::shared_ptr<ndnlog::new_api::Logger> logger);
 
   private:
     AudioThread(const AudioThread &) = delete;
 
+    // guards bundle; shared with deadline timer handler, which may run
+    // after this object was destroyed
+    typedef struct _BundleLock
+    {
+        boost::mutex mutex_;
+        AudioThread *thread_; // nullptr once thread is destroyed
+    } BundleLock;
+
     uint64_t bundleNo_;
     estimators::FreqMeter rateMeter_;
     std::string threadName_, codec_;
@@ -73,6 +91,10 @@ class AudioThread : public NdnRtcComponent,
     boost::shared_ptr<AudioBundlePacketT<Mutable>> bundle_;
     AudioCapturer capturer_;
     boost::atomic<bool> isRunning_;
+    unsigned int maxBundleDelayMs_;
+    int64_t bundleStartMs_, lastRtpMs_, rtpIntervalMs_;
+    boost::shared_ptr<BundleLock> bundleLock_;
+    boost::shared_ptr<boost::asio::steady_timer> deadlineTimer_;
 
     void
     onDeliverRtpFrame(unsigned int len, uint8_t *data);
@@ -81,7 +103,20 @@ class AudioThread : public NdnRtcComponent,
     onDeliverRtcpFrame(unsigned int len, uint8_t *data);
 
     void
-    deliver(const AudioBundlePacketT<Mutable>::AudioSampleBlob &blob);
+    deliver(const AudioSampleHeader &header, unsigned int len, const uint8_t *data);
+
+    void
+    flush();
+
+    void
+    setupDeadline();
+
+    void
+    checkDeadline(uint64_t bundleNo);
+
+    static void
+    onDeadline(const boost::system::error_code &e,
+               boost::shared_ptr<BundleLock> lock, uint64_t bundleNo);
 };
 }
 
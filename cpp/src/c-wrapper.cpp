@@ -181,10 +181,18 @@ cFrameInfo ndnrtc_LocalVideoStream_getLastPublishedInfo(ndnrtc::LocalVideoStream
     return frameInfo;
 }
 
+static std::map<std::string, boost::shared_ptr<FrameFetcher>> FrameFetchers;
+// decoded frames cache is shared by all frame fetchers of the same stream
+static std::map<ndnrtc::IStream*, boost::shared_ptr<DecodedFrameCache>> FrameFetcherCaches;
+
 void ndnrtc_destroyLocalStream(ndnrtc::IStream* localStreamObject)
 {
 	if (localStreamObject)
+	{
+		// fetchers in flight keep the cache until they complete
+		FrameFetcherCaches.erase(localStreamObject);
 		delete localStreamObject;
+	}
 }
 
 // const char* ndnrtc_LocalStream_getPrefix(IStream *stream)
@@ -234,26 +242,36 @@ double ndnrtc_getStatistic(ndnrtc::IStream *stream, const char* statName)
     return 0;
 }
 
-static std::map<std::string, boost::shared_ptr<FrameFetcher>> FrameFetchers;
+// each fetching call gets its' own key, so fetchers of the same frame
+// don't replace each other
+static unsigned int FrameFetcherId = 0;
+
 void ndnrtc_FrameFetcher_fetch(ndnrtc::IStream *stream,
                                const char* frameName, 
                                BufferAlloc bufferAllocFunc,
                                FrameFetched frameFetchedFunc)
 {
     boost::shared_ptr<StorageEngine> storage = ((LocalVideoStream*)stream)->getStorage();
-    boost::shared_ptr<FrameFetcher> ff = boost::make_shared<FrameFetcher>(storage);
+    if (FrameFetcherCaches.find(stream) == FrameFetcherCaches.end())
+        FrameFetcherCaches[stream] = FrameFetcher::createCache();
+    boost::shared_ptr<FrameFetcher> ff = boost::make_shared<FrameFetcher>(storage, FrameFetcherCaches[stream]);
 
-    std::string fkey(frameName);
+    std::string frameNameStr(frameName);
+    std::string fkey = std::to_string(++FrameFetcherId);
     FrameFetchers[fkey] = ff;
 
-    ((LocalVideoStream*)stream)->getLogger()->log(ndnlog::NdnLoggerLevelInfo) << "Setting up frame-fetcher for " << fkey << std::endl;
+    ((LocalVideoStream*)stream)->getLogger()->log(ndnlog::NdnLoggerLevelInfo) << "Setting up frame-fetcher for " << frameNameStr << std::endl;
 
     ff->setLogger(((LocalVideoStream*)stream)->getLogger());
     ff->fetch(Name(frameName),
-              [fkey, bufferAllocFunc](const boost::shared_ptr<IFrameFetcher>& fetcher, 
-                                      int width, int height)->uint8_t*
+              [fkey, frameNameStr, bufferAllocFunc](const boost::shared_ptr<IFrameFetcher>& fetcher, 
+                                                    int width, int height)->uint8_t*
               {
-                  return bufferAllocFunc(fkey.c_str(), width, height);
+                  uint8_t* buffer = bufferAllocFunc(frameNameStr.c_str(), width, height);
+                  // frame is skipped, fetching is completed
+                  if (!buffer)
+                      FrameFetchers.erase(fkey);
+                  return buffer;
               },
               [fkey, frameFetchedFunc](const boost::shared_ptr<IFrameFetcher>& fetcher, 
                  const FrameInfo fi, int nFetchedFrames,
@@ -262,8 +280,59 @@ void ndnrtc_FrameFetcher_fetch(ndnrtc::IStream *stream,
                     frameFetchedFunc(frameInfo, width, height, buffer);
                     FrameFetchers.erase(fkey);
               },
+              [fkey, frameNameStr, frameFetchedFunc](const boost::shared_ptr<IFrameFetcher>& ff, std::string reason){
+                    cFrameInfo frameInfo({0,0,(char*)frameNameStr.c_str()});
+                    frameFetchedFunc(frameInfo, 0, 0, nullptr);
+                    FrameFetchers.erase(fkey);
+              });
+}
+
+void ndnrtc_FrameFetcher_fetchRange(ndnrtc::IStream *stream,
+                                    const char* startFrameName,
+                                    unsigned int nFrames,
+                                    unsigned int stride,
+                                    BufferAlloc bufferAllocFunc,
+                                    FrameFetched frameFetchedFunc)
+{
+    boost::shared_ptr<StorageEngine> storage = ((LocalVideoStream*)stream)->getStorage();
+    if (FrameFetcherCaches.find(stream) == FrameFetcherCaches.end())
+        FrameFetcherCaches[stream] = FrameFetcher::createCache();
+    boost::shared_ptr<FrameFetcher> ff = boost::make_shared<FrameFetcher>(storage, FrameFetcherCaches[stream]);
+
+    std::string fkey = std::to_string(++FrameFetcherId);
+    FrameFetchers[fkey] = ff;
+
+    ((LocalVideoStream*)stream)->getLogger()->log(ndnlog::NdnLoggerLevelInfo) << "Setting up frame-fetcher for range of " 
+        << nFrames << " frames from " << startFrameName << std::endl;
+
+    // range frame is completed either when it's delivered or skipped (null 
+    // buffer was allocated for it)
+    boost::shared_ptr<unsigned int> nCompleted = boost::make_shared<unsigned int>(0);
+    boost::function<void()> onFrameCompleted = [fkey, nCompleted, nFrames](){
+        if (++(*nCompleted) == nFrames)
+            FrameFetchers.erase(fkey);
+    };
+
+    ff->setLogger(((LocalVideoStream*)stream)->getLogger());
+    ff->fetchRange(Name(startFrameName), nFrames, stride,
+              [bufferAllocFunc, onFrameCompleted](const boost::shared_ptr<IFrameFetcher>& fetcher, 
+                                                  int width, int height)->uint8_t*
+              {
+                  uint8_t* buffer = bufferAllocFunc(fetcher->getName().toUri().c_str(), width, height);
+                  if (!buffer)
+                      onFrameCompleted();
+                  return buffer;
+              },
+              [frameFetchedFunc, onFrameCompleted](const boost::shared_ptr<IFrameFetcher>& fetcher, 
+                 const FrameInfo fi, int nFetchedFrames,
+                 int width, int height, const uint8_t* buffer){
+                    cFrameInfo frameInfo({fi.timestamp_, fi.playbackNo_, (char*)fi.ndnName_.c_str()});
+                    frameFetchedFunc(frameInfo, width, height, buffer);
+                    onFrameCompleted();
+              },
               [fkey, frameFetchedFunc](const boost::shared_ptr<IFrameFetcher>& ff, std::string reason){
-                    cFrameInfo frameInfo({0,0,(char*)fkey.c_str()});
+                    std::string frameName = ff->getName().toUri();
+                    cFrameInfo frameInfo({0,0,(char*)frameName.c_str()});
                     frameFetchedFunc(frameInfo, 0, 0, nullptr);
                     FrameFetchers.erase(fkey);
               });
@@ -0,0 +1,185 @@
+//
+// decoder-worker.cpp
+//
+//  Created by Peter Gusev on 28 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <webrtc/common_video/libyuv/include/webrtc_libyuv.h>
+
+#include "decoder-worker.hpp"
+
+using namespace ndnrtc;
+using namespace boost;
+
+DecoderWorker::DecoderWorker(const VideoCoderParams &coderParams,
+                             OnDecodedImage onReady,
+                             size_t decodeAhead, size_t maxQueueSize)
+    : decoder_(make_shared<VideoDecoder>(coderParams,
+                                         boost::bind(&DecoderWorker::onDecoded, this, _1, _2))),
+      onReady_(onReady),
+      decodeAhead_(decodeAhead ? decodeAhead : 1),
+      maxQueueSize_(maxQueueSize ? maxQueueSize : 1),
+      isRunning_(true),
+      isAwaitingKey_(false)
+{
+    description_ = "decoder-worker";
+    thread_ = thread(bind(&DecoderWorker::run, this));
+}
+
+DecoderWorker::~DecoderWorker()
+{
+    stop();
+}
+
+void DecoderWorker::processFrame(const FrameInfo &frameInfo, const webrtc::EncodedImage &image)
+{
+    bool isKey = (image._frameType == webrtc::kVideoFrameKey);
+    Job job({frameInfo, image,
+             make_shared<std::vector<uint8_t>>(image._buffer, image._buffer + image._length)});
+    job.image_._buffer = job.data_->data();
+    job.image_._size = job.data_->size();
+
+    std::deque<Picture> pictures;
+    {
+        lock_guard<mutex> scopedLock(mutex_);
+
+        if (!isRunning_)
+            return;
+
+        if (queue_.size() >= maxQueueSize_)
+        {
+            LogWarnC << "⨂ decoder is behind by " << queue_.size()
+                     << " frames, resuming from next key frame" << std::endl;
+            queue_.clear();
+            isAwaitingKey_ = true;
+        }
+
+        if (isAwaitingKey_ && !isKey)
+            LogDebugC << "⨂ skip " << frameInfo.playbackNo_ << "p (awaiting key frame)" << std::endl;
+        else
+        {
+            isAwaitingKey_ = false;
+            queue_.push_back(job);
+        }
+
+        // hand out one picture per playout tick
+        if (ready_.size())
+        {
+            pictures.push_back(ready_.front());
+            ready_.pop_front();
+        }
+    }
+    queueCondition_.notify_one();
+
+    for (auto &p : pictures)
+    {
+        LogTraceC << "picture " << p.first.playbackNo_ << "p is ready" << std::endl;
+        onReady_(p.first, p.second);
+    }
+}
+
+void DecoderWorker::stop()
+{
+    {
+        lock_guard<mutex> scopedLock(mutex_);
+        isRunning_ = false;
+        queue_.clear();
+        ready_.clear();
+    }
+    queueCondition_.notify_one();
+
+    if (thread_.joinable() && this_thread::get_id() != thread_.get_id())
+        thread_.join();
+}
+
+size_t DecoderWorker::getQueueSize() const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    return queue_.size();
+}
+
+size_t DecoderWorker::getReadyNum() const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    return ready_.size();
+}
+
+void DecoderWorker::setLogger(boost::shared_ptr<ndnlog::new_api::Logger> logger)
+{
+    decoder_->setLogger(logger);
+    ILoggingObject::setLogger(logger);
+}
+
+void DecoderWorker::run()
+{
+    while (true)
+    {
+        unique_lock<mutex> lock(mutex_);
+        while (isRunning_ && queue_.empty())
+            queueCondition_.wait(lock);
+
+        if (!isRunning_)
+            break;
+
+        Job job = queue_.front();
+        queue_.pop_front();
+        lock.unlock();
+
+        // decoded picture is delivered synchronously via onDecoded
+        decoder_->processFrame(job.frameInfo_, job.image_);
+    }
+}
+
+void DecoderWorker::onDecoded(const FrameInfo &frameInfo, const WebRtcVideoFrame &frame)
+{
+    lock_guard<mutex> scopedLock(mutex_);
+
+    if (!isRunning_)
+        return;
+
+    if (ready_.size() >= decodeAhead_)
+    {
+        LogWarnC << "⨂ picture " << ready_.front().first.playbackNo_
+                 << "p was not played out in time, dropping" << std::endl;
+        ready_.pop_front();
+    }
+
+    ready_.push_back(Picture(frameInfo, frame));
+}
+
+//******************************************************************************
+bool ndnrtc::renderDecodedFrame(IExternalRenderer *renderer, const FrameInfo &frameInfo,
+                                const WebRtcVideoFrame &frame)
+{
+    IExternalRenderer::BufferType bufferType = IExternalRenderer::kARGB;
+    uint8_t *rgbFrameBuffer = renderer->getFrameBuffer(frame.width(),
+                                                       frame.height(),
+                                                       &bufferType);
+
+    if (bufferType == IExternalRenderer::kI420)
+    {
+        // no conversion - renderer reads decoded planes directly
+        rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer = frame.video_frame_buffer();
+        const uint8_t *const planes[3] = {buffer->DataY(), buffer->DataU(), buffer->DataV()};
+        const int strides[3] = {buffer->StrideY(), buffer->StrideU(), buffer->StrideV()};
+
+        renderer->renderI420Frame(frameInfo, frame.width(), frame.height(),
+                                  planes, strides);
+        return true;
+    }
+
+    if (!rgbFrameBuffer)
+        return false;
+
+    // @see frame-converter.cpp for explanation, why we flipping ARGB <-> BGRA data representations
+    // webrtc::VideoType videoType = (bufferType == IExternalRenderer::kARGB ? webrtc::kARGB : webrtc::kBGRA);
+    webrtc::VideoType videoType = (bufferType == IExternalRenderer::kARGB ? webrtc::kBGRA : webrtc::kARGB);
+
+    ConvertFromI420(frame, videoType, 0, rgbFrameBuffer);
+    renderer->renderFrame(frameInfo, frame.width(), frame.height(),
+                          rgbFrameBuffer);
+    return true;
+}
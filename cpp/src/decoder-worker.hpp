@@ -0,0 +1,97 @@
+//
+// decoder-worker.hpp
+//
+//  Created by Peter Gusev on 28 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#ifndef __decoder_worker_hpp__
+#define __decoder_worker_hpp__
+
+#include <deque>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "ndnrtc-object.hpp"
+#include "video-decoder.hpp"
+
+namespace ndnrtc
+{
+/**
+ * Decodes frames of a remote video stream on a dedicated thread.
+ * Worker is registered with video playout as its' frame consumer. Each
+ * playout tick queues encoded frame for decoding and hands out the oldest
+ * picture that has already been decoded (if any) to onReady callback, on the
+ * playout thread. Thus, playout timing accounts for rendering only, while
+ * decoding of the next frame runs in parallel.
+ * Up to decodeAhead decoded pictures are kept ready; if playout does not
+ * take them in time, oldest pictures are dropped. If decoder falls behind
+ * by more than maxQueueSize frames, queued frames are dropped and decoding
+ * resumes from the next Key frame.
+ */
+class DecoderWorker : public IEncodedFrameConsumer,
+                      public NdnRtcComponent
+{
+  public:
+    DecoderWorker(const VideoCoderParams &coderParams,
+                  OnDecodedImage onReady,
+                  size_t decodeAhead = 2,
+                  size_t maxQueueSize = 8);
+    ~DecoderWorker();
+
+    // interface conformance - IEncodedFrameConsumer
+    // called on playout thread
+    void processFrame(const FrameInfo &, const webrtc::EncodedImage &) override;
+
+    /**
+     * Stops worker thread and drops all queued frames and ready pictures.
+     * Blocks until frame that is being decoded (if any) is processed.
+     */
+    void stop();
+
+    size_t getQueueSize() const;
+    size_t getReadyNum() const;
+    void setLogger(boost::shared_ptr<ndnlog::new_api::Logger> logger);
+
+  private:
+    DecoderWorker(const DecoderWorker &) = delete;
+
+    typedef struct _Job
+    {
+        FrameInfo frameInfo_;
+        webrtc::EncodedImage image_;
+        // encoded image buffer is owned by playout, thus it is copied
+        boost::shared_ptr<std::vector<uint8_t>> data_;
+    } Job;
+    typedef std::pair<FrameInfo, WebRtcVideoFrame> Picture;
+
+    boost::shared_ptr<VideoDecoder> decoder_;
+    OnDecodedImage onReady_;
+    size_t decodeAhead_, maxQueueSize_;
+    mutable boost::mutex mutex_;
+    boost::condition_variable queueCondition_;
+    std::deque<Job> queue_;
+    std::deque<Picture> ready_;
+    bool isRunning_, isAwaitingKey_;
+    boost::thread thread_;
+
+    void run();
+    // called on worker thread
+    void onDecoded(const FrameInfo &frameInfo, const WebRtcVideoFrame &frame);
+};
+
+/**
+ * Passes decoded picture to external renderer in the format that renderer
+ * requests in getFrameBuffer call: decoded planes are passed to
+ * renderI420Frame as is, RGB formats are converted into renderer's buffer
+ * and passed to renderFrame.
+ * @return false if renderer has skipped the frame (returned null buffer for
+ *         RGB formats)
+ * @see IExternalRenderer::BufferType
+ */
+bool renderDecodedFrame(IExternalRenderer *renderer, const FrameInfo &frameInfo,
+                        const WebRtcVideoFrame &frame);
+}
+
+#endif
@@ -0,0 +1,383 @@
+//
+// encoder-worker.cpp
+//
+//  Created by Peter Gusev on 20 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <boost/make_shared.hpp>
+
+#include "encoder-worker.hpp"
+#include "video-thread.hpp"
+#include "video-coder.hpp"
+#include "frame-data.hpp"
+
+using namespace ndnrtc;
+using namespace boost;
+
+EncoderWorker::EncoderWorker(const VideoCoderParams &coderParams,
+                             OnEncoded onEncoded,
+                             size_t queueSize, int cpuCore,
+                             unsigned int nCores)
+    : videoThread_(make_shared<VideoThread>(coderParams, nCores)),
+      scaler_(make_shared<FrameScaler>(coderParams.encodeWidth_, coderParams.encodeHeight_)),
+      width_(coderParams.encodeWidth_),
+      height_(coderParams.encodeHeight_),
+      onEncoded_(onEncoded),
+      maxQueueSize_(queueSize ? queueSize : 1),
+      isRunning_(true),
+      pendingCoreNum_(0),
+      pendingKeyFrame_(false),
+      pendingBitrate_(0),
+      pendingFrameRate_(0),
+      isResolutionPending_(false),
+      pendingWidth_(0),
+      pendingHeight_(0)
+{
+    description_ = "encoder-worker";
+    thread_ = thread(bind(&EncoderWorker::run, this, cpuCore));
+}
+
+EncoderWorker::~EncoderWorker()
+{
+    stop();
+}
+
+bool EncoderWorker::enqueue(const WebRtcVideoFrame &frame, PacketNumber playbackNo,
+                            int64_t captureTimestampMs,
+                            const boost::shared_ptr<const WebRtcVideoFrame> &downscaled)
+{
+    std::deque<Job> dropped;
+    {
+        lock_guard<mutex> scopedLock(mutex_);
+
+        if (!isRunning_)
+            return false;
+
+        if (queue_.size() >= maxQueueSize_)
+        {
+            LogWarnC << "⨂ encoder queue is full, dropping frame "
+                     << queue_.front().playbackNo_ << "p" << std::endl;
+            dropped.push_back(queue_.front());
+            queue_.pop_front();
+        }
+
+        queue_.push_back(Job({frame, playbackNo, captureTimestampMs, downscaled}));
+    }
+    queueCondition_.notify_one();
+
+    for (auto &job : dropped)
+        onEncoded_(job, boost::shared_ptr<VideoFramePacket>());
+
+    return dropped.empty();
+}
+
+void EncoderWorker::stop()
+{
+    {
+        lock_guard<mutex> scopedLock(mutex_);
+        isRunning_ = false;
+        queue_.clear();
+        children_.clear();
+    }
+    queueCondition_.notify_one();
+
+    if (thread_.joinable() && this_thread::get_id() != thread_.get_id())
+        thread_.join();
+}
+
+void EncoderWorker::setChildren(const std::vector<boost::shared_ptr<EncoderWorker>> &children)
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    children_ = children;
+}
+
+void EncoderWorker::setRate(unsigned int bitrateKbps, double frameRate)
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    pendingBitrate_ = bitrateKbps;
+    pendingFrameRate_ = frameRate;
+}
+
+void EncoderWorker::setResolution(unsigned int width, unsigned int height)
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    pendingWidth_ = width;
+    pendingHeight_ = height;
+    isResolutionPending_ = true;
+}
+
+unsigned int EncoderWorker::getWidth() const
+{
+    return width_;
+}
+
+unsigned int EncoderWorker::getHeight() const
+{
+    return height_;
+}
+
+size_t EncoderWorker::getQueueSize() const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    return queue_.size();
+}
+
+void EncoderWorker::setDescription(const std::string &desc)
+{
+    description_ = desc;
+    videoThread_->setDescription(desc);
+}
+
+void EncoderWorker::setLogger(boost::shared_ptr<ndnlog::new_api::Logger> logger)
+{
+    videoThread_->setLogger(logger);
+    ILoggingObject::setLogger(logger);
+}
+
+//******************************************************************************
+void EncoderWorker::run(int cpuCore)
+{
+#ifdef __linux__
+    if (cpuCore >= 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpuCore, &cpuSet);
+
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+            LogWarnC << "failed to pin encoder thread to core " << cpuCore << std::endl;
+    }
+#endif
+
+    while (true)
+    {
+        unique_lock<mutex> lock(mutex_);
+        queueCondition_.wait(lock, [this]() { return !isRunning_ || queue_.size(); });
+
+        if (!isRunning_)
+            break;
+
+        Job job = queue_.front();
+        std::vector<boost::shared_ptr<EncoderWorker>> children(children_);
+        queue_.pop_front();
+
+        unsigned int bitrate = pendingBitrate_;
+        double frameRate = pendingFrameRate_;
+        pendingBitrate_ = 0;
+        pendingFrameRate_ = 0;
+
+        bool switchResolution = isResolutionPending_ &&
+                                videoThread_->getCoder().isKeyFrameDue();
+        unsigned int width = pendingWidth_, height = pendingHeight_;
+        if (switchResolution)
+        {
+            isResolutionPending_ = false;
+            width_ = width;
+            height_ = height;
+        }
+        lock.unlock();
+
+        if (bitrate)
+            videoThread_->setRate(bitrate, frameRate);
+        if (switchResolution)
+        {
+            scaler_ = make_shared<FrameScaler>(width, height);
+            videoThread_->setResolution(width, height);
+        }
+
+        unsigned int nCores = pendingCoreNum_.exchange(0);
+        if (nCores)
+            videoThread_->setCoreNum(nCores);
+        if (pendingKeyFrame_.exchange(false))
+            videoThread_->requestKeyFrame();
+
+        // lower resolutions are scaled from this one while it's being encoded
+        WebRtcVideoFrame scaledFrame = (*scaler_)(job.frame_);
+        // (unless frame was already downscaled to child's resolution)
+        for (auto &c : children)
+            if (job.downscaled_ && (int)c->getWidth() == job.downscaled_->width() &&
+                (int)c->getHeight() == job.downscaled_->height())
+                c->enqueue(*job.downscaled_, job.playbackNo_, job.captureTimestampMs_);
+            else
+                c->enqueue(scaledFrame, job.playbackNo_, job.captureTimestampMs_,
+                           job.downscaled_);
+
+        boost::shared_ptr<VideoFramePacket> packet = videoThread_->encode(scaledFrame, job.captureTimestampMs_);
+        onEncoded_(job, packet);
+    }
+}
+
+//******************************************************************************
+EncoderCoreScheduler &EncoderCoreScheduler::getSharedInstance()
+{
+    static EncoderCoreScheduler scheduler;
+    return scheduler;
+}
+
+EncoderCoreScheduler::EncoderCoreScheduler(unsigned int budget)
+    : budget_(budget)
+{
+}
+
+void EncoderCoreScheduler::setBudget(unsigned int budget)
+{
+    std::vector<std::string> changes;
+    {
+        lock_guard<mutex> scopedLock(mutex_);
+        budget_ = budget;
+        changes = rebalance();
+    }
+
+    notify(changes);
+}
+
+unsigned int EncoderCoreScheduler::getBudget() const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    return (budget_ ? budget_ : std::max(1u, thread::hardware_concurrency()));
+}
+
+unsigned int EncoderCoreScheduler::add(const std::string &id, const VideoCoderParams &params,
+                                       OnAllocation onAllocation)
+{
+    std::vector<std::string> changes;
+    unsigned int nCores = 0;
+    {
+        lock_guard<mutex> scopedLock(mutex_);
+        encoders_[id] = Entry({(double)params.encodeWidth_ * params.encodeHeight_ * params.codecFrameRate_,
+                               0, OnAllocation()});
+        changes = rebalance();
+        encoders_[id].onAllocation_ = onAllocation;
+        nCores = encoders_[id].nCores_;
+    }
+
+    // new encoder's allocation is returned, others are notified
+    notify(changes);
+
+    return nCores;
+}
+
+void EncoderCoreScheduler::remove(const std::string &id)
+{
+    std::vector<std::string> changes;
+    {
+        // waits for callbacks that are running, later ones won't find encoder
+        lock_guard<mutex> callbackLock(callbackMutex_);
+        lock_guard<mutex> scopedLock(mutex_);
+        if (!encoders_.erase(id))
+            return;
+        changes = rebalance();
+    }
+
+    notify(changes);
+}
+
+bool EncoderCoreScheduler::update(const std::string &id, const VideoCoderParams &params)
+{
+    std::vector<std::string> changes;
+    {
+        lock_guard<mutex> scopedLock(mutex_);
+        auto it = encoders_.find(id);
+        if (it == encoders_.end())
+            return false;
+
+        it->second.pixelRate_ = (double)params.encodeWidth_ * params.encodeHeight_ * params.codecFrameRate_;
+        changes = rebalance();
+    }
+
+    notify(changes);
+
+    return true;
+}
+
+unsigned int EncoderCoreScheduler::getAllocation(const std::string &id) const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    auto it = encoders_.find(id);
+    return (it == encoders_.end() ? 0 : it->second.nCores_);
+}
+
+std::vector<std::string>
+EncoderCoreScheduler::rebalance()
+{
+    std::vector<std::string> changes;
+    if (encoders_.empty())
+        return changes;
+
+    unsigned int budget = (budget_ ? budget_ : std::max(1u, thread::hardware_concurrency()));
+    std::map<std::string, unsigned int> allocation;
+
+    if (encoders_.size() >= budget)
+    {
+        for (auto &e : encoders_)
+            allocation[e.first] = 1;
+    }
+    else
+    {
+        // every encoder gets one core, the rest is divided proportionally to
+        // pixel rate, leftover cores go to largest fractional shares
+        unsigned int spare = budget - encoders_.size(), allocated = 0;
+        double totalRate = 0;
+        std::vector<std::pair<double, std::string>> remainders;
+
+        for (auto &e : encoders_)
+            totalRate += e.second.pixelRate_;
+
+        for (auto &e : encoders_)
+        {
+            double share = (totalRate > 0 ? spare * e.second.pixelRate_ / totalRate
+                                          : (double)spare / encoders_.size());
+            allocation[e.first] = 1 + (unsigned int)share;
+            allocated += (unsigned int)share;
+            remainders.push_back(std::make_pair(share - (unsigned int)share, e.first));
+        }
+
+        std::sort(remainders.begin(), remainders.end(),
+                  [](const std::pair<double, std::string> &a, const std::pair<double, std::string> &b) {
+                      return a.first > b.first;
+                  });
+        for (auto it = remainders.begin(); it != remainders.end() && allocated < spare; ++it, ++allocated)
+            allocation[it->second]++;
+    }
+
+    for (auto &e : encoders_)
+        if (e.second.nCores_ != allocation[e.first])
+        {
+            e.second.nCores_ = allocation[e.first];
+            if (e.second.onAllocation_)
+                changes.push_back(e.first);
+        }
+
+    return changes;
+}
+
+void EncoderCoreScheduler::notify(const std::vector<std::string> &ids)
+{
+    // callbacks are called outside of scheduler's lock, but one at a time and
+    // only for encoders that are still registered, with their latest allocation
+    lock_guard<mutex> callbackLock(callbackMutex_);
+
+    for (auto &id : ids)
+    {
+        OnAllocation onAllocation;
+        unsigned int nCores = 0;
+        {
+            lock_guard<mutex> scopedLock(mutex_);
+            auto it = encoders_.find(id);
+            if (it == encoders_.end())
+                continue;
+            onAllocation = it->second.onAllocation_;
+            nCores = it->second.nCores_;
+        }
+
+        if (onAllocation)
+            onAllocation(nCores);
+    }
+}
@@ -0,0 +1,238 @@
+//
+// encoder-worker.hpp
+//
+//  Created by Peter Gusev on 20 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#ifndef __encoder_worker_hpp__
+#define __encoder_worker_hpp__
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "ndnrtc-common.hpp"
+#include "ndnrtc-object.hpp"
+#include "webrtc.hpp"
+
+namespace ndnrtc
+{
+class VideoThread;
+class FrameScaler;
+class VideoCoderParams;
+struct Mutable;
+template <typename T>
+class VideoFramePacketT;
+
+/**
+ * Persistent encoding thread for one video thread of a local stream.
+ * Captured frames are queued to the worker which scales them to the video
+ * thread's resolution and encodes them on its' own OS thread. Each encoded
+ * frame is handed over to the onEncoded callback as soon as it is ready,
+ * independently of other workers of the stream.
+ * Queue is bounded: if encoder can not keep up with the capture rate, oldest
+ * queued frame is dropped.
+ * Workers may be chained into a scaling pyramid: once a frame is scaled to
+ * this worker's resolution, it is passed on to child workers (which have
+ * lower resolutions) before it is encoded, so that lower resolutions are
+ * scaled from the nearest higher one, in parallel with encoding.
+ */
+class EncoderWorker : public NdnRtcComponent
+{
+  public:
+    typedef struct _Job
+    {
+        WebRtcVideoFrame frame_;
+        PacketNumber playbackNo_;
+        int64_t captureTimestampMs_;
+        // frame downscaled while converting, passed on to the worker of its'
+        // resolution down the pyramid (empty if there is none)
+        boost::shared_ptr<const WebRtcVideoFrame> downscaled_;
+    } Job;
+    // called on worker thread; packet is empty if encoder dropped the frame.
+    // also called with empty packet on the enqueueing thread when a frame is
+    // dropped from a full queue, thus drops may be reported out of order
+    typedef boost::function<void(const Job &,
+                                 const boost::shared_ptr<VideoFramePacketT<Mutable>> &)>
+        OnEncoded;
+
+    /**
+     * Creates worker and starts its' thread.
+     * @param coderParams Video thread encoder parameters
+     * @param queueSize Maximum number of frames waiting to be encoded
+     * @param cpuCore CPU core to pin worker thread to or -1 for no pinning
+     *                (pinning is supported on Linux only)
+     * @param nCores Number of cores encoder may use (0 - all cores)
+     */
+    EncoderWorker(const VideoCoderParams &coderParams,
+                  OnEncoded onEncoded,
+                  size_t queueSize = 2, int cpuCore = -1,
+                  unsigned int nCores = 0);
+    ~EncoderWorker();
+
+    /**
+     * Queues captured frame for encoding.
+     * @param downscaled Lower resolution copy of the frame (if any), which
+     *                   is handed to descendant worker of the same resolution
+     *                   instead of scaling the frame for it
+     * @return false if queue was full and oldest frame was dropped or if
+     *         worker is stopped
+     */
+    bool enqueue(const WebRtcVideoFrame &frame, PacketNumber playbackNo,
+                 int64_t captureTimestampMs,
+                 const boost::shared_ptr<const WebRtcVideoFrame> &downscaled =
+                     boost::shared_ptr<const WebRtcVideoFrame>());
+
+    /**
+     * Stops worker thread and drops all queued frames. Blocks until frame
+     * that is being encoded (if any) is processed.
+     */
+    void stop();
+
+    /**
+     * Changes number of cores encoder may use. Encoder is re-initialized on
+     * worker thread before encoding next frame.
+     */
+    void setCoreNum(unsigned int nCores) { pendingCoreNum_ = nCores; }
+
+    /**
+     * Makes next encoded frame a Key frame (e.g. after an encoded frame was
+     * dropped and later frames can not be decoded).
+     */
+    void requestKeyFrame() { pendingKeyFrame_ = true; }
+
+    /**
+     * Retargets encoder's bitrate and frame rate. Takes effect with next
+     * encoded frame.
+     */
+    void setRate(unsigned int bitrateKbps, double frameRate);
+
+    /**
+     * Changes encoding resolution. Worker keeps scaling and encoding frames
+     * in the old one until the start of the next GOP, so that no extra key
+     * frame is produced. getWidth() and getHeight() report the resolution
+     * of frames being encoded, thus they change only once the switch
+     * happens.
+     */
+    void setResolution(unsigned int width, unsigned int height);
+
+    /**
+     * Sets workers which receive frames scaled by this worker.
+     */
+    void setChildren(const std::vector<boost::shared_ptr<EncoderWorker>> &children);
+
+    size_t getQueueSize() const;
+    unsigned int getWidth() const;
+    unsigned int getHeight() const;
+    boost::shared_ptr<VideoThread> getVideoThread() const { return videoThread_; }
+    void setDescription(const std::string &desc);
+    void setLogger(boost::shared_ptr<ndnlog::new_api::Logger> logger);
+
+  private:
+    EncoderWorker(const EncoderWorker &) = delete;
+
+    boost::shared_ptr<VideoThread> videoThread_;
+    boost::shared_ptr<FrameScaler> scaler_;
+    boost::atomic<unsigned int> width_, height_;
+    OnEncoded onEncoded_;
+    size_t maxQueueSize_;
+    mutable boost::mutex mutex_;
+    boost::condition_variable queueCondition_;
+    std::deque<Job> queue_;
+    std::vector<boost::shared_ptr<EncoderWorker>> children_;
+    bool isRunning_;
+    boost::atomic<unsigned int> pendingCoreNum_;
+    boost::atomic<bool> pendingKeyFrame_;
+    // guarded by mutex_; zeroes mean there are no pending changes
+    unsigned int pendingBitrate_;
+    double pendingFrameRate_;
+    bool isResolutionPending_;
+    unsigned int pendingWidth_, pendingHeight_;
+    boost::thread thread_;
+
+    void run(int cpuCore);
+};
+
+/**
+ * Divides producer-wide budget of CPU cores among all video encoders
+ * proportionally to their pixel rate (width x height x fps), so that
+ * simulcast encoders do not oversubscribe the machine. Every encoder gets
+ * at least one core. Allocations are re-balanced whenever an encoder is
+ * added or removed, or the budget changes; encoders are notified about
+ * their new allocation through callbacks, which are called outside of
+ * scheduler's lock, one at a time.
+ */
+class EncoderCoreScheduler
+{
+  public:
+    typedef boost::function<void(unsigned int)> OnAllocation;
+
+    static EncoderCoreScheduler &getSharedInstance();
+
+    EncoderCoreScheduler(unsigned int budget = 0);
+
+    /**
+     * Sets core budget; 0 means number of hardware cores.
+     */
+    void setBudget(unsigned int budget);
+    unsigned int getBudget() const;
+
+    /**
+     * Registers encoder and re-balances allocations.
+     * @param id Unique encoder id
+     * @param params Encoder parameters used to calculate pixel rate
+     * @param onAllocation Called when encoder's allocation changes later
+     * @return Number of cores allocated for this encoder
+     */
+    unsigned int add(const std::string &id, const VideoCoderParams &params,
+                     OnAllocation onAllocation);
+
+    /**
+     * Updates parameters of registered encoder and re-balances allocations.
+     * Encoder's new allocation (if changed) is passed to its' callback.
+     * Does nothing for encoders that are not registered (e.g. already
+     * removed), thus it is safe to call concurrently with remove().
+     * @return false if encoder is not registered
+     */
+    bool update(const std::string &id, const VideoCoderParams &params);
+
+    /**
+     * Unregisters encoder and re-balances allocations. Once it returns,
+     * encoder's callback is not running and won't be called anymore, thus
+     * callback's owner may be destroyed.
+     */
+    void remove(const std::string &id);
+
+    /**
+     * Returns current allocation for encoder or 0 if it is not registered.
+     */
+    unsigned int getAllocation(const std::string &id) const;
+
+  private:
+    typedef struct _Entry
+    {
+        double pixelRate_;
+        unsigned int nCores_;
+        OnAllocation onAllocation_;
+    } Entry;
+
+    EncoderCoreScheduler(const EncoderCoreScheduler &) = delete;
+
+    mutable boost::mutex mutex_;
+    // serializes allocation callbacks with encoders removal
+    boost::mutex callbackMutex_;
+    unsigned int budget_;
+    std::map<std::string, Entry> encoders_;
+
+    std::vector<std::string> rebalance();
+    void notify(const std::vector<std::string> &ids);
+};
+}
+
+#endif
@@ -0,0 +1,221 @@
+//
+// event-log.cpp
+//
+//  Created by Peter Gusev on 1 April 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <boost/chrono.hpp>
+
+#include "event-log.hpp"
+#include "clock.hpp"
+
+#define EVENT_LOG_MAGIC "NRTCEVLG"
+#define EVENT_LOG_VERSION 1
+
+using namespace ndnrtc;
+using namespace ndnrtc::eventlog;
+
+std::atomic<EventLog *> EventLog::current_(nullptr);
+
+static void throwError(const std::string &msg, const std::string &path)
+{
+    std::stringstream ss;
+    ss << msg << " " << path << ": " << strerror(errno);
+    throw std::runtime_error(ss.str());
+}
+
+void EventLog::start(const std::string &path, size_t capacity)
+{
+    // active log may be in use by writers, thus it can't be replaced
+    if (get())
+        throw std::runtime_error("event log is already active: " + get()->getPath());
+
+    EventLog *log = new EventLog(path, capacity);
+    EventLog *expected = nullptr;
+
+    if (!current_.compare_exchange_strong(expected, log, std::memory_order_acq_rel))
+    {
+        delete log;
+        throw std::runtime_error("event log is already active");
+    }
+}
+
+void EventLog::stop()
+{
+    EventLog *log = current_.exchange(nullptr, std::memory_order_acq_rel);
+
+    if (log)
+        delete log;
+}
+
+EventLog::EventLog(const std::string &path, size_t capacity)
+    : path_(path), fd_(-1), mappedSize_(0), header_(nullptr), records_(nullptr)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    mask_ = size - 1;
+
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+        throwError("can't open event log", path);
+
+    mappedSize_ = sizeof(EventLogHeader) + size * sizeof(EventRecord);
+    if (ftruncate(fd_, mappedSize_) != 0)
+    {
+        close(fd_);
+        throwError("can't allocate event log", path);
+    }
+
+    void *mem = mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mem == MAP_FAILED)
+    {
+        close(fd_);
+        throwError("can't map event log", path);
+    }
+
+    header_ = (EventLogHeader *)mem;
+    records_ = (EventRecord *)((uint8_t *)mem + sizeof(EventLogHeader));
+
+    // file was truncated, so all records are zeroed (empty)
+    memcpy(header_->magic_, EVENT_LOG_MAGIC, sizeof(header_->magic_));
+    header_->version_ = EVENT_LOG_VERSION;
+    header_->recordSize_ = sizeof(EventRecord);
+    header_->capacity_ = size;
+    header_->writePos_ = 0;
+    header_->startUnixUs_ = boost::chrono::duration_cast<boost::chrono::microseconds>(
+                                boost::chrono::system_clock::now().time_since_epoch())
+                                .count();
+    header_->startTimestampUs_ = clock::microsecondTimestamp();
+}
+
+EventLog::~EventLog()
+{
+    msync(header_, mappedSize_, MS_SYNC);
+    munmap(header_, mappedSize_);
+    close(fd_);
+}
+
+void EventLog::write(Component component, Event event, const void *instance,
+                     int64_t a0, int64_t a1, int64_t a2, int64_t a3, int64_t a4)
+{
+    uint64_t pos = __atomic_fetch_add(&header_->writePos_, 1, __ATOMIC_RELAXED);
+    EventRecord &r = records_[pos & mask_];
+
+    // record is marked incomplete while it's being written, so reader skips
+    // it if writer is interrupted
+    __atomic_store_n(&r.seqNo_, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    r.timestampUs_ = clock::microsecondTimestamp();
+    r.component_ = (uint16_t)component;
+    r.event_ = (uint16_t)event;
+    r.instance_ = (uint32_t)(uintptr_t)instance;
+    r.args_[0] = a0;
+    r.args_[1] = a1;
+    r.args_[2] = a2;
+    r.args_[3] = a3;
+    r.args_[4] = a4;
+
+    __atomic_store_n(&r.seqNo_, pos + 1, __ATOMIC_RELEASE);
+}
+
+uint64_t EventLog::getWrittenNum() const
+{
+    return __atomic_load_n(&header_->writePos_, __ATOMIC_RELAXED);
+}
+
+void EventLog::read(const std::string &path, EventLogHeader &header,
+                    std::vector<EventRecord> &records)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (!file.is_open())
+        throwError("can't open event log", path);
+
+    uint64_t fileSize = (uint64_t)file.tellg();
+    file.seekg(0);
+    file.read((char *)&header, sizeof(header));
+
+    if (!file || memcmp(header.magic_, EVENT_LOG_MAGIC, sizeof(header.magic_)) != 0 ||
+        header.recordSize_ != sizeof(EventRecord))
+        throw std::runtime_error("not an event log file: " + path);
+
+    // capacity comes from the file, thus it's checked before allocating slots
+    if (header.capacity_ > (fileSize - sizeof(header)) / sizeof(EventRecord))
+        throw std::runtime_error("truncated or corrupted event log file: " + path);
+
+    records.clear();
+
+    size_t nRecords = (size_t)std::min<uint64_t>(header.writePos_, header.capacity_);
+    std::vector<EventRecord> slots(header.capacity_);
+    file.read((char *)slots.data(), slots.size() * sizeof(EventRecord));
+
+    records.reserve(nRecords);
+    for (auto &r : slots)
+        if (r.seqNo_)
+            records.push_back(r);
+
+    std::sort(records.begin(), records.end(),
+              [](const EventRecord &a, const EventRecord &b) { return a.seqNo_ < b.seqNo_; });
+}
+
+const char *EventLog::toString(Component component)
+{
+    switch (component)
+    {
+    case Component::PipelineControl:
+        return "pipeline-control";
+    case Component::Pipeliner:
+        return "pipeliner";
+    case Component::SegmentController:
+        return "segment-controller";
+    case Component::Buffer:
+        return "buffer";
+    case Component::RtxController:
+        return "rtx-controller";
+    default:
+        return "unknown";
+    }
+}
+
+const char *EventLog::toString(Event event)
+{
+    switch (event)
+    {
+    case Event::StateTransition:
+        return "state-transition";
+    case Event::SampleRequested:
+        return "sample-requested";
+    case Event::SegmentsRerequested:
+        return "segments-rerequested";
+    case Event::SegmentArrived:
+        return "segment-arrived";
+    case Event::SegmentTimeout:
+        return "segment-timeout";
+    case Event::AppNack:
+        return "app-nack";
+    case Event::NetworkNack:
+        return "network-nack";
+    case Event::SlotRequested:
+        return "slot-requested";
+    case Event::SlotAssembling:
+        return "slot-assembling";
+    case Event::SlotReady:
+        return "slot-ready";
+    case Event::RtxRequired:
+        return "rtx-required";
+    default:
+        return "unknown";
+    }
+}
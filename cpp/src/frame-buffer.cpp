@@ -19,6 +19,7 @@
 #include "name-components.hpp"
 #include "simple-log.hpp"
 #include "statistics.hpp"
+#include "event-log.hpp"
 
 using namespace std;
 using namespace ndnrtc;
@@ -617,6 +618,10 @@ Buffer::requested(const std::vector<boost::shared_ptr<const ndn::Interest>>& int
 
         LogTraceC << "▷▷▷" << activeSlots_[it.first]->dump()
         << " x" << it.second.size() << std::endl;
+        eventlog::write(eventlog::Component::Buffer, eventlog::Event::SlotRequested, this,
+                        (activeSlots_[it.first]->getNameInfo().class_ == SampleClass::Key),
+                        activeSlots_[it.first]->getNameInfo().sampleNo_,
+                        it.second.size(), activeSlots_.size());
         //LogDebugC << shortdump() << std::endl;
         LogTraceC << dump() << std::endl;
     }
@@ -651,6 +656,10 @@ Buffer::received(const boost::shared_ptr<WireSegment>& segment)
         {
             LogTraceC << "►►►" << receipt.slot_->dump(true)
                 << " " << shortdump() << std::endl;
+            eventlog::write(eventlog::Component::Buffer, eventlog::Event::SlotReady, this,
+                            (receipt.slot_->getNameInfo().class_ == SampleClass::Key),
+                            receipt.slot_->getNameInfo().sampleNo_,
+                            receipt.slot_->getFetchedNum(), receipt.slot_->getLongestDrd());
             
             (*sstorage_)[Indicator::AssembledNum]++;
             if (receipt.slot_->getNameInfo().class_ == SampleClass::Key)
@@ -673,6 +682,12 @@ Buffer::received(const boost::shared_ptr<WireSegment>& segment)
                       << std::endl;
         LogTraceC << " ► " << receipt.slot_->dump(true)
                   << receipt.segment_->getInfo().segNo_ << std::endl;
+        eventlog::write(eventlog::Component::Buffer, eventlog::Event::SlotAssembling, this,
+                        (receipt.slot_->getNameInfo().class_ == SampleClass::Key),
+                        receipt.slot_->getNameInfo().sampleNo_,
+                        receipt.slot_->getFetchedNum(),
+                        (int64_t)(receipt.slot_->getAssembledLevel() * 1000),
+                        receipt.slot_->getState());
     }
     
     for (auto o:observers_) o->onNewData(receipt);
@@ -6,12 +6,110 @@
 //
 
 #include <webrtc/common_video/libyuv/include/webrtc_libyuv.h>
+#include <webrtc/common_video/include/video_frame_buffer.h>
+#include <libyuv/convert.h>
+#include <libyuv/scale.h>
+#include <boost/thread/lock_guard.hpp>
 #include "frame-converter.hpp"
 #include <stdexcept>
+#include <algorithm>
 
 using namespace ndnrtc;
 using namespace webrtc;
-#include <iostream>
+
+// number of destination blocks (2*factor source rows each) converted and
+// downscaled at once; keeps source band and its' I420 copy in cache
+#define FUSED_BAND_BLOCKS 4
+
+namespace {
+	// converts band of source rows into rows of full resolution I420 planes
+	typedef boost::function<int(unsigned int row, unsigned int nRows,
+		uint8_t *dstY, int strideY, uint8_t *dstU, int strideU,
+		uint8_t *dstV, int strideV)> ConvertBandFunc;
+
+	int convertAndDownscaleBands(unsigned int width, unsigned int height,
+		WebRtcVideoFrameBuffer *full, WebRtcVideoFrameBuffer *scaled,
+		ConvertBandFunc convertBand)
+	{
+		unsigned int factor = width / scaled->width();
+		unsigned int bandHeight = 2*factor*FUSED_BAND_BLOCKS;
+
+		for (unsigned int row = 0; row < height; row += bandHeight)
+		{
+			unsigned int nRows = std::min(bandHeight, height - row);
+			uint8_t *y = full->MutableDataY() + row*full->StrideY();
+			uint8_t *u = full->MutableDataU() + row/2*full->StrideU();
+			uint8_t *v = full->MutableDataV() + row/2*full->StrideV();
+
+			if (convertBand(row, nRows, y, full->StrideY(), u, full->StrideU(), v, full->StrideV()) < 0)
+				return -1;
+
+			// box filter of integer factor never crosses band boundaries,
+			// thus downscaled band is the same as if whole frame was scaled
+			libyuv::ScalePlane(y, full->StrideY(), width, nRows,
+				scaled->MutableDataY() + row/factor*scaled->StrideY(), scaled->StrideY(),
+				width/factor, nRows/factor, libyuv::kFilterBox);
+			libyuv::ScalePlane(u, full->StrideU(), width/2, nRows/2,
+				scaled->MutableDataU() + row/(2*factor)*scaled->StrideU(), scaled->StrideU(),
+				width/(2*factor), nRows/(2*factor), libyuv::kFilterBox);
+			libyuv::ScalePlane(v, full->StrideV(), width/2, nRows/2,
+				scaled->MutableDataV() + row/(2*factor)*scaled->StrideV(), scaled->StrideV(),
+				width/(2*factor), nRows/(2*factor), libyuv::kFilterBox);
+		}
+
+		return 0;
+	}
+}
+
+//******************************************************************************
+WebRtcSmartPtr<WebRtcVideoFrameBuffer>
+FrameBufferPool::getBuffer(int width, int height, int strideY, int strideU, int strideV)
+{
+	boost::lock_guard<boost::mutex> scopedLock(mutex_);
+	Geometry geometry(width, height, strideY, strideU, strideV);
+
+	if (buffers_.find(geometry) == buffers_.end())
+	{
+		// geometry has changed - release free buffers of other geometries
+		for (auto it = buffers_.begin(); it != buffers_.end(); )
+		{
+			auto &bufs = it->second;
+			bufs.erase(std::remove_if(bufs.begin(), bufs.end(),
+				[](const WebRtcSmartPtr<PooledBuffer>& b){ return b->HasOneRef(); }), bufs.end());
+
+			if (bufs.empty())
+				it = buffers_.erase(it);
+			else
+				++it;
+		}
+	}
+
+	std::vector<WebRtcSmartPtr<PooledBuffer>> &buffers = buffers_[geometry];
+	// buffer, referenced only by the pool, is free
+	for (auto &b:buffers)
+		if (b->HasOneRef())
+			return b;
+
+	WebRtcSmartPtr<PooledBuffer> buffer(new PooledBuffer(width, height, strideY, strideU, strideV));
+
+	if (buffers.size() < maxBuffers_)
+		buffers.push_back(buffer);
+
+	return buffer;
+}
+
+size_t
+FrameBufferPool::getBuffersNum() const
+{
+	boost::lock_guard<boost::mutex> scopedLock(mutex_);
+	size_t n = 0;
+
+	for (auto &it:buffers_)
+		n += it.second.size();
+	return n;
+}
+
+//******************************************************************************
 WebRtcVideoFrame RawFrameConverter::operator<<(const struct _8bitFixedSizeRawFrameWrapper& wr)
 {
     // NOTE: after many hours debugging and reading bytes, it is still uknown 
@@ -29,15 +127,7 @@ WebRtcVideoFrame RawFrameConverter::convert(const ArgbRawFrameWrapper& wr, const
 {             
 	// make conversion to I420
 
-	int stride_y = wr.width_;
-	int stride_uv = (wr.width_ + 1) / 2;
-	int target_width = wr.width_;
-	int target_height = wr.height_;
-
-	frameBuffer_ = I420Buffer::Create(wr.width_, wr.height_, stride_y, stride_uv, stride_uv);
-
-	if (!frameBuffer_)
-		throw std::runtime_error("Failed to allocate I420 frame");
+	WebRtcSmartPtr<WebRtcVideoFrameBuffer> frameBuffer = pool_.getBuffer(wr.width_, wr.height_);
 
 	const int conversionResult = ConvertToI420(commonVideoType,
 											   wr.frameData_,
@@ -45,25 +135,40 @@ WebRtcVideoFrame RawFrameConverter::convert(const ArgbRawFrameWrapper& wr, const
                                                wr.width_, wr.height_,
                                                wr.frameSize_,
                                                kVideoRotation_0,
-                                               frameBuffer_.get());
+                                               frameBuffer.get());
 	if (conversionResult < 0)
 		throw std::runtime_error("Failed to convert capture frame to I420");
 
-	return WebRtcVideoFrame(frameBuffer_, webrtc::kVideoRotation_0, 0);
+	return WebRtcVideoFrame(frameBuffer, webrtc::kVideoRotation_0, 0);
 }
 
 WebRtcVideoFrame RawFrameConverter::operator<<(const I420RawFrameWrapper& wr)
 {
-	frameBuffer_ = I420Buffer::Create(wr.width_, wr.height_, wr.strideY_, wr.strideU_, wr.strideV_);
+	if (wr.onReleased_)
+	{
+		// zero-copy: frame references caller's planes until it's released
+		rtc::scoped_refptr<VideoFrameBuffer> wrappedBuffer(
+			new rtc::RefCountedObject<WrappedI420Buffer>(wr.width_, wr.height_,
+				wr.yBuffer_, wr.strideY_,
+				wr.uBuffer_, wr.strideU_,
+				wr.vBuffer_, wr.strideV_,
+				rtc::Callback0<void>(wr.onReleased_)));
+
+		return WebRtcVideoFrame(wrappedBuffer, webrtc::kVideoRotation_0, 0);
+	}
+
+	// pooled buffer has the same strides, thus planes are copied as a whole
+	WebRtcSmartPtr<WebRtcVideoFrameBuffer> frameBuffer = 
+		pool_.getBuffer(wr.width_, wr.height_, wr.strideY_, wr.strideU_, wr.strideV_);
 
 	unsigned int ySize = wr.strideY_*wr.height_;
-	unsigned int uSize = wr.strideU_*(wr.height_+1)/2;
-	unsigned int vSize = wr.strideV_*(wr.height_+1)/2;
-	memcpy(frameBuffer_->MutableDataY(), wr.yBuffer_, ySize);
-	memcpy(frameBuffer_->MutableDataU(), wr.uBuffer_, uSize);
-	memcpy(frameBuffer_->MutableDataV(), wr.vBuffer_, vSize);
+	unsigned int uSize = wr.strideU_*((wr.height_+1)/2);
+	unsigned int vSize = wr.strideV_*((wr.height_+1)/2);
+	memcpy(frameBuffer->MutableDataY(), wr.yBuffer_, ySize);
+	memcpy(frameBuffer->MutableDataU(), wr.uBuffer_, uSize);
+	memcpy(frameBuffer->MutableDataV(), wr.vBuffer_, vSize);
 
-	return WebRtcVideoFrame(frameBuffer_, webrtc::kVideoRotation_0, 0);
+	return WebRtcVideoFrame(frameBuffer, webrtc::kVideoRotation_0, 0);
 }
 
 WebRtcVideoFrame RawFrameConverter::operator<<(const YUV_NV21FrameWrapper& wr)
@@ -71,15 +176,7 @@ WebRtcVideoFrame RawFrameConverter::operator<<(const YUV_NV21FrameWrapper& wr)
 	// make conversion to I420
 	const VideoType commonVideoType = RawVideoTypeToCommonVideoVideoType(kVideoNV21);
 
-	int stride_y = wr.width_;
-	int stride_uv = (wr.width_ + 1) / 2;
-	int target_width = wr.width_;
-	int target_height = wr.height_;
-
-	frameBuffer_ = I420Buffer::Create(wr.width_, wr.height_, stride_y, stride_uv, stride_uv);
-
-	if (!frameBuffer_)
-		throw std::runtime_error("Failed to allocate I420 frame");
+	WebRtcSmartPtr<WebRtcVideoFrameBuffer> frameBuffer = pool_.getBuffer(wr.width_, wr.height_);
 
 	const int conversionResult = ConvertToI420(commonVideoType,
 											   wr.yBuffer_,
@@ -87,9 +184,86 @@ WebRtcVideoFrame RawFrameConverter::operator<<(const YUV_NV21FrameWrapper& wr)
                                                wr.width_, wr.height_,
                                                wr.strideY_+wr.strideUV_,
                                                kVideoRotation_0,
-                                               frameBuffer_.get());
+                                               frameBuffer.get());
+	if (conversionResult < 0)
+		throw std::runtime_error("Failed to convert capture frame to I420");
+
+	return WebRtcVideoFrame(frameBuffer, webrtc::kVideoRotation_0, 0);
+}
+
+RawFrameConverter::FramePair
+RawFrameConverter::convertAndDownscale(const struct _8bitFixedSizeRawFrameWrapper& wr,
+	unsigned int dstWidth, unsigned int dstHeight)
+{
+	if (!canFuseDownscale(wr.width_, wr.height_, dstWidth, dstHeight))
+		return downscale(*this << wr, dstWidth, dstHeight);
+
+	WebRtcSmartPtr<WebRtcVideoFrameBuffer> frameBuffer = pool_.getBuffer(wr.width_, wr.height_);
+	WebRtcSmartPtr<WebRtcVideoFrameBuffer> scaledBuffer = downscalePool_.getBuffer(dstWidth, dstHeight);
+	unsigned int srcStride = wr.width_*4;
+	// see operator<< for why ARGB and BGRA are swapped
+	bool isArgb = wr.isArgb_;
+
+	int conversionResult = convertAndDownscaleBands(wr.width_, wr.height_,
+		frameBuffer.get(), scaledBuffer.get(),
+		[&wr, srcStride, isArgb](unsigned int row, unsigned int nRows,
+			uint8_t *y, int strideY, uint8_t *u, int strideU, uint8_t *v, int strideV){
+			const uint8_t *src = wr.frameData_ + row*srcStride;
+
+			if (isArgb)
+				return libyuv::BGRAToI420(src, srcStride, y, strideY, u, strideU, v, strideV,
+					wr.width_, nRows);
+			return libyuv::ARGBToI420(src, srcStride, y, strideY, u, strideU, v, strideV,
+				wr.width_, nRows);
+		});
+	if (conversionResult < 0)
+		throw std::runtime_error("Failed to convert capture frame to I420");
+
+	return FramePair(WebRtcVideoFrame(frameBuffer, webrtc::kVideoRotation_0, 0),
+		WebRtcVideoFrame(scaledBuffer, webrtc::kVideoRotation_0, 0));
+}
+
+RawFrameConverter::FramePair
+RawFrameConverter::convertAndDownscale(const YUV_NV21FrameWrapper& wr,
+	unsigned int dstWidth, unsigned int dstHeight)
+{
+	if (!canFuseDownscale(wr.width_, wr.height_, dstWidth, dstHeight))
+		return downscale(*this << wr, dstWidth, dstHeight);
+
+	WebRtcSmartPtr<WebRtcVideoFrameBuffer> frameBuffer = pool_.getBuffer(wr.width_, wr.height_);
+	WebRtcSmartPtr<WebRtcVideoFrameBuffer> scaledBuffer = downscalePool_.getBuffer(dstWidth, dstHeight);
+
+	int conversionResult = convertAndDownscaleBands(wr.width_, wr.height_,
+		frameBuffer.get(), scaledBuffer.get(),
+		[&wr](unsigned int row, unsigned int nRows,
+			uint8_t *y, int strideY, uint8_t *u, int strideU, uint8_t *v, int strideV){
+			return libyuv::NV21ToI420(wr.yBuffer_ + row*wr.strideY_, wr.strideY_,
+				wr.uvBuffer_ + row/2*wr.strideUV_, wr.strideUV_,
+				y, strideY, u, strideU, v, strideV, wr.width_, nRows);
+		});
 	if (conversionResult < 0)
 		throw std::runtime_error("Failed to convert capture frame to I420");
 
-	return WebRtcVideoFrame(frameBuffer_, webrtc::kVideoRotation_0, 0);
+	return FramePair(WebRtcVideoFrame(frameBuffer, webrtc::kVideoRotation_0, 0),
+		WebRtcVideoFrame(scaledBuffer, webrtc::kVideoRotation_0, 0));
+}
+
+bool RawFrameConverter::canFuseDownscale(unsigned int srcWidth, unsigned int srcHeight,
+	unsigned int dstWidth, unsigned int dstHeight)
+{
+	if (!dstWidth || !dstHeight || dstWidth % 2 || dstHeight % 2)
+		return false;
+
+	unsigned int factor = srcWidth / dstWidth;
+	return (factor >= 2 && srcWidth == factor*dstWidth && srcHeight == factor*dstHeight);
+}
+
+RawFrameConverter::FramePair
+RawFrameConverter::downscale(const WebRtcVideoFrame& frame, unsigned int dstWidth,
+	unsigned int dstHeight)
+{
+	WebRtcSmartPtr<WebRtcVideoFrameBuffer> scaledBuffer = downscalePool_.getBuffer(dstWidth, dstHeight);
+	scaledBuffer->ScaleFrom(*(frame.video_frame_buffer()));
+
+	return FramePair(frame, WebRtcVideoFrame(scaledBuffer, frame.rotation(), frame.timestamp_us()));
 }
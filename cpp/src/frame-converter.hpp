@@ -5,6 +5,17 @@
 //  Copyright 2013-2016 Regents of the University of California
 //
 
+#ifndef __frame_converter_hpp__
+#define __frame_converter_hpp__
+
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <webrtc/base/refcount.h>
+
 #include "webrtc.hpp"
 
 namespace ndnrtc {
@@ -28,6 +39,10 @@ namespace ndnrtc {
 		const unsigned char* yBuffer_;
 		const unsigned char* uBuffer_;
 		const unsigned char* vBuffer_;
+		// if set, frame planes are wrapped without copying; caller must keep
+		// them intact until this callback is called (once all scalers and
+		// encoders have released the frame)
+		boost::function<void()> onReleased_;
 	} I420RawFrameWrapper;
 
 	typedef struct _YUV_NV21FrameWrapper {
@@ -39,14 +54,55 @@ namespace ndnrtc {
 		const unsigned char* uvBuffer_;
 	} YUV_NV21FrameWrapper; 
 
+	/**
+	 * Pool of I420 frame buffers keyed by frame geometry (width, height and
+	 * plane strides). Buffer returns to the pool automatically once all
+	 * frames that reference it are released, so pooled buffers can be
+	 * handed over to other threads. If all pooled buffers of requested
+	 * geometry are in use and pool is at capacity, a new unpooled buffer is
+	 * allocated. Free buffers of other geometries are released when a new
+	 * geometry is requested.
+	 * The class is thread-safe.
+	 */
+	class FrameBufferPool
+	{
+	public:
+		FrameBufferPool(size_t maxBuffers = 8):maxBuffers_(maxBuffers){}
+		~FrameBufferPool(){}
+
+		WebRtcSmartPtr<WebRtcVideoFrameBuffer> getBuffer(int width, int height,
+			int strideY, int strideU, int strideV);
+		WebRtcSmartPtr<WebRtcVideoFrameBuffer> getBuffer(int width, int height)
+		{ return getBuffer(width, height, width, (width+1)/2, (width+1)/2); }
+
+		// number of buffers currently owned by the pool
+		size_t getBuffersNum() const;
+
+	private:
+		typedef rtc::RefCountedObject<WebRtcVideoFrameBuffer> PooledBuffer;
+		typedef std::tuple<int, int, int, int, int> Geometry;
+
+		FrameBufferPool(const FrameBufferPool&) = delete;
+
+		mutable boost::mutex mutex_;
+		size_t maxBuffers_;
+		std::map<Geometry, std::vector<WebRtcSmartPtr<PooledBuffer>>> buffers_;
+	};
+
 	/**
 	 * FrameConverter converts wrappers of raw video frames into a
-	 * WebRTC raw video frame object. Converted object is stored inside the
-	 * converter and is valid as long as converter lives.
+	 * WebRTC raw video frame object. Converted frames are allocated from
+	 * converter's buffer pool and may outlive the converter.
+	 * ARGB/BGRA and NV21 frames may also be downscaled while being
+	 * converted: source is converted in horizontal bands and every band is
+	 * box-filtered to the lower resolution while it is still in cache, so
+	 * the full frame is read from memory only once.
 	 */
 	class RawFrameConverter 
 	{
 	public:
+		typedef std::pair<WebRtcVideoFrame, WebRtcVideoFrame> FramePair;
+
 		RawFrameConverter(){}
 		~RawFrameConverter(){}
 
@@ -54,10 +110,39 @@ namespace ndnrtc {
 		WebRtcVideoFrame operator<<(const I420RawFrameWrapper&);
 		WebRtcVideoFrame operator<<(const YUV_NV21FrameWrapper&);
 
+		/**
+		 * Converts frame to I420 and downscales it to dstWidth x dstHeight.
+		 * If canFuseDownscale() is true for given resolutions, both are done
+		 * in one pass over the source; otherwise frame is converted and then
+		 * scaled as usual.
+		 * @return Pair of full resolution and downscaled frames
+		 */
+		FramePair convertAndDownscale(const struct _8bitFixedSizeRawFrameWrapper&,
+			unsigned int dstWidth, unsigned int dstHeight);
+		FramePair convertAndDownscale(const YUV_NV21FrameWrapper&,
+			unsigned int dstWidth, unsigned int dstHeight);
+
+		/**
+		 * Fused downscaling requires source resolution to be an integer
+		 * multiple (2 or more) of destination resolution, with the same
+		 * factor for both dimensions, and destination resolution to be even.
+		 */
+		static bool canFuseDownscale(unsigned int srcWidth, unsigned int srcHeight,
+			unsigned int dstWidth, unsigned int dstHeight);
+
+		const FrameBufferPool& getPool() const { return pool_; }
+		const FrameBufferPool& getDownscalePool() const { return downscalePool_; }
+
 	private:
-		WebRtcSmartPtr<WebRtcVideoFrameBuffer> frameBuffer_;
+		// downscaled frames have their own pool, so that alternating
+		// geometries do not release each others' buffers
+		FrameBufferPool pool_, downscalePool_;
 
         WebRtcVideoFrame convert(const struct _8bitFixedSizeRawFrameWrapper&, 
                                  const webrtc::VideoType&);
+        FramePair downscale(const WebRtcVideoFrame&, unsigned int dstWidth,
+                            unsigned int dstHeight);
 	};
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
@@ -71,6 +71,22 @@ class DataSegment : protected DataPacket::Blob
         return sp;
     }
 
+    /**
+     * Writes segment wire data (header followed by payload) into the buffer.
+     * Unlike getNetworkData(), payload is copied only once and no
+     * intermediate packet is created, so this is used for publishing.
+     */
+    void write(std::vector<uint8_t> &buffer) const
+    {
+        buffer.resize(size());
+        buffer[0] = 1;
+        buffer[1] = sizeof(Header) & 0x00ff;
+        buffer[2] = (sizeof(Header) & 0xff00) >> 8;
+        memcpy(buffer.data() + 3, &header_, sizeof(Header));
+        if (Blob::size())
+            memcpy(buffer.data() + 3 + sizeof(Header), Blob::data(), Blob::size());
+    }
+
     /**
      * This calculates total wire length for a segment with given payload 
      * length
@@ -136,6 +152,17 @@ typedef DataSegment<DataSegmentHeader> CommonSegment;
 template <typename T = Mutable>
 class VideoFramePacketT : public HeaderPacketT<CommonHeader, T>
 {
+    typedef struct _Header
+    {
+        uint32_t encodedWidth_;
+        uint32_t encodedHeight_;
+        uint32_t timestamp_;
+        int64_t capture_time_ms_;
+        WebRtcVideoFrameType frameType_;
+        bool completeFrame_;
+        uint32_t frameLength_;
+    } __attribute__((packed)) Header;
+
   public:
     typedef std::map<std::string, PacketNumber> ThreadSyncList;
 
@@ -143,22 +170,7 @@ class VideoFramePacketT : public HeaderPacketT<CommonHeader, T>
     VideoFramePacketT(const boost::shared_ptr<const std::vector<uint8_t>> &data) : HeaderPacketT<CommonHeader, T>(data) {}
 
     ENABLE_IF(T, Mutable)
-    VideoFramePacketT(const webrtc::EncodedImage &frame) : HeaderPacketT<CommonHeader, T>(frame._length, frame._buffer),
-                                                           isSyncListSet_(false)
-    {
-        assert(frame._encodedWidth);
-        assert(frame._encodedHeight);
-
-        Header hdr;
-        hdr.encodedWidth_ = frame._encodedWidth;
-        hdr.encodedHeight_ = frame._encodedHeight;
-        hdr.timestamp_ = frame._timeStamp;
-        hdr.capture_time_ms_ = frame.capture_time_ms_;
-        hdr.frameType_ = frame._frameType;
-        hdr.completeFrame_ = frame._completeFrame;
-        hdr.frameLength_ = frame._length;
-        this->addBlob(sizeof(hdr), (uint8_t *)&hdr);
-    }
+    VideoFramePacketT(const webrtc::EncodedImage &frame) : VideoFramePacketT(frame, frameHeader(frame)) {}
 
     ENABLE_IF(T, Mutable)
     VideoFramePacketT(NetworkData &&networkData) : CommonSamplePacket(boost::move(networkData)) {}
@@ -229,12 +241,14 @@ class VideoFramePacketT : public HeaderPacketT<CommonHeader, T>
         if (isSyncListSet_)
             throw std::runtime_error("Sync list has been already set");
 
-        for (auto it : syncList)
+        DataPacketBuilder builder;
+        for (auto &it : syncList)
         {
-            this->addBlob(it.first.size(), (uint8_t *)it.first.c_str());
-            this->addBlob(sizeof(it.second), (uint8_t *)&it.second);
+            builder.addBlob(it.first.size(), (const uint8_t *)it.first.c_str());
+            builder.addBlob(sizeof(it.second), (const uint8_t *)&it.second);
         }
 
+        this->addBlobs(builder);
         isSyncListSet_ = true;
     }
 
@@ -245,19 +259,32 @@ class VideoFramePacketT : public HeaderPacketT<CommonHeader, T>
     merge(const ImmutableVideoSegmentsVector &segments);
 
   private:
-    typedef struct _Header
-    {
-        uint32_t encodedWidth_;
-        uint32_t encodedHeight_;
-        uint32_t timestamp_;
-        int64_t capture_time_ms_;
-        WebRtcVideoFrameType frameType_;
-        bool completeFrame_;
-        uint32_t frameLength_;
-    } __attribute__((packed)) Header;
-
     webrtc::EncodedImage frame_;
     bool isSyncListSet_;
+
+    // frame header and encoded frame are written into packet in one pass
+    ENABLE_IF(T, Mutable)
+    VideoFramePacketT(const webrtc::EncodedImage &frame, const Header &hdr)
+        : HeaderPacketT<CommonHeader, T>(DataPacketBuilder()
+                                             .addBlob(sizeof(hdr), (const uint8_t *)&hdr)
+                                             .setPayload(frame._length, frame._buffer)),
+          isSyncListSet_(false) {}
+
+    static Header frameHeader(const webrtc::EncodedImage &frame)
+    {
+        assert(frame._encodedWidth);
+        assert(frame._encodedHeight);
+
+        Header hdr;
+        hdr.encodedWidth_ = frame._encodedWidth;
+        hdr.encodedHeight_ = frame._encodedHeight;
+        hdr.timestamp_ = frame._timeStamp;
+        hdr.capture_time_ms_ = frame.capture_time_ms_;
+        hdr.frameType_ = frame._frameType;
+        hdr.completeFrame_ = frame._completeFrame;
+        hdr.frameLength_ = frame._length;
+        return hdr;
+    }
 };
 
 typedef VideoFramePacketT<> VideoFramePacket;
@@ -266,6 +293,10 @@ typedef VideoFramePacketT<Immutable> ImmutableVideoFramePacket;
 /*******************************************************************************
  * AudioBundlePacket provides interface for bundling audio samples and 
  * preparing them for publishing as a data packet.
+ * Mutable bundle allocates its storage once, for the wire length given at
+ * construction, and samples are appended to it in place. Bundles can be
+ * swapped and cleared without re-allocation, so capturing side may keep 
+ * filling one bundle while another one is being published.
  */
 template <typename T>
 class AudioBundlePacketT : public HeaderPacketT<CommonHeader, T>
@@ -316,6 +347,8 @@ class AudioBundlePacketT : public HeaderPacketT<CommonHeader, T>
     ENABLE_IF(T, Mutable)
     AudioBundlePacketT(size_t wireLength) : HeaderPacketT<CommonHeader, T>(std::vector<uint8_t>()), wireLength_(wireLength)
     {
+        this->_data().reserve(wireLength_);
+        this->blobs_.reserve(payloadLength(wireLength_) / DataPacket::wireLength(AudioSampleBlob::wireLength(1)) + 1);
         clear();
     }
 
@@ -327,6 +360,14 @@ class AudioBundlePacketT : public HeaderPacketT<CommonHeader, T>
         return ((long)remainingSpace_ - (long)DataPacket::wireLength(sampleBlob.size())) >= 0;
     }
 
+    /**
+     * Checks whether bundle has space for a sample with given data length
+     */
+    bool hasSpace(size_t sampleDataLength) const
+    {
+        return ((long)remainingSpace_ - (long)DataPacket::wireLength(AudioSampleBlob::wireLength(sampleDataLength))) >= 0;
+    }
+
     size_t getRemainingSpace() const { return remainingSpace_; }
 
     ENABLE_IF(T, Mutable)
@@ -339,30 +380,41 @@ class AudioBundlePacketT : public HeaderPacketT<CommonHeader, T>
     ENABLE_IF(T, Mutable)
     AudioBundlePacketT<T> &operator<<(const AudioSampleBlob &sampleBlob)
     {
-        if (hasSpace(sampleBlob))
-        {
-            this->_data()[0]++;
-
-            uint8_t b1 = sampleBlob.size() & 0x00ff, b2 = (sampleBlob.size() & 0xff00) >> 8;
-            this->payloadBegin_ = this->_data().insert(this->payloadBegin_, b1);
-            this->payloadBegin_++;
-            this->payloadBegin_ = this->_data().insert(this->payloadBegin_, b2);
-            this->payloadBegin_++;
-            for (int i = 0; i < sizeof(sampleBlob.getHeader()); ++i)
-            {
-                this->payloadBegin_ = this->_data().insert(this->payloadBegin_, ((uint8_t *)&sampleBlob.getHeader())[i]);
-                this->payloadBegin_++;
-            }
-            // insert blob
-            this->_data().insert(this->payloadBegin_, sampleBlob.data(),
-                                 sampleBlob.data() + (sampleBlob.size() - sizeof(sampleBlob.getHeader())));
-            this->reinit();
-            remainingSpace_ -= DataPacket::wireLength(sampleBlob.size());
-        }
-        else
+        append(sampleBlob.getHeader(), sampleBlob.data(), sampleBlob.payloadLength());
+        return *this;
+    }
+
+    /**
+     * Appends sample to the end of the bundle. Sample data is copied directly
+     * into bundle storage, no memory is allocated unless bundle was not 
+     * created with the wire length constructor.
+     */
+    ENABLE_IF(T, Mutable)
+    void append(const AudioSampleHeader &header, const uint8_t *sampleData, size_t dataLength)
+    {
+        if (this->isHeaderSet())
+            throw std::runtime_error("Can't add more data to this packet"
+                                     " as header has been set already");
+        if (!hasSpace(dataLength))
             throw std::runtime_error("Can not add sample to bundle: no free space");
 
-        return *this;
+        // bundle has no payload, so sample blob goes right to the end
+        std::vector<uint8_t> &data = this->_data();
+        const uint8_t *storage = data.data();
+        uint16_t blobSize = AudioSampleBlob::wireLength(dataLength);
+
+        data[0]++;
+        data.push_back(blobSize & 0x00ff);
+        data.push_back((blobSize & 0xff00) >> 8);
+        data.insert(data.end(), (const uint8_t *)&header, (const uint8_t *)&header + sizeof(header));
+        data.insert(data.end(), sampleData, sampleData + dataLength);
+
+        if (storage == data.data())
+            this->blobs_.push_back(typename DataPacketT<T>::Blob(data.end() - blobSize, data.end()));
+        else
+            this->reinit(); // storage was relocated
+        this->payloadBegin_ = data.end();
+        remainingSpace_ -= DataPacket::wireLength(blobSize);
     }
 
     size_t getSamplesNum() const
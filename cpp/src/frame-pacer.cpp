@@ -0,0 +1,276 @@
+//
+// frame-pacer.cpp
+//
+//  Created by Peter Gusev on 26 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include "frame-pacer.hpp"
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "clock.hpp"
+
+#if BOOST_ASIO_HAS_STD_CHRONO
+
+namespace lib_chrono = std::chrono;
+
+#else
+
+namespace lib_chrono = boost::chrono;
+
+#endif
+
+using namespace ndnrtc;
+
+namespace ndnrtc
+{
+class FramePacerImpl : public boost::enable_shared_from_this<FramePacerImpl>
+{
+  public:
+    FramePacerImpl(boost::asio::io_service &io, double rate,
+                   FramePacer::OnFrame onFrame, unsigned int maxDuplicates);
+
+    void start();
+    void stop();
+    void setRate(double rate);
+    bool push(const WebRtcVideoFrame &frame, const WebRtcVideoFrame *downscaled);
+
+    void setupTimer();
+    void onFire(const boost::system::error_code &e);
+
+    boost::atomic<bool> isRunning_;
+    boost::asio::steady_timer timer_;
+    FramePacer::OnFrame onFrame_;
+    unsigned int maxDuplicates_;
+
+    // held while timer is set up or cancelled and while a tick is being
+    // fired, so that stop() waits for onFrame_ callback in progress
+    boost::mutex callbackMutex_;
+    // guards frame slot, counters and rate
+    mutable boost::mutex mutex_;
+    boost::shared_ptr<WebRtcVideoFrame> frame_, downscaled_;
+    bool isFresh_;
+    unsigned int nDuplicates_;
+    uint64_t releasedNum_, droppedNum_, duplicatedNum_;
+    double rate_;
+    bool isRateChanged_;
+
+    // accessed on io thread only
+    int64_t epochUs_, intervalUs_;
+    int64_t tickNo_;
+};
+}
+
+//******************************************************************************
+FramePacer::FramePacer(boost::asio::io_service &io, double rate, OnFrame onFrame,
+                       unsigned int maxDuplicates)
+    : pimpl_(boost::make_shared<FramePacerImpl>(io, rate, onFrame, maxDuplicates))
+{
+    if (rate <= 0)
+        throw std::runtime_error("Frame pacer rate must be positive");
+}
+
+FramePacer::~FramePacer()
+{
+    pimpl_->stop();
+}
+
+void FramePacer::start()
+{
+    pimpl_->start();
+}
+
+void FramePacer::stop()
+{
+    pimpl_->stop();
+}
+
+bool FramePacer::isRunning() const
+{
+    return pimpl_->isRunning_;
+}
+
+void FramePacer::setRate(double rate)
+{
+    pimpl_->setRate(rate);
+}
+
+double FramePacer::getRate() const
+{
+    boost::lock_guard<boost::mutex> scopedLock(pimpl_->mutex_);
+    return pimpl_->rate_;
+}
+
+bool FramePacer::push(const WebRtcVideoFrame &frame, const WebRtcVideoFrame *downscaled)
+{
+    return pimpl_->push(frame, downscaled);
+}
+
+uint64_t FramePacer::getReleasedNum() const
+{
+    boost::lock_guard<boost::mutex> scopedLock(pimpl_->mutex_);
+    return pimpl_->releasedNum_;
+}
+
+uint64_t FramePacer::getDroppedNum() const
+{
+    boost::lock_guard<boost::mutex> scopedLock(pimpl_->mutex_);
+    return pimpl_->droppedNum_;
+}
+
+uint64_t FramePacer::getDuplicatedNum() const
+{
+    boost::lock_guard<boost::mutex> scopedLock(pimpl_->mutex_);
+    return pimpl_->duplicatedNum_;
+}
+
+//******************************************************************************
+FramePacerImpl::FramePacerImpl(boost::asio::io_service &io, double rate,
+                               FramePacer::OnFrame onFrame, unsigned int maxDuplicates)
+    : isRunning_(false), timer_(io), onFrame_(onFrame), maxDuplicates_(maxDuplicates),
+      isFresh_(false), nDuplicates_(0), releasedNum_(0), droppedNum_(0), duplicatedNum_(0),
+      rate_(rate), isRateChanged_(false), epochUs_(0), intervalUs_(0), tickNo_(0)
+{
+}
+
+void FramePacerImpl::start()
+{
+    boost::lock_guard<boost::mutex> callbackLock(callbackMutex_);
+    if (isRunning_)
+        return;
+
+    {
+        boost::lock_guard<boost::mutex> scopedLock(mutex_);
+        intervalUs_ = (int64_t)(1000000. / rate_);
+        isRateChanged_ = false;
+    }
+
+    epochUs_ = clock::microsecondTimestamp();
+    tickNo_ = 1;
+    isRunning_ = true;
+    setupTimer();
+}
+
+void FramePacerImpl::stop()
+{
+    {
+        // waits for a tick being fired; later ticks see pacer stopped
+        boost::lock_guard<boost::mutex> callbackLock(callbackMutex_);
+        if (isRunning_)
+        {
+            isRunning_ = false;
+            timer_.cancel();
+        }
+    }
+
+    boost::lock_guard<boost::mutex> scopedLock(mutex_);
+    frame_.reset();
+    downscaled_.reset();
+    isFresh_ = false;
+}
+
+void FramePacerImpl::setRate(double rate)
+{
+    if (rate <= 0)
+        return;
+
+    boost::lock_guard<boost::mutex> scopedLock(mutex_);
+    rate_ = rate;
+    isRateChanged_ = true;
+}
+
+bool FramePacerImpl::push(const WebRtcVideoFrame &frame, const WebRtcVideoFrame *downscaled)
+{
+    boost::lock_guard<boost::mutex> scopedLock(mutex_);
+    bool dropped = isFresh_;
+
+    if (dropped)
+        droppedNum_++;
+
+    // frames share reference-counted buffers, thus copies are cheap
+    frame_ = boost::make_shared<WebRtcVideoFrame>(frame);
+    if (downscaled)
+        downscaled_ = boost::make_shared<WebRtcVideoFrame>(*downscaled);
+    else
+        downscaled_.reset();
+    isFresh_ = true;
+
+    return !dropped;
+}
+
+void FramePacerImpl::setupTimer()
+{
+    int64_t deadlineUs = epochUs_ + tickNo_ * intervalUs_;
+    int64_t nowUs = clock::microsecondTimestamp();
+
+    timer_.expires_from_now(lib_chrono::microseconds(deadlineUs > nowUs ? deadlineUs - nowUs : 0));
+    timer_.async_wait(boost::bind(&FramePacerImpl::onFire, shared_from_this(),
+                                  boost::asio::placeholders::error));
+}
+
+void FramePacerImpl::onFire(const boost::system::error_code &e)
+{
+    boost::lock_guard<boost::mutex> callbackLock(callbackMutex_);
+    if (e || !isRunning_)
+        return;
+
+    int64_t tickUs = epochUs_ + tickNo_ * intervalUs_;
+    boost::shared_ptr<WebRtcVideoFrame> frame, downscaled;
+
+    {
+        boost::lock_guard<boost::mutex> scopedLock(mutex_);
+
+        if (frame_)
+        {
+            if (isFresh_)
+            {
+                isFresh_ = false;
+                nDuplicates_ = 0;
+                frame = frame_;
+            }
+            else if (nDuplicates_ < maxDuplicates_)
+            {
+                nDuplicates_++;
+                duplicatedNum_++;
+                frame = frame_;
+            }
+
+            if (frame)
+            {
+                downscaled = downscaled_;
+                releasedNum_++;
+            }
+        }
+
+        if (isRateChanged_)
+        {
+            // new rate starts counting from this tick
+            isRateChanged_ = false;
+            intervalUs_ = (int64_t)(1000000. / rate_);
+            epochUs_ = tickUs;
+            tickNo_ = 0;
+        }
+    }
+
+    if (frame)
+        onFrame_(*frame, downscaled.get(), tickUs / 1000);
+
+    tickNo_++;
+
+    // if io thread was blocked for longer than an interval, missed ticks are
+    // skipped rather than fired in a burst
+    int64_t nowUs = clock::microsecondTimestamp();
+    if (epochUs_ + tickNo_ * intervalUs_ < nowUs)
+        tickNo_ = (nowUs - epochUs_) / intervalUs_ + 1;
+
+    if (isRunning_)
+        setupTimer();
+}
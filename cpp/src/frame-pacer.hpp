@@ -0,0 +1,81 @@
+//
+// frame-pacer.hpp
+//
+//  Created by Peter Gusev on 26 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#ifndef __frame_pacer_hpp__
+#define __frame_pacer_hpp__
+
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "webrtc.hpp"
+
+namespace ndnrtc
+{
+class FramePacerImpl;
+
+/**
+ * Frame pacer retimes captured frames to a steady rate.
+ * Captured frames are pushed into the pacer from the capturing thread,
+ * whereas pacer releases them on io thread at a fixed rate, similarly to
+ * PreciseGenerator: ticks are scheduled against absolute deadlines, so timer
+ * latencies do not accumulate into drift.
+ * If more than one frame was pushed between two ticks, older frames are
+ * dropped. If no frame was pushed since the last tick, the last frame is
+ * duplicated, but no more than maxDuplicates times in a row (i.e. pacer stops
+ * releasing frames if capture source has stalled).
+ * Each released frame is stamped with its' tick's scheduled time
+ * (monotonic clock, see clock::millisecondTimestamp()).
+ */
+class FramePacer
+{
+  public:
+    // downscaled frame is nullptr, if it was not provided with the frame
+    typedef boost::function<void(const WebRtcVideoFrame &frame,
+                                 const WebRtcVideoFrame *downscaled,
+                                 int64_t captureTimestampMs)>
+        OnFrame;
+
+    FramePacer(boost::asio::io_service &io, double rate, OnFrame onFrame,
+               unsigned int maxDuplicates = 2);
+    ~FramePacer();
+
+    void start();
+    /**
+     * Stops releasing frames. Once this returns, OnFrame callback is not
+     * running and won't be called, thus it must not be called from the
+     * callback itself.
+     */
+    void stop();
+    bool isRunning() const;
+
+    /**
+     * Changes pacing rate. New rate takes effect from the next tick.
+     */
+    void setRate(double rate);
+    double getRate() const;
+
+    /**
+     * Pushes captured frame into the pacer. Thread-safe.
+     * @param frame Captured frame
+     * @param downscaled Optional downscaled copy of the frame
+     * @return false if previously pushed frame has not been released yet
+     *         and thus was dropped
+     */
+    bool push(const WebRtcVideoFrame &frame,
+              const WebRtcVideoFrame *downscaled = nullptr);
+
+    uint64_t getReleasedNum() const;
+    uint64_t getDroppedNum() const;
+    uint64_t getDuplicatedNum() const;
+
+  private:
+    boost::shared_ptr<FramePacerImpl> pimpl_;
+};
+}
+
+#endif
@@ -132,6 +132,8 @@ pimpl_(boost::make_shared<VideoStreamImpl>(streamPrefix, settings, useFec))
 
 LocalVideoStream::~LocalVideoStream()
 {
+	// encoder threads hold pointer to the stream, stop them while it's alive
+	pimpl_->stopWorkers();
 }
 
 void
@@ -145,6 +147,18 @@ void LocalVideoStream::removeThread(const string& threadName)
 	pimpl_->removeThread(threadName);
 }
 
+void LocalVideoStream::setThreadRate(const string& threadName,
+	unsigned int bitrateKbps, double frameRate)
+{
+	pimpl_->setThreadRate(threadName, bitrateKbps, frameRate);
+}
+
+void LocalVideoStream::setThreadResolution(const string& threadName,
+	unsigned int width, unsigned int height)
+{
+	pimpl_->setThreadResolution(threadName, width, height);
+}
+
 int LocalVideoStream::incomingArgbFrame(const unsigned int width,
 	const unsigned int height,
 	unsigned char* argbFrameData,
@@ -171,7 +185,21 @@ int LocalVideoStream::incomingI420Frame(const unsigned int width,
 	const unsigned char* vBuffer)
 {
 	return pimpl_->incomingFrame(I420RawFrameWrapper({width, height, strideY, strideU,
-		strideV, yBuffer, uBuffer, vBuffer}));
+		strideV, yBuffer, uBuffer, vBuffer, boost::function<void()>()}));
+}
+
+int LocalVideoStream::incomingI420Frame(const unsigned int width,
+	const unsigned int height,
+	const unsigned int strideY,
+	const unsigned int strideU,
+	const unsigned int strideV,
+	const unsigned char* yBuffer,
+	const unsigned char* uBuffer,
+	const unsigned char* vBuffer,
+	boost::function<void()> onFrameReleased)
+{
+	return pimpl_->incomingFrame(I420RawFrameWrapper({width, height, strideY, strideU,
+		strideV, yBuffer, uBuffer, vBuffer, onFrameReleased}));
 }
 
 int LocalVideoStream::incomingNV21Frame(const unsigned int width,
@@ -237,4 +265,15 @@ boost::shared_ptr<StorageEngine>
 LocalVideoStream::getStorage() const
 {
     return pimpl_->getStorage();
-}
\ No newline at end of file
+}
+void
+LocalVideoStream::setEncoderCoreBudget(unsigned int nCores)
+{
+    EncoderCoreScheduler::getSharedInstance().setBudget(nCores);
+}
+
+unsigned int
+LocalVideoStream::getEncoderCoreBudget()
+{
+    return EncoderCoreScheduler::getSharedInstance().getBudget();
+}
@@ -8,7 +8,6 @@
 #include <boost/smart_ptr/shared_ptr.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include <ndn-cpp/face.hpp>
-#include <ndn-cpp/util/memory-content-cache.hpp>
 
 #include "media-stream-base.hpp"
 #include "name-components.hpp"
@@ -16,8 +15,12 @@
 #include "clock.hpp"
 #include "statistics.hpp"
 #include "storage-engine.hpp"
+#include "producer-cache.hpp"
 
 #define META_CHECK_INTERVAL_MS 10
+// producer cache keeps samples for this long, unless byte budget is exceeded
+#define CACHE_LIFETIME_MS 1000
+#define CACHE_MAX_BYTES (64 * 1024 * 1024)
 
 using namespace ndnrtc;
 using namespace std;
@@ -42,16 +45,12 @@ MediaStreamBase::MediaStreamBase(const std::string &basePrefix,
     streamPrefix_.append(Name(settings_.params_.streamName_));
     streamPrefix_.appendTimestamp(streamTimestamp_);
 
-    unsigned int minimumFreshness = min(settings_.params_.producerParams_.freshness_.metadataMs_, 
-                                        settings_.params_.producerParams_.freshness_.sampleMs_);
-    minimumFreshness = min(minimumFreshness, settings_.params_.producerParams_.freshness_.sampleKeyMs_);
-    // set cleanup interval for memory cache to 0
-    // this will make cache to cleanup every time there's an incoming interest 
-    // or data added (and prevent it from hanging for few ms when data rate is high)
-    cache_ = boost::make_shared<MemoryContentCache>(settings_.face_, 0);
-    cache_->setMinimumCacheLifetime(1000);
+    // samples are evicted from cache by age and size, interests that can't be
+    // answered right away are kept pending until data is published
+    cache_ = boost::make_shared<ProducerCache>(settings_.face_, CACHE_LIFETIME_MS, CACHE_MAX_BYTES);
+    cache_->setDescription("cache-" + settings_.params_.streamName_);
     // set filter for prefix without the timestamp, because stream _meta is served there
-    cache_->setInterestFilter(streamPrefix_.getPrefix(-1), cache_->getStorePendingInterest());
+    cache_->setInterestFilter(streamPrefix_.getPrefix(-1));
 
     PublisherSettings ps;
     ps.sign_ = settings_.sign_; // it's ok to sign every packet as data publisher
@@ -101,6 +100,7 @@ void
 MediaStreamBase::setLogger(boost::shared_ptr<ndnlog::new_api::Logger> logger)
 {
     metadataPublisher_->setLogger(logger);
+    cache_->setLogger(logger);
 }
 
 void MediaStreamBase::publishMeta()
@@ -134,6 +134,5 @@ unsigned int MediaStreamBase::periodicInvocation()
 void MediaStreamBase::onSegmentsCached(std::vector<boost::shared_ptr<const ndn::Data>> segments)
 {
     if (storage_)
-        for (auto& d:segments)
-            storage_->put(d);
+        storage_->put(segments);
 }
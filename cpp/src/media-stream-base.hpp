@@ -16,11 +16,6 @@
 #include "periodic.hpp"
 #include "statistics.hpp"
 
-namespace ndn
-{
-class MemoryContentCache;
-}
-
 namespace ndnrtc
 {
 namespace statistics
@@ -30,6 +25,7 @@ class StatisticsStorage;
 
 class StorageEngine;
 class MediaThreadParams;
+class ProducerCache;
 
 class MediaStreamBase : public NdnRtcComponent,
                         public Periodic
@@ -79,7 +75,7 @@ class MediaStreamBase : public NdnRtcComponent,
     MediaStreamSettings settings_;
     std::string basePrefix_;
     ndn::Name streamPrefix_;
-    boost::shared_ptr<ndn::MemoryContentCache> cache_;
+    boost::shared_ptr<ProducerCache> cache_;
     boost::shared_ptr<CommonPacketPublisher> metadataPublisher_;
     boost::shared_ptr<statistics::StatisticsStorage> statStorage_;
     boost::shared_ptr<StorageEngine> storage_;
@@ -18,11 +18,18 @@ using namespace std;
 Manifest::Manifest(const std::vector<boost::shared_ptr<const ndn::Data>> &dataObjects)
     : DataPacket(std::vector<uint8_t>())
 {
+    // digests must stay alive until they are written into the packet
+    std::vector<ndn::Blob> digests;
+    DataPacketBuilder builder;
+
+    digests.reserve(dataObjects.size());
     for (auto &d : dataObjects)
     {
-        ndn::Blob digest = (*d->getFullName())[-1].getValue();
-        addBlob(digest.size(), digest.buf());
+        digests.push_back((*d->getFullName())[-1].getValue());
+        builder.addBlob(digests.back().size(), digests.back().buf());
     }
+
+    addBlobs(builder);
 }
 
 Manifest::Manifest(NetworkData &&nd) : DataPacket(boost::move(nd)) {}
@@ -44,12 +51,16 @@ bool Manifest::hasData(const ndn::Data &data) const
 AudioThreadMeta::AudioThreadMeta(double rate, uint64_t bundleNo, const std::string &codec)
     : DataPacket(std::vector<uint8_t>())
 {
-    addBlob(sizeof(rate), (uint8_t *)&rate);
-    addBlob(sizeof(bundleNo), (uint8_t *)&bundleNo);
+    DataPacketBuilder builder;
+
+    builder.addBlob(sizeof(rate), (uint8_t *)&rate)
+        .addBlob(sizeof(bundleNo), (uint8_t *)&bundleNo);
     if (codec.size())
-        addBlob(codec.size(), (uint8_t *)codec.c_str());
+        builder.addBlob(codec.size(), (uint8_t *)codec.c_str());
     else
         isValid_ = false;
+
+    addBlobs(builder);
 }
 
 AudioThreadMeta::AudioThreadMeta(NetworkData &&data) : DataPacket(boost::move(data))
@@ -86,12 +97,16 @@ VideoThreadMeta::VideoThreadMeta(double rate, PacketNumber deltaSeqNo, PacketNum
             coder.gop_, coder.startBitrate_, coder.encodeWidth_, coder.encodeHeight_,
             segInfo.deltaAvgSegNum_, segInfo.deltaAvgParitySegNum_,
             segInfo.keyAvgSegNum_, segInfo.keyAvgParitySegNum_});
-    addBlob(sizeof(m), (uint8_t *)&m);
+    addBlobs(DataPacketBuilder()
+                 .addBlob(sizeof(m), (uint8_t *)&m)
+                 .addBlob(coder.codec_.size(), (uint8_t *)coder.codec_.c_str()));
 }
 
 VideoThreadMeta::VideoThreadMeta(NetworkData &&data) : DataPacket(boost::move(data))
 {
-    isValid_ = (blobs_.size() == 1 && blobs_[0].size() == sizeof(Meta));
+    // codec blob is optional - older producers publish VP9 only
+    isValid_ = ((blobs_.size() == 1 || blobs_.size() == 2) &&
+                blobs_[0].size() == sizeof(Meta));
 }
 
 double VideoThreadMeta::getRate() const
@@ -127,6 +142,8 @@ VideoCoderParams VideoThreadMeta::getCoderParams() const
     c.startBitrate_ = m->bitrate_;
     c.encodeWidth_ = m->width_;
     c.encodeHeight_ = m->height_;
+    if (blobs_.size() > 1)
+        c.codec_ = std::string((const char *)blobs_[1].data(), blobs_[1].size());
     return c;
 }
 
@@ -139,10 +156,13 @@ MediaStreamMeta::MediaStreamMeta(uint64_t timestamp) : DataPacket(std::vector<ui
 
 MediaStreamMeta::MediaStreamMeta(uint64_t timestamp, std::vector<std::string> threads) : DataPacket(std::vector<uint8_t>())
 {
-    addBlob(sizeof(uint64_t), (uint8_t*)&timestamp); // blob 0 is the timestamp
+    DataPacketBuilder builder;
+
+    builder.addBlob(sizeof(uint64_t), (uint8_t *)&timestamp); // blob 0 is the timestamp
+    for (auto &t : threads)
+        builder.addBlob(t.size(), (uint8_t *)t.c_str());
 
-    for (auto t : threads)
-        addThread(t);
+    addBlobs(builder);
 }
 
 void MediaStreamMeta::addThread(const std::string &thread)
@@ -7,6 +7,7 @@
 #ifndef __network_data_hpp__
 #define __network_data_hpp__
 
+#include <string.h>
 #include <boost/crc.hpp>
 #include <boost/move/move.hpp>
 #include <boost/shared_ptr.hpp>
@@ -182,6 +183,68 @@ class NetworkDataT
 typedef NetworkDataT<Immutable> ImmutableNetworkData;
 typedef NetworkDataT<> NetworkData;
 
+//******************************************************************************
+/**
+ * DataPacketBuilder prepares data packet (see DataPacketT for the wire format)
+ * in two phases. First, blobs and payload are described - builder keeps only
+ * pointers to the data, which must stay valid until packet is written. Then,
+ * wire length of the packet is computed and the packet is written into a 
+ * buffer of that length in one pass. Unlike adding blobs one by one, payload
+ * is not shifted and blobs are not re-parsed for every added blob.
+ * Builder has a fixed capacity (maximum number of blobs in data packet) and 
+ * does not allocate memory.
+ */
+class DataPacketBuilder
+{
+  public:
+    static const size_t MaxBlobsNum = 255;
+
+    DataPacketBuilder() : nBlobs_(0), payloadLength_(0), payload_(nullptr) {}
+
+    /**
+     * Adds blob to the packet. Empty blobs are ignored.
+     * Throws if packet has maximum number of blobs already.
+     */
+    DataPacketBuilder &addBlob(uint16_t length, const uint8_t *data);
+    DataPacketBuilder &setPayload(size_t length, const uint8_t *data);
+
+    size_t getBlobsNum() const { return nBlobs_; }
+    size_t getPayloadLength() const { return payloadLength_; }
+
+    /**
+     * Returns length of blobs with their sizes, as they are written on wire
+     */
+    size_t blobsWireLength() const;
+
+    /**
+     * Returns total wire length of the packet
+     */
+    size_t wireLength() const;
+
+    /**
+     * Writes blobs with their sizes into memory, which must be at least
+     * blobsWireLength() long
+     * @return Pointer past the last written byte
+     */
+    uint8_t *writeBlobs(uint8_t *dst) const;
+
+    /**
+     * Resizes buffer to the packet wire length and writes packet into it
+     */
+    void write(std::vector<uint8_t> &buffer) const;
+
+  private:
+    typedef struct _BlobRef
+    {
+        const uint8_t *data_;
+        uint16_t length_;
+    } BlobRef;
+
+    BlobRef blobs_[MaxBlobsNum];
+    size_t nBlobs_, payloadLength_;
+    const uint8_t *payload_;
+};
+
 //******************************************************************************
 /**
  * Data packet class extends NetworkData functionality by implementing addBlob
@@ -256,19 +319,26 @@ class DataPacketT : public NetworkDataT<T>
     }
 
     ENABLE_IF(T, Mutable)
-    DataPacketT(unsigned int dataLength, const uint8_t *payload) : NetworkDataT<T>(dataLength, payload)
+    DataPacketT(unsigned int dataLength, const uint8_t *payload) : NetworkDataT<T>(std::vector<uint8_t>())
     {
-        this->_data().insert(this->_data().begin(), 0);
+        DataPacketBuilder().setPayload(dataLength, payload).write(this->_data());
         payloadBegin_ = this->_data().begin() + 1;
     }
 
     ENABLE_IF(T, Mutable)
-    DataPacketT(const std::vector<uint8_t> &payload) : NetworkDataT<T>(payload)
+    DataPacketT(const std::vector<uint8_t> &payload) : NetworkDataT<T>(std::vector<uint8_t>())
     {
-        this->_data().insert(this->_data().begin(), 0);
+        DataPacketBuilder().setPayload(payload.size(), payload.data()).write(this->_data());
         payloadBegin_ = this->_data().begin() + 1;
     }
 
+    ENABLE_IF(T, Mutable)
+    DataPacketT(const DataPacketBuilder &builder) : NetworkDataT<T>(std::vector<uint8_t>())
+    {
+        builder.write(this->_data());
+        this->reinit();
+    }
+
     ENABLE_IF(T, Mutable)
     DataPacketT(NetworkDataT<T> &&networkData) : NetworkDataT<T>(boost::move(networkData))
     {
@@ -391,16 +461,32 @@ class DataPacketT : public NetworkDataT<T>
         if (dataLength == 0)
             return;
 
-        // increase blob counter
-        this->_data()[0]++;
-        // save blob size
-        uint8_t b1 = dataLength & 0x00ff, b2 = (dataLength & 0xff00) >> 8;
-        payloadBegin_ = this->_data().insert(payloadBegin_, b1);
-        payloadBegin_++;
-        payloadBegin_ = this->_data().insert(payloadBegin_, b2);
-        payloadBegin_++;
-        // insert blob
-        this->_data().insert(payloadBegin_, data, data + dataLength);
+        addBlobs(DataPacketBuilder().addBlob(dataLength, data));
+    }
+
+    /**
+     * Adds all blobs described by builder after existing blobs. Packet
+     * storage is resized and payload is moved only once, regardless of the
+     * number of blobs added. Payload of the builder is ignored.
+     */
+    ENABLE_IF(T, Mutable)
+    void addBlobs(const DataPacketBuilder &builder)
+    {
+        if (builder.getBlobsNum() == 0)
+            return;
+
+        std::vector<uint8_t> &data = this->_data();
+        if (data[0] + builder.getBlobsNum() > DataPacketBuilder::MaxBlobsNum)
+            throw std::runtime_error("Can't add more blobs to data packet");
+
+        size_t blobsOffset = payloadBegin_ - data.begin();
+        size_t payloadLength = data.size() - blobsOffset;
+        size_t blobsLength = builder.blobsWireLength();
+
+        data.resize(data.size() + blobsLength);
+        memmove(data.data() + blobsOffset + blobsLength, data.data() + blobsOffset, payloadLength);
+        builder.writeBlobs(data.data() + blobsOffset);
+        data[0] += builder.getBlobsNum();
         this->reinit();
     }
 };
@@ -408,6 +494,69 @@ class DataPacketT : public NetworkDataT<T>
 typedef DataPacketT<Immutable> ImmutableDataPacket;
 typedef DataPacketT<> DataPacket;
 
+inline DataPacketBuilder &
+DataPacketBuilder::addBlob(uint16_t length, const uint8_t *data)
+{
+    if (length == 0)
+        return *this;
+    if (nBlobs_ == MaxBlobsNum)
+        throw std::runtime_error("Can't add more blobs to data packet");
+
+    blobs_[nBlobs_].data_ = data;
+    blobs_[nBlobs_].length_ = length;
+    nBlobs_++;
+
+    return *this;
+}
+
+inline DataPacketBuilder &
+DataPacketBuilder::setPayload(size_t length, const uint8_t *data)
+{
+    payloadLength_ = length;
+    payload_ = data;
+    return *this;
+}
+
+inline size_t
+DataPacketBuilder::blobsWireLength() const
+{
+    size_t length = 0;
+    for (size_t i = 0; i < nBlobs_; ++i)
+        length += DataPacket::wireLength(blobs_[i].length_);
+    return length;
+}
+
+inline size_t
+DataPacketBuilder::wireLength() const
+{
+    // one byte for the number of blobs
+    return 1 + blobsWireLength() + payloadLength_;
+}
+
+inline uint8_t *
+DataPacketBuilder::writeBlobs(uint8_t *dst) const
+{
+    for (size_t i = 0; i < nBlobs_; ++i)
+    {
+        *dst++ = blobs_[i].length_ & 0x00ff;
+        *dst++ = (blobs_[i].length_ & 0xff00) >> 8;
+        memcpy(dst, blobs_[i].data_, blobs_[i].length_);
+        dst += blobs_[i].length_;
+    }
+    return dst;
+}
+
+inline void
+DataPacketBuilder::write(std::vector<uint8_t> &buffer) const
+{
+    buffer.resize(wireLength());
+    buffer[0] = nBlobs_;
+
+    uint8_t *payload = writeBlobs(buffer.data() + 1);
+    if (payloadLength_)
+        memcpy(payload, payload_, payloadLength_);
+}
+
 //******************************************************************************
 /**
  * HeaderPacket extends DataPacket class by adding functionality for a header 
@@ -437,6 +586,10 @@ class HeaderPacketT : public DataPacketT<T>
     HeaderPacketT(const std::vector<uint8_t> &payload) : DataPacketT<T>(payload),
                                                          isHeaderSet_(false) { this->isValid_ = false; }
 
+    ENABLE_IF(T, Mutable)
+    HeaderPacketT(const DataPacketBuilder &builder) : DataPacketT<T>(builder),
+                                                      isHeaderSet_(false) { this->isValid_ = false; }
+
     ENABLE_IF(T, Mutable)
     HeaderPacketT(const Header &header, unsigned int dataLength,
                   const uint8_t *payload) : DataPacketT<T>(dataLength, payload),
@@ -22,9 +22,6 @@
 #include "statistics.hpp"
 
 #define ADD_CRC 0
-// this number defines iteration when publisher will
-// send NACKs to all pending interests, unsatisfied with data
-#define FULL_PIT_FREQUENCY 1000
 
 namespace ndn
 {
@@ -50,6 +47,7 @@ template <typename T>
 class NetworkDataT;
 struct _DataSegmentHeader;
 typedef NetworkDataT<Mutable> MutableNetworkData;
+class ProducerCache;
 typedef std::vector<boost::shared_ptr<const ndn::Data>> PublishedDataPtrVector;
 typedef boost::function<void(PublishedDataPtrVector)> OnSegmentsCached;
 
@@ -68,13 +66,13 @@ struct _PublisherSettings
     bool sign_ = true;
 };
 
-typedef _PublisherSettings<ndn::KeyChain, ndn::MemoryContentCache> PublisherSettings;
+typedef _PublisherSettings<ndn::KeyChain, ProducerCache> PublisherSettings;
 
 template <typename SegmentType, typename Settings>
 class PacketPublisher : public NdnRtcComponent
 {
   public:
-    PacketPublisher(const Settings &settings) : settings_(settings), fullPitClean_(0)
+    PacketPublisher(const Settings &settings) : settings_(settings)
     {
         assert(settings_.keyChain_);
         assert(settings_.memoryCache_);
@@ -82,8 +80,7 @@ class PacketPublisher : public NdnRtcComponent
     }
 
     PublishedDataPtrVector publish(const ndn::Name &name, const MutableNetworkData &data,
-                                   int freshnessMs = -1,
-                                   bool forcePitClean = false, bool banPitClean = false)
+                                   int freshnessMs = -1, bool banPitClean = false)
     {
         // provide dummy memory of the size of the segment header to publish function
         // we don't care of bytes that will be saved in this memory, so allocate it
@@ -91,12 +88,12 @@ class PacketPublisher : public NdnRtcComponent
         boost::shared_ptr<uint8_t[]> dummyHeader(new uint8_t[SegmentType::headerSize()]);
         memset(dummyHeader.get(), SegmentType::headerSize(), 0);
         return publish(name, data, (_DataSegmentHeader &)*dummyHeader.get(),
-                       freshnessMs, forcePitClean, banPitClean);
+                       freshnessMs, banPitClean);
     }
 
     PublishedDataPtrVector publish(const ndn::Name &name, const MutableNetworkData &data,
                                    _DataSegmentHeader &commonHeader, int freshnessMs,
-                                   bool forcePitClean = false, bool banPitClean = false)
+                                   bool banPitClean = false)
     {
         PublishedDataPtrVector ndnSegments;
         std::vector<SegmentType> segments = SegmentType::slice(data, settings_.segmentWireLength_);
@@ -109,7 +106,7 @@ class PacketPublisher : public NdnRtcComponent
         unsigned int segIdx = 0;
         freshnessMs = (freshnessMs == -1 ? settings_.freshnessPeriodMs_ : freshnessMs);
 
-        for (auto segment : segments)
+        for (auto &segment : segments)
         {
             ndn::Name segmentName(name);
             segmentName.appendSegment(segIdx);
@@ -120,11 +117,14 @@ class PacketPublisher : public NdnRtcComponent
             checkForPendingInterests(segmentName, commonHeader);
             segment.setHeader(commonHeader);
 
-            boost::shared_ptr<MutableNetworkData> segmentData = segment.getNetworkData();
+            // segment is written directly into storage owned by data object
+            boost::shared_ptr<std::vector<uint8_t>> content(boost::make_shared<std::vector<uint8_t>>());
+            segment.write(*content);
+
             boost::shared_ptr<ndn::Data> ndnSegment(boost::make_shared<ndn::Data>(segmentName));
             ndnSegment->getMetaInfo().setFreshnessPeriod(freshnessMs);
             ndnSegment->getMetaInfo().setFinalBlockId(ndn::Name::Component::fromSegment(segments.size() - 1));
-            ndnSegment->setContent(segmentData->getData(), segment.size());
+            ndnSegment->setContent(ndn::Blob(content, false));
             sign(ndnSegment);
             settings_.memoryCache_->add(*ndnSegment);
             ++segIdx;
@@ -141,7 +141,7 @@ class PacketPublisher : public NdnRtcComponent
         }
 
         if (!banPitClean)
-            cleanPit(name, forcePitClean);
+            cleanPit(name);
 
         (*settings_.statStorage_)[statistics::Indicator::PublishedSegmentsNum] += segments.size();
 
@@ -153,7 +153,6 @@ class PacketPublisher : public NdnRtcComponent
 
   private:
     Settings settings_;
-    unsigned int fullPitClean_;
 
     void checkForPendingInterests(const ndn::Name &name, _DataSegmentHeader &commonHeader)
     {
@@ -191,9 +190,10 @@ class PacketPublisher : public NdnRtcComponent
     }
 
     /**
-     * Retrieves all pending interests for given name and publishes application NACKs for them
+     * Retrieves all pending interests for given name and publishes application NACKs for them,
+     * then NACKs pending interests for older samples of the same thread
      */
-    void cleanPit(const ndn::Name &name, bool forceFullPitClean = false)
+    void cleanPit(const ndn::Name &name)
     {
         std::vector<boost::shared_ptr<const ndn::MemoryContentCache::PendingInterest>> pendingInterests;
         settings_.memoryCache_->getPendingInterestsWithPrefix(name, pendingInterests);
@@ -205,18 +205,16 @@ class PacketPublisher : public NdnRtcComponent
                 << " (sending NACKs for "
                 << pendingInterests.size() << " interests)" << std::endl;
 
+            // cache satisfies pending interests once NACKs are added
             for (auto pi : pendingInterests)
-                publishNack(pi->getInterest()->getName());
+                settings_.memoryCache_->add(*makeNack(pi->getInterest()->getName()));
         }
         else
             LogTraceC << "no pending for " << name << std::endl;
 
-        if (fullPitClean_++ % FULL_PIT_FREQUENCY == 0 || forceFullPitClean)
-        {
-            if (!forceFullPitClean)
-                fullPitClean_ = 0;
-            deepCleanPit(name);
-        }
+        // pending interests of older samples are dropped in one range erase,
+        // thus it's cheap enough to do on every publish
+        deepCleanPit(name);
     }
 
     void deepCleanPit(const ndn::Name &name)
@@ -233,40 +231,41 @@ class PacketPublisher : public NdnRtcComponent
             return;
 
         std::vector<boost::shared_ptr<const ndn::MemoryContentCache::PendingInterest>> pendingInterests;
+        std::vector<boost::shared_ptr<const ndn::Data>> nacks;
 
-        // extract all pending interests for this stream
-        settings_.memoryCache_->getPendingInterestsWithPrefix(info.getPrefix(prefix_filter::Stream), pendingInterests);
+        // we are interested in older interests (those that request data that has already been published)
+        // this is needed to respond with NACKs, when consumer runs slightly behind producer;
+        // cache keeps pending interests bucketed by sample, so these are dropped in one go
+        settings_.memoryCache_->extractPendingInterestsBefore(name, pendingInterests);
 
         if (pendingInterests.size())
         {
+            LogTraceC << "PIT deep clean for " << name << " (sending NACKs for "
+                      << pendingInterests.size() << " interests)" << std::endl;
+
+            // NACKs are cached for late interests, but extracted pending
+            // interests are no longer in cache, so they are answered here
             for (auto pi : pendingInterests)
             {
-                NamespaceInfo piInfo;
-
-                if (NameComponents::extractInfo(pi->getInterest()->getName(), piInfo))
-                {
-                    // we are interested in older interests (those that request data that has already been published)
-                    // this is needed to respond with NACKs, when consumer runs slightly behind producer
-                    if (piInfo.class_ == info.class_ && piInfo.sampleNo_ < info.sampleNo_)
-                    {
-                        publishNack(pi->getInterest()->getName());
-                        LogTraceC << "PIT deep clean " << pi->getInterest()->getName() << std::endl;
-                    }
-                }
-                else
-                    LogWarnC << "couldn't extract info from pending interest "
-                             << pi->getInterest()->getName() << " this will time out" << std::endl;
+                nacks.push_back(makeNack(pi->getInterest()->getName()));
+                settings_.memoryCache_->add(*nacks.back());
             }
+
+            settings_.memoryCache_->putData(pendingInterests, nacks);
         }
     }
 
-    void publishNack(const ndn::Name &name)
+    boost::shared_ptr<const ndn::Data> makeNack(const ndn::Name &name)
     {
         boost::shared_ptr<ndn::Data> nack(boost::make_shared<ndn::Data>(name));
         nack->getMetaInfo().setFreshnessPeriod(settings_.freshnessPeriodMs_);
         nack->setContent((const uint8_t *)"nack", 4);
         nack->getMetaInfo().setType(ndn_ContentType_NACK);
-        // settings_.memoryCache_->add(*nack);
+        // NACKs are sent in bursts on publishing thread, thus they are not
+        // signed with the key, but carry a digest signature
+        settings_.keyChain_->signWithSha256(*nack);
+
+        return nack;
     }
 };
 
@@ -0,0 +1,170 @@
+//
+// decoded-frame-cache.cpp
+//
+//  Created by Peter Gusev on 15 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include "decoded-frame-cache.hpp"
+
+using namespace ndnrtc;
+using namespace ndn;
+using namespace boost;
+
+DecodedFrameCache::DecodedFrameCache(size_t capacity)
+    : capacity_(capacity), nFrames_(0)
+{
+}
+
+bool
+DecodedFrameCache::getFrame(const Name& frameName, CachedFrame& frame)
+{
+    lock_guard<mutex> scopedLock(mutex_);
+
+    auto it = frameGop_.find(frameName);
+    if (it == frameGop_.end())
+        return false;
+
+    frame = gopFrames_[it->second][frameName];
+    touch(gops_[it->second]);
+
+    return true;
+}
+
+shared_ptr<DecodedFrameCache::GopEntry>
+DecodedFrameCache::getGop(const Name& keyFrameName)
+{
+    lock_guard<mutex> scopedLock(mutex_);
+
+    auto it = gops_.find(keyFrameName);
+    if (it == gops_.end())
+        return shared_ptr<GopEntry>();
+
+    touch(it->second);
+    return it->second;
+}
+
+shared_ptr<DecodedFrameCache::GopEntry>
+DecodedFrameCache::addGop(const Name& keyFrameName,
+                          const VideoCoderParams& decoderParams)
+{
+    shared_ptr<GopEntry> gop = make_shared<GopEntry>();
+    gop->keyFrameName_ = keyFrameName;
+    gop->nextDeltaNo_ = 0;
+    gop->isBusy_ = false;
+
+    // decoder is bound to the GOP entry by a weak pointer, so that the entry
+    // (and the decoder it owns) can be released once evicted
+    weak_ptr<GopEntry> weakGop(gop);
+    gop->decoder_ = make_shared<VideoDecoder>(decoderParams,
+        [weakGop](const FrameInfo& fi, const WebRtcVideoFrame& f){
+            shared_ptr<GopEntry> g = weakGop.lock();
+            if (g && g->onDecoded_)
+                g->onDecoded_(fi, f);
+        });
+
+    lock_guard<mutex> scopedLock(mutex_);
+
+    remove(keyFrameName);
+    gops_[keyFrameName] = gop;
+    lru_.push_front(gop);
+
+    return gop;
+}
+
+void
+DecodedFrameCache::addFrame(const shared_ptr<GopEntry>& gop,
+                            const Name& frameName,
+                            const FrameInfo& frameInfo,
+                            const WebRtcVideoFrame& frame)
+{
+    // decoders allocate frames from a limited buffer pool, thus decoded
+    // frames are copied rather than retained
+    CachedFrame cachedFrame;
+    cachedFrame.frameInfo_ = frameInfo;
+    cachedFrame.frame_ = make_shared<WebRtcVideoFrame>(
+        WebRtcVideoFrameBuffer::Copy(*frame.video_frame_buffer()),
+        frame.rotation(), frame.timestamp_us());
+
+    lock_guard<mutex> scopedLock(mutex_);
+
+    // GOP might have been evicted meanwhile
+    if (gops_.find(gop->keyFrameName_) == gops_.end())
+        return;
+
+    std::map<Name, CachedFrame>& frames = gopFrames_[gop->keyFrameName_];
+    if (frames.find(frameName) == frames.end())
+        nFrames_++;
+
+    frames[frameName] = cachedFrame;
+    frameGop_[frameName] = gop->keyFrameName_;
+    touch(gop);
+    evict();
+}
+
+size_t
+DecodedFrameCache::getFramesNum() const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    return nFrames_;
+}
+
+size_t
+DecodedFrameCache::getGopsNum() const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    return gops_.size();
+}
+
+//******************************************************************************
+void
+DecodedFrameCache::touch(const shared_ptr<GopEntry>& gop)
+{
+    if (lru_.size() && lru_.front() == gop)
+        return;
+
+    lru_.remove(gop);
+    lru_.push_front(gop);
+}
+
+void
+DecodedFrameCache::remove(const Name& keyFrameName)
+{
+    auto gopIt = gops_.find(keyFrameName);
+    if (gopIt == gops_.end())
+        return;
+
+    lru_.remove(gopIt->second);
+    gops_.erase(gopIt);
+
+    auto framesIt = gopFrames_.find(keyFrameName);
+    if (framesIt != gopFrames_.end())
+    {
+        for (auto f:framesIt->second)
+            frameGop_.erase(f.first);
+        nFrames_ -= framesIt->second.size();
+        gopFrames_.erase(framesIt);
+    }
+}
+
+void
+DecodedFrameCache::evict()
+{
+    // never evict most recent GOP and GOPs that are being decoded
+    auto it = lru_.end();
+    while (nFrames_ > capacity_ && lru_.size() > 1 && it != lru_.begin())
+    {
+        --it;
+        if (it == lru_.begin())
+            break;
+
+        if (!(*it)->isBusy_)
+        {
+            Name keyFrameName = (*it)->keyFrameName_;
+            auto prev = it;
+            ++prev;
+            remove(keyFrameName);
+            it = prev;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+//
+// decoded-frame-cache.hpp
+//
+//  Created by Peter Gusev on 15 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#ifndef __decoded_frame_cache_hpp__
+#define __decoded_frame_cache_hpp__
+
+#include <list>
+#include <map>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ndn-cpp/name.hpp>
+
+#include "interfaces.hpp"
+#include "ndnrtc-common.hpp"
+#include "webrtc.hpp"
+#include "video-decoder.hpp"
+
+namespace ndnrtc {
+
+    /**
+     * Keeps decoder state and decoded I420 frames of recently decoded GOPs.
+     * Random access to a delta frame requires decoding the whole chain from
+     * the GOP's key frame up to the requested frame. When nearby frames of the
+     * same GOP are requested again (scrubbing back and forth), frame fetcher
+     * can either return decoded frame straight from the cache or continue
+     * decoding with the GOP's decoder from the last decoded frame.
+     * GOPs are evicted in least-recently-used order once total number of
+     * cached decoded frames exceeds capacity.
+     * The class is thread-safe, but a GOP's decoder must only be used by one
+     * frame fetcher at a time (see GopEntry::isBusy_).
+     */
+    class DecodedFrameCache {
+    public:
+        typedef struct _CachedFrame {
+            FrameInfo frameInfo_;
+            boost::shared_ptr<WebRtcVideoFrame> frame_;
+        } CachedFrame;
+
+        typedef struct _GopEntry {
+            ndn::Name keyFrameName_;
+            // decoder which has decoded all frames up to nextDeltaNo_
+            boost::shared_ptr<VideoDecoder> decoder_;
+            // sequence number of delta frame this decoder expects next
+            PacketNumber nextDeltaNo_;
+            // decoder output is forwarded to this callback
+            OnDecodedImage onDecoded_;
+            // set while a fetcher is decoding with this GOP's decoder
+            bool isBusy_;
+        } GopEntry;
+
+        DecodedFrameCache(size_t capacity = 300);
+
+        /**
+         * Looks up decoded frame by its' name.
+         * @return true if frame was found in the cache.
+         */
+        bool getFrame(const ndn::Name& frameName, CachedFrame& frame);
+
+        /**
+         * Returns GOP entry for the given key frame name or empty pointer if
+         * this GOP is not in the cache.
+         */
+        boost::shared_ptr<GopEntry> getGop(const ndn::Name& keyFrameName);
+
+        /**
+         * Creates new GOP entry (dropping previous entry for this GOP, if any).
+         * Decoder for this GOP is created with provided parameters and its'
+         * output is routed to GopEntry::onDecoded_.
+         */
+        boost::shared_ptr<GopEntry> addGop(const ndn::Name& keyFrameName,
+                                           const VideoCoderParams& decoderParams);
+
+        /**
+         * Stores a copy of decoded frame for the GOP.
+         */
+        void addFrame(const boost::shared_ptr<GopEntry>& gop,
+                      const ndn::Name& frameName,
+                      const FrameInfo& frameInfo,
+                      const WebRtcVideoFrame& frame);
+
+        size_t getFramesNum() const;
+        size_t getGopsNum() const;
+        size_t getCapacity() const { return capacity_; }
+
+    private:
+        DecodedFrameCache(const DecodedFrameCache&) = delete;
+
+        mutable boost::mutex mutex_;
+        size_t capacity_, nFrames_;
+        // most recently used GOPs are in front
+        std::list<boost::shared_ptr<GopEntry>> lru_;
+        std::map<ndn::Name, boost::shared_ptr<GopEntry>> gops_;
+        std::map<ndn::Name, std::map<ndn::Name, CachedFrame>> gopFrames_;
+        std::map<ndn::Name, ndn::Name> frameGop_; // frame name -> key frame name
+
+        void touch(const boost::shared_ptr<GopEntry>& gop);
+        void remove(const ndn::Name& keyFrameName);
+        void evict();
+    };
+}
+
+#endif
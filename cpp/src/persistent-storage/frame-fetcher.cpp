@@ -11,8 +11,11 @@
 #include "frame-data.hpp"
 #include "frame-buffer.hpp"
 #include "video-decoder.hpp"
+#include "persistent-storage/decoded-frame-cache.hpp"
 
+#include <limits>
 #include <ndn-cpp/name.hpp>
+#include <ndn-cpp/interest.hpp>
 
 using namespace ndnrtc;
 using namespace boost;
@@ -23,15 +26,23 @@ namespace ndnrtc {
                              public ndnlog::new_api::ILoggingObject,
                              public boost::enable_shared_from_this<FrameFetcherImpl> {
     public:
-        FrameFetcherImpl(const boost::shared_ptr<StorageEngine>& storage);
-        FrameFetcherImpl(const boost::shared_ptr<Face>& face, const boost::shared_ptr<KeyChain>& keyChain);
+        FrameFetcherImpl(const boost::shared_ptr<StorageEngine>& storage,
+                         const boost::shared_ptr<DecodedFrameCache>& cache);
+        FrameFetcherImpl(const boost::shared_ptr<Face>& face, const boost::shared_ptr<KeyChain>& keyChain,
+                         const boost::shared_ptr<DecodedFrameCache>& cache);
         ~FrameFetcherImpl(){ reset(); }
 
         void fetch(const ndn::Name& frameName, 
                    OnBufferAllocate onBufferAllocate,
                    OnFrameFetched onFrameFetched,
                    OnFetchFailure onFetchFailure);
-        const ndn::Name& getName() const
+        void fetchRange(const ndn::Name& startFrameName,
+                        unsigned int nFrames, unsigned int stride,
+                        OnBufferAllocate onBufferAllocate,
+                        OnFrameFetched onFrameFetched,
+                        OnFetchFailure onFetchFailure);
+        void setInFlightBudget(unsigned int budget) { inFlightBudget_ = budget; }
+        ndn::Name getName() const
         {
             return frameNameInfo_.getPrefix(prefix_filter::Sample);
         }
@@ -51,12 +62,71 @@ namespace ndnrtc {
         boost::shared_ptr<IFetchMethod> fetchMethod_;
         std::map<ndn::Name, boost::shared_ptr<FrameFetchingTask>> fetchingTasks_;
         boost::shared_ptr<FrameFetchingTask> keyFrameTask_, targetFrameTask_;
-        std::map<ndn::Name, boost::shared_ptr<FrameFetchingTask>> deltasTasks_;
+        std::map<PacketNumber, boost::shared_ptr<FrameFetchingTask>> deltasTasks_;
 
+        boost::shared_ptr<DecodedFrameCache> cache_;
+        // GOP being decoded; if set before decoding starts, decoding resumes
+        // with this GOP's cached decoder instead of starting from the Key frame
+        boost::shared_ptr<DecodedFrameCache::GopEntry> gop_;
+        Name keyFrameName_;
+        // codecs of fetched threads, from thread meta; keyed by thread prefix
+        std::map<Name, std::string> threadCodecs_;
+
+        typedef std::vector<std::pair<boost::shared_ptr<FrameFetchingTask>, PacketNumber>> DecodeQueue;
+        typedef struct _RangeFrame {
+            Name frameName_;
+            PacketNumber seqNo_;
+            Name keyFrameName_;
+            // first delta frame that must be decoded before this frame
+            PacketNumber firstDeltaNo_;
+            bool isKeyKnown_, isResolved_, isChainKnown_;
+            // whether GOP's Key frame must be decoded before this frame
+            bool needsKey_;
+            bool isCached_;
+            DecodedFrameCache::CachedFrame cachedFrame_;
+            // GOP decoder resumed from the cache
+            boost::shared_ptr<DecodedFrameCache::GopEntry> gop_;
+        } RangeFrame;
+
+        // range fetching
+        unsigned int inFlightBudget_, nInFlight_, rangeId_;
+        bool isRange_, rangeIsDelta_, isPumping_, isPumpPending_;
+        Name rangeThreadPrefix_, rangeKeyPrefix_;
+        std::vector<RangeFrame> rangeFrames_;
+        size_t nextScheduled_, nextResolved_, nextDecoded_;
+        // index of the last range frame which will be decoded (not taken 
+        // from the cache); subsequent frames of the same GOP continue 
+        // decoding from this frame
+        int lastDecodable_;
+        // frames waiting to be fetched, ordered by range frame index and 
+        // decoding order within this frame's chain (GOP's Key frame first)
+        std::map<std::pair<size_t, int64_t>, Name> rangeQueue_;
+        // GOP of the last decoded range frame
+        boost::shared_ptr<DecodedFrameCache::GopEntry> rangeGop_;
+
+        void fetchThreadMeta(int nRtx);
+        void onThreadMeta(const boost::shared_ptr<ndn::Data>& data);
+        bool isCodecKnown() const;
         void fetchGopKey(const boost::shared_ptr<const SlotSegment>& deltaSegment);
         void fetchGopDelta(const boost::shared_ptr<const SlotSegment>& segment);
+        void fetchDeltas(PacketNumber firstDeltaNo);
         void checkReadyDecode();
         void decode();
+        bool decodeFrames(const boost::shared_ptr<DecodedFrameCache::GopEntry>& gop,
+                          const DecodeQueue& decodeQueue,
+                          const boost::shared_ptr<FrameFetchingTask>& keyTask,
+                          const boost::shared_ptr<FrameFetchingTask>& targetTask,
+                          int nFramesFetched);
+        void pumpRange();
+        void scheduleRangeFrames();
+        void resolveRangeFrames();
+        void queueRangeDeltas(size_t idx);
+        void issueRangeTasks();
+        void decodeRangeFrames();
+        bool isRangeFrameFetched(size_t idx);
+        bool decodeRangeFrame(size_t idx);
+        Name rangeFrameName(PacketNumber seqNo) const;
+        void deliver(const FrameInfo& frameInfo, const WebRtcVideoFrame& frame, int nFramesFetched);
         void reset();
         void halt(std::string reason);
         VideoCoderParams setupDecoderParams(const boost::shared_ptr<ImmutableVideoFramePacket>&) const;
@@ -64,10 +134,18 @@ namespace ndnrtc {
 }
 
 //******************************************************************************
-FrameFetcher::FrameFetcher(const boost::shared_ptr<StorageEngine>& storage):
-    pimpl_(make_shared<FrameFetcherImpl>(storage)){}
-FrameFetcher::FrameFetcher(const boost::shared_ptr<Face>& face, const boost::shared_ptr<KeyChain>& keyChain):
-    pimpl_(make_shared<FrameFetcherImpl>(face, keyChain)){}
+FrameFetcher::FrameFetcher(const boost::shared_ptr<StorageEngine>& storage,
+                           const boost::shared_ptr<DecodedFrameCache>& cache):
+    pimpl_(make_shared<FrameFetcherImpl>(storage, cache)){}
+FrameFetcher::FrameFetcher(const boost::shared_ptr<Face>& face, const boost::shared_ptr<KeyChain>& keyChain,
+                           const boost::shared_ptr<DecodedFrameCache>& cache):
+    pimpl_(make_shared<FrameFetcherImpl>(face, keyChain, cache)){}
+
+boost::shared_ptr<DecodedFrameCache>
+FrameFetcher::createCache(size_t capacity)
+{
+    return make_shared<DecodedFrameCache>(capacity);
+}
 
 void
 FrameFetcher::fetch(const ndn::Name& frameName, 
@@ -78,7 +156,44 @@ FrameFetcher::fetch(const ndn::Name& frameName,
     pimpl_->fetch(frameName, onBufferAllocate, onFrameFetched, onFetchFailure);
 }
 
-const ndn::Name&
+void
+FrameFetcher::fetchRange(const ndn::Name& startFrameName,
+                         unsigned int nFrames, unsigned int stride,
+                         OnBufferAllocate onBufferAllocate,
+                         OnFrameFetched onFrameFetched,
+                         OnFetchFailure onFetchFailure)
+{
+    pimpl_->fetchRange(startFrameName, nFrames, stride, 
+                       onBufferAllocate, onFrameFetched, onFetchFailure);
+}
+
+void
+FrameFetcher::fetchRange(const ndn::Name& startFrameName,
+                         const ndn::Name& endFrameName, unsigned int stride,
+                         OnBufferAllocate onBufferAllocate,
+                         OnFrameFetched onFrameFetched,
+                         OnFetchFailure onFetchFailure)
+{
+    NamespaceInfo startInfo, endInfo;
+
+    if (!stride ||
+        !NameComponents::extractInfo(startFrameName, startInfo) ||
+        !NameComponents::extractInfo(endFrameName, endInfo) ||
+        !startInfo.getPrefix(prefix_filter::Thread).equals(endInfo.getPrefix(prefix_filter::Thread)) ||
+        endInfo.sampleNo_ < startInfo.sampleNo_)
+        throw std::runtime_error("Bad frame range provided");
+
+    pimpl_->fetchRange(startFrameName, (endInfo.sampleNo_ - startInfo.sampleNo_)/stride + 1, stride,
+                       onBufferAllocate, onFrameFetched, onFetchFailure);
+}
+
+void
+FrameFetcher::setInFlightBudget(unsigned int budget)
+{
+    pimpl_->setInFlightBudget(budget);
+}
+
+ndn::Name
 FrameFetcher::getName() const
 {
     return pimpl_->getName();
@@ -97,18 +212,28 @@ FrameFetcher::setLogger(boost::shared_ptr<ndnlog::new_api::Logger> logger)
 }
 
 //******************************************************************************
-FrameFetcherImpl::FrameFetcherImpl(const boost::shared_ptr<StorageEngine>& storage)
+FrameFetcherImpl::FrameFetcherImpl(const boost::shared_ptr<StorageEngine>& storage,
+                                   const boost::shared_ptr<DecodedFrameCache>& cache)
     : storage_(storage), 
       state_(FrameFetcher::Idle), 
-      fetchSettings_({3,1000})
+      fetchSettings_({3,1000}),
+      cache_(cache ? cache : make_shared<DecodedFrameCache>()),
+      inFlightBudget_(30), nInFlight_(0), rangeId_(0),
+      isRange_(false), rangeIsDelta_(false), isPumping_(false), isPumpPending_(false),
+      nextScheduled_(0), nextResolved_(0), nextDecoded_(0), lastDecodable_(-1)
 {
     fetchMethod_ = make_shared<FetchMethodLocal>(storage_);
     description_ = "frame-fetcher";
 }
 
-FrameFetcherImpl::FrameFetcherImpl(const boost::shared_ptr<Face>& face, const boost::shared_ptr<KeyChain>& keyChain)
+FrameFetcherImpl::FrameFetcherImpl(const boost::shared_ptr<Face>& face, const boost::shared_ptr<KeyChain>& keyChain,
+                                   const boost::shared_ptr<DecodedFrameCache>& cache)
     : state_(FrameFetcher::Idle), 
-      fetchSettings_({3,1000})
+      fetchSettings_({3,1000}),
+      cache_(cache ? cache : make_shared<DecodedFrameCache>()),
+      inFlightBudget_(30), nInFlight_(0), rangeId_(0),
+      isRange_(false), rangeIsDelta_(false), isPumping_(false), isPumpPending_(false),
+      nextScheduled_(0), nextResolved_(0), nextDecoded_(0), lastDecodable_(-1)
 {
     fetchMethod_ = make_shared<FetchMethodRemote>(face);
     description_ = "frame-fetcher";
@@ -126,10 +251,29 @@ FrameFetcherImpl::fetch(const ndn::Name& frameName,
         // rapid succession, these callbacks will be overwritten with the callbacks
         // from the latest invocation.
         // Needs to be fixed by storing callbacks per invocation.
+        if (isRange_)
+            reset();
+
         onBufferAllocate_ = onBufferAllocate;
         onFrameFetched_ = onFrameFetched;
         onFetchFailure_ = onFetchFailure;
         state_ = FrameFetcher::Fetching;
+        gop_.reset();
+
+        DecodedFrameCache::CachedFrame cachedFrame;
+        if (cache_->getFrame(frameNameInfo_.getPrefix(prefix_filter::Sample), cachedFrame))
+        {
+            LogInfoC << "target frame found in decoded frames cache" << std::endl;
+            state_ = FrameFetcher::Decoding;
+            deliver(cachedFrame.frameInfo_, *cachedFrame.frame_, 0);
+            return;
+        }
+
+        // decoder is set up from thread's codec, thus thread meta is needed
+        if (!isCodecKnown())
+            fetchThreadMeta(fetchSettings_.nRtx_);
+        if (state_ != FrameFetcher::Fetching)
+            return;
 
         if (!frameNameInfo_.isDelta_) // if it's a key frame - all is easy, just fetch it and decode
         {
@@ -156,6 +300,7 @@ FrameFetcherImpl::fetch(const ndn::Name& frameName,
 
             targetFrameTask_ = task;
             keyFrameTask_ = task;
+            keyFrameName_ = frameNameInfo_.getPrefix(prefix_filter::Sample);
             fetchingTasks_[frameName] = task;
 
             task->setLogger(getLogger());
@@ -203,6 +348,81 @@ FrameFetcherImpl::fetch(const ndn::Name& frameName,
         throw std::runtime_error("Bad frame name provided");
 }
 
+void
+FrameFetcherImpl::fetchThreadMeta(int nRtx)
+{
+    Name metaPrefix(frameNameInfo_.getPrefix(prefix_filter::ThreadNT));
+    metaPrefix.append(NameComponents::NameComponentMeta);
+
+    // any version of thread meta will do, as thread's codec does not change
+    boost::shared_ptr<Interest> interest(make_shared<Interest>(metaPrefix, fetchSettings_.interestLifeTimeMs_));
+    interest->setCanBePrefix(true);
+    interest->setChildSelector(1);
+
+    LogInfoC << "fetching thread meta " << metaPrefix << std::endl;
+
+    shared_ptr<FrameFetcherImpl> self = shared_from_this();
+    unsigned int rangeId = rangeId_;
+    fetchMethod_->express(interest,
+        [self, this, rangeId](const boost::shared_ptr<const Interest>& interest,
+                              const boost::shared_ptr<Data>& data)
+        {
+            if (rangeId != rangeId_) return;
+            onThreadMeta(data);
+        },
+        [self, this, rangeId, nRtx](const boost::shared_ptr<const Interest>& interest)
+        {
+            if (rangeId != rangeId_) return;
+
+            LogWarnC << "timeout for thread meta " << interest->getName() << std::endl;
+            if (nRtx > 0)
+                fetchThreadMeta(nRtx-1);
+            else
+                halt("Couldn't fetch thread meta "+interest->getName().toUri());
+        },
+        [self, this, rangeId](const boost::shared_ptr<const Interest>& interest,
+                              const boost::shared_ptr<NetworkNack>&)
+        {
+            if (rangeId != rangeId_) return;
+            halt("Couldn't fetch thread meta "+interest->getName().toUri());
+        });
+}
+
+void
+FrameFetcherImpl::onThreadMeta(const boost::shared_ptr<Data>& data)
+{
+    NamespaceInfo info;
+
+    if (data->getMetaInfo().getType() != ndn_ContentType_NACK &&
+        NameComponents::extractInfo(data->getName(), info) && info.isMeta_ && info.segNo_ == 0)
+    {
+        ImmutableHeaderPacket<DataSegmentHeader> packet(data->getContent());
+        NetworkData nd(packet.getPayload().size(), packet.getPayload().data());
+        VideoThreadMeta meta(boost::move(nd));
+
+        if (meta.isValid())
+        {
+            threadCodecs_[info.getPrefix(prefix_filter::ThreadNT)] = meta.getCoderParams().codec_;
+            LogInfoC << "thread codec is " << meta.getCoderParams().codec_ << std::endl;
+
+            // decoding may have been waiting for the codec
+            if (isRange_)
+                pumpRange();
+            else if (fetchingTasks_.size())
+                checkReadyDecode();
+            return;
+        }
+    }
+
+    halt("Couldn't read thread meta from "+data->getName().toUri());
+}
+
+bool
+FrameFetcherImpl::isCodecKnown() const
+{
+    return threadCodecs_.find(frameNameInfo_.getPrefix(prefix_filter::ThreadNT)) != threadCodecs_.end();
+}
+
 void 
 FrameFetcherImpl::fetchGopKey(const boost::shared_ptr<const SlotSegment>& deltaSegment)
 {
@@ -214,6 +434,22 @@ FrameFetcherImpl::fetchGopKey(const boost::shared_ptr<const SlotSegment>& deltaS
                                       .append(NameComponents::NameComponentKey)
                                       .appendSequenceNumber(keyFrameNumber);
     
+    keyFrameName_ = keyFrameName;
+
+    // if decoder for this GOP has not yet passed target frame, continue
+    // decoding from where it stopped instead of starting from the Key frame
+    shared_ptr<DecodedFrameCache::GopEntry> gop = cache_->getGop(keyFrameName);
+    if (gop && !gop->isBusy_ && gop->nextDeltaNo_ <= frameNameInfo_.sampleNo_)
+    {
+        LogInfoC << "resuming GOP " << keyFrameNumber << " decoding from delta " 
+                 << gop->nextDeltaNo_ << std::endl;
+
+        gop_ = gop;
+        gop_->isBusy_ = true;
+        fetchDeltas(gop->nextDeltaNo_);
+        return;
+    }
+
     LogInfoC << "will fetch Key frame " << keyFrameNumber
              << " (" << keyFrameName << ")" << std::endl;
     
@@ -259,8 +495,12 @@ FrameFetcherImpl::fetchGopDelta(const boost::shared_ptr<const SlotSegment>& segm
 {
     const shared_ptr<WireData<VideoFrameSegmentHeader>> videoFrameSegment = 
         dynamic_pointer_cast<WireData<VideoFrameSegmentHeader>>(segment->getData());
-    PacketNumber firstGopDeltaNumber = videoFrameSegment->segment().getHeader().pairedSequenceNo_;
+    fetchDeltas(videoFrameSegment->segment().getHeader().pairedSequenceNo_);
+}
 
+void
+FrameFetcherImpl::fetchDeltas(PacketNumber firstGopDeltaNumber)
+{
     // check, how many delta frames we need to fetch
     int deltasToFetch = frameNameInfo_.sampleNo_ - firstGopDeltaNumber;
 
@@ -300,7 +540,7 @@ FrameFetcherImpl::fetchGopDelta(const boost::shared_ptr<const SlotSegment>& segm
                     },
                     fetchSettings_);
 
-            deltasTasks_[deltaFrameName] = task;
+            deltasTasks_[deltaSeqNo] = task;
             fetchingTasks_[deltaFrameName] = task;
 
             task->setLogger(getLogger());
@@ -321,7 +561,7 @@ FrameFetcherImpl::checkReadyDecode()
         for (auto t:fetchingTasks_)
             allFetched &= (t.second->getState() == FrameFetchingTask::Completed);
 
-        if (allFetched)
+        if (allFetched && isCodecKnown())
         {
             state_ = FrameFetcher::Decoding;
             decode();
@@ -332,86 +572,514 @@ FrameFetcherImpl::checkReadyDecode()
 void
 FrameFetcherImpl::decode()
 {
-    // initialize decoder here and start decoding...
     VideoFrameSlot frameSlot;
     bool recovered = false;
-    shared_ptr<const BufferSlot> slot = keyFrameTask_->getSlot();
-    shared_ptr<ImmutableVideoFramePacket> framePacket =
-        frameSlot.readPacket(*slot, recovered);
-    
-    if (framePacket.get())
+
+    // build decoding queue: each task is paired with the number of delta frame
+    // GOP decoder will expect after this task's frame is decoded
+    std::vector<std::pair<shared_ptr<FrameFetchingTask>, PacketNumber>> decodeQueue;
+
+    if (!gop_)
     {
+        shared_ptr<const BufferSlot> keySlot = keyFrameTask_->getSlot();
+        shared_ptr<ImmutableVideoFramePacket> keyPacket = frameSlot.readPacket(*keySlot, recovered);
+
+        if (!keyPacket.get())
+        {
+            halt("Couldn't retrieve frame from "+keySlot->getPrefix().toUri());
+            return;
+        }
+
+        gop_ = cache_->addGop(keyFrameName_, setupDecoderParams(keyPacket));
+        gop_->isBusy_ = true;
+        decodeQueue.push_back(std::make_pair(keyFrameTask_, 
+                                             frameSlot.readSegmentHeader(*keySlot).pairedSequenceNo_));
+    }
+
+    for (auto t:deltasTasks_)
+        decodeQueue.push_back(std::make_pair(t.second, t.first+1));
+
+    if (targetFrameTask_ != keyFrameTask_)
+        decodeQueue.push_back(std::make_pair(targetFrameTask_, frameNameInfo_.sampleNo_+1));
+
+    LogDebugC << "need to decode " << decodeQueue.size() << " frames" << std::endl;
+
+    shared_ptr<DecodedFrameCache::GopEntry> gop = gop_;
+    bool targetDecoded = decodeFrames(gop, decodeQueue, keyFrameTask_, targetFrameTask_,
+                                      fetchingTasks_.size());
+    gop->isBusy_ = false;
+
+    if (state_ == FrameFetcher::Decoding && !targetDecoded)
+        halt("Couldn't decode frame "+frameNameInfo_.getPrefix(prefix_filter::Sample).toUri());
+}
+
+bool
+FrameFetcherImpl::decodeFrames(const shared_ptr<DecodedFrameCache::GopEntry>& gop,
+                               const DecodeQueue& decodeQueue,
+                               const shared_ptr<FrameFetchingTask>& keyTask,
+                               const shared_ptr<FrameFetchingTask>& targetTask,
+                               int nFramesFetched)
+{
+    VideoFrameSlot frameSlot;
+    bool recovered = false;
+    bool isTarget = false, targetDecoded = false;
+
+    gop->onDecoded_ = [&isTarget, &targetDecoded, nFramesFetched, gop, this]
+        (const FrameInfo& fi, const WebRtcVideoFrame& f){
+            cache_->addFrame(gop, Name(fi.ndnName_), fi, f);
+
+            if (isTarget)
+            {
+                targetDecoded = true;
+                deliver(fi, f, nFramesFetched);
+            }
+        };
+
+    for (auto& q:decodeQueue)
+    {
+        shared_ptr<const BufferSlot> slot = q.first->getSlot();
+        shared_ptr<ImmutableVideoFramePacket> framePacket = frameSlot.readPacket(*slot, recovered);
+
+        if (!framePacket.get())
+        {
+            // decoder state is broken now -- prevent it from being resumed
+            gop->nextDeltaNo_ = std::numeric_limits<PacketNumber>::max();
+            halt("Couldn't retrieve frame from "+slot->getPrefix().toUri());
+            break;
+        }
+
         VideoFrameSegmentHeader header = frameSlot.readSegmentHeader(*slot);
         FrameInfo finfo({ (uint64_t)(slot->getHeader().publishUnixTimestamp_*1000),
-                                     header.playbackNo_,
-                                     slot->getPrefix().toUri() });
-        VideoCoderParams params = setupDecoderParams(framePacket);
-        shared_ptr<FrameFetcherImpl> self = shared_from_this();
-        int needToDecode = fetchingTasks_.size();
-        OnDecodedImage onDecoded = 
-            [&needToDecode, self, this](const FrameInfo& fi, const WebRtcVideoFrame& f){
-                --needToDecode;
+                          header.playbackNo_,
+                          slot->getPrefix().toUri(),
+                          q.first == keyTask });
 
-                if (needToDecode == 0)
-                {
-                    uint8_t* buffer = onBufferAllocate_(self, f.width(), f.height());
-                    if (buffer)
-                    {
-                        state_ = FrameFetcher::Completed;
-
-                        ConvertFromI420(f, webrtc::kBGRA, 0, buffer);
-                        onFrameFetched_(self, fi, fetchingTasks_.size(), 
-                                        f.width(), f.height(), buffer);
-                    }
-                    else
-                        LogWarnC << "received null buffer for frame" << std::endl;
-                    reset();
-                }
-            };
-        boost::shared_ptr<VideoDecoder> decoder = 
-            boost::make_shared<VideoDecoder>(params, onDecoded);
+        isTarget = (q.first == targetTask);
+        gop->decoder_->processFrame(finfo, framePacket->getFrame());
+        gop->nextDeltaNo_ = q.second;
+    }
+
+    gop->onDecoded_ = OnDecodedImage();
+
+    return targetDecoded;
+}
+
+void
+FrameFetcherImpl::fetchRange(const ndn::Name& startFrameName,
+                             unsigned int nFrames, unsigned int stride,
+                             OnBufferAllocate onBufferAllocate,
+                             OnFrameFetched onFrameFetched,
+                             OnFetchFailure onFetchFailure)
+{
+    NamespaceInfo startInfo;
+
+    if (!NameComponents::extractInfo(startFrameName, startInfo))
+        throw std::runtime_error("Bad frame name provided");
+    if (!nFrames || !stride)
+        throw std::runtime_error("Bad frame range provided");
+
+    reset();
 
-        LogDebugC << "need to decode " << needToDecode << " frames. decoding Key" << std::endl;
-        assert(needToDecode > 0);
-        decoder->processFrame(finfo, framePacket->getFrame());
+    onBufferAllocate_ = onBufferAllocate;
+    onFrameFetched_ = onFrameFetched;
+    onFetchFailure_ = onFetchFailure;
+    frameNameInfo_ = startInfo;
+    state_ = FrameFetcher::Fetching;
+
+    isRange_ = true;
+    rangeIsDelta_ = startInfo.isDelta_;
+    rangeThreadPrefix_ = startInfo.getPrefix(prefix_filter::Thread);
+    rangeKeyPrefix_ = startInfo.getPrefix(prefix_filter::ThreadNT)
+                               .append(NameComponents::NameComponentKey);
+
+    for (unsigned int i = 0; i < nFrames; ++i)
+    {
+        RangeFrame rf;
+        rf.seqNo_ = startInfo.sampleNo_ + i*stride;
+        rf.frameName_ = rangeFrameName(rf.seqNo_);
+        rf.firstDeltaNo_ = rf.seqNo_;
+        rf.isKeyKnown_ = rf.isResolved_ = rf.isChainKnown_ = false;
+        rf.needsKey_ = rf.isCached_ = false;
+        rangeFrames_.push_back(rf);
+    }
+
+    LogInfoC << "fetching range of " << nFrames << " frames from " << startFrameName
+             << " (stride " << stride << ", in-flight budget " << inFlightBudget_ << ")" << std::endl;
+
+    if (!isCodecKnown())
+        fetchThreadMeta(fetchSettings_.nRtx_);
+    pumpRange();
+}
+
+void
+FrameFetcherImpl::pumpRange()
+{
+    // fetching tasks may complete synchronously (when fetching from local 
+    // storage) and trigger pumping again -- in this case, the loop below 
+    // just makes one more iteration
+    if (isPumping_)
+    {
+        isPumpPending_ = true;
+        return;
+    }
+
+    isPumping_ = true;
+    do {
+        isPumpPending_ = false;
+
+        scheduleRangeFrames();
+        resolveRangeFrames();
+        decodeRangeFrames();
+        issueRangeTasks();
+    } while (isPumpPending_ && isRange_ && state_ == FrameFetcher::Fetching);
+    isPumping_ = false;
+}
+
+void
+FrameFetcherImpl::scheduleRangeFrames()
+{
+    // frames are scheduled ahead of decoding, as long as there is room in 
+    // the in-flight budget
+    while (isRange_ && state_ == FrameFetcher::Fetching &&
+           nextScheduled_ < rangeFrames_.size() &&
+           nextScheduled_ - nextDecoded_ < inFlightBudget_ &&
+           nInFlight_ + rangeQueue_.size() < inFlightBudget_)
+    {
+        RangeFrame& rf = rangeFrames_[nextScheduled_];
 
-        // decode deltas if needed
-        for (auto t:deltasTasks_)
+        if (cache_->getFrame(rf.frameName_, rf.cachedFrame_))
         {
-            LogDebugC << "decoding Delta " << needToDecode << std::endl;
+            LogDebugC << "range frame " << rf.frameName_ << " found in decoded frames cache" << std::endl;
+            rf.isCached_ = true;
+            rf.isKeyKnown_ = true;
+        }
+        else
+        {
+            if (!rangeIsDelta_)
+            {
+                rf.keyFrameName_ = rf.frameName_;
+                rf.isKeyKnown_ = true;
+            }
+            rangeQueue_[std::make_pair(nextScheduled_, (int64_t)rf.seqNo_)] = rf.frameName_;
+        }
 
-            slot = t.second->getSlot();
-            framePacket = frameSlot.readPacket(*slot, recovered);
-            if (framePacket.get())
-                decoder->processFrame(finfo, framePacket->getFrame());
-            else
-                halt("Couldn't retrieve frame from "+t.second->getSlot()->getPrefix().toUri());
+        nextScheduled_++;
+    }
+}
+
+void
+FrameFetcherImpl::resolveRangeFrames()
+{
+    // figures out, in order, what must be decoded before each range frame: 
+    // frames of the same GOP continue decoding from the previous range frame, 
+    // the first frame of a GOP is decoded either from the GOP's Key frame or 
+    // from the cached decoder of this GOP
+    while (isRange_ && state_ == FrameFetcher::Fetching &&
+           nextResolved_ < nextScheduled_ &&
+           rangeFrames_[nextResolved_].isKeyKnown_)
+    {
+        size_t idx = nextResolved_++;
+        RangeFrame& rf = rangeFrames_[idx];
+
+        rf.isResolved_ = true;
+        if (rf.isCached_)
+        {
+            rf.isChainKnown_ = true;
+            continue;
         }
 
-        if (targetFrameTask_ != keyFrameTask_)
+        if (!rangeIsDelta_)
         {
-            assert(needToDecode == 1);
-            LogDebugC << "decoding target frame " << needToDecode << std::endl;
+            rf.needsKey_ = true;
+            rf.isChainKnown_ = true;
+        }
+        else
+        {
+            shared_ptr<DecodedFrameCache::GopEntry> gop;
 
-            slot = targetFrameTask_->getSlot();
-            framePacket = frameSlot.readPacket(*slot, recovered);
-            if (framePacket.get())
+            if (lastDecodable_ >= 0 && 
+                rangeFrames_[lastDecodable_].keyFrameName_ == rf.keyFrameName_)
+            {
+                rf.firstDeltaNo_ = rangeFrames_[lastDecodable_].seqNo_ + 1;
+                rf.isChainKnown_ = true;
+            }
+            else if ((gop = cache_->getGop(rf.keyFrameName_)) && 
+                     !gop->isBusy_ && gop->nextDeltaNo_ <= rf.seqNo_)
             {
-                header = frameSlot.readSegmentHeader(*slot);
-                finfo.timestamp_ = (uint64_t)(slot->getHeader().publishUnixTimestamp_*1000);
-                finfo.playbackNo_ = header.playbackNo_;
-                finfo.ndnName_ = slot->getPrefix().toUri();
+                LogDebugC << "range frame " << rf.seqNo_ << " resumes GOP "
+                          << rf.keyFrameName_ << " decoding from delta " 
+                          << gop->nextDeltaNo_ << std::endl;
 
-                decoder->processFrame(finfo, framePacket->getFrame());
+                gop->isBusy_ = true;
+                rf.gop_ = gop;
+                rf.firstDeltaNo_ = gop->nextDeltaNo_;
+                rf.isChainKnown_ = true;
             }
             else
-                halt("Couldn't retrieve frame from "+targetFrameTask_->getSlot()->getPrefix().toUri());
+            {
+                // deltas will be queued once Key frame's first segment arrives
+                rf.needsKey_ = true;
+                rangeQueue_[std::make_pair(idx, (int64_t)-1)] = rf.keyFrameName_;
+            }
+
+            if (rf.isChainKnown_)
+                queueRangeDeltas(idx);
         }
 
-        assert(needToDecode == 0);
+        lastDecodable_ = idx;
+    }
+}
+
+void
+FrameFetcherImpl::queueRangeDeltas(size_t idx)
+{
+    RangeFrame& rf = rangeFrames_[idx];
+    
+    for (PacketNumber deltaSeqNo = rf.firstDeltaNo_; deltaSeqNo < rf.seqNo_; ++deltaSeqNo)
+        rangeQueue_[std::make_pair(idx, (int64_t)deltaSeqNo)] = rangeFrameName(deltaSeqNo);
+}
+
+void
+FrameFetcherImpl::issueRangeTasks()
+{
+    while (isRange_ && state_ == FrameFetcher::Fetching &&
+           nInFlight_ < inFlightBudget_ && rangeQueue_.size())
+    {
+        size_t idx = rangeQueue_.begin()->first.first;
+        bool isGopKey = (rangeQueue_.begin()->first.second < 0);
+        Name frameName = rangeQueue_.begin()->second;
+        rangeQueue_.erase(rangeQueue_.begin());
+
+        if (fetchingTasks_.find(frameName) != fetchingTasks_.end())
+            continue;
+
+        bool isTarget = (frameName == rangeFrames_[idx].frameName_);
+        shared_ptr<FrameFetcherImpl> self = shared_from_this();
+        unsigned int rangeId = rangeId_;
+        OnSegment onFirstSegment;
+
+        if (rangeIsDelta_ && isTarget)
+            onFirstSegment = [self, this, rangeId, idx](const boost::shared_ptr<const FetchingTask>& task,
+                                                        const boost::shared_ptr<const SlotSegment>& segment)
+            {
+                if (rangeId != rangeId_) return;
+
+                // figure out GOP's Key frame
+                const shared_ptr<WireData<VideoFrameSegmentHeader>> videoFrameSegment = 
+                    dynamic_pointer_cast<WireData<VideoFrameSegmentHeader>>(segment->getData());
+                
+                rangeFrames_[idx].keyFrameName_ = Name(rangeKeyPrefix_)
+                    .appendSequenceNumber(videoFrameSegment->segment().getHeader().pairedSequenceNo_);
+                rangeFrames_[idx].isKeyKnown_ = true;
+                pumpRange();
+            };
+        else if (isGopKey)
+            onFirstSegment = [self, this, rangeId, idx](const boost::shared_ptr<const FetchingTask>& task,
+                                                        const boost::shared_ptr<const SlotSegment>& segment)
+            {
+                if (rangeId != rangeId_) return;
+
+                // figure out first Delta of the GOP and request deltas
+                const shared_ptr<WireData<VideoFrameSegmentHeader>> videoFrameSegment = 
+                    dynamic_pointer_cast<WireData<VideoFrameSegmentHeader>>(segment->getData());
+
+                rangeFrames_[idx].firstDeltaNo_ = videoFrameSegment->segment().getHeader().pairedSequenceNo_;
+                rangeFrames_[idx].isChainKnown_ = true;
+                queueRangeDeltas(idx);
+                pumpRange();
+            };
+
+        shared_ptr<FrameFetchingTask> task = 
+            make_shared<FrameFetchingTask>(
+                frameName,
+                fetchMethod_,
+                [self, this, rangeId](const boost::shared_ptr<const FetchingTask>& task, 
+                                      const boost::shared_ptr<const BufferSlot>& slot)
+                {
+                    if (rangeId != rangeId_) return;
+
+                    LogDebugC << "fetched " << task->getFrameName() << std::endl;
+                    nInFlight_--;
+                    pumpRange();
+                },
+                [self, this, rangeId](const boost::shared_ptr<const FetchingTask>& task,
+                                      std::string reason)
+                {
+                    if (rangeId != rangeId_) return;
+
+                    LogErrorC << "failed to fetch " << task->getFrameName() 
+                              << ": " << reason << std::endl;
+                    halt(reason);
+                },
+                fetchSettings_,
+                onFirstSegment);
+
+        LogDebugC << "will fetch " << frameName << std::endl;
+
+        fetchingTasks_[frameName] = task;
+        nInFlight_++;
+
+        task->setLogger(getLogger());
+        task->start();
+    }
+}
+
+void
+FrameFetcherImpl::decodeRangeFrames()
+{
+    while (isRange_ && state_ == FrameFetcher::Fetching &&
+           nextDecoded_ < nextResolved_)
+    {
+        RangeFrame& rf = rangeFrames_[nextDecoded_];
+        unsigned int rangeId = rangeId_;
+
+        NameComponents::extractInfo(rf.frameName_, frameNameInfo_);
+
+        if (rf.isCached_)
+            deliver(rf.cachedFrame_.frameInfo_, *rf.cachedFrame_.frame_, 0);
+        else if (!isRangeFrameFetched(nextDecoded_) || !isCodecKnown() ||
+                 !decodeRangeFrame(nextDecoded_))
+            break;
+
+        // client code might have started new fetching from the callback
+        if (rangeId != rangeId_)
+            return;
+
+        nextDecoded_++;
+    }
+
+    if (isRange_ && state_ == FrameFetcher::Fetching &&
+        nextDecoded_ == rangeFrames_.size())
+    {
+        LogInfoC << "fetched range of " << rangeFrames_.size() << " frames" << std::endl;
+
+        state_ = FrameFetcher::Completed;
+        reset();
+    }
+}
+
+bool
+FrameFetcherImpl::isRangeFrameFetched(size_t idx)
+{
+    const RangeFrame& rf = rangeFrames_[idx];
+    
+    if (!rf.isChainKnown_)
+        return false;
+
+    std::vector<Name> frameNames;
+    if (rf.needsKey_)
+        frameNames.push_back(rf.keyFrameName_);
+    for (PacketNumber deltaSeqNo = rf.firstDeltaNo_; deltaSeqNo < rf.seqNo_; ++deltaSeqNo)
+        frameNames.push_back(rangeFrameName(deltaSeqNo));
+    frameNames.push_back(rf.frameName_);
+
+    for (auto& n:frameNames)
+    {
+        auto it = fetchingTasks_.find(n);
+        if (it == fetchingTasks_.end() || 
+            it->second->getState() != FrameFetchingTask::Completed)
+            return false;
+    }
+
+    return true;
+}
+
+bool
+FrameFetcherImpl::decodeRangeFrame(size_t idx)
+{
+    RangeFrame& rf = rangeFrames_[idx];
+    shared_ptr<FrameFetchingTask> targetTask = fetchingTasks_[rf.frameName_];
+    shared_ptr<FrameFetchingTask> keyTask;
+    shared_ptr<DecodedFrameCache::GopEntry> gop = rf.gop_;
+    DecodeQueue decodeQueue;
+
+    if (rf.needsKey_)
+    {
+        VideoFrameSlot frameSlot;
+        bool recovered = false;
+
+        keyTask = fetchingTasks_[rf.keyFrameName_];
+        shared_ptr<const BufferSlot> keySlot = keyTask->getSlot();
+        shared_ptr<ImmutableVideoFramePacket> keyPacket = frameSlot.readPacket(*keySlot, recovered);
+
+        if (!keyPacket.get())
+        {
+            halt("Couldn't retrieve frame from "+keySlot->getPrefix().toUri());
+            return false;
+        }
+
+        gop = cache_->addGop(rf.keyFrameName_, setupDecoderParams(keyPacket));
+        gop->isBusy_ = true;
+        decodeQueue.push_back(std::make_pair(keyTask, 
+                                             frameSlot.readSegmentHeader(*keySlot).pairedSequenceNo_));
+    }
+    else if (!gop)
+        gop = rangeGop_; // continue decoding GOP of the previous range frame
+
+    assert(gop);
+    if (rangeGop_ && rangeGop_ != gop)
+        rangeGop_->isBusy_ = false;
+    rangeGop_ = gop;
+
+    if (rangeIsDelta_)
+    {
+        for (PacketNumber deltaSeqNo = rf.firstDeltaNo_; deltaSeqNo < rf.seqNo_; ++deltaSeqNo)
+            decodeQueue.push_back(std::make_pair(fetchingTasks_[rangeFrameName(deltaSeqNo)],
+                                                 deltaSeqNo+1));
+        decodeQueue.push_back(std::make_pair(targetTask, rf.seqNo_+1));
+    }
+
+    LogDebugC << "need to decode " << decodeQueue.size() << " frames for range frame "
+              << rf.frameName_ << std::endl;
+
+    Name frameName = rf.frameName_;
+    unsigned int rangeId = rangeId_;
+    bool targetDecoded = decodeFrames(gop, decodeQueue, keyTask, targetTask, decodeQueue.size());
+
+    if (rangeId != rangeId_)
+        return false;
+
+    // fetched data is not needed anymore
+    for (auto& q:decodeQueue)
+        fetchingTasks_.erase(q.first->getFrameName());
+
+    if (!targetDecoded)
+    {
+        halt("Couldn't decode frame "+frameName.toUri());
+        return false;
+    }
+
+    return true;
+}
+
+Name
+FrameFetcherImpl::rangeFrameName(PacketNumber seqNo) const
+{
+    return Name(rangeThreadPrefix_).appendSequenceNumber(seqNo);
+}
+
+void
+FrameFetcherImpl::deliver(const FrameInfo& frameInfo, const WebRtcVideoFrame& frame, 
+                          int nFramesFetched)
+{
+    shared_ptr<FrameFetcherImpl> self = shared_from_this();
+    uint8_t* buffer = onBufferAllocate_(self, frame.width(), frame.height());
+
+    if (buffer)
+    {
+        // range fetching completes once the last frame of the range is delivered
+        if (!isRange_)
+            state_ = FrameFetcher::Completed;
+
+        ConvertFromI420(frame, webrtc::kBGRA, 0, buffer);
+        onFrameFetched_(self, frameInfo, nFramesFetched, 
+                        frame.width(), frame.height(), buffer);
     }
     else
-        halt("Couldn't retrieve frame from "+keyFrameTask_->getSlot()->getPrefix().toUri());
+        LogWarnC << "received null buffer for frame" << std::endl;
+
+    if (!isRange_)
+        reset();
 }
 
 void
@@ -427,6 +1095,30 @@ FrameFetcherImpl::reset()
     deltasTasks_.clear();
     keyFrameTask_.reset();
     targetFrameTask_.reset();
+
+    if (gop_)
+    {
+        gop_->isBusy_ = false;
+        gop_.reset();
+    }
+
+    for (auto& rf:rangeFrames_)
+        if (rf.gop_) rf.gop_->isBusy_ = false;
+
+    if (rangeGop_)
+    {
+        rangeGop_->isBusy_ = false;
+        rangeGop_.reset();
+    }
+
+    // invalidates callbacks of range fetching tasks still in flight
+    rangeId_++;
+    isRange_ = false;
+    rangeFrames_.clear();
+    rangeQueue_.clear();
+    nInFlight_ = 0;
+    nextScheduled_ = nextResolved_ = nextDecoded_ = 0;
+    lastDecodable_ = -1;
 }
 
 void
@@ -452,5 +1144,9 @@ FrameFetcherImpl::setupDecoderParams(const boost::shared_ptr<ImmutableVideoFrame
     p.encodeWidth_ = fp->getFrame()._encodedWidth;
     p.dropFramesOn_ = false;
 
+    auto it = threadCodecs_.find(frameNameInfo_.getPrefix(prefix_filter::ThreadNT));
+    if (it != threadCodecs_.end())
+        p.codec_ = it->second;
+
     return p;
 }
\ No newline at end of file
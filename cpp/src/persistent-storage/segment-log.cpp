@@ -0,0 +1,347 @@
+//
+// segment-log.cpp
+//
+//  Created by Peter Gusev on 18 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include "segment-log.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <ndn-cpp/data.hpp>
+
+using namespace ndnrtc;
+using namespace ndn;
+using namespace boost;
+
+#define SEGMENT_LOG_MAGIC 0x4e52534c // "NRSL"
+#define SEGMENT_INDEX_MAGIC 0x4e525349 // "NRSI"
+// log is mapped with this much extra room, so that it does not need to be
+// remapped on every append (pages past the end of the file are never touched)
+#define SEGMENT_LOG_MAP_RESERVE (64*1024*1024)
+
+namespace ndnrtc {
+    // log record: header, followed by packet name URI and packet wire
+    typedef struct _RecordHeader {
+        uint32_t magic_;
+        uint32_t keyLength_;
+        uint32_t wireLength_;
+    } RecordHeader;
+
+    class SegmentLog::Mapping {
+    public:
+        Mapping(int fd, size_t size):size_(size), addr_(nullptr)
+        {
+            if (size_)
+            {
+                addr_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+                if (addr_ == MAP_FAILED)
+                    throw std::runtime_error(std::string("failed to map segment log: ")+strerror(errno));
+            }
+        }
+
+        ~Mapping()
+        {
+            if (addr_) munmap(addr_, size_);
+        }
+
+        const uint8_t* data() const { return (const uint8_t*)addr_; }
+        size_t size() const { return size_; }
+
+    private:
+        size_t size_;
+        void *addr_;
+    };
+}
+
+//******************************************************************************
+SegmentLog::SegmentLog(std::string path, bool readOnly)
+    : logPath_(path+"/segments.log"), indexPath_(path+"/segments.idx"),
+      readOnly_(readOnly), isFailed_(false), fd_(-1), logSize_(0), payloadSize_(0)
+{
+    if (!readOnly_ && mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+        throw std::runtime_error("failed to create directory "+path+": "+strerror(errno));
+
+    fd_ = open(logPath_.c_str(), (readOnly_ ? O_RDONLY : O_RDWR|O_CREAT|O_APPEND), 0644);
+    if (fd_ < 0)
+        throw std::runtime_error("failed to open "+logPath_+": "+strerror(errno));
+
+    struct stat st;
+    fstat(fd_, &st);
+    logSize_ = st.st_size;
+
+    loadIndex();
+}
+
+SegmentLog::~SegmentLog()
+{
+    close();
+}
+
+void
+SegmentLog::close()
+{
+    lock_guard<mutex> scopedLock(mutex_);
+
+    if (fd_ >= 0)
+    {
+        if (!readOnly_)
+            saveIndex();
+
+        mapping_.reset();
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool
+SegmentLog::append(const std::vector<shared_ptr<const Data>>& batch)
+{
+    if (readOnly_)
+        throw std::runtime_error("segment log is open in read-only mode");
+
+    // whole batch is serialized into one buffer and written at once
+    std::vector<std::pair<std::string, Entry>> entries;
+    std::vector<uint8_t> buffer;
+
+    for (auto d:batch)
+    {
+        SignedBlob wire = d->wireEncode();
+        std::string key = d->getName().toUri();
+        RecordHeader hdr({ SEGMENT_LOG_MAGIC, (uint32_t)key.size(), (uint32_t)wire.size() });
+        size_t recordOffset = buffer.size();
+
+        buffer.resize(recordOffset + sizeof(hdr) + key.size() + wire.size());
+        memcpy(buffer.data()+recordOffset, &hdr, sizeof(hdr));
+        memcpy(buffer.data()+recordOffset+sizeof(hdr), key.data(), key.size());
+        memcpy(buffer.data()+recordOffset+sizeof(hdr)+key.size(), wire.buf(), wire.size());
+
+        entries.push_back(std::make_pair(key,
+            Entry({ recordOffset+sizeof(hdr)+key.size(), (uint32_t)wire.size() })));
+    }
+
+    lock_guard<mutex> scopedLock(mutex_);
+
+    if (fd_ < 0 || isFailed_)
+        return false;
+
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t res = write(fd_, buffer.data()+written, buffer.size()-written);
+        if (res < 0)
+        {
+            if (errno == EINTR) continue;
+            // drop partially written records, so that the log stays consistent;
+            // if that fails, records appended after the torn tail would be
+            // lost on recovery, so no more appends are accepted
+            if (written && ftruncate(fd_, logSize_) != 0)
+                isFailed_ = true;
+            return false;
+        }
+        written += res;
+    }
+
+    for (auto& e:entries)
+    {
+        e.second.offset_ += logSize_;
+
+        auto it = index_.find(e.first);
+        if (it != index_.end())
+            payloadSize_ -= it->second.wireLength_;
+        payloadSize_ += e.second.wireLength_;
+        index_[e.first] = e.second;
+    }
+    logSize_ += buffer.size();
+
+    return true;
+}
+
+bool
+SegmentLog::get(const std::string& key, OnWire onWire)
+{
+    shared_ptr<Mapping> mapping;
+    Entry entry;
+
+    {
+        lock_guard<mutex> scopedLock(mutex_);
+
+        auto it = index_.find(key);
+        if (it == index_.end())
+            return false;
+
+        entry = it->second;
+        mapping = getMapping(entry.offset_ + entry.wireLength_);
+    }
+
+    // mapping is retained until callback returns, even if the log gets
+    // remapped meanwhile
+    onWire(mapping->data()+entry.offset_, entry.wireLength_);
+    return true;
+}
+
+void
+SegmentLog::scan(const std::string& prefix,
+                 boost::function<void(const std::string&, const Entry&)> visitor) const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+
+    for (auto it = index_.lower_bound(prefix);
+         it != index_.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+         ++it)
+        visitor(it->first, it->second);
+}
+
+size_t
+SegmentLog::getKeysNum() const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    return index_.size();
+}
+
+size_t
+SegmentLog::getPayloadSize() const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    return payloadSize_;
+}
+
+bool
+SegmentLog::isFailed() const
+{
+    lock_guard<mutex> scopedLock(mutex_);
+    return isFailed_;
+}
+
+//******************************************************************************
+void
+SegmentLog::loadIndex()
+{
+    // index file: magic, size of the log indexed, number of entries, followed
+    // by entries (key length, key, offset, wire length) in sorted order
+    uint64_t indexedSize = 0;
+    std::ifstream idx(indexPath_, std::ios::binary);
+
+    if (idx.good())
+    {
+        uint32_t magic = 0;
+        uint64_t nEntries = 0;
+
+        idx.read((char*)&magic, sizeof(magic));
+        idx.read((char*)&indexedSize, sizeof(indexedSize));
+        idx.read((char*)&nEntries, sizeof(nEntries));
+
+        if (idx.good() && magic == SEGMENT_INDEX_MAGIC && indexedSize <= logSize_)
+        {
+            std::string key;
+
+            for (uint64_t i = 0; i < nEntries && idx.good(); ++i)
+            {
+                uint32_t keyLength = 0;
+                Entry e;
+
+                idx.read((char*)&keyLength, sizeof(keyLength));
+                key.resize(keyLength);
+                idx.read(&key[0], keyLength);
+                idx.read((char*)&e.offset_, sizeof(e.offset_));
+                idx.read((char*)&e.wireLength_, sizeof(e.wireLength_));
+
+                if (idx.good())
+                {
+                    index_.emplace_hint(index_.end(), key, e);
+                    payloadSize_ += e.wireLength_;
+                }
+            }
+
+            if (!idx.good())
+            {
+                // corrupted index -- rebuild it from the log
+                index_.clear();
+                payloadSize_ = 0;
+                indexedSize = 0;
+            }
+        }
+        else
+            indexedSize = 0;
+    }
+
+    if (indexedSize < logSize_)
+        recover(indexedSize);
+}
+
+void
+SegmentLog::saveIndex()
+{
+    std::string tmpPath = indexPath_+".tmp";
+    std::ofstream idx(tmpPath, std::ios::binary|std::ios::trunc);
+    uint32_t magic = SEGMENT_INDEX_MAGIC;
+    uint64_t nEntries = index_.size();
+
+    idx.write((const char*)&magic, sizeof(magic));
+    idx.write((const char*)&logSize_, sizeof(logSize_));
+    idx.write((const char*)&nEntries, sizeof(nEntries));
+
+    for (auto& e:index_)
+    {
+        uint32_t keyLength = e.first.size();
+        idx.write((const char*)&keyLength, sizeof(keyLength));
+        idx.write(e.first.data(), keyLength);
+        idx.write((const char*)&e.second.offset_, sizeof(e.second.offset_));
+        idx.write((const char*)&e.second.wireLength_, sizeof(e.second.wireLength_));
+    }
+    idx.close();
+
+    if (idx.good())
+        rename(tmpPath.c_str(), indexPath_.c_str());
+}
+
+void
+SegmentLog::recover(uint64_t offset)
+{
+    shared_ptr<Mapping> mapping = getMapping(logSize_);
+    const uint8_t *log = mapping->data();
+
+    while (offset + sizeof(RecordHeader) <= logSize_)
+    {
+        RecordHeader hdr;
+        memcpy(&hdr, log+offset, sizeof(hdr));
+
+        uint64_t recordSize = sizeof(hdr) + hdr.keyLength_ + hdr.wireLength_;
+        if (hdr.magic_ != SEGMENT_LOG_MAGIC || offset + recordSize > logSize_)
+            break;
+
+        std::string key((const char*)log+offset+sizeof(hdr), hdr.keyLength_);
+        auto it = index_.find(key);
+        if (it != index_.end())
+            payloadSize_ -= it->second.wireLength_;
+
+        index_[key] = Entry({ offset+sizeof(hdr)+hdr.keyLength_, hdr.wireLength_ });
+        payloadSize_ += hdr.wireLength_;
+        offset += recordSize;
+    }
+
+    // incomplete record at the end of the log (interrupted write)
+    if (offset < logSize_)
+    {
+        if (!readOnly_ && ftruncate(fd_, offset) != 0)
+            throw std::runtime_error("failed to truncate "+logPath_+": "+strerror(errno));
+        logSize_ = offset;
+    }
+}
+
+shared_ptr<SegmentLog::Mapping>
+SegmentLog::getMapping(uint64_t minSize)
+{
+    if (!mapping_ || mapping_->size() < minSize)
+        mapping_ = make_shared<Mapping>(fd_,
+            (readOnly_ ? logSize_ : logSize_ + SEGMENT_LOG_MAP_RESERVE));
+
+    return mapping_;
+}
@@ -0,0 +1,98 @@
+//
+// segment-log.hpp
+//
+//  Created by Peter Gusev on 18 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#ifndef __segment_log_hpp__
+#define __segment_log_hpp__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "storage-engine.hpp"
+
+namespace ndn {
+    class Data;
+}
+
+namespace ndnrtc {
+
+    /**
+     * Append-only log of data packets for write-once, read-many workloads
+     * (stream recording and replay).
+     * Data packets are appended to the log file (<path>/segments.log) as
+     * records of packet name and wire encoding, one write per batch. Log file
+     * is memory-mapped for reading, so packets are read straight from the
+     * mapping without any copying.
+     * Sorted index of packet names (name -> record offset) is kept in memory
+     * and is saved to the index file (<path>/segments.idx) when the log is
+     * closed. Upon opening, the index is loaded and the tail of the log which
+     * was not indexed (for instance, after a crash) is recovered by scanning.
+     * The class is thread-safe.
+     */
+    class SegmentLog {
+    public:
+        typedef struct _Entry {
+            uint64_t offset_;       // offset of packet wire in the log file
+            uint32_t wireLength_;
+        } Entry;
+
+        SegmentLog(std::string path, bool readOnly = false);
+        ~SegmentLog();
+
+        void close();
+
+        /**
+         * Appends a batch of data packets to the log with a single write.
+         * If a write fails and the partially written batch can't be 
+         * truncated, log stops accepting appends (the torn tail is dropped
+         * when the log is opened next time).
+         * @return true if the whole batch was appended, false otherwise.
+         */
+        bool append(const std::vector<boost::shared_ptr<const ndn::Data>>& batch);
+
+        /**
+         * Calls onWire with the wire encoding of a packet stored under the
+         * given key (packet name URI). The buffer points into the log
+         * mapping and is valid only while the callback runs.
+         * @return true if packet was found, false otherwise.
+         */
+        bool get(const std::string& key, OnWire onWire);
+
+        /**
+         * Calls visitor for all keys that start with prefix, in sorted order.
+         */
+        void scan(const std::string& prefix,
+                  boost::function<void(const std::string&, const Entry&)> visitor) const;
+
+        size_t getKeysNum() const;
+        size_t getPayloadSize() const;
+        bool isFailed() const;
+
+    private:
+        class Mapping;
+
+        SegmentLog(const SegmentLog&) = delete;
+
+        std::string logPath_, indexPath_;
+        bool readOnly_, isFailed_;
+        int fd_;
+        uint64_t logSize_, payloadSize_;
+        mutable boost::mutex mutex_;
+        std::map<std::string, Entry> index_;
+        boost::shared_ptr<Mapping> mapping_;
+
+        void loadIndex();
+        void saveIndex();
+        void recover(uint64_t offset);
+        boost::shared_ptr<Mapping> getMapping(uint64_t minSize);
+    };
+}
+
+#endif
@@ -15,17 +15,20 @@
 #include <boost/algorithm/string.hpp>
 
 #include "clock.hpp"
+#include "persistent-storage/segment-log.hpp"
 
 #if HAVE_PERSISTENT_STORAGE
 
 #ifndef __ANDROID__ // use RocksDB on linux and macOS
     
     #include <rocksdb/db.h>
+    #include <rocksdb/write_batch.h>
     namespace db_namespace = rocksdb;
 
 #else // for Android - use LevelDB
 
     #include <leveldb/db.h>
+    #include <leveldb/write_batch.h>
     namespace db_namespace = leveldb;
 
 #endif
@@ -49,13 +52,17 @@ class StorageEngineImpl : public enable_shared_from_this<StorageEngineImpl>
     } Stats;
 
 #if HAVE_PERSISTENT_STORAGE
-    StorageEngineImpl(std::string dbPath) : dbPath_(dbPath), db_(nullptr), keysTrieBuilt_(false)
+    StorageEngineImpl(std::string dbPath, StorageEngine::Backend backend) 
+        : dbPath_(dbPath), backend_(backend), db_(nullptr), keysTrieBuilt_(false)
     {
     }
 #else
-    StorageEngineImpl(std::string dbPath)
+    // segment log does not depend on key-value storage libraries
+    StorageEngineImpl(std::string dbPath, StorageEngine::Backend backend)
+        : dbPath_(dbPath), backend_(backend), keysTrieBuilt_(false)
     {
-        throw std::runtime_error("The library is not copmiled with persistent storage support.");
+        if (backend_ == StorageEngine::KeyValueBackend)
+            throw std::runtime_error("The library is not copmiled with persistent storage support.");
     }
 #endif
 
@@ -68,12 +75,15 @@ class StorageEngineImpl : public enable_shared_from_this<StorageEngineImpl>
     void close();
 
     bool put(const Data &data);
+    bool put(const std::vector<shared_ptr<const Data>> &batch);
     shared_ptr<Data> get(const Name &dataName);
     shared_ptr<Data> read(const Interest &interest);
+    bool read(const Interest &interest, OnWire onWire);
 
     void getLongestPrefixes(asio::io_service &io,
                             function<void(const std::vector<Name> &)> onCompletion);
     const Stats &getStats() const { return stats_; }
+    StorageEngine::Backend getBackend() const { return backend_; }
 
   private:
     class NameTrie
@@ -133,6 +143,8 @@ class StorageEngineImpl : public enable_shared_from_this<StorageEngineImpl>
     };
 
     std::string dbPath_;
+    StorageEngine::Backend backend_;
+    boost::shared_ptr<SegmentLog> log_;
     bool keysTrieBuilt_;
     NameTrie keysTrie_;
     Stats stats_;
@@ -141,13 +153,17 @@ class StorageEngineImpl : public enable_shared_from_this<StorageEngineImpl>
 #endif
 
     void buildKeyTrie();
+    bool getWire(const std::string &key, OnWire onWire);
+    // calls visitor for all keys starting with prefix, in sorted order
+    void scan(const std::string &prefix, function<void(const std::string &)> visitor);
 };
 
 }
 
 
 //******************************************************************************
-StorageEngine::StorageEngine(std::string dbPath, bool readOnly) : pimpl_(boost::make_shared<StorageEngineImpl>(dbPath))
+StorageEngine::StorageEngine(std::string dbPath, bool readOnly, Backend backend) 
+    : pimpl_(boost::make_shared<StorageEngineImpl>(dbPath, backend))
 {
     try
     {
@@ -174,6 +190,11 @@ void StorageEngine::put(const Data &data)
     pimpl_->put(data);
 }
 
+bool StorageEngine::put(const std::vector<shared_ptr<const Data>> &batch)
+{
+    return pimpl_->put(batch);
+}
+
 shared_ptr<Data>
 StorageEngine::get(const Name &dataName)
 {
@@ -186,6 +207,11 @@ StorageEngine::read(const Interest &interest)
     return pimpl_->read(interest);
 }
 
+bool StorageEngine::read(const Interest &interest, OnWire onWire)
+{
+    return pimpl_->read(interest, onWire);
+}
+
 void StorageEngine::scanForLongestPrefixes(asio::io_service &io,
                                            function<void(const std::vector<ndn::Name> &)> onCompleted)
 {
@@ -204,9 +230,21 @@ StorageEngine::getKeysNum() const
     return pimpl_->getStats().nKeys_;
 }
 
+StorageEngine::Backend
+StorageEngine::getBackend() const
+{
+    return pimpl_->getBackend();
+}
+
 //******************************************************************************
 bool StorageEngineImpl::open(bool readOnly)
 {
+    if (backend_ == StorageEngine::SegmentLogBackend)
+    {
+        log_ = make_shared<SegmentLog>(dbPath_, readOnly);
+        return true;
+    }
+
 #if HAVE_PERSISTENT_STORAGE
     db_namespace::Options options;
     options.create_if_missing = true;
@@ -227,6 +265,9 @@ bool StorageEngineImpl::open(bool readOnly)
 
 void StorageEngineImpl::close()
 {
+    if (log_)
+        log_->close();
+
 #if HAVE_PERSISTENT_STORAGE
     if (db_)
     {
@@ -240,6 +281,9 @@ void StorageEngineImpl::close()
 
 bool StorageEngineImpl::put(const Data &data)
 {
+    if (log_)
+        return log_->append({ make_shared<const Data>(data) });
+
 #if HAVE_PERSISTENT_STORAGE
     if (!db_)
         throw std::runtime_error("DB is not open");
@@ -255,49 +299,70 @@ bool StorageEngineImpl::put(const Data &data)
 #endif
 }
 
-shared_ptr<Data> StorageEngineImpl::get(const Name &dataName)
+bool StorageEngineImpl::put(const std::vector<shared_ptr<const Data>> &batch)
 {
+    if (log_)
+        return log_->append(batch);
+
 #if HAVE_PERSISTENT_STORAGE
     if (!db_)
         throw std::runtime_error("DB is not open");
 
-    static std::string dataString;
-    db_namespace::Status s = db_->Get(db_namespace::ReadOptions(),
-                                      dataName.toUri(),
-                                      &dataString);
-    if (s.ok())
+    db_namespace::WriteBatch writeBatch;
+    for (auto d : batch)
     {
-        shared_ptr<Data> data = make_shared<Data>();
-        data->wireDecode((const uint8_t *)dataString.data(), dataString.size());
-
-        return data;
+        SignedBlob wire = d->wireEncode();
+        writeBatch.Put(d->getName().toUri(),
+                       db_namespace::Slice((const char *)wire.buf(), wire.size()));
     }
+
+    db_namespace::Status s = db_->Write(db_namespace::WriteOptions(), &writeBatch);
+    return s.ok();
+#else
+    return false;
 #endif
-    return shared_ptr<Data>(nullptr);
+}
+
+shared_ptr<Data> StorageEngineImpl::get(const Name &dataName)
+{
+    shared_ptr<Data> data;
+
+    getWire(dataName.toUri(), [&data](const uint8_t *wire, size_t wireLength) {
+        data = make_shared<Data>();
+        data->wireDecode(wire, wireLength);
+    });
+
+    return data;
 }
 
 shared_ptr<Data> StorageEngineImpl::read(const Interest &interest)
 {
     shared_ptr<Data> data;
-#if HAVE_PERSISTENT_STORAGE
+
+    read(interest, [&data](const uint8_t *wire, size_t wireLength) {
+        data = make_shared<Data>();
+        data->wireDecode(wire, wireLength);
+    });
+
+    return data;
+}
+
+bool StorageEngineImpl::read(const Interest &interest, OnWire onWire)
+{
     bool canBePrefix = interest.getCanBePrefix();
 
     if (canBePrefix)
     {
         // extract by prefix match
-        Name prefix = interest.getName(), keyName;
-        auto it = db_->NewIterator(db_namespace::ReadOptions());
+        Name prefix = interest.getName();
         std::string key = "";
         bool checkMaxSuffixComponents = interest.getMaxSuffixComponents() != -1;
         bool checkMinSuffixComponents = interest.getMinSuffixComponents() != -1;
 
-        for (it->Seek(prefix.toUri());
-             it->Valid() && it->key().starts_with(prefix.toUri());
-             it->Next())
-        {
+        scan(prefix.toUri(), [&](const std::string &k) {
             if (checkMaxSuffixComponents || checkMinSuffixComponents)
             {
-                keyName = Name(it->key().ToString());
+                Name keyName(k);
                 int nSuffixComponents = keyName.size() - prefix.size();
                 bool passCheck = false;
 
@@ -309,21 +374,59 @@ shared_ptr<Data> StorageEngineImpl::read(const Interest &interest)
                     passCheck = true;
                 
                 if (passCheck)
-                    key = it->key().ToString();
+                    key = k;
             }
             else
-                key = it->key().ToString();
-        }
+                key = k;
+        });
 
         if (key != "")
-            data = get(Name(key));
+            return getWire(key, onWire);
 
-        delete it;
+        return false;
+    }
+    
+    return getWire(interest.getName().toUri(), onWire);
+}
+
+bool StorageEngineImpl::getWire(const std::string &key, OnWire onWire)
+{
+    if (log_)
+        return log_->get(key, onWire);
+
+#if HAVE_PERSISTENT_STORAGE
+    if (!db_)
+        throw std::runtime_error("DB is not open");
+
+    std::string dataString;
+    db_namespace::Status s = db_->Get(db_namespace::ReadOptions(), key, &dataString);
+    if (s.ok())
+    {
+        onWire((const uint8_t *)dataString.data(), dataString.size());
+        return true;
     }
-    else
-        data =  get(interest.getName());
 #endif
-    return data;
+    return false;
+}
+
+void StorageEngineImpl::scan(const std::string &prefix, function<void(const std::string &)> visitor)
+{
+    if (log_)
+    {
+        log_->scan(prefix, [visitor](const std::string &key, const SegmentLog::Entry &) {
+            visitor(key);
+        });
+        return;
+    }
+
+#if HAVE_PERSISTENT_STORAGE
+    db_namespace::Iterator *it = db_->NewIterator(db_namespace::ReadOptions());
+
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next())
+        visitor(it->key().ToString());
+
+    delete it;
+#endif
 }
 
 void StorageEngineImpl::getLongestPrefixes(asio::io_service &io,
@@ -346,6 +449,15 @@ void StorageEngineImpl::buildKeyTrie()
 {
     stats_.nKeys_ = 0;
     stats_.valueSizeBytes_ = 0;
+
+    if (log_)
+    {
+        scan("", [this](const std::string &key) { keysTrie_.insert(key); });
+        stats_.nKeys_ = log_->getKeysNum();
+        stats_.valueSizeBytes_ = log_->getPayloadSize();
+        return;
+    }
+
 #if HAVE_PERSISTENT_STORAGE
 
     db_namespace::Iterator *it = db_->NewIterator(rocksdb::ReadOptions());
@@ -17,6 +17,7 @@
 #include "playout-control.hpp"
 #include "statistics.hpp"
 #include "sample-estimator.hpp"
+#include "event-log.hpp"
 #include "../include/remote-stream.hpp"
 
 using namespace ndnrtc;
@@ -123,7 +124,6 @@ class ReceivedMetadataProcessing
         return false;
     }
 
-    // TODO: update code for audio too
     ENABLE_IF(MetadataClass, AudioThreadMeta)
     bool processMetadata(boost::shared_ptr<AudioThreadMeta> metadata,
                          boost::shared_ptr<PipelineControlStateMachine::Struct> ctrl)
@@ -132,11 +132,15 @@ class ReceivedMetadataProcessing
         {
             PacketNumber bundleNo = metadata->getBundleNo();
             double initialDrd = ctrl->drdEstimator_->getOriginalEstimation();
+            double bundleRate = metadata->getRate();
+
             unsigned int pipelineInitial =
-                ctrl->interestControl_->getCurrentStrategy()->calculateDemand(metadata->getRate(),
+                ctrl->interestControl_->getCurrentStrategy()->calculateDemand(bundleRate,
                                                                               initialDrd, initialDrd * 0.05);
 
-            ctrl->interestControl_->initialize(metadata->getRate(), pipelineInitial);
+            // bundles are never larger than one segment
+            ctrl->sampleEstimator_->bootstrapSegmentNumber(1, SampleClass::Delta, SegmentClass::Data);
+            ctrl->interestControl_->initialize(bundleRate, pipelineInitial);
             ctrl->pipeliner_->setSequenceNumber(bundleNo, SampleClass::Delta);
             ctrl->pipeliner_->setNeedSample(SampleClass::Delta);
             ctrl->pipeliner_->fillUpPipeline(ctrl->threadPrefix_);
@@ -673,6 +677,9 @@ void PipelineControlStateMachine::switchToState(const boost::shared_ptr<Pipeline
              << event->toString() << ")->[" << state->str() << "] "
              << stateDuration << "ms" << std::endl;
 
+    eventlog::write(eventlog::Component::PipelineControl, eventlog::Event::StateTransition, this,
+                    currentState_->toInt(), state->toInt(), event->getType(), stateDuration);
+
     currentState_->exit();
     currentState_ = state;
     currentState_->enter();
@@ -17,6 +17,7 @@
 #include "interest-queue.hpp"
 #include "segment-controller.hpp"
 #include "statistics.hpp"
+#include "event-log.hpp"
 
 using namespace ndnrtc;
 using namespace ndnrtc::statistics;
@@ -70,6 +71,11 @@ Pipeliner::express(const ndn::Name& threadPrefix, bool placeInBuffer)
     request(batch, DeadlinePriority::fromNow(0));
     if (placeInBuffer) buffer_->requested(batch);
 
+    eventlog::write(eventlog::Component::Pipeliner, eventlog::Event::SampleRequested, this,
+                    (nextSamplePriority_ == SampleClass::Key),
+                    (nextSamplePriority_ == SampleClass::Delta ? seqCounter_.delta_ : seqCounter_.key_),
+                    batch.size(), 0);
+
     nextSamplePriority_ = SampleClass::Delta;
 }
 
@@ -102,6 +108,11 @@ Pipeliner::fillUpPipeline(const ndn::Name& threadPrefix)
         buffer_->requested(batch);
         interestControl_->increment();
 
+        eventlog::write(eventlog::Component::Pipeliner, eventlog::Event::SampleRequested, this,
+                        (nextSamplePriority_ == SampleClass::Key),
+                        (nextSamplePriority_ == SampleClass::Delta ? seqCounter_.delta_ : seqCounter_.key_),
+                        batch.size(), deadline);
+
         LogDebugC << "requested "
             << (nextSamplePriority_ == SampleClass::Delta ? seqCounter_.delta_ : seqCounter_.key_)
             << " " << SAMPLE_SUFFIX(n) << " x" << batch.size() << std::endl;
@@ -218,6 +229,9 @@ void Pipeliner::onNewData(const BufferReceipt& receipt)
         LogTraceC << interests.size() << " missing segments for "
             << receipt.slot_->getNameInfo().getSuffix(suffix_filter::Thread) << std::endl;
         express(interests, true);
+        eventlog::write(eventlog::Component::Pipeliner, eventlog::Event::SegmentsRerequested, this,
+                        (receipt.slot_->getNameInfo().class_ == SampleClass::Key),
+                        receipt.slot_->getNameInfo().sampleNo_, interests.size());
         (*sstorage_)[Indicator::DoubleRtFrames]++;
         if (!receipt.slot_->getNameInfo().isDelta_)
             (*sstorage_)[Indicator::DoubleRtFramesKey]++;
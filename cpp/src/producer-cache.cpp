@@ -0,0 +1,499 @@
+//
+// producer-cache.cpp
+//
+//  Created by Peter Gusev on 30 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include <algorithm>
+#include <assert.h>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <ndn-cpp/face.hpp>
+#include <ndn-cpp/interest-filter.hpp>
+
+#include "producer-cache.hpp"
+
+// samples further than this from cached ones are kept in name store
+#define MAX_SEQNO_GAP 1024
+// segments with greater numbers are not indexed, but matched by name
+#define MAX_INDEXED_SEGNO 1024
+// how often expired entries are removed from name store
+#define STORE_CLEANUP_INTERVAL_MS 100
+// used for interests without lifetime
+#define DEFAULT_INTEREST_LIFETIME_MS 4000
+
+using namespace ndnrtc;
+using namespace ndn;
+
+ProducerCache::ProducerCache(Face *face, unsigned int lifetimeMs, size_t maxBytes)
+    : face_(face), lifetimeMs_(lifetimeMs), maxBytes_(maxBytes), bytes_(0),
+      lastStoreCleanupMs_(0)
+{
+    description_ = "producer-cache";
+}
+
+ProducerCache::~ProducerCache()
+{
+    if (face_)
+        for (auto id : interestFilterIds_)
+            face_->unsetInterestFilter(id);
+}
+
+void ProducerCache::setInterestFilter(const Name &prefix)
+{
+    interestFilterIds_.push_back(
+        face_->setInterestFilter(prefix, boost::bind(&ProducerCache::onInterest, this,
+                                                     _1, _2, _3, _4, _5)));
+}
+
+void ProducerCache::add(const Data &data)
+{
+    MillisecondsSince1970 now = ndn_getNowMilliseconds();
+    boost::shared_ptr<const Data> d(boost::make_shared<Data>(data));
+    Milliseconds freshness = data.getMetaInfo().getFreshnessPeriod();
+    MillisecondsSince1970 staleMs = (freshness < 0 ? -1 : now + freshness);
+
+    NamespaceInfo info;
+    SampleKey key;
+    bool isSample = NameComponents::extractInfo(data.getName(), info) &&
+                    getSampleKey(info, key);
+    boost::shared_ptr<Sample> sample;
+
+    if (isSample && (sample = getSample(key, true)))
+    {
+        Entry *e = getEntry(*sample, info, data);
+        size_t size = data.getDefaultWireEncoding().size();
+
+        if (e->data_)
+        {
+            size_t oldSize = e->data_->getDefaultWireEncoding().size();
+            sample->bytes_ -= oldSize;
+            bytes_ -= oldSize;
+        }
+
+        e->data_ = d;
+        e->staleMs_ = staleMs;
+        sample->bytes_ += size;
+        bytes_ += size;
+    }
+    else
+    {
+        StoreEntry &e = store_[data.getName()];
+        e.data_ = d;
+        e.staleMs_ = staleMs;
+        e.expireMs_ = now + std::max<Milliseconds>(freshness, lifetimeMs_);
+    }
+
+    if (isSample)
+    {
+        auto it = samplePit_.find(key);
+        if (it != samplePit_.end())
+        {
+            satisfyPending(it->second, data);
+            if (it->second.empty())
+                samplePit_.erase(it);
+        }
+    }
+
+    if (otherPit_.size())
+        satisfyPending(otherPit_, data);
+
+    evict(now);
+    cleanupStore(now);
+}
+
+boost::shared_ptr<const Data>
+ProducerCache::find(const Interest &interest)
+{
+    MillisecondsSince1970 now = ndn_getNowMilliseconds();
+    NamespaceInfo info;
+    SampleKey key;
+
+    if (NameComponents::extractInfo(interest.getName(), info) && getSampleKey(info, key))
+    {
+        boost::shared_ptr<Sample> sample = getSample(key, false);
+        boost::shared_ptr<const Data> d;
+
+        if (sample)
+            d = findInSample(*sample, info, interest, now);
+        if (d)
+            return d;
+    }
+
+    // samples too far from their ring are kept in name store as well
+    return findInStore(interest, now);
+}
+
+void ProducerCache::storePendingInterest(const boost::shared_ptr<const Interest> &interest,
+                                         Face &face)
+{
+    boost::shared_ptr<const PendingInterest> pi(boost::make_shared<PendingInterest>(interest, face));
+    Milliseconds lifetime = interest->getInterestLifetimeMilliseconds();
+    MillisecondsSince1970 timeoutMs = pi->getTimeoutPeriodStart() +
+                                      (lifetime < 0 ? DEFAULT_INTEREST_LIFETIME_MS : lifetime);
+    NamespaceInfo info;
+    SampleKey key;
+
+    if (NameComponents::extractInfo(interest->getName(), info) && getSampleKey(info, key))
+    {
+        samplePit_[key].push_back(pi);
+        pitTimeouts_.push(PitTimeout(timeoutMs, key));
+    }
+    else
+        otherPit_.push_back(pi);
+}
+
+void ProducerCache::getPendingInterestsForName(const Name &name,
+                                               PendingInterests &pendingInterests)
+{
+    pendingInterests.clear();
+
+    MillisecondsSince1970 now = ndn_getNowMilliseconds();
+    NamespaceInfo info;
+    SampleKey key;
+
+    if (NameComponents::extractInfo(name, info) && getSampleKey(info, key))
+    {
+        auto it = samplePit_.find(key);
+        if (it != samplePit_.end())
+            for (auto &pi : it->second)
+                if (!pi->isTimedOut(now) && pi->getInterest()->matchesName(name))
+                    pendingInterests.push_back(pi);
+    }
+
+    for (auto &pi : otherPit_)
+        if (!pi->isTimedOut(now) && pi->getInterest()->matchesName(name))
+            pendingInterests.push_back(pi);
+}
+
+void ProducerCache::getPendingInterestsWithPrefix(const Name &prefix,
+                                                  PendingInterests &pendingInterests)
+{
+    pendingInterests.clear();
+
+    MillisecondsSince1970 now = ndn_getNowMilliseconds();
+    NamespaceInfo info;
+    SampleKey key;
+
+    if (NameComponents::extractInfo(prefix, info) && getSampleKey(info, key))
+    {
+        auto it = samplePit_.find(key);
+        if (it != samplePit_.end())
+            for (auto &pi : it->second)
+                if (!pi->isTimedOut(now) && prefix.match(pi->getInterest()->getName()))
+                    pendingInterests.push_back(pi);
+    }
+    else
+    {
+        // prefix above sample level - check all pending interests
+        for (auto &it : samplePit_)
+            for (auto &pi : it.second)
+                if (!pi->isTimedOut(now) && prefix.match(pi->getInterest()->getName()))
+                    pendingInterests.push_back(pi);
+    }
+
+    for (auto &pi : otherPit_)
+        if (!pi->isTimedOut(now) && prefix.match(pi->getInterest()->getName()))
+            pendingInterests.push_back(pi);
+}
+
+void ProducerCache::extractPendingInterestsBefore(const Name &sampleName,
+                                                  PendingInterests &pendingInterests)
+{
+    pendingInterests.clear();
+
+    NamespaceInfo info;
+    SampleKey key;
+
+    if (!NameComponents::extractInfo(sampleName, info) || !getSampleKey(info, key))
+        return;
+
+    MillisecondsSince1970 now = ndn_getNowMilliseconds();
+    auto first = samplePit_.lower_bound(SampleKey(key.first, 0));
+    auto last = samplePit_.lower_bound(key);
+
+    for (auto it = first; it != last; ++it)
+        for (auto &pi : it->second)
+            if (!pi->isTimedOut(now))
+                pendingInterests.push_back(pi);
+
+    // stale entries in pitTimeouts_ are skipped by cleanupPit
+    samplePit_.erase(first, last);
+}
+
+void ProducerCache::putData(const PendingInterests &pendingInterests,
+                            const std::vector<boost::shared_ptr<const Data>> &data)
+{
+    assert(pendingInterests.size() == data.size());
+
+    for (size_t i = 0; i < pendingInterests.size(); ++i)
+        putData(pendingInterests[i]->getFace(), *data[i]);
+}
+
+void ProducerCache::onInterest(const boost::shared_ptr<const Name> &prefix,
+                               const boost::shared_ptr<const Interest> &interest,
+                               Face &face, uint64_t interestFilterId,
+                               const boost::shared_ptr<const InterestFilter> &filter)
+{
+    cleanupPit(ndn_getNowMilliseconds());
+
+    boost::shared_ptr<const Data> data = find(*interest);
+
+    if (data)
+        putData(face, *data);
+    else
+        storePendingInterest(interest, face);
+}
+
+size_t ProducerCache::getPendingInterestsNum() const
+{
+    size_t n = otherPit_.size();
+    for (auto &it : samplePit_)
+        n += it.second.size();
+    return n;
+}
+
+//******************************************************************************
+bool ProducerCache::getSampleKey(const NamespaceInfo &info, SampleKey &key)
+{
+    if (info.isMeta_ || !info.hasSeqNo_ || info.class_ == SampleClass::Unknown)
+        return false;
+
+    key = SampleKey(RingKey(info.threadName_, info.class_), info.sampleNo_);
+    return true;
+}
+
+bool ProducerCache::isIndexed(const NamespaceInfo &info, const Data &data)
+{
+    if (data.getMetaInfo().getType() == ndn_ContentType_NACK || info.segNo_ > MAX_INDEXED_SEGNO)
+        return false;
+
+    const Name::Component &finalBlockId = data.getMetaInfo().getFinalBlockId();
+    return (finalBlockId.getValue().size() == 0 || info.segNo_ <= finalBlockId.toSegment());
+}
+
+bool ProducerCache::isFresh(const Entry &e, const Interest &interest,
+                            MillisecondsSince1970 now)
+{
+    return !interest.getMustBeFresh() || e.staleMs_ < 0 || now < e.staleMs_;
+}
+
+boost::shared_ptr<ProducerCache::Sample>
+ProducerCache::getSample(const SampleKey &key, bool create)
+{
+    PacketNumber seqNo = key.second;
+    auto it = rings_.find(key.first);
+
+    if (it == rings_.end() && !create)
+        return boost::shared_ptr<Sample>();
+
+    Ring &ring = (it == rings_.end() ? rings_[key.first] : it->second);
+
+    if (ring.samples_.empty())
+        ring.firstSeqNo_ = seqNo;
+
+    int64_t idx = (int64_t)seqNo - ring.firstSeqNo_;
+
+    if (idx >= 0 && idx < (int64_t)ring.samples_.size() && ring.samples_[idx])
+        return ring.samples_[idx];
+
+    if (!create || idx < -MAX_SEQNO_GAP || idx > (int64_t)ring.samples_.size() + MAX_SEQNO_GAP)
+        return boost::shared_ptr<Sample>();
+
+    boost::shared_ptr<Sample> sample(boost::make_shared<Sample>());
+    sample->ring_ = key.first;
+    sample->seqNo_ = seqNo;
+    sample->addedMs_ = ndn_getNowMilliseconds();
+    sample->bytes_ = 0;
+
+    if (idx < 0)
+    {
+        ring.samples_.insert(ring.samples_.begin(), -idx, boost::shared_ptr<Sample>());
+        ring.firstSeqNo_ = seqNo;
+        idx = 0;
+    }
+    else if (idx >= (int64_t)ring.samples_.size())
+        ring.samples_.resize(idx + 1);
+
+    ring.samples_[idx] = sample;
+    fifo_.push_back(sample);
+
+    return sample;
+}
+
+ProducerCache::Entry *
+ProducerCache::getEntry(Sample &sample, const NamespaceInfo &info, const Data &data)
+{
+    std::vector<Entry> *entries = nullptr;
+
+    if (info.segmentClass_ == SegmentClass::Data)
+        entries = &sample.data_;
+    else if (info.segmentClass_ == SegmentClass::Parity)
+        entries = &sample.parity_;
+
+    // segment number comes from interest name for NACKs, thus only segments
+    // within sample's final block are indexed
+    if (entries && isIndexed(info, data))
+    {
+        if (entries->size() <= info.segNo_)
+            entries->resize(info.segNo_ + 1, Entry({boost::shared_ptr<const Data>(), -1}));
+        return &(*entries)[info.segNo_];
+    }
+
+    // other sample segments (manifest, NACKs) are few, thus matched by name
+    for (auto &e : sample.other_)
+        if (e.data_->getName().equals(data.getName()))
+            return &e;
+
+    sample.other_.push_back(Entry({boost::shared_ptr<const Data>(), -1}));
+    return &sample.other_.back();
+}
+
+boost::shared_ptr<const Data>
+ProducerCache::findInSample(const Sample &sample, const NamespaceInfo &info,
+                            const Interest &interest, MillisecondsSince1970 now) const
+{
+    const std::vector<Entry> *entries = nullptr;
+
+    if (info.segmentClass_ == SegmentClass::Data)
+        entries = &sample.data_;
+    else if (info.segmentClass_ == SegmentClass::Parity)
+        entries = &sample.parity_;
+
+    if (entries && info.segNo_ < entries->size())
+    {
+        const Entry &e = (*entries)[info.segNo_];
+        if (e.data_ && isFresh(e, interest, now) && interest.matchesName(e.data_->getName()))
+            return e.data_;
+    }
+
+    // interest for sample prefix, manifest or segment that is not indexed -
+    // return first match
+    std::vector<const std::vector<Entry> *> lookup({&sample.other_});
+    if (!entries)
+        lookup = {&sample.data_, &sample.parity_, &sample.other_};
+
+    for (auto v : lookup)
+        for (auto &e : *v)
+            if (e.data_ && isFresh(e, interest, now) && interest.matchesName(e.data_->getName()))
+                return e.data_;
+
+    return boost::shared_ptr<const Data>();
+}
+
+boost::shared_ptr<const Data>
+ProducerCache::findInStore(const Interest &interest, MillisecondsSince1970 now) const
+{
+    boost::shared_ptr<const Data> match;
+    bool rightmost = (interest.getChildSelector() == 1);
+
+    for (auto it = store_.lower_bound(interest.getName());
+         it != store_.end() && interest.getName().isPrefixOf(it->first); ++it)
+    {
+        if (now < it->second.expireMs_ && isFresh(it->second, interest, now) &&
+            interest.matchesName(it->first))
+        {
+            match = it->second.data_;
+            if (!rightmost)
+                break;
+        }
+    }
+
+    return match;
+}
+
+void ProducerCache::satisfyPending(PendingInterests &pit, const Data &data)
+{
+    MillisecondsSince1970 now = ndn_getNowMilliseconds();
+    size_t i = 0;
+
+    while (i < pit.size())
+    {
+        if (pit[i]->isTimedOut(now))
+            pit.erase(pit.begin() + i);
+        else if (pit[i]->getInterest()->matchesName(data.getName()))
+        {
+            putData(pit[i]->getFace(), data);
+            pit.erase(pit.begin() + i);
+        }
+        else
+            ++i;
+    }
+}
+
+void ProducerCache::putData(Face &face, const Data &data)
+{
+    try
+    {
+        face.putData(data);
+    }
+    catch (std::exception &e)
+    {
+        LogWarnC << "couldn't put data " << data.getName() << ": " << e.what() << std::endl;
+    }
+}
+
+void ProducerCache::evict(MillisecondsSince1970 now)
+{
+    while (fifo_.size() &&
+           (bytes_ > maxBytes_ || now - fifo_.front()->addedMs_ > lifetimeMs_))
+    {
+        boost::shared_ptr<Sample> sample = fifo_.front();
+        fifo_.pop_front();
+
+        Ring &ring = rings_[sample->ring_];
+        int64_t idx = (int64_t)sample->seqNo_ - ring.firstSeqNo_;
+
+        if (idx >= 0 && idx < (int64_t)ring.samples_.size())
+            ring.samples_[idx].reset();
+
+        while (ring.samples_.size() && !ring.samples_.front())
+        {
+            ring.samples_.pop_front();
+            ring.firstSeqNo_++;
+        }
+
+        bytes_ -= sample->bytes_;
+    }
+}
+
+void ProducerCache::cleanupPit(MillisecondsSince1970 now)
+{
+    while (pitTimeouts_.size() && pitTimeouts_.top().first <= now)
+    {
+        auto it = samplePit_.find(pitTimeouts_.top().second);
+        pitTimeouts_.pop();
+
+        if (it != samplePit_.end())
+        {
+            PendingInterests &pit = it->second;
+            pit.erase(std::remove_if(pit.begin(), pit.end(),
+                                     [now](const boost::shared_ptr<const PendingInterest> &pi) {
+                                         return pi->isTimedOut(now);
+                                     }),
+                      pit.end());
+            if (pit.empty())
+                samplePit_.erase(it);
+        }
+    }
+
+    otherPit_.erase(std::remove_if(otherPit_.begin(), otherPit_.end(),
+                                   [now](const boost::shared_ptr<const PendingInterest> &pi) {
+                                       return pi->isTimedOut(now);
+                                   }),
+                    otherPit_.end());
+}
+
+void ProducerCache::cleanupStore(MillisecondsSince1970 now)
+{
+    if (now - lastStoreCleanupMs_ < STORE_CLEANUP_INTERVAL_MS)
+        return;
+
+    lastStoreCleanupMs_ = now;
+    for (auto it = store_.begin(); it != store_.end();)
+        if (it->second.expireMs_ <= now)
+            it = store_.erase(it);
+        else
+            ++it;
+}
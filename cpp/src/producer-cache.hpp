@@ -0,0 +1,180 @@
+//
+// producer-cache.hpp
+//
+//  Created by Peter Gusev on 30 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#ifndef __producer_cache_hpp__
+#define __producer_cache_hpp__
+
+#include <deque>
+#include <map>
+#include <queue>
+#include <boost/shared_ptr.hpp>
+#include <ndn-cpp/name.hpp>
+#include <ndn-cpp/interest.hpp>
+#include <ndn-cpp/data.hpp>
+#include <ndn-cpp/util/memory-content-cache.hpp>
+
+#include "name-components.hpp"
+#include "ndnrtc-object.hpp"
+
+namespace ndn
+{
+class Face;
+class InterestFilter;
+}
+
+namespace ndnrtc
+{
+/**
+ * Content cache and pending interest table for media stream producers, a
+ * drop-in replacement of ndn::MemoryContentCache for PacketPublisher.
+ * Segments of media samples are kept in rings of recent samples (one ring
+ * per thread and sample class) indexed by sequence number, so both interest
+ * matching and pending interests lookup cost one name parse and an index
+ * lookup, regardless of the number of cached segments and pending interests.
+ * Data with names that do not belong to samples (stream and thread meta) is
+ * kept in a small name-ordered store and matched by prefix.
+ * Oldest samples are evicted once they are older than cache lifetime or once
+ * cached samples exceed byte budget.
+ * Like ndn::MemoryContentCache, this class is not thread-safe and must be
+ * used on face thread.
+ */
+class ProducerCache : public NdnRtcComponent
+{
+  public:
+    typedef ndn::MemoryContentCache::PendingInterest PendingInterest;
+    typedef std::vector<boost::shared_ptr<const PendingInterest>> PendingInterests;
+
+    ProducerCache(ndn::Face *face, unsigned int lifetimeMs = 1000,
+                  size_t maxBytes = 64 * 1024 * 1024);
+    ~ProducerCache();
+
+    /**
+     * Sets interest filter on the face. Incoming interests that can't be
+     * satisfied from cache are stored as pending interests.
+     */
+    void setInterestFilter(const ndn::Name &prefix);
+
+    /**
+     * Caches data and satisfies pending interests matching it.
+     */
+    void add(const ndn::Data &data);
+
+    /**
+     * Returns cached data matching interest or null.
+     */
+    boost::shared_ptr<const ndn::Data> find(const ndn::Interest &interest);
+
+    void storePendingInterest(const boost::shared_ptr<const ndn::Interest> &interest,
+                              ndn::Face &face);
+    void getPendingInterestsForName(const ndn::Name &name, PendingInterests &pendingInterests);
+    void getPendingInterestsWithPrefix(const ndn::Name &prefix, PendingInterests &pendingInterests);
+
+    /**
+     * Removes pending interests for all samples of the same thread and class
+     * as sampleName, that are older than this sample, and returns ones that
+     * haven't timed out yet. Pending interests are bucketed by sample, so this
+     * costs one range erase and does not depend on the size of the table.
+     */
+    void extractPendingInterestsBefore(const ndn::Name &sampleName,
+                                       PendingInterests &pendingInterests);
+
+    /**
+     * Sends each data packet to the face of the corresponding pending
+     * interest. Data is not cached.
+     */
+    void putData(const PendingInterests &pendingInterests,
+                 const std::vector<boost::shared_ptr<const ndn::Data>> &data);
+
+    // incoming interests callback
+    void onInterest(const boost::shared_ptr<const ndn::Name> &prefix,
+                    const boost::shared_ptr<const ndn::Interest> &interest,
+                    ndn::Face &face, uint64_t interestFilterId,
+                    const boost::shared_ptr<const ndn::InterestFilter> &filter);
+
+    size_t getCachedBytes() const { return bytes_; }
+    size_t getCachedSamplesNum() const { return fifo_.size(); }
+    size_t getPendingInterestsNum() const;
+
+  private:
+    ProducerCache(const ProducerCache &) = delete;
+
+    typedef std::pair<std::string, SampleClass> RingKey;
+    typedef std::pair<RingKey, PacketNumber> SampleKey;
+
+    typedef struct _Entry
+    {
+        boost::shared_ptr<const ndn::Data> data_;
+        ndn::MillisecondsSince1970 staleMs_; // -1 if data never becomes stale
+    } Entry;
+
+    typedef struct _Sample
+    {
+        RingKey ring_;
+        PacketNumber seqNo_;
+        ndn::MillisecondsSince1970 addedMs_;
+        size_t bytes_;
+        // indexed by segment number
+        std::vector<Entry> data_, parity_;
+        // manifest, NACKs and segments beyond sample's final block
+        std::vector<Entry> other_;
+    } Sample;
+
+    typedef struct _Ring
+    {
+        PacketNumber firstSeqNo_;
+        std::deque<boost::shared_ptr<Sample>> samples_; // may have gaps (null)
+    } Ring;
+
+    struct NameLess
+    {
+        bool operator()(const ndn::Name &a, const ndn::Name &b) const { return a.compare(b) < 0; }
+    };
+
+    typedef struct _StoreEntry : public Entry
+    {
+        ndn::MillisecondsSince1970 expireMs_;
+    } StoreEntry;
+
+    typedef std::pair<ndn::MillisecondsSince1970, SampleKey> PitTimeout;
+
+    ndn::Face *face_;
+    unsigned int lifetimeMs_;
+    size_t maxBytes_, bytes_;
+    std::vector<uint64_t> interestFilterIds_;
+
+    std::map<RingKey, Ring> rings_;
+    std::deque<boost::shared_ptr<Sample>> fifo_; // eviction order
+    std::map<ndn::Name, StoreEntry, NameLess> store_;
+    ndn::MillisecondsSince1970 lastStoreCleanupMs_;
+
+    // ordered by thread, class and seqNo, so older samples form a range
+    std::map<SampleKey, PendingInterests> samplePit_;
+    PendingInterests otherPit_; // interests for non-sample names
+    std::priority_queue<PitTimeout, std::vector<PitTimeout>, std::greater<PitTimeout>> pitTimeouts_;
+
+    static bool getSampleKey(const NamespaceInfo &info, SampleKey &key);
+    // whether data or parity segment is indexed by its' segment number
+    static bool isIndexed(const NamespaceInfo &info, const ndn::Data &data);
+    static bool isFresh(const Entry &e, const ndn::Interest &interest,
+                        ndn::MillisecondsSince1970 now);
+
+    boost::shared_ptr<Sample> getSample(const SampleKey &key, bool create);
+    Entry *getEntry(Sample &sample, const NamespaceInfo &info, const ndn::Data &data);
+    boost::shared_ptr<const ndn::Data> findInSample(const Sample &sample, const NamespaceInfo &info,
+                                                    const ndn::Interest &interest,
+                                                    ndn::MillisecondsSince1970 now) const;
+    boost::shared_ptr<const ndn::Data> findInStore(const ndn::Interest &interest,
+                                                   ndn::MillisecondsSince1970 now) const;
+    void satisfyPending(PendingInterests &pit, const ndn::Data &data);
+    void putData(ndn::Face &face, const ndn::Data &data);
+    void evict(ndn::MillisecondsSince1970 now);
+    void cleanupPit(ndn::MillisecondsSince1970 now);
+    void cleanupStore(ndn::MillisecondsSince1970 now);
+};
+}
+
+#endif
@@ -7,7 +7,6 @@
 
 #include "remote-video-stream.hpp"
 #include <ndn-cpp/name.hpp>
-#include <webrtc/common_video/libyuv/include/webrtc_libyuv.h>
 
 #include "interfaces.hpp"
 #include "frame-data.hpp"
@@ -19,7 +18,7 @@
 #include "playout-control.hpp"
 #include "sample-estimator.hpp"
 #include "sample-validator.hpp"
-#include "video-decoder.hpp"
+#include "decoder-worker.hpp"
 #include "clock.hpp"
 
 using namespace ndnrtc;
@@ -212,23 +211,8 @@ void RemoteVideoStreamImpl::setLogger(boost::shared_ptr<ndnlog::new_api::Logger>
 #pragma mark private
 void RemoteVideoStreamImpl::feedFrame(const FrameInfo &frameInfo, const WebRtcVideoFrame &frame)
 {
-    IExternalRenderer::BufferType bufferType = IExternalRenderer::kARGB;
-    uint8_t *rgbFrameBuffer = renderer_->getFrameBuffer(frame.width(),
-                                                        frame.height(),
-                                                        &bufferType);
-
-    if (rgbFrameBuffer)
-    {
-        LogTraceC << "passing frame " << frameInfo.playbackNo_ << "p to renderer" << std::endl;
-
-        // @see frame-converter.cpp for explanation, why we flipping ARGB <-> BGRA data representations
-        // webrtc::VideoType videoType = (bufferType == IExternalRenderer::kARGB ? webrtc::kARGB : webrtc::kBGRA);
-        webrtc::VideoType videoType = (bufferType == IExternalRenderer::kARGB ? webrtc::kBGRA : webrtc::kARGB);
-
-        ConvertFromI420(frame, videoType, 0, rgbFrameBuffer);
-        renderer_->renderFrame(frameInfo, frame.width(), frame.height(),
-                                   rgbFrameBuffer);
-    }
+    if (renderDecodedFrame(renderer_, frameInfo, frame))
+        LogTraceC << "passed frame " << frameInfo.playbackNo_ << "p to renderer" << std::endl;
     else
         LogTraceC << "renderer is busy." << std::endl;
 }
@@ -237,12 +221,16 @@ void RemoteVideoStreamImpl::setupDecoder()
 {
     boost::shared_ptr<RemoteVideoStreamImpl> me = boost::dynamic_pointer_cast<RemoteVideoStreamImpl>(shared_from_this());
     VideoThreadMeta meta(threadsMeta_[threadName_]->data());
-    boost::shared_ptr<VideoDecoder> decoder =
-        boost::make_shared<VideoDecoder>(meta.getCoderParams(),
-                                         [this, me](const FrameInfo& finfo, const WebRtcVideoFrame &frame) 
-                                         {
-                                            feedFrame(finfo, frame);
-                                         });
+    // frames are decoded on decoder's thread, whereas decoded pictures are
+    // rendered on playout ticks
+    boost::shared_ptr<DecoderWorker> decoder =
+        boost::make_shared<DecoderWorker>(meta.getCoderParams(),
+                                          [this, me](const FrameInfo& finfo, const WebRtcVideoFrame &frame) 
+                                          {
+                                             feedFrame(finfo, frame);
+                                          });
+    decoder->setDescription("decoder-" + threadName_);
+    decoder->setLogger(logger_);
     boost::dynamic_pointer_cast<VideoPlayout>(playout_)->registerFrameConsumer(decoder.get());
     decoder_ = decoder;
 }
@@ -250,6 +238,8 @@ void RemoteVideoStreamImpl::setupDecoder()
 void RemoteVideoStreamImpl::releaseDecoder()
 {
     dynamic_pointer_cast<VideoPlayout>(playout_)->deregisterFrameConsumer();
+    if (decoder_)
+        decoder_->stop();
     decoder_.reset();
 }
 
@@ -19,7 +19,7 @@ class IPlayoutControl;
 class VideoPlayout;
 class PipelineControl;
 class ManifestValidator;
-class VideoDecoder;
+class DecoderWorker;
 class IExternalRenderer;
 class IVideoPlayoutObserver;
 class IBufferObserver;
@@ -58,7 +58,7 @@ class RemoteVideoStreamImpl : public RemoteStreamImpl
 
     boost::shared_ptr<ManifestValidator> validator_;
     IExternalRenderer *renderer_;
-    boost::shared_ptr<VideoDecoder> decoder_;
+    boost::shared_ptr<DecoderWorker> decoder_;
 
     void construct();
     void feedFrame(const FrameInfo&, const WebRtcVideoFrame &);
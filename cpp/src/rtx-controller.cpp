@@ -11,6 +11,7 @@
 #include "rtx-controller.hpp"
 
 #include "clock.hpp"
+#include "event-log.hpp"
 #include "drd-estimator.hpp"
 #include "estimators.hpp"
 
@@ -103,6 +104,10 @@ void RetransmissionController::checkRetransmissions()
                           << " playback in " << playbackDeadline - now << "ms" << std::endl;
 
                 std::vector<boost::shared_ptr<const ndn::Interest>> pendingInterests = slot->getPendingInterests();
+                eventlog::write(eventlog::Component::RtxController, eventlog::Event::RtxRequired, this,
+                                (slot->getNameInfo().class_ == SampleClass::Key),
+                                slot->getNameInfo().sampleNo_, pendingInterests.size(),
+                                playbackDeadline - now);
                 if (pendingInterests.size())
                     for (auto o : observers_)
                         o->onRetransmissionRequired(pendingInterests);
@@ -9,6 +9,7 @@
 #include "frame-data.hpp"
 #include "async.hpp"
 #include "clock.hpp"
+#include "event-log.hpp"
 
 #include <boost/thread/lock_guard.hpp>
 
@@ -226,6 +227,11 @@ void SegmentControllerImpl::onData(const boost::shared_ptr<const Interest> &inte
     {
         LogTraceC << "app nack " << data->getName() << std::endl;
         (*sstorage_)[Indicator::AppNackNum]++;
+
+        NamespaceInfo info;
+        if (eventlog::EventLog::get() && NameComponents::extractInfo(data->getName(), info))
+            eventlog::write(eventlog::Component::SegmentController, eventlog::Event::AppNack, this,
+                            (info.class_ == SampleClass::Key), info.sampleNo_, info.segNo_, info.isParity_);
         return;
     }
 
@@ -241,6 +247,9 @@ void SegmentControllerImpl::onData(const boost::shared_ptr<const Interest> &inte
         {
             LogTraceC << data->getName() << " "
                       << data->getContent().size() << " bytes" << std::endl;
+            eventlog::write(eventlog::Component::SegmentController, eventlog::Event::SegmentArrived, this,
+                            (info.class_ == SampleClass::Key), info.sampleNo_, info.segNo_, info.isParity_,
+                            data->getContent().size());
             {
                 boost::lock_guard<boost::mutex> scopedLock(mutex_);
                 for (auto &o : observers_)
@@ -271,6 +280,8 @@ void SegmentControllerImpl::onTimeout(const boost::shared_ptr<const Interest> &i
     if (NameComponents::extractInfo(interest->getName(), info))
     {
         LogTraceC << interest->getName() << std::endl;
+        eventlog::write(eventlog::Component::SegmentController, eventlog::Event::SegmentTimeout, this,
+                        (info.class_ == SampleClass::Key), info.sampleNo_, info.segNo_, info.isParity_);
 
         {
             boost::lock_guard<boost::mutex> scopedLock(mutex_);
@@ -304,6 +315,9 @@ void SegmentControllerImpl::onNetworkNack(const boost::shared_ptr<const Interest
         {
             boost::lock_guard<boost::mutex> scopedLock(mutex_);
             int reason = (networkNack->getReason() == ndn_NetworkNackReason_OTHER_CODE ? networkNack->getOtherReasonCode() : networkNack->getReason());
+            eventlog::write(eventlog::Component::SegmentController, eventlog::Event::NetworkNack, this,
+                            (info.class_ == SampleClass::Key), info.sampleNo_, info.segNo_, info.isParity_,
+                            reason);
 
             for (auto &o : observers_)
                 o->segmentNack(info, reason, interest);
@@ -24,13 +24,10 @@
 #include <iomanip>
 #include "simple-log.hpp"
 
-#define MAX_BUF_SIZE 4*256 // string buffer
-
 using namespace ndnlog;
 using namespace ndnlog::new_api;
 using namespace boost::chrono;
 
-static char tempBuf[MAX_BUF_SIZE];
 #if defined __APPLE__
 static std::string lvlToString[] = {
     [NdnLoggerLevelTrace] =     "TRACE",
@@ -57,6 +54,13 @@ static boost::shared_ptr<boost::asio::io_service::work> LogThreadWork;
 
 NilLogger NilLogger::nilLogger_;
 Logger* Logger::sharedInstance_ = 0;
+thread_local LogRecordBuffer* Logger::currentRecord_ = nullptr;
+
+static LogRecordBuffer* threadRecordBuffer()
+{
+    static thread_local LogRecordBuffer buffer;
+    return &buffer;
+}
 
 void startLogThread();
 void stopLogThread();
@@ -70,10 +74,11 @@ unsigned int Logger::FlushIntervalMs = 100;
 #pragma mark - construction/destruction
 Logger::Logger(const NdnLoggerDetailLevel& logLevel,
                         const std::string& logFile):
-isWritingLogEntry_(false),
-currentEntryLogType_(NdnLoggerLevelTrace),
 logLevel_(logLevel),
-sink_(boost::make_shared<DefaultSink>(logFile))
+sink_(boost::make_shared<DefaultSink>(logFile)),
+isDrainScheduled_(false),
+droppedRecordsNum_(0),
+recordsQueue_(QueueCapacity)
 {
     lastFlushTimestampMs_ = getMillisecondTimestamp();   
     isProcessing_ = true;
@@ -81,10 +86,11 @@ sink_(boost::make_shared<DefaultSink>(logFile))
 
 Logger::Logger(const NdnLoggerDetailLevel& logLevel,
                const boost::shared_ptr<ILogRecordSink> sink):
-isWritingLogEntry_(false),
-currentEntryLogType_(NdnLoggerLevelTrace),
 logLevel_(logLevel),
-sink_(sink)
+sink_(sink),
+isDrainScheduled_(false),
+droppedRecordsNum_(0),
+recordsQueue_(QueueCapacity)
 {
     lastFlushTimestampMs_ = getMillisecondTimestamp();   
     isProcessing_ = true;
@@ -100,45 +106,37 @@ Logger::~Logger()
 Logger&
 Logger::log(const NdnLogType& logType,
                      const ILoggingObject* loggingInstance,
-                     const std::string& locationFunc,
+                     const char* locationFunc,
                      const int& locationLine)
 {
+    if (!isEnabled(logType))
+        return NilLogger::get();
     
-    if (logType < (NdnLogType)logLevel_)
+    if (loggingInstance != 0 && !loggingInstance->isLoggingEnabled())
         return NilLogger::get();
     
-    sink_->lockExclusively();
+    if (!currentRecord_)
+        currentRecord_ = threadRecordBuffer();
     
-    if (isWritingLogEntry_ &&
-        currentEntryLogType_ >= (NdnLogType)logLevel_)
+    if (currentRecord_->logger_)
         throw std::runtime_error("Previous log entry wasn't closed");
     
-    sink_->unlock();
+    currentRecord_->logger_ = this;
+    currentRecord_->record().clear();
     
-    bool shouldIgnore = (loggingInstance != 0 &&
-                            !loggingInstance->isLoggingEnabled());
+    std::ostream& record = currentRecord_->stream();
     
-    if (!shouldIgnore &&
-        logType >= (NdnLogType)logLevel_)
-    {
-        sink_->lockExclusively();
-        startLogRecord();
-        
-        isWritingLogEntry_ = true;
-        currentEntryLogType_ = logType;
-        
-        // LogEntry header has the following format:
-        // <timestamp> <log_level> - <logging_instance> [<location_file>:<location_line>] ":"
-        // log location info is enabled only for debug levels less than INFO
-        currentLogRecord_ << getMillisecondTimestamp() << "\t[" << stringify(logType) << "]";
-        
-        if (loggingInstance)
-            currentLogRecord_
-            << "[" << std::setw(20) << loggingInstance->getDescription() << "]-"
-            << std::setw(20) << locationFunc;
-        
-        currentLogRecord_ << ": ";
-    }
+    // LogEntry header has the following format:
+    // <timestamp> <log_level> - <logging_instance> [<location_file>:<location_line>] ":"
+    // log location info is enabled only for debug levels less than INFO
+    record << getMillisecondTimestamp() << "\t[" << lvlToString[logType] << "]";
+    
+    if (loggingInstance)
+        record
+        << "[" << std::setw(20) << loggingInstance->getDescription() << "]-"
+        << std::setw(20) << locationFunc;
+    
+    record << ": ";
     
     return *this;
 }
@@ -146,7 +144,10 @@ Logger::log(const NdnLogType& logType,
 void
 Logger::flush()
 {
+    // sink is written on log thread
+    sink_->lockExclusively();
     sink_->flush();
+    sink_->unlock();
     // getOutStream().flush();    
 }
 
@@ -211,38 +212,116 @@ Logger::getMillisecondTimestamp()
 void
 Logger::processLogRecords()
 {
+    // cleared before draining, so records queued meanwhile schedule
+    // another drain
+    isDrainScheduled_ = false;
+    
+    if (!sink_)
+        return;
+    
+    sink_->lockExclusively();
+    
     if (isProcessing_)
     {
-        std::string record;
+        static thread_local std::string record;
 
         while (recordsQueue_.pop(record))
-            if (sink_) sink_->finalizeRecord(record);
-
-        if ((getMillisecondTimestamp() - lastFlushTimestampMs_) >= FlushIntervalMs)
-            if (sink_) sink_->flush();
+            sink_->finalizeRecord(record);
+
+        unsigned int droppedNum = droppedRecordsNum_.exchange(0);
+        if (droppedNum)
+            sink_->finalizeRecord("[CRITICAL]\tlog queue is full, dropped " +
+                                  std::to_string(droppedNum) + " records\n");
+
+        int64_t now = getMillisecondTimestamp();
+        if ((now - lastFlushTimestampMs_) >= FlushIntervalMs)
+        {
+            sink_->flush();
+            lastFlushTimestampMs_ = now;
+        }
     }
-    else if (sink_)
+    else
     {
         sink_->flush();
         sink_->close();
     }
+    
+    sink_->unlock();
 }
 
 void
-Logger::startLogRecord()
+Logger::finalizeLogRecord(std::string& record)
 {
-    currentLogRecord_.str( std::string() );
-    currentLogRecord_.clear();
+    if (!recordsQueue_.push(record))
+        droppedRecordsNum_++;
+    
+    if (!isDrainScheduled_.exchange(true))
+        LogIoService.post(boost::bind(&Logger::processLogRecords, shared_from_this()));
 }
 
-void
-Logger::finalizeLogRecord()
+//******************************************************************************
+LogRecordQueue::LogRecordQueue(size_t capacity):
+enqueuePos_(0), dequeuePos_(0)
 {
-    if (!recordsQueue_.push(currentLogRecord_.str()))
-        sink_->finalizeRecord("[CRITICAL]\tlog queue is full");
-        // getOutFileStream() << "[CRITICAL]\tlog queue is full" << std::endl;
-    else
-        LogIoService.post(boost::bind(&Logger::processLogRecords, shared_from_this()));
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    
+    slots_ = new Slot[size];
+    mask_ = size - 1;
+    for (size_t i = 0; i < size; ++i)
+        slots_[i].seq_.store(i, std::memory_order_relaxed);
+}
+
+LogRecordQueue::~LogRecordQueue()
+{
+    delete [] slots_;
+}
+
+bool
+LogRecordQueue::push(std::string& record)
+{
+    Slot* slot;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    
+    for (;;)
+    {
+        slot = &slots_[pos & mask_];
+        size_t seq = slot->seq_.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        
+        if (diff == 0)
+        {
+            // slot is free, try to claim it
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return false; // slot still holds a record from previous lap
+        else
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+    }
+    
+    slot->record_.swap(record);
+    record.clear();
+    slot->seq_.store(pos + 1, std::memory_order_release);
+    
+    return true;
+}
+
+bool
+LogRecordQueue::pop(std::string& record)
+{
+    Slot* slot = &slots_[dequeuePos_ & mask_];
+    size_t seq = slot->seq_.load(std::memory_order_acquire);
+    
+    if ((intptr_t)seq - (intptr_t)(dequeuePos_ + 1) < 0)
+        return false;
+    
+    record.swap(slot->record_);
+    slot->seq_.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+    ++dequeuePos_;
+    
+    return true;
 }
 
 //******************************************************************************
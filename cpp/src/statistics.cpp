@@ -90,6 +90,12 @@ map_list_of
 ( Indicator::PublishedKeyNum, "Published key frames" )
 ( Indicator::InterestsReceivedNum, "Interests received" )
 ( Indicator::SignNum, "Sign operations")
+( Indicator::PublishDelay, "Capture-to-publish delay (ms)" )
+( Indicator::PublishQueueSize, "Publish queue" )
+( Indicator::PublishLag, "Publish queue lag (ms)" )
+( Indicator::PublishDroppedNum, "Dropped from publish queue" )
+( Indicator::PacerDroppedNum, "Dropped by frame pacer" )
+( Indicator::PacerDuplicatedNum, "Duplicated by frame pacer" )
 
 // encoder
 ( Indicator::EncodedNum, "Encoded frames" )
@@ -173,6 +179,12 @@ map_list_of ( Indicator::Timestamp, 0. )
 ( Indicator::PublishedKeyNum, 0. )
 ( Indicator::InterestsReceivedNum, 0. )
 ( Indicator::SignNum, 0. )
+( Indicator::PublishDelay, 0. )
+( Indicator::PublishQueueSize, 0. )
+( Indicator::PublishLag, 0. )
+( Indicator::PublishDroppedNum, 0. )
+( Indicator::PacerDroppedNum, 0. )
+( Indicator::PacerDuplicatedNum, 0. )
 ( Indicator::CurrentProducerFramerate, 0. )
 // encoder
 ( Indicator::DroppedNum, 0. )
@@ -253,6 +265,12 @@ boost::assign::map_list_of
 (Indicator::PublishedKeyNum, "framesPubKey")
 (Indicator::InterestsReceivedNum, "irecvd")
 (Indicator::SignNum, "signNum")
+(Indicator::PublishDelay, "pubDelay")
+(Indicator::PublishQueueSize, "pubQueue")
+(Indicator::PublishLag, "pubLag")
+(Indicator::PublishDroppedNum, "pubDropped")
+(Indicator::PacerDroppedNum, "pacerDropped")
+(Indicator::PacerDuplicatedNum, "pacerDup")
 // encoder
 (Indicator::EncodedNum, "framesEncoded")
 // capturer
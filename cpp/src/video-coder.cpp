@@ -9,9 +9,10 @@
 //  Created: 8/21/13
 //
 
-// #define USE_VP9
-
 #include <boost/thread.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <webrtc/media/base/codec.h>
+#include <webrtc/modules/video_coding/codecs/h264/include/h264.h>
 #include <webrtc/modules/video_coding/codecs/vp8/include/vp8.h>
 #include <webrtc/modules/video_coding/codecs/vp9/include/vp9.h>
 #include <webrtc/modules/video_coding/include/video_coding.h>
@@ -72,29 +73,108 @@ char *plotCodec(webrtc::VideoCodec codec)
     return msg;
 }
 
+//******************************************************************************
+VideoCodecFactory &VideoCodecFactory::getSharedInstance()
+{
+    static VideoCodecFactory factory;
+    return factory;
+}
+
+VideoCodecFactory::VideoCodecFactory()
+{
+    registerCodec("vp8", webrtc::kVideoCodecVP8,
+                  []() { return VP8Encoder::Create(); },
+                  []() { return VP8Decoder::Create(); });
+    registerCodec("vp9", webrtc::kVideoCodecVP9,
+                  []() { return VP9Encoder::Create(); },
+                  []() { return VP9Decoder::Create(); });
+
+    // OpenH264 is built into WebRTC only if rtc_use_h264 was set
+    if (H264Encoder::IsSupported())
+        registerCodec("h264", webrtc::kVideoCodecH264,
+                      []() { return H264Encoder::Create(cricket::VideoCodec(cricket::kH264CodecName)); },
+                      []() { return H264Decoder::Create(); });
+}
+
+void VideoCodecFactory::registerCodec(const std::string &name, webrtc::VideoCodecType type,
+                                      CreateEncoder createEncoder, CreateDecoder createDecoder)
+{
+    boost::lock_guard<boost::mutex> scopedLock(mutex_);
+    codecs_[name] = Codec({type, createEncoder, createDecoder});
+}
+
+bool VideoCodecFactory::isSupported(const std::string &name) const
+{
+    boost::lock_guard<boost::mutex> scopedLock(mutex_);
+    return (codecs_.find(name) != codecs_.end());
+}
+
+std::vector<std::string> VideoCodecFactory::getCodecs() const
+{
+    boost::lock_guard<boost::mutex> scopedLock(mutex_);
+    std::vector<std::string> codecs;
+
+    for (auto &c : codecs_)
+        codecs.push_back(c.first);
+    return codecs;
+}
+
+webrtc::VideoCodecType VideoCodecFactory::getCodecType(const std::string &name) const
+{
+    return getCodec(name).type_;
+}
+
+webrtc::VideoEncoder *VideoCodecFactory::createEncoder(const std::string &name) const
+{
+    return getCodec(name).createEncoder_();
+}
+
+webrtc::VideoDecoder *VideoCodecFactory::createDecoder(const std::string &name) const
+{
+    return getCodec(name).createDecoder_();
+}
+
+VideoCodecFactory::Codec VideoCodecFactory::getCodec(const std::string &name) const
+{
+    boost::lock_guard<boost::mutex> scopedLock(mutex_);
+    auto it = codecs_.find(name);
+
+    if (it == codecs_.end())
+        throw std::runtime_error("Video codec " + name + " is not supported");
+    return it->second;
+}
+
 //******************************************************************************
 #pragma mark - static
 webrtc::VideoCodec VideoCoder::codecFromSettings(const VideoCoderParams &settings)
 {
     webrtc::VideoCodec codec;
+    webrtc::VideoCodecType type = VideoCodecFactory::getSharedInstance().getCodecType(settings.codec_);
 
     // setup default params first
-#ifdef USE_VP9
-    webrtc::VCMCodecDataBase::Codec(webrtc::kVideoCodecVP9, &codec);
-#else
-    webrtc::VCMCodecDataBase::Codec(webrtc::kVideoCodecVP8, &codec);
-#endif
+    webrtc::VCMCodecDataBase::Codec(type, &codec);
 
     // dropping frames
-#ifdef USE_VP9
-    codec.VP9()->resilience = 1;
-    codec.VP9()->frameDroppingOn = settings.dropFramesOn_;
-    codec.VP9()->keyFrameInterval = settings.gop_;
-#else
-    codec.VP8()->resilience = kResilientStream;
-    codec.VP8()->frameDroppingOn = settings.dropFramesOn_;
-    codec.VP8()->keyFrameInterval = settings.gop_;
-#endif
+    switch (type)
+    {
+    case webrtc::kVideoCodecVP8:
+        codec.VP8()->resilience = kResilientStream;
+        codec.VP8()->frameDroppingOn = settings.dropFramesOn_;
+        codec.VP8()->keyFrameInterval = settings.gop_;
+        break;
+    case webrtc::kVideoCodecVP9:
+        codec.VP9()->resilience = 1;
+        codec.VP9()->frameDroppingOn = settings.dropFramesOn_;
+        codec.VP9()->keyFrameInterval = settings.gop_;
+        break;
+    case webrtc::kVideoCodecH264:
+        codec.H264()->frameDroppingOn = settings.dropFramesOn_;
+        codec.H264()->keyFrameInterval = settings.gop_;
+        break;
+    default:
+        // externally registered codecs keep their defaults
+        break;
+    }
 
     // customize parameteres if possible
     codec.maxFramerate = (int)settings.codecFrameRate_;
@@ -110,45 +190,28 @@ webrtc::VideoCodec VideoCoder::codecFromSettings(const VideoCoderParams &setting
 
 //******************************************************************************
 FrameScaler::FrameScaler(unsigned int dstWidth, unsigned int dstHeight)
-    : srcWidth_(0), srcHeight_(0),
-      dstWidth_(dstWidth), dstHeight_(dstHeight)
+    : dstWidth_(dstWidth), dstHeight_(dstHeight)
 {
-    initScaledFrame();
 }
 
 const WebRtcVideoFrame
 FrameScaler::operator()(const WebRtcVideoFrame &frame)
 {
-    // try do scaling on this thread. if throws, do it old-fashioned way
-    // ScalerThread::getSharedInstance()->perform([&res, &frame, this](){
-    //     scaledFrameBuffer_->ScaleFrom(frame);
-    // });
+    if (frame.width() == (int)dstWidth_ && frame.height() == (int)dstHeight_)
+        return frame;
 
-    scaledFrameBuffer_->ScaleFrom(*(frame.video_frame_buffer()));
+    WebRtcSmartPtr<WebRtcVideoFrameBuffer> scaledFrameBuffer =
+        bufferPool_.getBuffer(dstWidth_, dstHeight_);
 
-    return WebRtcVideoFrame(scaledFrameBuffer_, frame.rotation(), frame.timestamp_us());
-}
+    scaledFrameBuffer->ScaleFrom(*(frame.video_frame_buffer()));
 
-void FrameScaler::initScaledFrame()
-{
-    int stride_y = dstWidth_;
-    int stride_uv = (dstWidth_ + 1) / 2;
-    int target_width = dstWidth_;
-    int target_height = dstHeight_;
-
-    scaledFrameBuffer_ = I420Buffer::Create(target_width,
-                                            abs(target_height),
-                                            stride_y,
-                                            stride_uv, stride_uv);
-
-    if (!scaledFrameBuffer_)
-        throw std::runtime_error("failed to allocate scaled frame");
+    return WebRtcVideoFrame(scaledFrameBuffer, frame.rotation(), frame.timestamp_us());
 }
 
 //********************************************************************************
 #pragma mark - construction/destruction
 VideoCoder::VideoCoder(const VideoCoderParams &coderParams, IEncoderDelegate *delegate,
-                       KeyEnforcement keyEnforcement)
+                       KeyEnforcement keyEnforcement, unsigned int nCores)
     : NdnRtcComponent(),
       coderParams_(coderParams),
       delegate_(delegate),
@@ -157,11 +220,8 @@ VideoCoder::VideoCoder(const VideoCoderParams &coderParams, IEncoderDelegate *de
       codec_(VideoCoder::codecFromSettings(coderParams_)),
       codecSpecificInfo_(nullptr),
       keyEnforcement_(keyEnforcement),
-#ifdef USE_VP9
-      encoder_(VP9Encoder::Create())
-#else
-      encoder_(VP8Encoder::Create())
-#endif
+      nCores_(nCores ? nCores : boost::thread::hardware_concurrency()),
+      encoder_(VideoCodecFactory::getSharedInstance().createEncoder(coderParams.codec_))
 {
     assert(delegate_);
     description_ = "coder";
@@ -171,14 +231,7 @@ VideoCoder::VideoCoder(const VideoCoderParams &coderParams, IEncoderDelegate *de
         throw std::runtime_error("Error creating encoder");
 
     encoder_->RegisterEncodeCompleteCallback(this);
-    int maxPayload = 1440;
-
-    if (encoder_->InitEncode(&codec_, boost::thread::hardware_concurrency(), maxPayload) != WEBRTC_VIDEO_CODEC_OK)
-        throw std::runtime_error("Can't initialize encoder");
-
-    LogInfoC
-        << "initialized. max payload " << maxPayload
-        << " parameters: " << plotCodec(codec_) << endl;
+    initEncoder();
 }
 
 //********************************************************************************
@@ -232,6 +285,69 @@ void VideoCoder::onRawFrame(const WebRtcVideoFrame &frame)
         LogErrorC << "can't encode frame due to error " << err << std::endl;
 }
 
+void VideoCoder::setCoreNum(unsigned int nCores)
+{
+    if (!nCores || nCores == nCores_)
+        return;
+
+    LogInfoC << "re-initializing encoder for " << nCores
+             << " cores (was " << nCores_ << ")" << endl;
+
+    nCores_ = nCores;
+    encoder_->Release();
+    initEncoder();
+
+    // re-initialized encoder starts new GOP
+    keyFrameTrigger_ = 0;
+}
+
+void VideoCoder::setRate(unsigned int bitrateKbps, double frameRate)
+{
+    if (!bitrateKbps || frameRate <= 0)
+        return;
+
+    LogInfoC << "retargeting encoder to " << bitrateKbps << "Kbps "
+             << frameRate << "fps (was " << coderParams_.startBitrate_ << "Kbps "
+             << coderParams_.codecFrameRate_ << "fps)" << endl;
+
+    coderParams_.startBitrate_ = bitrateKbps;
+    coderParams_.codecFrameRate_ = frameRate;
+    if (bitrateKbps > coderParams_.maxBitrate_)
+        coderParams_.maxBitrate_ = bitrateKbps;
+
+    // keep codec settings in sync, in case encoder is re-initialized later
+    codec_.startBitrate = bitrateKbps;
+    codec_.targetBitrate = bitrateKbps;
+    codec_.maxBitrate = coderParams_.maxBitrate_;
+    codec_.maxFramerate = (int)frameRate;
+
+    webrtc::BitrateAllocation allocation;
+    allocation.SetBitrate(0, 0, bitrateKbps * 1000);
+
+    if (encoder_->SetRateAllocation(allocation, (uint32_t)frameRate) != WEBRTC_VIDEO_CODEC_OK)
+        LogErrorC << "failed to set encoder rate allocation" << endl;
+}
+
+void VideoCoder::setResolution(unsigned int width, unsigned int height)
+{
+    if (width == coderParams_.encodeWidth_ && height == coderParams_.encodeHeight_)
+        return;
+
+    LogInfoC << "re-initializing encoder for " << width << "x" << height
+             << " (was " << coderParams_.encodeWidth_ << "x"
+             << coderParams_.encodeHeight_ << ")" << endl;
+
+    coderParams_.encodeWidth_ = width;
+    coderParams_.encodeHeight_ = height;
+    codec_.width = width;
+    codec_.height = height;
+    encoder_->Release();
+    initEncoder();
+
+    // re-initialized encoder starts new GOP
+    keyFrameTrigger_ = 0;
+}
+
 //********************************************************************************
 #pragma mark - interfaces realization - EncodedImageCallback
 webrtc::EncodedImageCallback::Result
@@ -270,3 +386,18 @@ VideoCoder::OnEncodedImage(const EncodedImage &encodedImage,
     delegate_->onEncodedFrame(encodedImage);
     return Result(Result::OK);
 }
+
+//********************************************************************************
+#pragma mark - private
+void VideoCoder::initEncoder()
+{
+    int maxPayload = 1440;
+
+    if (encoder_->InitEncode(&codec_, nCores_, maxPayload) != WEBRTC_VIDEO_CODEC_OK)
+        throw std::runtime_error("Can't initialize encoder");
+
+    LogInfoC
+        << "initialized. max payload " << maxPayload
+        << " cores " << nCores_
+        << " parameters: " << plotCodec(codec_) << endl;
+}
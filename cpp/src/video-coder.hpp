@@ -12,14 +12,18 @@
 #ifndef __ndnrtc__video_coder__
 #define __ndnrtc__video_coder__
 
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
 #include <webrtc/modules/video_coding/include/video_codec_interface.h>
 
 #include "webrtc.hpp"
 #include "ndnrtc-common.hpp"
 #include "statistics.hpp"
 #include "ndnrtc-object.hpp"
-
-#define USE_VP9
+#include "frame-converter.hpp"
 
 namespace ndnrtc
 {
@@ -43,13 +47,63 @@ class IEncoderDelegate
 };
 
 /**
-     * This class performs scaling of raw frames. WebRTC uses frame buffers
-     * pool for allocating frames memory. All frame operations that involve 
-     * memory manipulations must use buffer pool. According to WebRTC design,
-     * access to buffer pool is restricted to only one thread - the one that
-     * was the first to access pool. As frame scaling involves pool access,
-     * one has to ensure that scaling is always performed on the same thread.
-     * This rule affects applies to all FrameScaler instances.
+ * Registry of video codecs available for video threads. Encoders and
+ * decoders are created by codec name (see VideoCoderParams::codec_), thus
+ * every video thread may use its' own codec. VP8, VP9 and software H.264
+ * (OpenH264, available only if WebRTC was built with it) are registered by
+ * default; other implementations (e.g. hardware encoders) may be registered
+ * by application before streams are created.
+ * The class is thread-safe.
+ */
+class VideoCodecFactory
+{
+  public:
+    typedef boost::function<webrtc::VideoEncoder *()> CreateEncoder;
+    typedef boost::function<webrtc::VideoDecoder *()> CreateDecoder;
+
+    static VideoCodecFactory &getSharedInstance();
+
+    /**
+     * Registers codec implementation (replaces existing one with the same
+     * name).
+     * @param name Codec name, as used in VideoCoderParams
+     * @param type WebRTC codec type, which defines encoder settings
+     */
+    void registerCodec(const std::string &name, webrtc::VideoCodecType type,
+                       CreateEncoder createEncoder, CreateDecoder createDecoder);
+    bool isSupported(const std::string &name) const;
+    std::vector<std::string> getCodecs() const;
+
+    // these throw if codec is not registered
+    webrtc::VideoCodecType getCodecType(const std::string &name) const;
+    webrtc::VideoEncoder *createEncoder(const std::string &name) const;
+    webrtc::VideoDecoder *createDecoder(const std::string &name) const;
+
+  private:
+    typedef struct _Codec
+    {
+        webrtc::VideoCodecType type_;
+        CreateEncoder createEncoder_;
+        CreateDecoder createDecoder_;
+    } Codec;
+
+    VideoCodecFactory();
+    VideoCodecFactory(const VideoCodecFactory &) = delete;
+
+    mutable boost::mutex mutex_;
+    std::map<std::string, Codec> codecs_;
+
+    Codec getCodec(const std::string &name) const;
+};
+
+/**
+     * This class performs scaling of raw frames. Scaled frames are allocated
+     * from scaler's own FrameBufferPool: a buffer is reused once all frames
+     * referencing it are released, so scaled frames may be safely passed to
+     * other threads (e.g. for further scaling). Unlike WebRTC's buffer pool,
+     * FrameBufferPool is thread-safe and is not bound to the thread that
+     * accessed it first, thus scaling may be performed on any thread.
+     * If source frame already has target resolution, it is returned as is.
      */
 class FrameScaler
 {
@@ -57,22 +111,20 @@ class FrameScaler
     FrameScaler(unsigned int dstWidth, unsigned int dstHeight);
     const WebRtcVideoFrame operator()(const WebRtcVideoFrame &frame);
 
+    unsigned int getWidth() const { return dstWidth_; }
+    unsigned int getHeight() const { return dstHeight_; }
+
   private:
     FrameScaler(const FrameScaler &) = delete;
 
-    unsigned int srcWidth_, srcHeight_;
     unsigned int dstWidth_, dstHeight_;
-    // webrtc::Scaler scaler_;
-    // WebRtcVideoFrame scaledFrame_;
-    WebRtcSmartPtr<WebRtcVideoFrameBuffer> scaledFrameBuffer_;
-
-    void
-    initScaledFrame();
+    FrameBufferPool bufferPool_;
 };
 
 /**
-     * This class is a main wrapper for VP8 WebRTC encoder. It consumes raw
-     * frames, encodes them using VP8 encoder, configured for specified
+     * This class is a main wrapper for WebRTC encoders. It consumes raw
+     * frames, encodes them using encoder of the codec, specified in
+     * parameters (see VideoCodecFactory), configured for specified
      * parameters and passes encoded frames to its' frame consumer class.
      */
 class VideoCoder : public NdnRtcComponent,
@@ -87,12 +139,44 @@ class VideoCoder : public NdnRtcComponent,
         EncoderDefined // encoder determines when to insert Key frames (default)
     };
 
+    /**
+     * @param nCores Number of CPU cores encoder may use; if 0, encoder may
+     *               use all available cores
+     */
     VideoCoder(const VideoCoderParams &coderParams, IEncoderDelegate *delegate,
-               KeyEnforcement = KeyEnforcement::EncoderDefined);
+               KeyEnforcement = KeyEnforcement::EncoderDefined, unsigned int nCores = 0);
 
     void onRawFrame(const WebRtcVideoFrame &frame);
     int getGopCounter() const { return gopPos_; }
 
+    /**
+     * Re-initializes encoder to use given number of CPU cores. Next encoded
+     * frame will be a Key frame. Must be called on encoding thread.
+     */
+    void setCoreNum(unsigned int nCores);
+    unsigned int getCoreNum() const { return nCores_; }
+
+    /**
+     * Makes next encoded frame a Key frame. Must be called on encoding
+     * thread.
+     */
+    void requestKeyFrame() { keyFrameTrigger_ = 0; }
+    bool isKeyFrameDue() const { return (keyFrameTrigger_ % coderParams_.gop_ == 0); }
+
+    /**
+     * Retargets encoder's bitrate and frame rate without re-initializing it.
+     * Max bitrate is raised if new bitrate exceeds it. Must be called on
+     * encoding thread.
+     */
+    void setRate(unsigned int bitrateKbps, double frameRate);
+
+    /**
+     * Re-initializes encoder for new resolution. Next encoded frame will be
+     * a Key frame. Must be called on encoding thread.
+     */
+    void setResolution(unsigned int width, unsigned int height);
+    const VideoCoderParams &getParams() const { return coderParams_; }
+
     static webrtc::VideoCodec codecFromSettings(const VideoCoderParams &settings);
 
   private:
@@ -109,6 +193,9 @@ class VideoCoder : public NdnRtcComponent,
 
     int keyFrameTrigger_, gopPos_;
     KeyEnforcement keyEnforcement_;
+    unsigned int nCores_;
+
+    void initEncoder();
 
     // interface webrtc::EncodedImageCallback
     webrtc::EncodedImageCallback::Result OnEncodedImage(const webrtc::EncodedImage &encoded_image,
@@ -11,9 +11,6 @@
 
 #include <boost/thread.hpp>
 
-#include <modules/video_coding/codecs/vp8/include/vp8.h>
-#include <modules/video_coding/codecs/vp9/include/vp9.h>
-
 #include "video-decoder.hpp"
 #include "video-coder.hpp"
 #include "clock.hpp"
@@ -68,11 +65,7 @@ void VideoDecoder::resetDecoder()
     if (decoder_.get())
         decoder_->Release();
 
-#ifdef USE_VP9
-    decoder_.reset(webrtc::VP9Decoder::Create());
-#else
-    decoder_.reset(webrtc::VP8Decoder::Create());
-#endif
+    decoder_.reset(VideoCodecFactory::getSharedInstance().createDecoder(settings_.codec_));
     
     if (!decoder_.get())
         throw std::runtime_error("can't create decoder");
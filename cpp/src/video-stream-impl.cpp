@@ -5,14 +5,12 @@
 //  Copyright 2013-2016 Regents of the University of California
 //
 
-#define BOOST_THREAD_PROVIDES_FUTURE
-#include <boost/thread/future.hpp>
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
 #include <ndn-cpp/c/common.h>
 #include <ndn-cpp/face.hpp>
 #include <ndn-cpp/security/key-chain.hpp>
-#include <ndn-cpp/util/memory-content-cache.hpp>
 #include <boost/thread/lock_guard.hpp>
 
 #include "video-stream-impl.hpp"
@@ -20,6 +18,7 @@
 #include "video-thread.hpp"
 #include "video-coder.hpp"
 #include "packet-publisher.hpp"
+#include "producer-cache.hpp"
 #include "name-components.hpp"
 #include "simple-log.hpp"
 #include "estimators.hpp"
@@ -36,21 +35,26 @@ using namespace ndn;
 using namespace estimators;
 
 typedef boost::shared_ptr<VideoFramePacket> FramePacketPtr;
-typedef boost::future<FramePacketPtr> FutureFrame;
-typedef boost::shared_ptr<boost::future<FramePacketPtr>> FutureFramePtr;
 
 VideoStreamImpl::VideoStreamImpl(const std::string &streamPrefix,
                                  const MediaStreamSettings &settings, bool useFec)
     : MediaStreamBase(streamPrefix, settings),
       playbackCounter_(0),
       fecEnabled_(useFec),
-      busyPublishing_(0)
+      isPublishScheduled_(false),
+      heldCaptureTimestampMs_(0),
+      publishDelay_(Average(boost::make_shared<SampleWindow>(30))),
+      publishLag_(Average(boost::make_shared<SampleWindow>(30)))
 {
     if (settings_.params_.type_ == MediaStreamParams::MediaStreamType::MediaStreamTypeAudio)
         throw runtime_error("Wrong media stream parameters type supplied (audio instead of video)");
 
     description_ = "vstream-" + settings_.params_.streamName_;
 
+    if (settings_.paceFrames_)
+        pacer_ = boost::make_shared<FramePacer>(settings_.faceIo_, VideoCoderParams().codecFrameRate_,
+                                                boost::bind(&VideoStreamImpl::onPacedFrame, this, _1, _2, _3));
+
     for (int i = 0; i < settings_.params_.getThreadNum(); ++i)
         if (settings_.params_.getVideoThread(i))
             add(settings_.params_.getVideoThread(i));
@@ -74,7 +78,9 @@ VideoStreamImpl::VideoStreamImpl(const std::string &streamPrefix,
 
 VideoStreamImpl::~VideoStreamImpl()
 {
-    // cleanup
+    if (pacer_)
+        pacer_->stop();
+    stopWorkers();
 }
 
 vector<string> VideoStreamImpl::getThreads() const
@@ -82,7 +88,7 @@ vector<string> VideoStreamImpl::getThreads() const
     boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
     std::vector<string> threads;
 
-    for (auto it : threads_)
+    for (auto it : workers_)
         threads.push_back(it.first);
 
     return threads;
@@ -91,7 +97,18 @@ vector<string> VideoStreamImpl::getThreads() const
 int VideoStreamImpl::incomingFrame(const ArgbRawFrameWrapper &w)
 {
     LogDebugC << "⤹ incoming ARGB frame " << w.width_ << "x" << w.height_ << std::endl;
-    if (feedFrame(conv_ << w))
+    unsigned int dstWidth, dstHeight;
+    bool fed = false;
+
+    if (getFusedDownscale(w.width_, w.height_, dstWidth, dstHeight))
+    {
+        RawFrameConverter::FramePair frames = conv_.convertAndDownscale(w, dstWidth, dstHeight);
+        fed = feedFrame(frames.first, &frames.second);
+    }
+    else
+        fed = feedFrame(conv_ << w);
+
+    if (fed)
         return (playbackCounter_ - 1);
     return -1;
 }
@@ -107,7 +124,18 @@ int VideoStreamImpl::incomingFrame(const I420RawFrameWrapper &w)
 int VideoStreamImpl::incomingFrame(const YUV_NV21FrameWrapper &w)
 {
     LogDebugC << "⤹ incoming NV21 frame " << w.width_ << "x" << w.height_ << std::endl;
-    if (feedFrame(conv_ << w))
+    unsigned int dstWidth, dstHeight;
+    bool fed = false;
+
+    if (getFusedDownscale(w.width_, w.height_, dstWidth, dstHeight))
+    {
+        RawFrameConverter::FramePair frames = conv_.convertAndDownscale(w, dstWidth, dstHeight);
+        fed = feedFrame(frames.first, &frames.second);
+    }
+    else
+        fed = feedFrame(conv_ << w);
+
+    if (fed)
         return (playbackCounter_ - 1);
     return -1;
 }
@@ -117,8 +145,8 @@ void VideoStreamImpl::setLogger(boost::shared_ptr<ndnlog::new_api::Logger> logge
     boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
     MediaStreamBase::setLogger(logger);
 
-    for (auto t : threads_)
-        t.second->setLogger(logger);
+    for (auto w : workers_)
+        w.second->setLogger(logger);
     framePublisher_->setLogger(logger);
     metadataPublisher_->setLogger(logger);
     ILoggingObject::setLogger(logger);
@@ -129,24 +157,49 @@ void VideoStreamImpl::add(const MediaThreadParams *mp)
 {
     const VideoThreadParams *params = static_cast<const VideoThreadParams *>(mp);
     // check if thread already exists
-    if (threads_.find(params->threadName_) != threads_.end())
+    if (workers_.find(params->threadName_) != workers_.end())
     {
         stringstream ss;
         ss << "Thread " << params->threadName_ << " has been added already";
         throw runtime_error(ss.str());
     }
+    else if (!VideoCodecFactory::getSharedInstance().isSupported(params->coderParams_.codec_))
+    {
+        stringstream ss;
+        ss << "Thread " << params->threadName_ << " codec " << params->coderParams_.codec_
+           << " is not supported";
+        throw runtime_error(ss.str());
+    }
     else
     {
-        boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
-
-        threads_[params->threadName_] = boost::make_shared<VideoThread>(params->coderParams_);
-        scalers_[params->threadName_] = boost::make_shared<FrameScaler>(params->coderParams_.encodeWidth_,
-                                                                        params->coderParams_.encodeHeight_);
-        seqCounters_[params->threadName_].first = -1;
-        seqCounters_[params->threadName_].second = -1;
-        metaKeepers_[params->threadName_] = boost::make_shared<MetaKeeper>(params);
+        std::string threadName = params->threadName_;
+        // scheduler may call back while other threads are being added, thus
+        // it must be called without holding stream locks
+        unsigned int nCores =
+            EncoderCoreScheduler::getSharedInstance().add(getEncoderId(threadName), params->coderParams_,
+                                                          boost::bind(&VideoStreamImpl::setEncoderCoreNum, this,
+                                                                      threadName, _1));
 
-        threads_[params->threadName_]->setDescription("thread-" + params->threadName_);
+        boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
+        boost::lock_guard<boost::mutex> publishLock(publishMutex_);
+
+        int cpuCore = -1;
+        if (settings_.pinEncoderThreads_ && boost::thread::hardware_concurrency())
+            cpuCore = workers_.size() % boost::thread::hardware_concurrency();
+
+        workers_[threadName] =
+            boost::make_shared<EncoderWorker>(params->coderParams_,
+                                              boost::bind(&VideoStreamImpl::onEncoded, this, threadName, _1, _2),
+                                              settings_.encoderQueueSize_, cpuCore, nCores);
+        seqCounters_[threadName].first = -1;
+        seqCounters_[threadName].second = -1;
+        metaKeepers_[threadName] = boost::make_shared<MetaKeeper>(params);
+
+        workers_[threadName]->setDescription("thread-" + threadName);
+        // allocation might have changed before worker was created
+        workers_[threadName]->setCoreNum(EncoderCoreScheduler::getSharedInstance().getAllocation(getEncoderId(threadName)));
+        buildScalingPyramid();
+        updatePacerRate();
     }
 
     LogTraceC << "added thread " << params->threadName_ << std::endl;
@@ -154,64 +207,316 @@ void VideoStreamImpl::add(const MediaThreadParams *mp)
 
 void VideoStreamImpl::remove(const string &threadName)
 {
-    if (threads_.find(threadName) != threads_.end())
+    boost::shared_ptr<EncoderWorker> worker;
+    {
+        boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
+        boost::lock_guard<boost::mutex> publishLock(publishMutex_);
+        if (workers_.find(threadName) == workers_.end())
+            return;
+
+        worker = workers_[threadName];
+        worker->setChildren(std::vector<boost::shared_ptr<EncoderWorker>>());
+        workers_.erase(threadName);
+        buildScalingPyramid();
+    }
+
+    // worker may be publishing a frame right now, wait for it to finish
+    worker->stop();
+    EncoderCoreScheduler::getSharedInstance().remove(getEncoderId(threadName));
+
     {
         boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
+        boost::lock_guard<boost::mutex> publishLock(publishMutex_);
 
-        threads_.erase(threadName);
-        scalers_.erase(threadName);
         seqCounters_.erase(threadName);
         metaKeepers_.erase(threadName);
+        lastPublished_.erase(threadName);
+        awaitingKey_.erase(threadName);
+        updatePacerRate();
+    }
+
+    LogTraceC << "remove thread " << threadName << std::endl;
+}
 
-        LogTraceC << "remove thread " << threadName << std::endl;
+void VideoStreamImpl::stopWorkers()
+{
+    std::map<std::string, boost::shared_ptr<EncoderWorker>> workers;
+    {
+        boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
+        workers = workers_;
+    }
+
+    for (auto w : workers)
+    {
+        w.second->stop();
+        EncoderCoreScheduler::getSharedInstance().remove(getEncoderId(w.first));
     }
 }
 
-bool VideoStreamImpl::feedFrame(const WebRtcVideoFrame &frame)
+void VideoStreamImpl::buildScalingPyramid()
 {
-    (*statStorage_)[Indicator::CapturedNum]++;
+    // each worker scales from the smallest worker that has resolution not
+    // lower than its' own (ties are broken by thread name order); workers
+    // that have no such parent, scale from captured frames
+    std::map<std::string, std::vector<boost::shared_ptr<EncoderWorker>>> children;
+    rootWorkers_.clear();
 
-    if (busyPublishing_ > 0)
+    for (auto w : workers_)
     {
-        LogWarnC << "⨂ busy publishing (capture rate may be too high)" << std::endl;
-        return false;
+        std::string parent;
+        uint64_t parentArea = 0;
+        uint64_t area = (uint64_t)w.second->getWidth() * w.second->getHeight();
+
+        for (auto p : workers_)
+        {
+            if (p.first == w.first ||
+                p.second->getWidth() < w.second->getWidth() ||
+                p.second->getHeight() < w.second->getHeight())
+                continue;
+
+            uint64_t pArea = (uint64_t)p.second->getWidth() * p.second->getHeight();
+            if (pArea == area && p.first > w.first)
+                continue;
+
+            if (parent == "" || pArea < parentArea)
+            {
+                parent = p.first;
+                parentArea = pArea;
+            }
+        }
+
+        if (parent == "")
+            rootWorkers_.push_back(w.second);
+        else
+        {
+            children[parent].push_back(w.second);
+            LogTraceC << "thread " << w.first << " is scaled from " << parent << std::endl;
+        }
     }
 
-    if (threads_.size())
+    for (auto w : workers_)
+        w.second->setChildren(children[w.first]);
+}
+
+void VideoStreamImpl::setThreadRate(const std::string &thread, unsigned int bitrateKbps,
+                                    double frameRate)
+{
+    VideoCoderParams coderParams;
     {
         boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
-        LogDebugC << "↓ feeding " << playbackCounter_ << "p into encoders..." << std::endl;
+        boost::lock_guard<boost::mutex> publishLock(publishMutex_);
+        auto it = workers_.find(thread);
 
-        map<string, FutureFramePtr> futureFrames;
-        for (auto it : threads_)
+        if (it == workers_.end())
         {
-            FutureFramePtr ff =
-                boost::make_shared<FutureFrame>(boost::move(boost::async(boost::launch::async,
-                                                                         boost::bind(&VideoThread::encode, it.second.get(),
-                                                                         (*scalers_[it.first])(frame)))));
-            futureFrames[it.first] = ff;
+            LogWarnC << "can't set rate: no thread " << thread << std::endl;
+            return;
         }
 
-        map<string, FramePacketPtr> frames;
-        for (auto it : futureFrames)
+        coderParams = metaKeepers_[thread]->getCoderParams();
+        coderParams.startBitrate_ = bitrateKbps;
+        coderParams.codecFrameRate_ = frameRate;
+        if (bitrateKbps > coderParams.maxBitrate_)
+            coderParams.maxBitrate_ = bitrateKbps;
+
+        it->second->setRate(bitrateKbps, frameRate);
+        metaKeepers_[thread]->setCoderParams(coderParams);
+        updatePacerRate();
+    }
+
+    LogInfoC << "thread " << thread << " retargeted to " << bitrateKbps << "Kbps "
+             << frameRate << "fps" << std::endl;
+    updateCoderParams(thread, coderParams);
+}
+
+void VideoStreamImpl::setThreadResolution(const std::string &thread, unsigned int width,
+                                          unsigned int height)
+{
+    VideoCoderParams coderParams;
+    {
+        boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
+        boost::lock_guard<boost::mutex> publishLock(publishMutex_);
+        auto it = workers_.find(thread);
+
+        if (it == workers_.end())
         {
-            FramePacketPtr f(it.second->get());
-            if (f.get())
-            {
-                (*statStorage_)[Indicator::EncodedNum]++;
-                frames[it.first] = f;
-            }
+            LogWarnC << "can't set resolution: no thread " << thread << std::endl;
+            return;
         }
 
-        (*statStorage_)[Indicator::DroppedNum] += (threads_.size() - frames.size());
-        bool result = false;
+        // meta and scaling pyramid are updated once frames of the new
+        // resolution are published (see updateResolution)
+        coderParams = metaKeepers_[thread]->getCoderParams();
+        coderParams.encodeWidth_ = width;
+        coderParams.encodeHeight_ = height;
+
+        it->second->setResolution(width, height);
+    }
+
+    LogInfoC << "thread " << thread << " switches to " << width << "x" << height
+             << " with next key frame" << std::endl;
+    updateCoderParams(thread, coderParams);
+}
+
+void VideoStreamImpl::updateCoderParams(const std::string &thread, const VideoCoderParams &coderParams)
+{
+    // pixel rate has changed, thus core allocation has to be re-balanced;
+    // scheduler must be called without holding stream locks. thread may have
+    // been removed meanwhile, so encoder is not registered again
+    EncoderCoreScheduler::getSharedInstance().update(getEncoderId(thread), coderParams);
+}
+
+void VideoStreamImpl::updateResolution(const std::string &thread, const webrtc::EncodedImage &image)
+{
+    boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
+    boost::lock_guard<boost::mutex> publishLock(publishMutex_);
+    auto it = metaKeepers_.find(thread);
+
+    if (it == metaKeepers_.end())
+        return;
+
+    VideoCoderParams coderParams = it->second->getCoderParams();
+    if (coderParams.encodeWidth_ == image._encodedWidth &&
+        coderParams.encodeHeight_ == image._encodedHeight)
+        return;
+
+    LogInfoC << "thread " << thread << " switched to " << image._encodedWidth
+             << "x" << image._encodedHeight << std::endl;
+
+    coderParams.encodeWidth_ = image._encodedWidth;
+    coderParams.encodeHeight_ = image._encodedHeight;
+    it->second->setCoderParams(coderParams);
+    // thread may have moved within the scaling pyramid
+    buildScalingPyramid();
+}
+
+void VideoStreamImpl::setEncoderCoreNum(const std::string &thread, unsigned int nCores)
+{
+    boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
+    auto it = workers_.find(thread);
+
+    if (it != workers_.end())
+    {
+        LogInfoC << "thread " << thread << " encoder core allocation: " << nCores << std::endl;
+        it->second->setCoreNum(nCores);
+    }
+}
+
+std::string VideoStreamImpl::getEncoderId(const std::string &thread) const
+{
+    return streamPrefix_.toUri() + "/" + thread;
+}
+
+bool VideoStreamImpl::getFusedDownscale(unsigned int width, unsigned int height,
+                                        unsigned int &dstWidth, unsigned int &dstHeight) const
+{
+    boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
+    uint64_t area = 0;
+
+    // the largest worker (anywhere in the scaling pyramid) that can be
+    // downscaled to while converting; frame is routed to it by encodeFrame
+    for (auto it : workers_)
+    {
+        boost::shared_ptr<EncoderWorker> w = it.second;
+        if (RawFrameConverter::canFuseDownscale(width, height, w->getWidth(), w->getHeight()) &&
+            (uint64_t)w->getWidth() * w->getHeight() > area)
+        {
+            dstWidth = w->getWidth();
+            dstHeight = w->getHeight();
+            area = (uint64_t)dstWidth * dstHeight;
+        }
+    }
+
+    return (area > 0);
+}
+
+bool VideoStreamImpl::feedFrame(const WebRtcVideoFrame &frame, const WebRtcVideoFrame *downscaled)
+{
+    (*statStorage_)[Indicator::CapturedNum]++;
+
+    if (pacer_)
+    {
+        // frame is encoded on pacer's next tick, unless superseded by a newer one
+        if (!pacer_->push(frame, downscaled))
+            LogDebugC << "⨂ frame superseded before pacer tick (capture burst)" << std::endl;
+        (*statStorage_)[Indicator::PacerDroppedNum] = pacer_->getDroppedNum();
+        return true;
+    }
+
+    return encodeFrame(frame, downscaled, clock::millisecondTimestamp());
+}
+
+void VideoStreamImpl::onPacedFrame(const WebRtcVideoFrame &frame, const WebRtcVideoFrame *downscaled,
+                                   int64_t captureTimestampMs)
+{
+    encodeFrame(frame, downscaled, captureTimestampMs);
+    (*statStorage_)[Indicator::PacerDuplicatedNum] = pacer_->getDuplicatedNum();
+}
+
+void VideoStreamImpl::updatePacerRate()
+{
+    if (!pacer_)
+        return;
+
+    double rate = 0;
+    for (auto it : metaKeepers_)
+        rate = std::max(rate, it.second->getCoderParams().codecFrameRate_);
 
-        if (frames.size())
+    if (rate > 0 && rate != pacer_->getRate())
+    {
+        LogInfoC << "pacing captured frames at " << rate << "fps" << std::endl;
+        pacer_->setRate(rate);
+    }
+
+    if (!pacer_->isRunning())
+        pacer_->start();
+}
+
+bool VideoStreamImpl::encodeFrame(const WebRtcVideoFrame &frame, const WebRtcVideoFrame *downscaled,
+                                  int64_t captureTimestampMs)
+{
+    // other policies drop encoded frames from the publish queue instead
+    if (settings_.publishQueuePolicy_ == PublishQueuePolicy::Coalesce)
+    {
+        boost::lock_guard<boost::mutex> scopedLock(publishMutex_);
+        if (publishQueue_.size() >= settings_.publishQueueSize_)
         {
-            publish(frames);
-            playbackCounter_++;
-            result = true;
+            LogWarnC << "⨂ publish queue is full (capture rate may be too high), "
+                     << "holding captured frame" << std::endl;
+
+            if (heldFrame_)
+                (*statStorage_)[Indicator::DroppedNum]++;
+
+            heldFrame_ = boost::make_shared<WebRtcVideoFrame>(frame);
+            heldDownscaled_ = (downscaled ? boost::make_shared<WebRtcVideoFrame>(*downscaled)
+                                          : boost::shared_ptr<WebRtcVideoFrame>());
+            heldCaptureTimestampMs_ = captureTimestampMs;
+            return false;
         }
+    }
+
+    if (workers_.size())
+    {
+        boost::lock_guard<boost::mutex> scopedLock(internalMutex_);
+        LogDebugC << "↓ feeding " << playbackCounter_ << "p into encoders..." << std::endl;
+
+        // encoders run on their own threads and publish frames as soon as
+        // they are encoded, without waiting for each other
+        // (lower resolutions are passed down the scaling pyramid by workers);
+        // frames dropped from full queues are reported back via onEncoded
+        // workers of downscaled frame's resolution skip scaling altogether,
+        // downscaled frame is carried down the pyramid until it reaches them
+        boost::shared_ptr<const WebRtcVideoFrame> fused;
+        if (downscaled)
+            fused = boost::make_shared<WebRtcVideoFrame>(*downscaled);
+
+        for (auto w : rootWorkers_)
+            if (fused && (int)w->getWidth() == fused->width() &&
+                (int)w->getHeight() == fused->height())
+                w->enqueue(*fused, playbackCounter_, captureTimestampMs);
+            else
+                w->enqueue(frame, playbackCounter_, captureTimestampMs, fused);
+        playbackCounter_++;
 
         if (!isPeriodicInvocationSet())
         {
@@ -220,7 +525,7 @@ bool VideoStreamImpl::feedFrame(const WebRtcVideoFrame &frame)
                             boost::bind(&VideoStreamImpl::periodicInvocation, me));
         }
 
-        return result;
+        return true;
     }
     else
         LogWarnC << "incoming frame was given, but there are no threads" << std::endl;
@@ -228,50 +533,227 @@ bool VideoStreamImpl::feedFrame(const WebRtcVideoFrame &frame)
     return false;
 }
 
-void VideoStreamImpl::publish(map<string, FramePacketPtr> &frames)
+void VideoStreamImpl::onEncoded(const std::string &thread, const EncoderWorker::Job &job,
+                                const FramePacketPtr &fp)
 {
-    LogTraceC << "will publish " << frames.size() << " frames" << std::endl;
+    boost::lock_guard<boost::mutex> scopedLock(publishMutex_);
 
-    for (auto it : frames)
+    if (!fp.get())
     {
-        // prepare packet header
-        bool isKey = (it.second->getFrame()._frameType == webrtc::kVideoFrameKey);
+        (*statStorage_)[Indicator::DroppedNum]++;
+        return;
+    }
 
-        if (isKey)
-            seqCounters_[it.first].first++;
+    (*statStorage_)[Indicator::EncodedNum]++;
+
+    // thread might have been removed while frame was being encoded
+    auto worker = workers_.find(thread);
+    if (worker == workers_.end())
+        return;
+
+    bool isKey = (fp->getFrame()._frameType == webrtc::kVideoFrameKey);
+    if (isKey)
+        awaitingKey_.erase(thread);
+    else if (awaitingKey_.find(thread) != awaitingKey_.end())
+    {
+        // delta frames, encoded after a dropped one, can't be decoded
+        LogDebugC << "⨂ dropping " << job.playbackNo_ << "p of " << thread
+                  << " (waiting for key frame)" << std::endl;
+        (*statStorage_)[Indicator::PublishDroppedNum]++;
+        return;
+    }
+
+    // this is called on the worker's thread, so it's safe to query its' coder
+    PublishJob pj;
+    pj.thread_ = thread;
+    pj.playbackNo_ = job.playbackNo_;
+    pj.captureTimestampMs_ = job.captureTimestampMs_;
+    pj.queuedTimestampMs_ = clock::millisecondTimestamp();
+    pj.gopPos_ = (unsigned char)worker->second->getVideoThread()->getCoder().getGopCounter();
+    pj.isKey_ = isKey;
+    pj.packet_ = fp;
+
+    if (publishQueue_.size() >= settings_.publishQueueSize_ &&
+        settings_.publishQueuePolicy_ != PublishQueuePolicy::Coalesce &&
+        !dropQueued(pj))
+        return;
+
+    publishQueue_.push_back(pj);
+    (*statStorage_)[Indicator::PublishQueueSize] = publishQueue_.size();
+
+    // queued frames are published by one face thread task, which is
+    // re-scheduled once it has emptied the queue
+    if (!isPublishScheduled_)
+    {
+        isPublishScheduled_ = true;
+        boost::shared_ptr<VideoStreamImpl> me = boost::static_pointer_cast<VideoStreamImpl>(shared_from_this());
+        async::dispatchAsync(settings_.faceIo_, [me]() { me->publishQueued(); });
+    }
+}
+
+bool VideoStreamImpl::dropQueued(const PublishJob &incoming)
+{
+    auto victim = std::find_if(publishQueue_.begin(), publishQueue_.end(),
+                               [](const PublishJob &pj) { return !pj.isKey_; });
+
+    if (victim == publishQueue_.end())
+    {
+        if (settings_.publishQueuePolicy_ == PublishQueuePolicy::NeverDropKey)
+        {
+            if (incoming.isKey_)
+                return true;
+
+            // queue holds key frames only, thus incoming delta is dropped
+            LogWarnC << "⨂ publish queue is full, dropping "
+                     << incoming.playbackNo_ << "p of " << incoming.thread_ << std::endl;
+            (*statStorage_)[Indicator::PublishDroppedNum]++;
+            awaitingKey_.insert(incoming.thread_);
+            workers_[incoming.thread_]->requestKeyFrame();
+            return false;
+        }
+
+        victim = publishQueue_.begin();
+    }
+
+    std::string thread = victim->thread_;
+    size_t nDropped = 1;
+    bool hasKey = false;
+
+    LogWarnC << "⨂ publish queue is full, dropping "
+             << victim->playbackNo_ << "p of " << thread << std::endl;
+
+    // later delta frames of the same thread reference dropped frame, up to
+    // thread's next key frame
+    for (auto it = publishQueue_.erase(victim); it != publishQueue_.end() && !hasKey;)
+        if (it->thread_ != thread)
+            ++it;
+        else if (it->isKey_)
+            hasKey = true;
         else
-            seqCounters_[it.first].second++;
+        {
+            it = publishQueue_.erase(it);
+            nDropped++;
+        }
 
-        CommonHeader packetHdr;
-        packetHdr.sampleRate_ = metaKeepers_[it.first]->getRate();
-        packetHdr.publishTimestampMs_ = clock::millisecondTimestamp();
-        packetHdr.publishUnixTimestamp_ = clock::unixTimestamp();
+    (*statStorage_)[Indicator::PublishDroppedNum] += nDropped;
 
-        it.second->setSyncList(getCurrentSyncList(isKey));
-        it.second->setHeader(packetHdr);
+    if (hasKey)
+        return true;
 
-        LogTraceC << "thread " << it.first << " " << packetHdr.sampleRate_
-                  << "fps " << packetHdr.publishTimestampMs_ << "ms " << std::endl;
+    if (workers_.find(thread) != workers_.end())
+    {
+        awaitingKey_.insert(thread);
+        workers_[thread]->requestKeyFrame();
+    }
 
-        lastPublished_[it.first].timestamp_ = (uint64_t)(packetHdr.publishUnixTimestamp_*1000);
-        lastPublished_[it.first].playbackNo_ = playbackCounter_;
-        lastPublished_[it.first].ndnName_ = publish(it.first, it.second);
+    if (incoming.thread_ == thread && !incoming.isKey_)
+    {
+        (*statStorage_)[Indicator::PublishDroppedNum]++;
+        return false;
     }
+
+    return true;
 }
 
-std::string VideoStreamImpl::publish(const string &thread, FramePacketPtr &fp)
+void VideoStreamImpl::publishQueued()
 {
+    boost::shared_ptr<WebRtcVideoFrame> heldFrame, heldDownscaled;
+    int64_t heldCaptureTimestampMs = 0;
+
+    while (true)
+    {
+        // queue has room now, thus frame held by Coalesce policy goes to encoders
+        if (heldFrame)
+        {
+            encodeFrame(*heldFrame, heldDownscaled.get(), heldCaptureTimestampMs);
+            heldFrame.reset();
+            heldDownscaled.reset();
+        }
+
+        PublishJob pj;
+        PacketNumber seqNo, pairedSeq;
+        double publishUnixTimestamp;
+        boost::shared_ptr<MetaKeeper> keeper;
+        {
+            boost::lock_guard<boost::mutex> scopedLock(publishMutex_);
+
+            if (publishQueue_.empty())
+            {
+                isPublishScheduled_ = false;
+                return;
+            }
+
+            pj = publishQueue_.front();
+            publishQueue_.pop_front();
+            (*statStorage_)[Indicator::PublishQueueSize] = publishQueue_.size();
+
+            if (heldFrame_ && publishQueue_.size() < settings_.publishQueueSize_)
+            {
+                heldFrame.swap(heldFrame_);
+                heldDownscaled.swap(heldDownscaled_);
+                heldCaptureTimestampMs = heldCaptureTimestampMs_;
+            }
+
+            // thread might have been removed while frame was queued
+            if (metaKeepers_.find(pj.thread_) == metaKeepers_.end())
+                continue;
+
+            publishLag_.newValue(clock::millisecondTimestamp() - pj.queuedTimestampMs_);
+            (*statStorage_)[Indicator::PublishLag] = publishLag_.value();
+
+            // sequence numbers are assigned at publishing, so that frames
+            // dropped from the queue leave no gaps in the namespace
+            if (pj.isKey_)
+                seqCounters_[pj.thread_].first++;
+            else
+                seqCounters_[pj.thread_].second++;
+
+            seqNo = (pj.isKey_ ? seqCounters_[pj.thread_].first : seqCounters_[pj.thread_].second);
+            pairedSeq = (pj.isKey_ ? seqCounters_[pj.thread_].second + 1 : seqCounters_[pj.thread_].first);
+            keeper = metaKeepers_[pj.thread_];
+
+            CommonHeader packetHdr;
+            packetHdr.sampleRate_ = keeper->getRate();
+            packetHdr.publishTimestampMs_ = clock::millisecondTimestamp();
+            packetHdr.publishUnixTimestamp_ = clock::unixTimestamp();
+            publishUnixTimestamp = packetHdr.publishUnixTimestamp_;
+
+            pj.packet_->setSyncList(getCurrentSyncList(pj.isKey_));
+            pj.packet_->setHeader(packetHdr);
+
+            LogTraceC << "thread " << pj.thread_ << " " << packetHdr.sampleRate_
+                      << "fps " << packetHdr.publishTimestampMs_ << "ms " << std::endl;
+        }
+
+        std::string dataName = publish(pj, seqNo, pairedSeq, keeper);
+        // resolution switches happen at key frames only
+        if (pj.isKey_)
+            updateResolution(pj.thread_, pj.packet_->getFrame());
+
+        {
+            boost::lock_guard<boost::mutex> scopedLock(publishMutex_);
+            lastPublished_[pj.thread_].timestamp_ = (uint64_t)(publishUnixTimestamp*1000);
+            lastPublished_[pj.thread_].playbackNo_ = pj.playbackNo_;
+            lastPublished_[pj.thread_].ndnName_ = dataName;
+
+            if (publishQueue_.empty())
+                (*statStorage_)[Indicator::ProcessedNum]++;
+        }
+    }
+}
+
+std::string VideoStreamImpl::publish(const PublishJob &pj, PacketNumber seqNo, PacketNumber pairedSeq,
+                                     const boost::shared_ptr<MetaKeeper> &keeper)
+{
+    const FramePacketPtr &fp = pj.packet_;
     boost::shared_ptr<NetworkData> parityData = fp->getParityData(
         VideoFrameSegment::payloadLength(settings_.params_.producerParams_.segmentSize_),
         PARITY_RATIO);
 
-    bool isKey = (fp->getFrame()._frameType == webrtc::kVideoFrameKey);
-    PacketNumber seqNo = (isKey ? seqCounters_[thread].first : seqCounters_[thread].second);
-    PacketNumber pairedSeq = (isKey ? seqCounters_[thread].second + 1 : seqCounters_[thread].first);
-    PacketNumber playbackNo = playbackCounter_;
-    unsigned char gopPos = (char)threads_[thread]->getCoder().getGopCounter();
+    bool isKey = pj.isKey_;
+    PacketNumber playbackNo = pj.playbackNo_;
     Name dataName(streamPrefix_);
-    dataName.append(thread)
+    dataName.append(pj.thread_)
         .append((isKey ? NameComponents::NameComponentKey : NameComponents::NameComponentDelta))
         .appendSequenceNumber(seqNo);
 
@@ -279,69 +761,55 @@ std::string VideoStreamImpl::publish(const string &thread, FramePacketPtr &fp)
                                                    settings_.params_.producerParams_.segmentSize_);
     size_t nParitySeg = fecEnabled_ && VideoFrameSegment::numSlices(*parityData,
                                                      settings_.params_.producerParams_.segmentSize_);
-    boost::shared_ptr<VideoStreamImpl> me = boost::static_pointer_cast<VideoStreamImpl>(shared_from_this());
-    boost::shared_ptr<MetaKeeper> keeper = metaKeepers_[thread];
-
-    LogTraceC << "spawned publish task for "
-              << seqNo
-              << (isKey ? "k " : "d ")
-              << playbackNo << "p "
-              << "(" << SAMPLE_SUFFIX(dataName) << ")" << std::endl;
-
-    busyPublishing_++;
-    async::dispatchAsync(settings_.faceIo_, [me, nParitySeg, nDataSeg, seqNo, pairedSeq, keeper, isKey,
-                                             thread, fp, parityData, dataName, playbackNo, gopPos, this] {
-        VideoFrameSegmentHeader segmentHdr;
-        segmentHdr.totalSegmentsNum_ = nDataSeg;
-        segmentHdr.paritySegmentsNum_ = nParitySeg;
-        segmentHdr.playbackNo_ = playbackNo;
-        segmentHdr.pairedSequenceNo_ = pairedSeq;
-
-        PublishedDataPtrVector segments =
-            me->framePublisher_->publish(dataName, *fp, segmentHdr,
-                                         (isKey ? settings_.params_.producerParams_.freshness_.sampleKeyMs_ : -1),
-                                         isKey, true);
-        assert(segments.size());
-        keeper->updateMeta(isKey, nDataSeg, nParitySeg, seqNo, pairedSeq, gopPos);
+
+    VideoFrameSegmentHeader segmentHdr;
+    segmentHdr.totalSegmentsNum_ = nDataSeg;
+    segmentHdr.paritySegmentsNum_ = nParitySeg;
+    segmentHdr.playbackNo_ = playbackNo;
+    segmentHdr.pairedSequenceNo_ = pairedSeq;
+
+    PublishedDataPtrVector segments =
+        framePublisher_->publish(dataName, *fp, segmentHdr,
+                                 (isKey ? settings_.params_.producerParams_.freshness_.sampleKeyMs_ : -1),
+                                 true);
+    assert(segments.size());
+    keeper->updateMeta(isKey, nDataSeg, nParitySeg, seqNo, pairedSeq, pj.gopPos_);
+
+    LogDebugC << "↓ published "
+              << seqNo << (isKey ? "k " : "d ") << playbackNo << "p "
+              << "(" << SAMPLE_SUFFIX(dataName) << ")x" << segments.size()
+              << " Dgen " << segmentHdr.generationDelayMs_ << "ms" << std::endl;
+
+    PublishedDataPtrVector paritySegments;
+    if (nParitySeg)
+    {
+        Name parityName(dataName);
+        parityName.append(NameComponents::NameComponentParity);
+
+        paritySegments =
+            framePublisher_->publish(parityName, *parityData, segmentHdr,
+                                     (isKey ? settings_.params_.producerParams_.freshness_.sampleKeyMs_ : -1));
+        assert(paritySegments.size());
+        std::copy(paritySegments.begin(), paritySegments.end(), std::back_inserter(segments));
 
         LogDebugC << "↓ published "
                   << seqNo << (isKey ? "k " : "d ") << playbackNo << "p "
-                  << "(" << SAMPLE_SUFFIX(dataName) << ")x" << segments.size()
-                  << " Dgen " << segmentHdr.generationDelayMs_ << "ms" << std::endl;
+                  << "(" << PARITY_SUFFIX(parityName) << ")x" << paritySegments.size()
+                  << std::endl;
+    }
+    publishManifest(dataName, segments);
 
-        PublishedDataPtrVector paritySegments;
-        if (nParitySeg)
-        {
-            Name parityName(dataName);
-            parityName.append(NameComponents::NameComponentParity);
-
-            paritySegments =
-                me->framePublisher_->publish(parityName, *parityData, segmentHdr,
-                                             (isKey ? settings_.params_.producerParams_.freshness_.sampleKeyMs_ : -1),
-                                             isKey);
-            assert(paritySegments.size());
-            std::copy(paritySegments.begin(), paritySegments.end(), std::back_inserter(segments));
-
-            LogDebugC << "↓ published "
-                      << seqNo << (isKey ? "k " : "d ") << playbackNo << "p "
-                      << "(" << PARITY_SUFFIX(parityName) << ")x" << paritySegments.size()
-                      << std::endl;
-        }
-        publishManifest(dataName, segments);
-        busyPublishing_--;
-
-        LogInfoC << "▻ published frame "
-                 << seqNo << (isKey ? "k " : "d ") << playbackNo << "p "
-                 << " data segments x" << segments.size()
-                 << " parity segments x" << paritySegments.size()
-                 << std::endl;
-
-        (*statStorage_)[Indicator::PublishedNum]++;
-        if (isKey)
-            (*statStorage_)[Indicator::PublishedKeyNum]++;
-        if (busyPublishing_ == 0)
-            (*statStorage_)[Indicator::ProcessedNum]++;
-    });
+    LogInfoC << "▻ published frame "
+             << seqNo << (isKey ? "k " : "d ") << playbackNo << "p "
+             << " data segments x" << segments.size()
+             << " parity segments x" << paritySegments.size()
+             << std::endl;
+
+    publishDelay_.newValue(clock::millisecondTimestamp() - pj.captureTimestampMs_);
+    (*statStorage_)[Indicator::PublishDelay] = publishDelay_.value();
+    (*statStorage_)[Indicator::PublishedNum]++;
+    if (isKey)
+        (*statStorage_)[Indicator::PublishedKeyNum]++;
 
     return dataName.toUri();
 }
@@ -352,8 +820,7 @@ void VideoStreamImpl::publishManifest(ndn::Name dataName, PublishedDataPtrVector
     dataName.append(NameComponents::NameComponentManifest).appendVersion(0);
     PublishedDataPtrVector ss = metadataPublisher_->publish(dataName, m);
 
-    LogDebugC << (busyPublishing_ == 1 ? "⤷" : "↓")
-              << " published manifest ☆ (" << dataName.getSubName(-5, 5) << ")x"
+    LogDebugC << "↓ published manifest ☆ (" << dataName.getSubName(-5, 5) << ")x"
               << ss.size() << std::endl;
 }
 
@@ -401,7 +868,8 @@ VideoStreamImpl::MetaKeeper::MetaKeeper(const VideoThreadParams *params)
       deltaParity_(Average(boost::make_shared<TimeWindow>(100))),
       keyData_(Average(boost::make_shared<SampleWindow>(2))),
       keyParity_(Average(boost::make_shared<SampleWindow>(2))),
-      versionNumber_(0)
+      versionNumber_(0),
+      coderParams_(params->coderParams_)
 {
 }
 
@@ -440,7 +908,13 @@ VideoStreamImpl::MetaKeeper::getMeta() const
     segInfo.keyAvgParitySegNum_ = keyParity_.value();
 
     return boost::move(VideoThreadMeta(rateMeter_.value(), seqNo_.first, seqNo_.second, gopPos_,
-                                       segInfo, ((VideoThreadParams *)params_)->coderParams_));
+                                       segInfo, coderParams_));
+}
+
+void VideoStreamImpl::MetaKeeper::setCoderParams(const VideoCoderParams &coderParams)
+{
+    coderParams_ = coderParams;
+    versionNumber_++;
 }
 
 double
@@ -8,6 +8,8 @@
 #ifndef __video_stream_impl_h__
 #define __video_stream_impl_h__
 
+#include <deque>
+#include <set>
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <boost/asio/steady_timer.hpp>
@@ -19,6 +21,8 @@
 #include "packet-publisher.hpp"
 #include "frame-converter.hpp"
 #include "estimators.hpp"
+#include "encoder-worker.hpp"
+#include "frame-pacer.hpp"
 
 namespace ndn
 {
@@ -55,6 +59,9 @@ class VideoStreamImpl : public MediaStreamBase
     int incomingFrame(const ArgbRawFrameWrapper &);
     int incomingFrame(const I420RawFrameWrapper &);
     int incomingFrame(const YUV_NV21FrameWrapper &);
+
+    void setThreadRate(const std::string &thread, unsigned int bitrateKbps, double frameRate);
+    void setThreadResolution(const std::string &thread, unsigned int width, unsigned int height);
     
     const std::map<std::string, FrameInfo>& getLastPublished() { return lastPublished_; }
     void setLogger(boost::shared_ptr<ndnlog::new_api::Logger>) override;
@@ -74,6 +81,10 @@ class VideoStreamImpl : public MediaStreamBase
         VideoThreadMeta getMeta() const;
         double getRate() const;
 
+        // changes coder parameters advertised in meta and bumps meta version
+        void setCoderParams(const VideoCoderParams &coderParams);
+        const VideoCoderParams &getCoderParams() const { return coderParams_; }
+
         void updateMeta(bool isKey, size_t nDataSeg, size_t nParitySeg, 
                         PacketNumber seqNo, PacketNumber pairedSeqNo, unsigned char gopPos);
 
@@ -88,26 +99,75 @@ class VideoStreamImpl : public MediaStreamBase
         std::pair<PacketNumber, PacketNumber> seqNo_;
         unsigned char gopPos_;
         uint32_t versionNumber_;
+        VideoCoderParams coderParams_;
     };
 
+    // encoded frame waiting to be published on face thread
+    typedef struct _PublishJob
+    {
+        std::string thread_;
+        PacketNumber playbackNo_;
+        int64_t captureTimestampMs_, queuedTimestampMs_;
+        unsigned char gopPos_;
+        bool isKey_;
+        boost::shared_ptr<VideoFramePacketAlias> packet_;
+    } PublishJob;
+
     bool fecEnabled_;
-    boost::atomic<int> busyPublishing_;
     RawFrameConverter conv_;
-    std::map<std::string, boost::shared_ptr<VideoThread>> threads_;
-    std::map<std::string, boost::shared_ptr<FrameScaler>> scalers_;
+    // guards per-thread publishing state, which is accessed from encoder
+    // worker threads (seqCounters_, metaKeepers_, lastPublished_) and
+    // publish queue
+    boost::mutex publishMutex_;
+    std::deque<PublishJob> publishQueue_;
+    bool isPublishScheduled_;
+    // Coalesce policy: the latest frame captured while publish queue is
+    // full; it supersedes previously held one and is encoded once a queued
+    // frame has been published
+    boost::shared_ptr<WebRtcVideoFrame> heldFrame_, heldDownscaled_;
+    int64_t heldCaptureTimestampMs_;
+    // threads that had delta frames dropped and wait for a key frame
+    std::set<std::string> awaitingKey_;
+    std::map<std::string, boost::shared_ptr<EncoderWorker>> workers_;
+    // workers that scale from captured frames (top of the scaling pyramid)
+    std::vector<boost::shared_ptr<EncoderWorker>> rootWorkers_;
     std::map<std::string, boost::shared_ptr<MetaKeeper>> metaKeepers_;
     std::map<std::string, std::pair<uint64_t, uint64_t>> seqCounters_;
     uint64_t playbackCounter_;
     boost::shared_ptr<VideoPacketPublisher> framePublisher_;
     std::map<std::string, FrameInfo> lastPublished_;
+    estimators::Average publishDelay_, publishLag_;
+    boost::shared_ptr<FramePacer> pacer_;
 
     void add(const MediaThreadParams *params) override;
     void remove(const std::string &threadName) override;
     bool updateMeta() override;
 
-    bool feedFrame(const WebRtcVideoFrame &frame);
-    void publish(std::map<std::string, boost::shared_ptr<VideoFramePacketAlias>> &frames);
-    std::string publish(const std::string &thread, boost::shared_ptr<VideoFramePacketAlias> &fp);
+    // downscaled is an optional copy of the frame, downscaled while it was
+    // converted; it is fed to workers of the same resolution
+    bool feedFrame(const WebRtcVideoFrame &frame, const WebRtcVideoFrame *downscaled = nullptr);
+    bool encodeFrame(const WebRtcVideoFrame &frame, const WebRtcVideoFrame *downscaled,
+                     int64_t captureTimestampMs);
+    void onPacedFrame(const WebRtcVideoFrame &frame, const WebRtcVideoFrame *downscaled,
+                      int64_t captureTimestampMs);
+    void updatePacerRate();
+    bool getFusedDownscale(unsigned int width, unsigned int height,
+                           unsigned int &dstWidth, unsigned int &dstHeight) const;
+    void stopWorkers();
+    void buildScalingPyramid();
+    void setEncoderCoreNum(const std::string &thread, unsigned int nCores);
+    // advertises resolution of published key frame, if it has changed
+    void updateResolution(const std::string &thread, const webrtc::EncodedImage &image);
+    void updateCoderParams(const std::string &thread, const VideoCoderParams &coderParams);
+    std::string getEncoderId(const std::string &thread) const;
+    void onEncoded(const std::string &thread, const EncoderWorker::Job &job,
+                   const boost::shared_ptr<VideoFramePacketAlias> &fp);
+    // makes room in full publish queue according to the policy; returns
+    // false if incoming frame must be dropped instead
+    bool dropQueued(const PublishJob &incoming);
+    void publishQueued();
+    std::string publish(const PublishJob &pj, PacketNumber seqNo, PacketNumber pairedSeq,
+                        const boost::shared_ptr<MetaKeeper> &keeper);
     void publishManifest(ndn::Name dataName, PublishedDataPtrVector &segments);
     std::map<std::string, PacketNumber> getCurrentSyncList(bool forKey = false);
 };
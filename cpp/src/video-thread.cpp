@@ -20,9 +20,9 @@ using namespace ndnrtc;
 using namespace webrtc;
 
 //******************************************************************************
-VideoThread::VideoThread(const VideoCoderParams &coderParams)
-    : coder_(coderParams, this, VideoCoder::KeyEnforcement::Gop),
-      nEncoded_(0), nDropped_(0)
+VideoThread::VideoThread(const VideoCoderParams &coderParams, unsigned int nCores)
+    : coder_(coderParams, this, VideoCoder::KeyEnforcement::Gop, nCores),
+      nEncoded_(0), nDropped_(0), captureTimestampMs_(-1)
 {
     description_ = "vthread";
 }
@@ -34,8 +34,9 @@ VideoThread::~VideoThread()
 //******************************************************************************
 #pragma mark - public
 boost::shared_ptr<VideoFramePacket>
-VideoThread::encode(const WebRtcVideoFrame &frame)
+VideoThread::encode(const WebRtcVideoFrame &frame, int64_t captureTimestampMs)
 {
+    captureTimestampMs_ = captureTimestampMs;
     coder_.onRawFrame(frame);
     // result should be delivered using onEncodedFrame or onDroppedFrame
     // callbacks which prepare videoFramePacket_ accordingly
@@ -58,7 +59,16 @@ void VideoThread::onEncodingStarted()
 void VideoThread::onEncodedFrame(const webrtc::EncodedImage &encodedImage)
 {
     nEncoded_++;
-    videoFramePacket_ = boost::make_shared<VideoFramePacket>(encodedImage);
+
+    if (captureTimestampMs_ < 0)
+        videoFramePacket_ = boost::make_shared<VideoFramePacket>(encodedImage);
+    else
+    {
+        // image shares encoder's buffer, only the header fields are copied
+        webrtc::EncodedImage image(encodedImage);
+        image.capture_time_ms_ = captureTimestampMs_;
+        videoFramePacket_ = boost::make_shared<VideoFramePacket>(image);
+    }
 }
 
 void VideoThread::onDroppedFrame()
@@ -25,10 +25,13 @@ class VideoThread : public NdnRtcComponent,
                     public IEncoderDelegate
 {
   public:
-    VideoThread(const VideoCoderParams &coderParams);
+    VideoThread(const VideoCoderParams &coderParams, unsigned int nCores = 0);
     ~VideoThread();
 
-    boost::shared_ptr<VideoFramePacketT<Mutable>> encode(const WebRtcVideoFrame &frame);
+    // captureTimestampMs, if given, is written into encoded frame's header
+    // (otherwise, it carries whatever capture time encoder has set)
+    boost::shared_ptr<VideoFramePacketT<Mutable>> encode(const WebRtcVideoFrame &frame,
+                                                         int64_t captureTimestampMs = -1);
 
     void
         setLogger(boost::shared_ptr<ndnlog::new_api::Logger>);
@@ -45,10 +48,23 @@ class VideoThread : public NdnRtcComponent,
     const VideoCoder &
     getCoder() const { return coder_; }
 
+    void
+    setCoreNum(unsigned int nCores) { coder_.setCoreNum(nCores); }
+
+    void
+    requestKeyFrame() { coder_.requestKeyFrame(); }
+
+    void
+    setRate(unsigned int bitrateKbps, double frameRate) { coder_.setRate(bitrateKbps, frameRate); }
+
+    void
+    setResolution(unsigned int width, unsigned int height) { coder_.setResolution(width, height); }
+
   private:
     VideoThread(const VideoThread &) = delete;
     VideoCoder coder_;
     unsigned int nEncoded_, nDropped_;
+    int64_t captureTimestampMs_;
 
 #warning using shared pointer here as libstdc++ on OSX does not support std::move
     // TODO: update code to use std::move on Ubuntu
@@ -15,8 +15,10 @@
 class MockExternalRenderer : public ndnrtc::IExternalRenderer
 {
 public:
-	MOCK_METHOD2(getFrameBuffer, uint8_t*(int,int));
-	MOCK_METHOD4(renderBGRAFrame, void(const ndnrtc::FrameInfo& frameInfo,int,int,const uint8_t*));
+	MOCK_METHOD3(getFrameBuffer, uint8_t*(int,int,BufferType*));
+	MOCK_METHOD4(renderFrame, void(const ndnrtc::FrameInfo& frameInfo,int,int,const uint8_t*));
+	MOCK_METHOD5(renderI420Frame, void(const ndnrtc::FrameInfo& frameInfo,int,int,
+		const uint8_t* const[3],const int[3]));
 };
 
 #endif
@@ -17,6 +17,7 @@ class MockNdnKeyChain
 {
 public:
 	MOCK_METHOD1(sign, void(ndn::Data&));
+	MOCK_METHOD1(signWithSha256, void(ndn::Data&));
 	MOCK_METHOD3(verifyData, void(const boost::shared_ptr<ndn::Data>& data, 
 		const ndn::OnVerified& onVerified, const ndn::OnDataValidationFailed& onVerifyFailed));
 
@@ -40,6 +41,8 @@ public:
 	MOCK_METHOD2(setInterestFilter, void(const ndn::Name&, const ndn::OnInterestCallback&));
 	MOCK_METHOD2(getPendingInterestsForName, void(const ndn::Name&, std::vector<boost::shared_ptr<const ndn::MemoryContentCache::PendingInterest> >&));
 	MOCK_METHOD2(getPendingInterestsWithPrefix, void(const ndn::Name&, std::vector<boost::shared_ptr<const ndn::MemoryContentCache::PendingInterest> >&));
+	MOCK_METHOD2(extractPendingInterestsBefore, void(const ndn::Name&, std::vector<boost::shared_ptr<const ndn::MemoryContentCache::PendingInterest> >&));
+	MOCK_METHOD2(putData, void(const std::vector<boost::shared_ptr<const ndn::MemoryContentCache::PendingInterest> >&, const std::vector<boost::shared_ptr<const ndn::Data> >&));
 	MOCK_METHOD1(add, void(const ndn::Data&));
 	MOCK_METHOD0(getStorePendingInterest, const ndn::OnInterestCallback&());
 
@@ -264,9 +264,9 @@ TEST(TestConsumerClientParams, TestOutput)
               "synced to: mic; seg size: 1000 bytes; freshness (ms): metadata 10 sample 15 sample (key) 900; "
               "capture device id: 11; 2 threads:\n"
               "[0: name: low; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n"
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n"
               "[1: name: hi; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n]\n",
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n]\n",
               ss.str());
 }
 
@@ -356,9 +356,9 @@ TEST(TestConsumerClientParams, TestCopy)
               "synced to: mic; seg size: 1000 bytes; freshness (ms): metadata 10 sample 15 sample (key) 900; "
               "capture device id: 11; 2 threads:\n"
               "[0: name: low; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n"
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n"
               "[1: name: hi; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n]\n",
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n]\n",
               ss.str());
 }
 
@@ -532,9 +532,9 @@ TEST(TestClientParams, TestOutput)
               "synced to: mic; seg size: 1000 bytes; freshness (ms): metadata 10 sample 15 sample (key) 900; "
               "capture device id: 11; 2 threads:\n"
               "[0: name: low; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n"
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n"
               "[1: name: hi; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n]\n"
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n]\n"
               "-producing:\nprefix: /ndn/edu/ucla/remap;\n"
               "--0:\n"
               "stream source: ; session prefix: /ndn/edu/ucla/remap/ndnrtc/user/client1; name: mic (audio); "
@@ -546,9 +546,9 @@ TEST(TestClientParams, TestOutput)
               "synced to: mic; seg size: 1000 bytes; freshness (ms): metadata 10 sample 15 sample (key) 900; "
               "capture device id: 11; 2 threads:\n"
               "[0: name: low; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n"
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n"
               "[1: name: hi; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n",
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n",
               ss.str());
 }
 
@@ -250,16 +250,16 @@ TEST(TestConfigLoad, LoadAndOutput)
 		"stream source: camera.argb; session prefix: ; name: camera (video); "
 		"synced to: sound; seg size: 1000 bytes; freshness: 2000 ms; no device; 2 threads:\n"
 		"[0: name: low; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-		"Max bitrate: 10000 Kbit/s; 720x405; Drop: YES]\n"
+		"Max bitrate: 10000 Kbit/s; 720x405; Drop: YES; Codec: vp9]\n"
 		"[1: name: hi; 30FPS; GOP: 30; Start bitrate: 3000 Kbit/s; "
-		"Max bitrate: 10000 Kbit/s; 1920x1080; Drop: YES]\n"
+		"Max bitrate: 10000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n"
 		"--1:\n"
 		"stream source: desktop.argb; session prefix: ; name: desktop (video); "
 		"synced to: sound; seg size: 1000 bytes; freshness: 2000 ms; no device; 2 threads:\n"
 		"[0: name: mid; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-		"Max bitrate: 10000 Kbit/s; 1080x720; Drop: YES]\n"
+		"Max bitrate: 10000 Kbit/s; 1080x720; Drop: YES; Codec: vp9]\n"
 		"[1: name: low; 30FPS; GOP: 30; Start bitrate: 300 Kbit/s; "
-		"Max bitrate: 10000 Kbit/s; 352x288; Drop: YES]\n"
+		"Max bitrate: 10000 Kbit/s; 352x288; Drop: YES; Codec: vp9]\n"
 		"--2:\n"
 		"stream source: ; session prefix: ; name: sound (audio); "
 		"synced to: ; seg size: 1000 bytes; freshness: 2000 ms; "
@@ -331,7 +331,7 @@ TEST(TestConfigLoad, TestSampleProducerParams)
 		"--0:\n"
 		"stream source: ../tests/test-source-320x240.argb; session prefix: ; "
 		"name: camera (video); synced to: sound; seg size: 1000 bytes; freshness: 2000 ms; no device; 1 threads:\n"
-		"[0: name: tiny; 30FPS; GOP: 30; Start bitrate: 100 Kbit/s; Max bitrate: 10000 Kbit/s; 320x240; Drop: YES]\n"
+		"[0: name: tiny; 30FPS; GOP: 30; Start bitrate: 100 Kbit/s; Max bitrate: 10000 Kbit/s; 320x240; Drop: YES; Codec: vp9]\n"
 		"--1:\n"
 		"stream source: ; session prefix: ; name: sound (audio); synced to: ;"
 		" seg size: 1000 bytes; freshness: 2000 ms; capture device id: 0; 1 threads:\n"
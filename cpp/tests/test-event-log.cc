@@ -0,0 +1,163 @@
+//
+// test-event-log.cc
+//
+//  Created by Peter Gusev on 1 April 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <boost/thread.hpp>
+
+#include "gtest/gtest.h"
+#include "event-log.hpp"
+
+using namespace ndnrtc::eventlog;
+
+static const std::string LogPath = "/tmp/test-event-log.bin";
+
+TEST(TestEventLog, TestInactive)
+{
+    EXPECT_FALSE(EventLog::get());
+    // no-op
+    write(Component::Buffer, Event::SlotReady, nullptr, 1, 2, 3);
+}
+
+TEST(TestEventLog, TestWriteRead)
+{
+    EventLog::start(LogPath, 1000);
+    ASSERT_TRUE(EventLog::get());
+
+    int obj;
+    for (int i = 0; i < 100; ++i)
+        write(Component::SegmentController, Event::SegmentArrived, &obj, 0, i, i % 5, 0, 1000 + i);
+    write(Component::PipelineControl, Event::StateTransition, &obj, 1, 2, 0, 150);
+
+    EXPECT_EQ(101, EventLog::get()->getWrittenNum());
+    // active log can't be replaced while it may be written to
+    EXPECT_THROW(EventLog::start(LogPath + ".other"), std::runtime_error);
+    EXPECT_EQ(LogPath, EventLog::get()->getPath());
+    EventLog::stop();
+    EXPECT_FALSE(EventLog::get());
+
+    EventLogHeader header;
+    std::vector<EventRecord> records;
+    EventLog::read(LogPath, header, records);
+
+    EXPECT_EQ(1024, header.capacity_);
+    EXPECT_EQ(101, header.writePos_);
+    ASSERT_EQ(101, records.size());
+
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(i + 1, records[i].seqNo_);
+        EXPECT_EQ((uint16_t)Component::SegmentController, records[i].component_);
+        EXPECT_EQ((uint16_t)Event::SegmentArrived, records[i].event_);
+        EXPECT_EQ((uint32_t)(uintptr_t)&obj, records[i].instance_);
+        EXPECT_EQ(i, records[i].args_[1]);
+        EXPECT_EQ(1000 + i, records[i].args_[4]);
+        if (i)
+        {
+            EXPECT_LE(records[i - 1].timestampUs_, records[i].timestampUs_);
+        }
+    }
+
+    EXPECT_EQ((uint16_t)Event::StateTransition, records.back().event_);
+    EXPECT_EQ(150, records.back().args_[3]);
+    EXPECT_STREQ("state-transition", EventLog::toString((Event)records.back().event_));
+
+    remove(LogPath.c_str());
+}
+
+TEST(TestEventLog, TestWrapAround)
+{
+    EventLog::start(LogPath, 64);
+
+    for (int i = 0; i < 200; ++i)
+        write(Component::Pipeliner, Event::SampleRequested, nullptr, 0, i);
+    EventLog::stop();
+
+    EventLogHeader header;
+    std::vector<EventRecord> records;
+    EventLog::read(LogPath, header, records);
+
+    // only last 64 records are kept
+    ASSERT_EQ(64, records.size());
+    for (int i = 0; i < 64; ++i)
+    {
+        EXPECT_EQ(137 + i, records[i].seqNo_);
+        EXPECT_EQ(136 + i, records[i].args_[1]);
+    }
+
+    remove(LogPath.c_str());
+}
+
+TEST(TestEventLog, TestMultipleThreads)
+{
+    int nThreads = 4, nEvents = 10000;
+    std::vector<boost::thread> threads;
+
+    EventLog::start(LogPath, nThreads * nEvents);
+
+    for (int t = 0; t < nThreads; ++t)
+        threads.push_back(boost::thread([t, nEvents]() {
+            for (int i = 0; i < nEvents; ++i)
+                write(Component::Buffer, Event::SlotAssembling, nullptr, t, i);
+        }));
+
+    for (auto &t : threads)
+        t.join();
+    EventLog::stop();
+
+    EventLogHeader header;
+    std::vector<EventRecord> records;
+    EventLog::read(LogPath, header, records);
+    ASSERT_EQ(nThreads * nEvents, records.size());
+
+    // events of each thread are in order
+    std::vector<int64_t> last(nThreads, -1);
+    for (auto &r : records)
+    {
+        EXPECT_EQ(last[r.args_[0]] + 1, r.args_[1]);
+        last[r.args_[0]] = r.args_[1];
+    }
+
+    remove(LogPath.c_str());
+}
+
+TEST(TestEventLog, TestBadFile)
+{
+    FILE *f = fopen(LogPath.c_str(), "w");
+    fprintf(f, "not an event log");
+    fclose(f);
+
+    EventLogHeader header;
+    std::vector<EventRecord> records;
+    EXPECT_THROW(EventLog::read(LogPath, header, records), std::runtime_error);
+    EXPECT_THROW(EventLog::read("/tmp/no-such-event-log.bin", header, records), std::runtime_error);
+    EXPECT_THROW(EventLog::start("/no-such-dir/event-log.bin"), std::runtime_error);
+    EXPECT_FALSE(EventLog::get());
+
+    // header claims more records than the file holds
+    EventLog::start(LogPath, 64);
+    EventLog::stop();
+    ASSERT_EQ(0, truncate(LogPath.c_str(), sizeof(EventLogHeader) + 63 * sizeof(EventRecord)));
+    EXPECT_THROW(EventLog::read(LogPath, header, records), std::runtime_error);
+
+    f = fopen(LogPath.c_str(), "r+");
+    uint64_t capacity = 0xffffffffffffffull;
+    fseek(f, offsetof(EventLogHeader, capacity_), SEEK_SET);
+    fwrite(&capacity, sizeof(capacity), 1, f);
+    fclose(f);
+    EXPECT_THROW(EventLog::read(LogPath, header, records), std::runtime_error);
+
+    remove(LogPath.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -6,6 +6,8 @@
 //
 
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "frame-converter.hpp"
@@ -36,12 +38,158 @@ TEST(TestFrameConverter, TestI420Frame)
 	uint8_t *vbuf = (uint8_t*)malloc(kSizeUv);
 
 	RawFrameConverter conv;
-	WebRtcVideoFrame frame = conv << I420RawFrameWrapper({w,h,strideY, strideUV, strideUV, ybuf, ubuf, vbuf});
+	WebRtcVideoFrame frame = conv << I420RawFrameWrapper({w,h,strideY, strideUV, strideUV, ybuf, ubuf, vbuf,
+		boost::function<void()>()});
 	
 	EXPECT_EQ(w, frame.width());
 	EXPECT_EQ(h, frame.height());
 }
 
+TEST(TestFrameConverter, TestBufferPool)
+{
+	unsigned int w = 640, h = 480, size = w*h*4;
+	uint8_t* data = (uint8_t*)malloc(size);
+	RawFrameConverter conv;
+
+	{
+		WebRtcVideoFrame frame1 = conv << ArgbRawFrameWrapper({w,h,data,size});
+		WebRtcVideoFrame frame2 = conv << ArgbRawFrameWrapper({w,h,data,size});
+
+		// frame1 is still alive, thus buffers must differ
+		EXPECT_NE(frame1.video_frame_buffer().get(), frame2.video_frame_buffer().get());
+		EXPECT_EQ(2, conv.getPool().getBuffersNum());
+	}
+
+	// released buffers are reused
+	for (int i = 0; i < 10; ++i)
+		WebRtcVideoFrame frame = conv << ArgbRawFrameWrapper({w,h,data,size});
+	EXPECT_EQ(2, conv.getPool().getBuffersNum());
+
+	// new geometry releases free buffers
+	WebRtcVideoFrame frame = conv << ArgbRawFrameWrapper({w/2,h/2,data,size/4});
+	EXPECT_EQ(w/2, frame.width());
+	EXPECT_EQ(1, conv.getPool().getBuffersNum());
+
+	free(data);
+}
+
+TEST(TestFrameConverter, TestBufferPoolCapacity)
+{
+	FrameBufferPool pool(2);
+	std::vector<WebRtcSmartPtr<WebRtcVideoFrameBuffer>> buffers;
+
+	for (int i = 0; i < 4; ++i)
+		buffers.push_back(pool.getBuffer(320, 240));
+
+	EXPECT_EQ(2, pool.getBuffersNum());
+	buffers.clear();
+
+	WebRtcSmartPtr<WebRtcVideoFrameBuffer> b = pool.getBuffer(320, 240);
+	EXPECT_EQ(320, b->width());
+	EXPECT_EQ(160, b->StrideU());
+	EXPECT_EQ(2, pool.getBuffersNum());
+}
+
+TEST(TestFrameConverter, TestI420FrameZeroCopy)
+{
+	unsigned int w = 16, h = 16, strideY = 16, strideUV = 8;
+	uint8_t ybuf[256], ubuf[64], vbuf[64];
+	bool released = false;
+	RawFrameConverter conv;
+
+	{
+		WebRtcVideoFrame frame = conv << I420RawFrameWrapper({w,h,strideY, strideUV, strideUV, 
+			ybuf, ubuf, vbuf, [&released](){ released = true; }});
+		
+		EXPECT_EQ(w, frame.width());
+		EXPECT_EQ(h, frame.height());
+		EXPECT_EQ(ybuf, frame.video_frame_buffer()->DataY());
+		EXPECT_EQ(ubuf, frame.video_frame_buffer()->DataU());
+		EXPECT_EQ(vbuf, frame.video_frame_buffer()->DataV());
+
+		WebRtcVideoFrame copy(frame);
+		EXPECT_FALSE(released);
+	}
+
+	EXPECT_TRUE(released);
+	EXPECT_EQ(0, conv.getPool().getBuffersNum());
+}
+
+TEST(TestFrameConverter, TestCanFuseDownscale)
+{
+	EXPECT_TRUE(RawFrameConverter::canFuseDownscale(1280, 720, 640, 360));
+	EXPECT_TRUE(RawFrameConverter::canFuseDownscale(1920, 1080, 640, 360));
+	EXPECT_TRUE(RawFrameConverter::canFuseDownscale(3840, 2160, 960, 540));
+	EXPECT_FALSE(RawFrameConverter::canFuseDownscale(1280, 720, 1280, 720));
+	EXPECT_FALSE(RawFrameConverter::canFuseDownscale(1280, 720, 854, 480));
+	EXPECT_FALSE(RawFrameConverter::canFuseDownscale(1280, 720, 640, 480));
+	EXPECT_FALSE(RawFrameConverter::canFuseDownscale(1920, 1080, 480, 360));
+	EXPECT_FALSE(RawFrameConverter::canFuseDownscale(640, 480, 0, 0));
+}
+
+TEST(TestFrameConverter, TestArgbFrameConvertAndDownscale)
+{
+	unsigned int w = 640, h = 480, size = w*h*4;
+	uint8_t* data = (uint8_t*)malloc(size);
+
+	for (unsigned int i = 0; i < size; ++i)
+		data[i] = (uint8_t)((i/4)%w + (i%4)*32 + (i/(4*w)));
+
+	RawFrameConverter conv;
+	WebRtcVideoFrame frame = conv << ArgbRawFrameWrapper({w,h,data,size,true});
+	RawFrameConverter::FramePair frames = 
+		conv.convertAndDownscale(ArgbRawFrameWrapper({w,h,data,size,true}), w/2, h/2);
+
+	EXPECT_EQ(w, frames.first.width());
+	EXPECT_EQ(h, frames.first.height());
+	EXPECT_EQ(w/2, frames.second.width());
+	EXPECT_EQ(h/2, frames.second.height());
+	EXPECT_EQ(1, conv.getDownscalePool().getBuffersNum());
+
+	// full resolution frame is the same as converted one
+	for (unsigned int y = 0; y < h; ++y)
+		EXPECT_EQ(0, memcmp(frame.video_frame_buffer()->DataY() + y*frame.video_frame_buffer()->StrideY(),
+			frames.first.video_frame_buffer()->DataY() + y*frames.first.video_frame_buffer()->StrideY(), w));
+
+	// downscaled pixels are averages of 2x2 full resolution blocks
+	const uint8_t *fullY = frames.first.video_frame_buffer()->DataY();
+	const uint8_t *scaledY = frames.second.video_frame_buffer()->DataY();
+	int fullStride = frames.first.video_frame_buffer()->StrideY();
+	int scaledStride = frames.second.video_frame_buffer()->StrideY();
+	for (unsigned int y = 0; y < h/2; ++y)
+		for (unsigned int x = 0; x < w/2; ++x)
+		{
+			int avg = (fullY[2*y*fullStride + 2*x] + fullY[2*y*fullStride + 2*x + 1] +
+				fullY[(2*y+1)*fullStride + 2*x] + fullY[(2*y+1)*fullStride + 2*x + 1] + 2)/4;
+			EXPECT_NEAR(avg, scaledY[y*scaledStride + x], 1);
+		}
+
+	// resolutions that can not be fused are scaled separately
+	frames = conv.convertAndDownscale(ArgbRawFrameWrapper({w,h,data,size,true}), 320, 180);
+	EXPECT_EQ(w, frames.first.width());
+	EXPECT_EQ(320, frames.second.width());
+	EXPECT_EQ(180, frames.second.height());
+
+	free(data);
+}
+
+TEST(TestFrameConverter, TestNV21FrameConvertAndDownscale)
+{
+	unsigned int w = 1280, h = 720;
+	std::vector<uint8_t> y(w*h, 128), uv(w*h/2, 64);
+
+	RawFrameConverter conv;
+	RawFrameConverter::FramePair frames = 
+		conv.convertAndDownscale(YUV_NV21FrameWrapper({w,h,w,w,y.data(),uv.data()}), w/4, h/4);
+
+	EXPECT_EQ(w, frames.first.width());
+	EXPECT_EQ(w/4, frames.second.width());
+	EXPECT_EQ(h/4, frames.second.height());
+	EXPECT_EQ(128, frames.second.video_frame_buffer()->DataY()[0]);
+	EXPECT_EQ(64, frames.second.video_frame_buffer()->DataU()[0]);
+	EXPECT_EQ(64, frames.second.video_frame_buffer()->DataV()[0]);
+}
+
 int main(int argc, char **argv) {
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
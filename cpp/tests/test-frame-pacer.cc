@@ -0,0 +1,173 @@
+//
+// test-frame-pacer.cc
+//
+//  Created by Peter Gusev on 26 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include <stdlib.h>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#include "gtest/gtest.h"
+#include "tests-helpers.hpp"
+#include "src/frame-pacer.hpp"
+
+using namespace ndnrtc;
+
+class PacerIo
+{
+  public:
+    PacerIo() : work_(new boost::asio::io_service::work(io_)),
+                t_([this]() { io_.run(); }) {}
+    ~PacerIo()
+    {
+        work_.reset();
+        io_.stop();
+        t_.join();
+    }
+
+    boost::asio::io_service io_;
+    boost::shared_ptr<boost::asio::io_service::work> work_;
+    boost::thread t_;
+};
+
+TEST(TestFramePacer, TestDropBurst)
+{
+    PacerIo pio;
+    WebRtcVideoFrame frame(getFrame(320, 240));
+    int nReleased = 0;
+    FramePacer pacer(pio.io_, 10, [&nReleased](const WebRtcVideoFrame &, const WebRtcVideoFrame *d, int64_t) {
+        EXPECT_FALSE(d);
+        nReleased++;
+    }, 0);
+
+    EXPECT_TRUE(pacer.push(frame));
+    for (int i = 0; i < 9; ++i)
+        EXPECT_FALSE(pacer.push(frame));
+
+    pacer.start();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(250));
+    pacer.stop();
+
+    EXPECT_EQ(1, nReleased);
+    EXPECT_EQ(1, pacer.getReleasedNum());
+    EXPECT_EQ(9, pacer.getDroppedNum());
+    EXPECT_EQ(0, pacer.getDuplicatedNum());
+}
+
+TEST(TestFramePacer, TestDuplicate)
+{
+    PacerIo pio;
+    WebRtcVideoFrame frame(getFrame(320, 240));
+    WebRtcVideoFrame downscaled(getFrame(160, 120));
+    int nReleased = 0;
+    FramePacer pacer(pio.io_, 20, [&nReleased](const WebRtcVideoFrame &f, const WebRtcVideoFrame *d, int64_t) {
+        EXPECT_EQ(320, f.width());
+        ASSERT_TRUE(d);
+        EXPECT_EQ(160, d->width());
+        nReleased++;
+    }, 2);
+
+    pacer.start();
+    pacer.push(frame, &downscaled);
+    // 1 frame and 2 duplicates, then pacer waits for new frames
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(300));
+    pacer.stop();
+
+    EXPECT_EQ(3, nReleased);
+    EXPECT_EQ(2, pacer.getDuplicatedNum());
+    EXPECT_EQ(0, pacer.getDroppedNum());
+}
+
+TEST(TestFramePacer, TestCadence)
+{
+    PacerIo pio;
+    WebRtcVideoFrame frame(getFrame(320, 240));
+    boost::mutex mutex;
+    std::vector<int64_t> timestamps;
+    double rate = 25;
+    FramePacer pacer(pio.io_, rate, [&](const WebRtcVideoFrame &, const WebRtcVideoFrame *, int64_t ts) {
+        boost::lock_guard<boost::mutex> scopedLock(mutex);
+        timestamps.push_back(ts);
+    });
+
+    pacer.start();
+    // bursty source: 4 frames at once every 80ms, ~50fps on average
+    for (int i = 0; i < 25; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+            pacer.push(frame);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(80));
+    }
+    pacer.stop();
+
+    boost::lock_guard<boost::mutex> scopedLock(mutex);
+    EXPECT_NEAR(2000 / (1000. / rate), timestamps.size(), 3);
+    EXPECT_LT(0, pacer.getDroppedNum());
+
+    for (int i = 1; i < timestamps.size(); ++i)
+        EXPECT_NEAR(1000. / rate, timestamps[i] - timestamps[i - 1], 1);
+}
+
+TEST(TestFramePacer, TestSetRate)
+{
+    PacerIo pio;
+    WebRtcVideoFrame frame(getFrame(320, 240));
+    int nReleased = 0;
+    FramePacer pacer(pio.io_, 10, [&nReleased](const WebRtcVideoFrame &, const WebRtcVideoFrame *, int64_t) {
+        nReleased++;
+    }, 100);
+
+    EXPECT_ANY_THROW(FramePacer p(pio.io_, 0, FramePacer::OnFrame()));
+
+    pacer.push(frame);
+    pacer.start();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
+    int nSlow = nReleased;
+
+    pacer.setRate(50);
+    EXPECT_EQ(50, pacer.getRate());
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
+    pacer.stop();
+
+    EXPECT_NEAR(5, nSlow, 1);
+    EXPECT_NEAR(25, nReleased - nSlow, 3);
+}
+
+TEST(TestFramePacer, TestStopWaitsForCallback)
+{
+    PacerIo pio;
+    WebRtcVideoFrame frame(getFrame(320, 240));
+    boost::atomic<bool> isInCallback(false);
+    boost::atomic<int> nReleased(0);
+    FramePacer pacer(pio.io_, 100, [&](const WebRtcVideoFrame &, const WebRtcVideoFrame *, int64_t) {
+        isInCallback = true;
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+        nReleased++;
+        isInCallback = false;
+    }, 100);
+
+    pacer.push(frame);
+    pacer.start();
+    while (!isInCallback)
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+
+    // stop is called while callback is running
+    pacer.stop();
+    EXPECT_FALSE(isInCallback);
+    int n = nReleased;
+
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+    EXPECT_EQ(n, nReleased);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -517,6 +517,90 @@ TEST(TestVideoStream, TestRemoveThreadWhilePublishing)
     }
     t.join();
 }
+
+TEST(TestVideoStream, TestPublishQueuePolicy)
+{
+#ifdef ENABLE_LOGGING
+    ndnlog::new_api::Logger::initAsyncLogging();
+    ndnlog::new_api::Logger::getLogger("").setLogLevel(ndnlog::NdnLoggerDetailLevelAll);
+#endif
+
+    int width = 1280, height = 720, nFrames = 30;
+    int frameSize = width * height * 4 * sizeof(uint8_t);
+    uint8_t *frameBuffer = (uint8_t *)malloc(frameSize);
+    for (int i = 0; i < frameSize; ++i)
+        frameBuffer[i] = std::rand() % 256; // random noise
+
+    ndn::Face face("aleph.ndn.ucla.edu");
+    std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
+    shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
+
+    std::vector<PublishQueuePolicy> policies({PublishQueuePolicy::DropOldestDelta,
+                                              PublishQueuePolicy::NeverDropKey,
+                                              PublishQueuePolicy::Coalesce});
+    for (auto policy : policies)
+    {
+        // face thread is not running at first, thus encoded frames pile up
+        // in the publish queue
+        boost::asio::io_service io;
+        boost::shared_ptr<boost::asio::io_service::work> work(boost::make_shared<boost::asio::io_service::work>(io));
+        int nRejected = 0;
+
+        MediaStreamSettings settings(io, getSampleVideoParams());
+        settings.face_ = &face;
+        settings.keyChain_ = keyChain.get();
+        settings.publishQueueSize_ = 2;
+        settings.publishQueuePolicy_ = policy;
+        LocalVideoStream s(appPrefix, settings);
+
+#ifdef ENABLE_LOGGING
+        s.setLogger(ndnlog::new_api::Logger::getLoggerPtr(""));
+#endif
+
+        for (int i = 0; i < nFrames; ++i)
+        {
+            if (s.incomingArgbFrame(width, height, frameBuffer, frameSize) < 0)
+                nRejected++;
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(30));
+        }
+
+        statistics::StatisticsStorage stat = s.getStatistics();
+        double nEncoded = stat[statistics::Indicator::EncodedNum];
+        if (policy == PublishQueuePolicy::Coalesce)
+        {
+            // nothing is dropped from the queue, captured frames are held
+            // instead and all but the latest one are superseded
+            EXPECT_LT(0, nRejected);
+            EXPECT_EQ(0, stat[statistics::Indicator::PublishDroppedNum]);
+            EXPECT_LT(0, stat[statistics::Indicator::DroppedNum]);
+        }
+        else
+        {
+            EXPECT_EQ(0, nRejected);
+            EXPECT_LT(0, stat[statistics::Indicator::PublishDroppedNum]);
+        }
+        if (policy == PublishQueuePolicy::DropOldestDelta)
+            EXPECT_GE(2, stat[statistics::Indicator::PublishQueueSize]);
+
+        boost::thread t([&io]() {
+            io.run();
+        });
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
+
+        stat = s.getStatistics();
+        EXPECT_EQ(0, stat[statistics::Indicator::PublishQueueSize]);
+        EXPECT_LT(0, stat[statistics::Indicator::PublishedNum]);
+        EXPECT_LE(0, stat[statistics::Indicator::PublishLag]);
+        if (policy == PublishQueuePolicy::Coalesce)
+            // held frame was encoded once queue had room
+            EXPECT_LT(nEncoded, stat[statistics::Indicator::EncodedNum]);
+
+        work.reset();
+        t.join();
+    }
+
+    free(frameBuffer);
+}
 #endif
 
 #if 1
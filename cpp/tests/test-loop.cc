@@ -252,7 +252,7 @@ TEST(TestLoop, TestVideo)
       rs.setLogger(ndnlog::new_api::Logger::getLoggerPtr(remoteStreamLoggerPath));
 #endif
       
-      EXPECT_CALL(renderer, getFrameBuffer(320,240))
+      EXPECT_CALL(renderer, getFrameBuffer(320,240,_))
         .Times(AtLeast(1))
         .WillRepeatedly(Return(frame->getBuffer().get()));
       
@@ -271,7 +271,7 @@ TEST(TestLoop, TestVideo)
           frameSink << *frame;
 #endif
         };
-      EXPECT_CALL(renderer, renderBGRAFrame(_,_,_,_))
+      EXPECT_CALL(renderer, renderFrame(_,_,_,_))
         .Times(AtLeast(1))
         .WillRepeatedly(Invoke(renderFrame));
 
@@ -10,12 +10,14 @@
 #include <boost/asio.hpp>
 #include <boost/chrono.hpp>
 #include <stdlib.h>
+#include <numeric>
 #include <ndn-cpp/data.hpp>
 #include "gtest/gtest.h"
 
 #include "tests-helpers.hpp"
 #include "frame-data.hpp"
 #include "src/video-thread.hpp"
+#include "src/encoder-worker.hpp"
 #include "src/audio-thread.hpp"
 #include "mock-objects/audio-thread-callback-mock.hpp"
 
@@ -198,6 +200,247 @@ TEST(TestVideoThread, TestEncodeMultipleThreads)
 			seqCounters[i].first, seqCounters[i].second);
 	}
 }
+
+TEST(TestVideoThread, TestEncoderWorkers)
+{
+	int nFrames = 90;
+	int width = 1280, height = 720;
+	std::vector<WebRtcVideoFrame> frames = getFrameSequence(width, height, nFrames);
+
+	std::vector<VideoCoderParams> coderParams;
+	for (int scale = 1; scale <= 4; scale *= 2)
+	{
+		VideoCoderParams vcp(sampleVideoCoderParams());
+		vcp.startBitrate_ = 3000/scale;
+		vcp.maxBitrate_ = 3000/scale;
+		vcp.encodeWidth_ = width/scale;
+		vcp.encodeHeight_ = height/scale;
+		coderParams.push_back(vcp);
+	}
+
+	boost::mutex m;
+	std::vector<int> nEncoded(coderParams.size(), 0), nDropped(coderParams.size(), 0);
+	std::vector<PacketNumber> lastPlaybackNo(coderParams.size(), -1);
+	std::vector<boost::shared_ptr<EncoderWorker>> workers;
+	for (int k = 0; k < coderParams.size(); ++k)
+		workers.push_back(boost::make_shared<EncoderWorker>(coderParams[k],
+			[k, &m, &nEncoded, &nDropped, &lastPlaybackNo, &coderParams]
+			(const EncoderWorker::Job& job, const boost::shared_ptr<VideoFramePacket>& vf){
+				boost::lock_guard<boost::mutex> lock(m);
+
+				if (vf.get())
+				{
+					// encoded frames are delivered in capture order
+					EXPECT_LT(lastPlaybackNo[k], job.playbackNo_);
+					lastPlaybackNo[k] = job.playbackNo_;
+					EXPECT_EQ(coderParams[k].encodeWidth_, vf->getFrame()._encodedWidth);
+					EXPECT_EQ(coderParams[k].encodeHeight_, vf->getFrame()._encodedHeight);
+					nEncoded[k]++;
+				}
+				else
+					nDropped[k]++;
+			}));
+
+	boost::asio::io_service io;
+	boost::asio::deadline_timer runTimer(io);
+	int nQueueDrops = 0;
+
+	for (int i = 0; i < nFrames; ++i)
+	{
+		runTimer.expires_from_now(boost::posix_time::milliseconds(30));
+		for (auto w:workers)
+			if (!w->enqueue(frames[i], i, 0))
+				nQueueDrops++;
+		runTimer.wait();
+	}
+
+	// wait for queues to drain
+	boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
+	for (auto w:workers)
+	{
+		EXPECT_EQ(0, w->getQueueSize());
+		w->stop();
+		EXPECT_FALSE(w->enqueue(frames[0], nFrames, 0));
+	}
+
+	for (int k = 0; k < workers.size(); ++k)
+	{
+		EXPECT_LT(0, nEncoded[k]);
+		// frames dropped from full queues are reported as dropped too
+		EXPECT_EQ(nFrames, nEncoded[k] + nDropped[k]);
+		GT_PRINTF("worker %d (%dx%d): %d encoded, %d dropped\n",
+			k, coderParams[k].encodeWidth_, coderParams[k].encodeHeight_,
+			nEncoded[k], nDropped[k]);
+	}
+	GT_PRINTF("%d frames dropped due to full queues\n", nQueueDrops);
+}
+
+TEST(TestVideoThread, TestEncoderWorkersCascade)
+{
+	int nFrames = 90;
+	int width = 1280, height = 720;
+	std::vector<WebRtcVideoFrame> frames = getFrameSequence(width, height, nFrames);
+
+	boost::mutex m;
+	std::vector<VideoCoderParams> coderParams;
+	std::vector<int> nEncoded, nDropped;
+	std::vector<boost::shared_ptr<EncoderWorker>> workers;
+
+	for (int scale = 1; scale <= 4; scale *= 2)
+	{
+		VideoCoderParams vcp(sampleVideoCoderParams());
+		vcp.startBitrate_ = 3000/scale;
+		vcp.maxBitrate_ = 3000/scale;
+		vcp.encodeWidth_ = width/scale;
+		vcp.encodeHeight_ = height/scale;
+		coderParams.push_back(vcp);
+		nEncoded.push_back(0);
+		nDropped.push_back(0);
+	}
+
+	for (int k = 0; k < coderParams.size(); ++k)
+		workers.push_back(boost::make_shared<EncoderWorker>(coderParams[k],
+			[k, &m, &nEncoded, &nDropped, &coderParams]
+			(const EncoderWorker::Job& job, const boost::shared_ptr<VideoFramePacket>& vf){
+				boost::lock_guard<boost::mutex> lock(m);
+				if (vf.get())
+				{
+					EXPECT_EQ(coderParams[k].encodeWidth_, vf->getFrame()._encodedWidth);
+					EXPECT_EQ(coderParams[k].encodeHeight_, vf->getFrame()._encodedHeight);
+					nEncoded[k]++;
+				}
+				else
+					nDropped[k]++;
+			}));
+
+	// 1280x720 -> 640x360 -> 320x180
+	workers[0]->setChildren({ workers[1] });
+	workers[1]->setChildren({ workers[2] });
+
+	boost::asio::io_service io;
+	boost::asio::deadline_timer runTimer(io);
+
+	for (int i = 0; i < nFrames; ++i)
+	{
+		runTimer.expires_from_now(boost::posix_time::milliseconds(30));
+		workers[0]->enqueue(frames[i], i, 0);
+		runTimer.wait();
+	}
+
+	boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
+	for (auto w:workers)
+		w->stop();
+
+	// children receive only frames that were not dropped from parent's queue
+	EXPECT_EQ(nFrames, nEncoded[0] + nDropped[0]);
+	for (int k = 0; k < workers.size(); ++k)
+	{
+		EXPECT_LT(0, nEncoded[k]);
+		EXPECT_GE(nFrames, nEncoded[k] + nDropped[k]);
+		GT_PRINTF("worker %d (%dx%d): %d encoded, %d dropped\n",
+			k, coderParams[k].encodeWidth_, coderParams[k].encodeHeight_,
+			nEncoded[k], nDropped[k]);
+	}
+}
+
+TEST(TestVideoThread, TestEncoderCoreScheduler)
+{
+	EncoderCoreScheduler scheduler(8);
+	std::map<std::string, unsigned int> allocations;
+	auto onAllocation = [&allocations](std::string id){
+		return [id, &allocations](unsigned int nCores){ allocations[id] = nCores; };
+	};
+
+	VideoCoderParams hd(sampleVideoCoderParams()), sd(sampleVideoCoderParams()), ld(sampleVideoCoderParams());
+	hd.encodeWidth_ = 1280; hd.encodeHeight_ = 720;
+	sd.encodeWidth_ = 640; sd.encodeHeight_ = 360;
+	ld.encodeWidth_ = 320; ld.encodeHeight_ = 180;
+
+	EXPECT_EQ(8, scheduler.add("hd", hd, onAllocation("hd")));
+	EXPECT_EQ(0, allocations.size());
+
+	// remaining 6 cores are divided 16:4:1
+	EXPECT_EQ(2, scheduler.add("sd", sd, onAllocation("sd")));
+	EXPECT_EQ(6, allocations["hd"]);
+	EXPECT_EQ(1, scheduler.add("ld", ld, onAllocation("ld")));
+	EXPECT_EQ(5, scheduler.getAllocation("hd"));
+	EXPECT_EQ(5, allocations["hd"]);
+	EXPECT_EQ(2, scheduler.getAllocation("sd"));
+	EXPECT_EQ(1, scheduler.getAllocation("ld"));
+	EXPECT_EQ(8, scheduler.getAllocation("hd")+scheduler.getAllocation("sd")+scheduler.getAllocation("ld"));
+
+	scheduler.remove("hd");
+	EXPECT_EQ(0, scheduler.getAllocation("hd"));
+	EXPECT_EQ(6, allocations["sd"]);
+	EXPECT_EQ(2, allocations["ld"]);
+
+	// budget smaller than number of encoders
+	scheduler.setBudget(1);
+	EXPECT_EQ(1, allocations["sd"]);
+	EXPECT_EQ(1, allocations["ld"]);
+}
+
+TEST(TestVideoThread, TestEncoderCoreSchedulerUpdate)
+{
+	EncoderCoreScheduler scheduler(8);
+	std::map<std::string, unsigned int> allocations;
+	auto onAllocation = [&allocations](std::string id){
+		return [id, &allocations](unsigned int nCores){ allocations[id] = nCores; };
+	};
+
+	VideoCoderParams hd(sampleVideoCoderParams()), sd(sampleVideoCoderParams());
+	hd.encodeWidth_ = 1280; hd.encodeHeight_ = 720;
+	sd.encodeWidth_ = 640; sd.encodeHeight_ = 360;
+
+	scheduler.add("hd", hd, onAllocation("hd"));
+	scheduler.add("sd", sd, onAllocation("sd"));
+	EXPECT_EQ(6, scheduler.getAllocation("hd"));
+	EXPECT_EQ(2, scheduler.getAllocation("sd"));
+
+	// both encoders have the same pixel rate now
+	EXPECT_TRUE(scheduler.update("sd", hd));
+	EXPECT_EQ(4, allocations["hd"]);
+	EXPECT_EQ(4, allocations["sd"]);
+
+	// removed encoders are not registered again
+	scheduler.remove("sd");
+	EXPECT_FALSE(scheduler.update("sd", sd));
+	EXPECT_EQ(0, scheduler.getAllocation("sd"));
+	EXPECT_EQ(8, scheduler.getAllocation("hd"));
+}
+
+TEST(TestVideoThread, TestEncoderCoreSchedulerRemove)
+{
+	EncoderCoreScheduler scheduler(8);
+	VideoCoderParams params(sampleVideoCoderParams());
+	boost::atomic<bool> inCallback(false), isRemoved(false);
+	boost::atomic<int> nCalls(0);
+
+	scheduler.add("a", params, [&](unsigned int){
+		EXPECT_FALSE(isRemoved);
+		inCallback = true;
+		nCalls++;
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+		inCallback = false;
+	});
+
+	// adding encoder re-balances allocation of "a" on another thread
+	boost::thread t([&scheduler, params](){
+		scheduler.add("b", params, [](unsigned int){});
+	});
+
+	while (!inCallback)
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+
+	// removal waits for running callback and no callbacks follow
+	scheduler.remove("a");
+	EXPECT_FALSE(inCallback);
+	isRemoved = true;
+
+	scheduler.setBudget(2);
+	t.join();
+	EXPECT_EQ(1, nCalls);
+}
 #endif
 
 TEST(TestAudioThread, TestRunOpusThread)
@@ -445,6 +688,58 @@ TEST(TestAudioThread, TestRestart)
 
 	runTimer.wait();
 }
+
+TEST(TestAudioThread, TestBundleDelay)
+{
+	MockAudioThreadCallback callback;
+	AudioThreadParams ap("hd", "opus");
+	AudioCaptureParams acp;
+	acp.deviceId_ = 0;
+	ap.maxBundleDelayMs_ = 20;
+	int wire_length = 1000;
+	// deadline timer runs on io thread
+	boost::asio::io_service io;
+	boost::shared_ptr<boost::asio::io_service::work> work(boost::make_shared<boost::asio::io_service::work>(io));
+	boost::thread t([&io](){ io.run(); });
+	AudioThread at(ap, acp, &callback, wire_length, &io);
+	int nBundles = 0, nFullBundles = 0;
+	high_resolution_clock::time_point lastTs;
+	std::vector<double> intervals;
+
+	boost::function<void(std::string, uint64_t, boost::shared_ptr<AudioBundlePacket>)> onBundle = 
+		[&](std::string, uint64_t n, boost::shared_ptr<AudioBundlePacket> b){
+		high_resolution_clock::time_point now = high_resolution_clock::now();
+		if (nBundles++)
+			intervals.push_back(duration_cast<milliseconds>(now - lastTs).count());
+		lastTs = now;
+
+		EXPECT_LE(1, b->getSamplesNum());
+		if (!b->hasSpace(b->operator[](0)))
+			nFullBundles++;
+	};
+
+	EXPECT_CALL(callback, onSampleBundle("hd", _, _))
+		.Times(AtLeast(1))
+		.WillRepeatedly(Invoke(onBundle));
+
+	boost::asio::deadline_timer runTimer(io);
+	runTimer.expires_from_now(boost::posix_time::milliseconds(1000));
+
+	EXPECT_NO_THROW(at.start());
+	runTimer.wait();
+	EXPECT_NO_THROW(at.stop());
+	work.reset();
+	t.join();
+
+	// bundles are published by deadline, not by size
+	ASSERT_LT(10, nBundles);
+	EXPECT_GT(nBundles / 2, nFullBundles);
+	double avgInterval = std::accumulate(intervals.begin(), intervals.end(), 0.) / intervals.size();
+	EXPECT_GE(ap.maxBundleDelayMs_ + 10, avgInterval);
+
+	GT_PRINTF("Received %d bundles (%d full), average interval %.2fms\n",
+		nBundles, nFullBundles, avgInterval);
+}
 #endif
 
 int main(int argc, char **argv) {
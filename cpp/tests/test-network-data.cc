@@ -26,10 +26,12 @@ class DataPacketTest : public DataPacket
     DataPacketTest(const std::vector<uint8_t> &payload) : DataPacket(payload) {}
     DataPacketTest(const DataPacketTest &dataPacket) : DataPacket(dataPacket) {}
     DataPacketTest(NetworkData &&networkData) : DataPacket(boost::move(networkData)) {}
+    DataPacketTest(const DataPacketBuilder &builder) : DataPacket(builder) {}
 
     unsigned int getBlobsNum() const { return DataPacket::getBlobsNum(); }
     const Blob getBlob(size_t pos) const { return DataPacket::getBlob(pos); }
     void addBlob(uint16_t dataLength, const uint8_t *data) { DataPacket::addBlob(dataLength, data); }
+    void addBlobs(const DataPacketBuilder &builder) { DataPacket::addBlobs(builder); }
 };
 
 TEST(TestNetworkData, TestCreate1)
@@ -258,6 +260,68 @@ TEST(TestDataPacket, TestBlobs)
     EXPECT_EQ(DataPacket::wireLength(data_len, blobLengths), dp.getLength());
 }
 
+TEST(TestDataPacket, TestBuilder)
+{
+    uint8_t const data[] = {0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39};
+    std::size_t const data_len = sizeof(data) / sizeof(data[0]);
+    uint8_t const header1[] = {0x31};
+    uint8_t const header2[] = {0x30, 0x32, 0x33, 0x34};
+    int x = 5;
+
+    DataPacketBuilder builder;
+    builder.addBlob(sizeof(header1), header1)
+        .addBlob(0, nullptr)
+        .addBlob(sizeof(header2), header2)
+        .addBlob(sizeof(x), (const uint8_t *)&x)
+        .setPayload(data_len, data);
+
+    EXPECT_EQ(3, builder.getBlobsNum());
+    EXPECT_EQ(data_len, builder.getPayloadLength());
+
+    DataPacketTest expected(data_len, data);
+    expected.addBlob(sizeof(header1), header1);
+    expected.addBlob(sizeof(header2), header2);
+    expected.addBlob(sizeof(x), (const uint8_t *)&x);
+
+    std::vector<size_t> blobLengths = boost::assign::list_of(sizeof(header1))(sizeof(header2))(sizeof(x));
+    EXPECT_EQ(DataPacket::wireLength(data_len, blobLengths), builder.wireLength());
+
+    {
+        DataPacketTest dp(builder);
+
+        EXPECT_TRUE(dp.isValid());
+        ASSERT_EQ(3, dp.getBlobsNum());
+        EXPECT_EQ(expected.data(), dp.data());
+        EXPECT_EQ(x, *(int *)dp.getBlob(2).data());
+        EXPECT_EQ(data_len, dp.getPayload().size());
+        for (int i = 0; i < dp.getPayload().size(); ++i)
+            EXPECT_EQ(data[i], dp.getPayload()[i]);
+    }
+    {
+        // blobs are added after existing ones, payload stays intact
+        DataPacketTest dp(data_len, data);
+        dp.addBlob(sizeof(header1), header1);
+        dp.addBlobs(DataPacketBuilder()
+                        .addBlob(sizeof(header2), header2)
+                        .addBlob(sizeof(x), (const uint8_t *)&x));
+
+        EXPECT_TRUE(dp.isValid());
+        ASSERT_EQ(3, dp.getBlobsNum());
+        EXPECT_EQ(expected.data(), dp.data());
+    }
+    {
+        DataPacketBuilder full;
+        for (size_t i = 0; i < DataPacketBuilder::MaxBlobsNum; ++i)
+            full.addBlob(sizeof(x), (const uint8_t *)&x);
+        EXPECT_ANY_THROW(full.addBlob(sizeof(x), (const uint8_t *)&x));
+
+        DataPacketTest dp(data_len, data);
+        dp.addBlob(sizeof(header1), header1);
+        EXPECT_ANY_THROW(dp.addBlobs(full));
+        EXPECT_EQ(1, dp.getBlobsNum());
+    }
+}
+
 TEST(TestDataPacket, TestDataPacketCopy)
 {
     uint8_t const data[] = {0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39};
@@ -677,6 +741,89 @@ TEST(TestAudioBundle, TestMoveAndReuse)
     }
 }
 
+TEST(TestAudioBundle, TestAppendInPlace)
+{
+    int data_len = 247;
+    std::vector<uint8_t> rtpData;
+    for (int i = 0; i < data_len; ++i)
+        rtpData.push_back((uint8_t)i);
+
+    int wire_len = 1000;
+    AudioBundlePacket bundlePacket(wire_len), blobBundle(wire_len), spareBundle(wire_len);
+    AudioBundlePacket::AudioSampleBlob sample({true}, rtpData.begin(), rtpData.end());
+    const uint8_t *storage = bundlePacket.getData();
+    const uint8_t *spareStorage = spareBundle.getData();
+
+    for (int j = 0; j < 3; ++j)
+    {
+        while (bundlePacket.hasSpace(data_len))
+        {
+            bundlePacket.append({true}, rtpData.data(), data_len);
+            blobBundle << sample;
+        }
+
+        EXPECT_ANY_THROW(bundlePacket.append({true}, rtpData.data(), data_len));
+        ASSERT_EQ(AudioBundlePacket::wireLength(wire_len, data_len) / AudioBundlePacket::AudioSampleBlob::wireLength(data_len),
+                  bundlePacket.getSamplesNum());
+        for (int i = 0; i < bundlePacket.getSamplesNum(); ++i)
+        {
+            EXPECT_TRUE(bundlePacket[i].getHeader().isRtcp_);
+            EXPECT_EQ(data_len, bundlePacket[i].payloadLength());
+            EXPECT_EQ(0, memcmp(rtpData.data(), bundlePacket[i].data(), data_len));
+        }
+
+        bundlePacket.setHeader({25, 1, 2});
+        blobBundle.setHeader({25, 1, 2});
+        EXPECT_ANY_THROW(bundlePacket.append({true}, rtpData.data(), data_len));
+        ASSERT_TRUE(bundlePacket.isValid());
+        ASSERT_EQ(AudioBundlePacket::wireLength(wire_len, data_len), bundlePacket.getLength());
+        ASSERT_EQ(blobBundle.getLength(), bundlePacket.getLength());
+        EXPECT_EQ(0, memcmp(blobBundle.getData(), bundlePacket.getData(), bundlePacket.getLength()));
+
+        ImmutableAudioBundlePacket received(boost::make_shared<const std::vector<uint8_t>>(bundlePacket.data()));
+        ASSERT_TRUE(received.isValid());
+        EXPECT_EQ(bundlePacket.getSamplesNum(), received.getSamplesNum());
+        EXPECT_EQ(25, received.getHeader().sampleRate_);
+
+        // storage is exchanged between bundles, but never re-allocated
+        spareBundle.swap(bundlePacket);
+        bundlePacket.clear();
+        blobBundle.clear();
+        EXPECT_EQ(0, bundlePacket.getSamplesNum());
+        EXPECT_EQ(j % 2 ? storage : spareStorage, bundlePacket.getData());
+        EXPECT_EQ(j % 2 ? spareStorage : storage, spareBundle.getData());
+    }
+}
+
+TEST(TestDataSegment, TestWrite)
+{
+    int data_len = 2472;
+    std::vector<uint8_t> data;
+
+    for (int i = 0; i < data_len; ++i)
+        data.push_back((uint8_t)i);
+
+    NetworkData nd((const std::vector<uint8_t>)data);
+    std::vector<CommonSegment> segments = CommonSegment::slice(nd, 1000);
+    std::vector<uint8_t> buffer;
+    DataSegmentHeader header;
+    header.interestNonce_ = 0x1234;
+    header.interestArrivalMs_ = 1460399362;
+    header.generationDelayMs_ = 200;
+
+    ASSERT_EQ(3, segments.size());
+    for (auto &s : segments)
+    {
+        s.setHeader(header);
+        s.write(buffer);
+
+        boost::shared_ptr<NetworkData> segmentData = s.getNetworkData();
+        ASSERT_EQ(s.size(), buffer.size());
+        ASSERT_EQ(segmentData->getLength(), buffer.size());
+        EXPECT_EQ(segmentData->data(), buffer);
+    }
+}
+
 TEST(TestDataSegment, TestSlice)
 {
     int data_len = 6472;
@@ -1099,6 +1246,20 @@ TEST(TestVideoThreadMeta, TestCreate)
     }
 }
 
+TEST(TestVideoThreadMeta, TestCodec)
+{
+    FrameSegmentsInfo segInfo({5.6, 2.3, 54.3, 12.3});
+    VideoCoderParams coder = sampleVideoCoderParams();
+    coder.codec_ = "h264";
+    VideoThreadMeta meta(27, 465, 15, 14, segInfo, coder);
+
+    NetworkData nd(boost::move(meta));
+    VideoThreadMeta meta2(boost::move(nd));
+
+    EXPECT_TRUE(meta2.isValid());
+    EXPECT_EQ("h264", meta2.getCoderParams().codec_);
+}
+
 TEST(TestVideoThreadMeta, TestCreateFail)
 {
     uint8_t const data[] = {0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
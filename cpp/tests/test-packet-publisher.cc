@@ -18,6 +18,7 @@
 #include "gtest/gtest.h"
 #include "tests-helpers.hpp"
 #include "src/packet-publisher.hpp"
+#include "src/producer-cache.hpp"
 #include "mock-objects/ndn-cpp-mock.hpp"
 #include "frame-data.hpp"
 
@@ -586,6 +587,37 @@ TEST(TestPacketPublisher, TestPitDeepClean)
                 if (name.match(p->getInterest()->getName()))
                     interests.push_back(p);
         };
+    boost::function<void(const Name &, PendingInterests &)> mockExtractBefore =
+        [&pendingInterests](const Name &name, PendingInterests &interests) {
+            NamespaceInfo info, piInfo;
+            ASSERT_TRUE(NameComponents::extractInfo(name, info));
+
+            interests.clear();
+            int i = 0;
+            while (i < pendingInterests.size())
+            {
+                if (NameComponents::extractInfo(pendingInterests[i]->getInterest()->getName(), piInfo) &&
+                    piInfo.threadName_ == info.threadName_ && piInfo.class_ == info.class_ &&
+                    piInfo.sampleNo_ < info.sampleNo_)
+                {
+                    interests.push_back(pendingInterests[i]);
+                    pendingInterests.erase(pendingInterests.begin() + i);
+                }
+                else
+                    i++;
+            }
+        };
+    size_t nacksSent = 0;
+    boost::function<void(const PendingInterests &, const PublishedDataPtrVector &)> mockPutData =
+        [&nacksSent](const PendingInterests &interests, const PublishedDataPtrVector &data) {
+            ASSERT_EQ(interests.size(), data.size());
+            for (int i = 0; i < data.size(); ++i)
+            {
+                EXPECT_EQ(ndn_ContentType_NACK, data[i]->getMetaInfo().getType());
+                EXPECT_EQ(interests[i]->getInterest()->getName(), data[i]->getName());
+            }
+            nacksSent += data.size();
+        };
 
     std::vector<Data> dataObjects;
     std::vector<Data> nacks;
@@ -619,6 +651,9 @@ TEST(TestPacketPublisher, TestPitDeepClean)
         .Times(0);
     EXPECT_CALL(keyChain, sign(_))
         .Times(AtLeast(1));
+    // NACKs carry digest signature
+    EXPECT_CALL(keyChain, signWithSha256(_))
+        .Times(15);
     EXPECT_CALL(memoryCache, getPendingInterestsForName(_, _))
         .Times(AtLeast(1))
         .WillRepeatedly(Invoke(mockGetPendingForName));
@@ -628,6 +663,12 @@ TEST(TestPacketPublisher, TestPitDeepClean)
     EXPECT_CALL(memoryCache, add(_))
         .Times(AtLeast(1))
         .WillRepeatedly(Invoke(mockAddData));
+    EXPECT_CALL(memoryCache, extractPendingInterestsBefore(_, _))
+        .Times(AtLeast(1))
+        .WillRepeatedly(Invoke(mockExtractBefore));
+    EXPECT_CALL(memoryCache, putData(_, _))
+        .Times(1)
+        .WillRepeatedly(Invoke(mockPutData));
 
     PacketPublisher<VideoFrameSegment, MockSettings> publisher(settings);
 #ifdef ENABLE_LOGGING
@@ -691,14 +732,107 @@ TEST(TestPacketPublisher, TestPitDeepClean)
                 pendingInterests.push_back(pi);
             }
 
-            // passing last argument as true should force deep PIT cleaning
-            PublishedDataPtrVector segments = publisher.publish(packetName, vp, segHdr, freshness, true);
+            // PIT is deep cleaned on every publish
+            PublishedDataPtrVector segments = publisher.publish(packetName, vp, segHdr, freshness);
             EXPECT_EQ(segments.size(), dataObjects.size());
             EXPECT_EQ(15, nacks.size()); // as a result, we shall receive 10 (old sample) + 5 (current sample) NACKs
+            EXPECT_EQ(10, nacksSent);    // NACKs for old sample are sent in one batch
+            EXPECT_EQ(0, pendingInterests.size());
         }
     }
 }
 
+TEST(TestPacketPublisher, TestNackHugeSegment)
+{
+    Face face("aleph.ndn.ucla.edu");
+    std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
+    boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
+    ProducerCache memCache(&face);
+
+    PublisherSettings settings;
+    int wireLength = 1000;
+    int freshness = 1000;
+    settings.keyChain_ = keyChain.get();
+    settings.memoryCache_ = &memCache;
+    settings.segmentWireLength_ = wireLength;
+    settings.freshnessPeriodMs_ = freshness;
+    settings.statStorage_ = StatisticsStorage::createProducerStatistics();
+
+    Name threadPrefix("/ndn/edu/ucla/remap/peter/ndncon/instance1/ndnrtc/%FD%02/video/camera/%FC%00%00%01c_%27%DE%D6/hi/d");
+    VideoPacketPublisher publisher(settings);
+
+    size_t frameLen = 4300;
+    int32_t size = webrtc::CalcBufferSize(webrtc::kI420, 640, 480);
+    std::vector<uint8_t> buffer(frameLen);
+    for (int i = 0; i < frameLen; ++i)
+        buffer[i] = i % 255;
+
+    webrtc::EncodedImage frame(buffer.data(), frameLen, size);
+    frame._encodedWidth = 640;
+    frame._encodedHeight = 480;
+    frame._frameType = webrtc::kVideoFrameKey;
+    frame._completeFrame = true;
+
+    CommonHeader hdr;
+    hdr.sampleRate_ = 24.7;
+    hdr.publishTimestampMs_ = 488589553;
+    hdr.publishUnixTimestamp_ = 1460488589;
+    VideoFramePacket vp(frame);
+    vp.setHeader(hdr);
+
+    VideoFrameSegmentHeader segHdr;
+    segHdr.totalSegmentsNum_ = VideoFrameSegment::numSlices(vp, wireLength);
+
+    // publishing without pending interests
+    boost::chrono::high_resolution_clock::time_point t1 = boost::chrono::high_resolution_clock::now();
+    PublishedDataPtrVector segments = publisher.publish(Name(threadPrefix).appendSequenceNumber(0),
+                                                        vp, segHdr, freshness);
+    double publishUs = boost::chrono::duration_cast<boost::chrono::microseconds>(
+                           boost::chrono::high_resolution_clock::now() - t1).count();
+    size_t cachedBytes = memCache.getCachedBytes();
+
+    // interests for segments far beyond the end of the samples, for the
+    // sample being published (NACKed on PIT clean) and for the previous
+    // sample (NACKed on deep PIT clean)
+    int nInterests = 100;
+    for (int i = 0; i < nInterests; ++i)
+    {
+        Name n(threadPrefix);
+        n.appendSequenceNumber(i % 2 ? 1 : 0).appendSegment(0xffffffff - i);
+        memCache.storePendingInterest(boost::make_shared<Interest>(n, 2000), face);
+    }
+    EXPECT_EQ(nInterests, memCache.getPendingInterestsNum());
+
+    t1 = boost::chrono::high_resolution_clock::now();
+    segments = publisher.publish(Name(threadPrefix).appendSequenceNumber(1),
+                                 vp, segHdr, freshness);
+    double publishNacksUs = boost::chrono::duration_cast<boost::chrono::microseconds>(
+                                boost::chrono::high_resolution_clock::now() - t1).count();
+
+    EXPECT_EQ(0, memCache.getPendingInterestsNum());
+    EXPECT_EQ(2, memCache.getCachedSamplesNum());
+    // NACKs are cached by name and take no more than their own size
+    EXPECT_GT(2 * cachedBytes + nInterests * wireLength, memCache.getCachedBytes());
+
+    for (int i = 0; i < nInterests; ++i)
+    {
+        Name n(threadPrefix);
+        n.appendSequenceNumber(i % 2 ? 1 : 0).appendSegment(0xffffffff - i);
+        boost::shared_ptr<const Data> nack = memCache.find(Interest(n));
+        ASSERT_TRUE(nack.get());
+        EXPECT_EQ(ndn_ContentType_NACK, nack->getMetaInfo().getType());
+        EXPECT_TRUE(dynamic_cast<const DigestSha256Signature *>(nack->getSignature()));
+    }
+
+    // NACKs carry digest signature, thus each of them costs much less than
+    // a segment, signed with the key
+    double nackUs = (publishNacksUs - publishUs) / nInterests;
+    EXPECT_LT(nackUs, publishUs / segments.size());
+    GT_PRINTF("Published frame of %d segments in %.2fms, with %d NACKs in %.2fms (%.3fms per NACK)\n",
+              (int)segments.size(), publishUs / 1000, nInterests, publishNacksUs / 1000,
+              (publishNacksUs - publishUs) / 1000 / nInterests);
+}
+
 TEST(TestPacketPublisher, TestBenchmarkSigningSegment1000)
 {
     Face face("aleph.ndn.ucla.edu");
@@ -706,7 +840,7 @@ TEST(TestPacketPublisher, TestBenchmarkSigningSegment1000)
     boost::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage(boost::make_shared<MemoryPrivateKeyStorage>());
     std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(&face);
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(&face);
 
     PublisherSettings settings;
 
@@ -780,7 +914,7 @@ TEST(TestPacketPublisher, TestBenchmarkSigningSegment8000)
     boost::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage(boost::make_shared<MemoryPrivateKeyStorage>());
     std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(&face);
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(&face);
 
     PublisherSettings settings;
 
@@ -854,7 +988,7 @@ TEST(TestPacketPublisher, TestBenchmarkNoSigning)
     boost::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage(boost::make_shared<MemoryPrivateKeyStorage>());
     std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(&face);
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(&face);
 
     PublisherSettings settings;
 
@@ -162,7 +162,7 @@ TEST(TestVideoCoderParams, TestOutput)
 
     EXPECT_EQ(ss.str(),
               "30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES");
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9");
 }
 
 TEST(TestVideoCoderParams, TestOutput2)
@@ -174,7 +174,7 @@ TEST(TestVideoCoderParams, TestOutput2)
 
     EXPECT_EQ(ss.str(),
               "0FPS; GOP: 0; Start bitrate: 0 Kbit/s; "
-              "Max bitrate: 0 Kbit/s; 0x0; Drop: NO");
+              "Max bitrate: 0 Kbit/s; 0x0; Drop: NO; Codec: vp9");
 }
 
 TEST(TestVideoCoderParams, TestOutput3)
@@ -187,7 +187,7 @@ TEST(TestVideoCoderParams, TestOutput3)
 
     EXPECT_EQ(ss.str(),
               "30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: NO");
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: NO; Codec: vp9");
 }
 
 TEST(TestVideoCoderParams, TestCopyCtor)
@@ -201,7 +201,7 @@ TEST(TestVideoCoderParams, TestCopyCtor)
     ss << vcp2;
     EXPECT_EQ(ss.str(),
               "30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES");
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9");
 }
 
 TEST(TestVideoThreadParams, TestCtor)
@@ -249,7 +249,7 @@ TEST(TestVideoThreadParams, TestOutput)
 
     EXPECT_EQ(ss.str(),
               "name: ; 0FPS; GOP: 0; Start bitrate: 0 Kbit/s; "
-              "Max bitrate: 0 Kbit/s; 0x0; Drop: NO");
+              "Max bitrate: 0 Kbit/s; 0x0; Drop: NO; Codec: vp9");
 }
 
 TEST(TestVideoThreadParams, TestOutput2)
@@ -262,7 +262,7 @@ TEST(TestVideoThreadParams, TestOutput2)
 
     EXPECT_EQ(ss.str(),
               "name: ; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES");
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9");
 }
 
 TEST(TestVideoThreadParams, TestCopy)
@@ -278,7 +278,7 @@ TEST(TestVideoThreadParams, TestCopy)
     ss << *vtpCopy;
     EXPECT_EQ(ss.str(),
               "name: thread-original; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES");
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9");
     EXPECT_EQ(FrameSegmentsInfo(1, 2, 3, 4), vtpCopy->getSegmentsInfo());
     EXPECT_EQ(sampleVideoCoderParams(), vtpCopy->coderParams_);
 }
@@ -447,9 +447,9 @@ TEST(TestMediaStreamParams, TestOutput3)
               "name: camera (video); synced to: mic; seg size: 1000 bytes; "
               "freshness (ms): metadata 10 sample 15 sample (key) 900; capture device id: 10; 2 threads:\n"
               "[0: name: low; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n"
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n"
               "[1: name: mid; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n");
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n");
 }
 
 TEST(TestMediaStreamParams, TestCopy)
@@ -478,9 +478,9 @@ TEST(TestMediaStreamParams, TestCopy)
               "name: camera (video); synced to: mic; seg size: 1000 bytes; "
               "freshness (ms): metadata 10 sample 15 sample (key) 900; capture device id: 10; 2 threads:\n"
               "[0: name: low; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n"
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n"
               "[1: name: mid; 30FPS; GOP: 30; Start bitrate: 1000 Kbit/s; "
-              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES]\n");
+              "Max bitrate: 3000 Kbit/s; 1920x1080; Drop: YES; Codec: vp9]\n");
 }
 
 TEST(TestGeneralConsumerParams, TestOutput)
@@ -32,6 +32,7 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/filesystem.hpp>
+#include <fstream>
 
 #include "frame-converter.hpp"
 #include "gtest/gtest.h"
@@ -41,15 +42,19 @@
 #include "client/src/video-source.hpp"
 #include "client/src/frame-io.hpp"
 #include "src/packet-publisher.hpp"
+#include "src/producer-cache.hpp"
 #include "mock-objects/ndn-cpp-mock.hpp"
 #include "frame-data.hpp"
 #include "video-thread.hpp"
 #include "interfaces.hpp"
 
 #include "persistent-storage/fetching-task.hpp"
+#include "persistent-storage/decoded-frame-cache.hpp"
+#include "persistent-storage/segment-log.hpp"
 #include "storage-engine.hpp"
 #include "frame-fetcher.hpp"
 #include "frame-buffer.hpp"
+#include "clock.hpp"
 #include "local-stream.hpp"
 
 #include "mock-objects/external-capturer-mock.hpp"
@@ -112,7 +117,7 @@ TEST(TestPeristentStorage, TestBenchmarkSegment8000)
     boost::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage(boost::make_shared<MemoryPrivateKeyStorage>());
     std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(&face);
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(&face);
 
     PublisherSettings settings;
 
@@ -269,7 +274,7 @@ TEST(TestPersistentStorage, TestWriteMillion)
     boost::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage(boost::make_shared<MemoryPrivateKeyStorage>());
     std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(&face);
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(&face);
 
     uint64_t dbInsertOps = 0;
     uint64_t dbInsertUsec = 0;
@@ -413,7 +418,7 @@ TEST(TestPersistentStorage, TestBenchmarkVideoPublishing)
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
     
     publisherFace->setCommandSigningInfo(*keyChain, certName(keyName(appPrefix)));
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(publisherFace.get());
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(publisherFace.get());
 
     PublisherSettings settings;
 
@@ -499,7 +504,7 @@ TEST(TestPersistentStorage, TestBenchmarkVideoPublishing)
         segmentHdr.pairedSequenceNo_ = pairedSeq;
 
         PublishedDataPtrVector segments =
-            publisher.publish(dataName, *vf, segmentHdr, (isKey ? 900 : -1), isKey, true);
+            publisher.publish(dataName, *vf, segmentHdr, (isKey ? 900 : -1), true);
         assert(segments.size());
 
         if (isKey)
@@ -519,7 +524,7 @@ TEST(TestPersistentStorage, TestBenchmarkVideoPublishing)
             Name parityName(dataName);
             parityName.append(NameComponents::NameComponentParity);
 
-            paritySegments = publisher.publish(parityName, *parityData, segmentHdr, (isKey ? 900: -1), isKey);
+            paritySegments = publisher.publish(parityName, *parityData, segmentHdr, (isKey ? 900: -1));
         }
 
         if (isKey)
@@ -634,7 +639,7 @@ TEST(TestPeristentStorage, TestStorageEngine)
     boost::shared_ptr<MemoryPrivateKeyStorage> privateKeyStorage(boost::make_shared<MemoryPrivateKeyStorage>());
     std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(&face);
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(&face);
 
     PublisherSettings settings;
     std::set<std::string> insertedData;
@@ -817,7 +822,7 @@ TEST(TestPersistentStorage, TestFrameFetchingTask)
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
     
     publisherFace->setCommandSigningInfo(*keyChain, certName(keyName(appPrefix)));
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(publisherFace.get());
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(publisherFace.get());
 
     PublisherSettings settings;
 
@@ -904,7 +909,7 @@ TEST(TestPersistentStorage, TestFrameFetchingTask)
         segmentHdr.pairedSequenceNo_ = pairedSeq;
 
         PublishedDataPtrVector segments =
-            publisher.publish(dataName, *vf, segmentHdr, (isKey ? 900 : -1), isKey, true);
+            publisher.publish(dataName, *vf, segmentHdr, (isKey ? 900 : -1), true);
         assert(segments.size());
 
         if (isKey)
@@ -924,7 +929,7 @@ TEST(TestPersistentStorage, TestFrameFetchingTask)
             Name parityName(dataName);
             parityName.append(NameComponents::NameComponentParity);
 
-            paritySegments = publisher.publish(parityName, *parityData, segmentHdr, (isKey ? 900: -1), isKey);
+            paritySegments = publisher.publish(parityName, *parityData, segmentHdr, (isKey ? 900: -1));
         }
 
         if (isKey)
@@ -1060,7 +1065,7 @@ TEST(TestPersistentStorage, TestFrameFetcher)
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
     
     publisherFace->setCommandSigningInfo(*keyChain, certName(keyName(appPrefix)));
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(publisherFace.get());
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(publisherFace.get());
 
     PublisherSettings settings;
 
@@ -1129,7 +1134,7 @@ TEST(TestPersistentStorage, TestFrameFetcher)
         segmentHdr.pairedSequenceNo_ = pairedSeq;
 
         PublishedDataPtrVector segments =
-            publisher.publish(dataName, *vf, segmentHdr, (isKey ? 900 : -1), isKey, true);
+            publisher.publish(dataName, *vf, segmentHdr, (isKey ? 900 : -1), true);
         assert(segments.size());
 
         if (isKey)
@@ -1149,7 +1154,7 @@ TEST(TestPersistentStorage, TestFrameFetcher)
             Name parityName(dataName);
             parityName.append(NameComponents::NameComponentParity);
 
-            paritySegments = publisher.publish(parityName, *parityData, segmentHdr, (isKey ? 900: -1), isKey);
+            paritySegments = publisher.publish(parityName, *parityData, segmentHdr, (isKey ? 900: -1));
         }
 
         if (isKey)
@@ -1255,7 +1260,7 @@ TEST(TestPersistentStorage, TestFrameFetcher)
 #endif
 
 #if 1
-MediaStreamParams getSampleVideoParams()
+MediaStreamParams getSampleVideoParams(std::string codec = "vp9")
 {
     MediaStreamParams msp("camera");
 
@@ -1271,6 +1276,7 @@ MediaStreamParams getSampleVideoParams()
     VideoThreadParams atp("low", sampleVideoCoderParams());
     atp.coderParams_.encodeWidth_ = 320;
     atp.coderParams_.encodeHeight_ = 240;
+    atp.coderParams_.codec_ = codec;
     msp.addMediaThread(atp);
 
     return msp;
@@ -1309,7 +1315,7 @@ TEST(TestPersistentStorage, TestFrameFetcherWithLocalStream)
     boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
     
     publisherFace->setCommandSigningInfo(*keyChain, certName(keyName(appPrefix)));
-    boost::shared_ptr<MemoryContentCache> memCache = boost::make_shared<MemoryContentCache>(publisherFace.get());
+    boost::shared_ptr<ProducerCache> memCache = boost::make_shared<ProducerCache>(publisherFace.get());
 
     // setting up local stream
     MediaStreamSettings settings(io_source, getSampleVideoParams());
@@ -1416,8 +1422,723 @@ TEST(TestPersistentStorage, TestFrameFetcherWithLocalStream)
     db_namespace::Options options;
     db_namespace::DestroyDB(dbPath, options);
 }
+
+TEST(TestPersistentStorage, TestPacedCaptureTime)
+{
+#ifndef __ANDROID__
+    std::string dbPath("/tmp/testdb-capture-time");
+#else
+    std::string dbPath("/data/local/tmp/testdb-capture-time");
+#endif
+
+#ifdef ENABLE_LOGGING
+    ndnlog::new_api::Logger::initAsyncLogging();
+    ndnlog::new_api::Logger::getLoggerPtr("")->setLogLevel(ndnlog::NdnLoggerDetailLevelDebug);
+#endif
+
+    boost::asio::io_service io;
+    boost::shared_ptr<boost::asio::io_service::work> work(boost::make_shared<boost::asio::io_service::work>(io));
+    boost::thread t([&io](){
+        io.run();
+    });
+
+    int width = 320, height = 240, nFrames = 30;
+    int frameSize = width*height*4;
+    uint8_t *frameBuffer = (uint8_t*)malloc(frameSize);
+    for (int i = 0; i < frameSize; ++i)
+        frameBuffer[i] = std::rand()%256;
+
+    std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
+    boost::shared_ptr<Face> publisherFace(boost::make_shared<ThreadsafeFace>(io));
+    boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
+    publisherFace->setCommandSigningInfo(*keyChain, certName(keyName(appPrefix)));
+
+    MediaStreamSettings settings(io, getSampleVideoParams());
+    settings.face_ = publisherFace.get();
+    settings.keyChain_ = keyChain.get();
+    settings.storagePath_ = dbPath;
+    settings.paceFrames_ = true;
+
+    int64_t startMs = ndnrtc::clock::millisecondTimestamp();
+    {
+        LocalVideoStream localStream(appPrefix, settings);
+
+#ifdef ENABLE_LOGGING
+        localStream.setLogger(ndnlog::new_api::Logger::getLoggerPtr(""));
+#endif
+
+        for (int i = 0; i < nFrames; ++i)
+        {
+            EXPECT_NO_THROW(localStream.incomingArgbFrame(width, height, frameBuffer, frameSize));
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(33));
+        }
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
+
+        // published frames carry capture time of the pacer's ticks
+        boost::shared_ptr<StorageEngine> storage = localStream.getStorage();
+        int64_t lastCaptureMs = 0;
+        int nChecked = 0;
+
+        for (PacketNumber seqNo = 0; seqNo < (PacketNumber)nFrames; ++seqNo)
+        {
+            Name frameName(localStream.getPrefix());
+            frameName.append(localStream.getThreads()[0])
+                     .append(NameComponents::NameComponentDelta)
+                     .appendSequenceNumber(seqNo);
+
+            VideoFramePacket::ImmutableVideoSegmentsVector segments;
+            boost::shared_ptr<ndn::Data> data = storage->get(Name(frameName).appendSegment(0));
+            if (!data)
+                continue;
+
+            ImmutableHeaderPacket<VideoFrameSegmentHeader> seg0(data->getContent());
+            segments.push_back(seg0);
+            for (int k = 1; k < seg0.getHeader().totalSegmentsNum_; ++k)
+            {
+                data = storage->get(Name(frameName).appendSegment(k));
+                ASSERT_TRUE(data.get());
+                segments.push_back(ImmutableHeaderPacket<VideoFrameSegmentHeader>(data->getContent()));
+            }
+
+            boost::shared_ptr<VideoFramePacket> packet = VideoFramePacket::merge(segments);
+            int64_t captureMs = packet->getFrame().capture_time_ms_;
+
+            EXPECT_LE(startMs, captureMs);
+            EXPECT_GE(ndnrtc::clock::millisecondTimestamp(), captureMs);
+            EXPECT_LT(lastCaptureMs, captureMs);
+            lastCaptureMs = captureMs;
+            nChecked++;
+        }
+
+        EXPECT_LT(0, nChecked);
+    }
+
+    work.reset();
+    t.join();
+    free(frameBuffer);
+
+    db_namespace::Options options;
+    db_namespace::DestroyDB(dbPath, options);
+}
+
+TEST(TestPersistentStorage, TestFrameFetcherCache)
+{
+#ifndef __ANDROID__
+    std::string dbPath("/tmp/testdb-cache");
+#else
+    std::string dbPath("/data/local/tmp/testdb-cache");
+#endif
+
+    boost::asio::io_service io_source;
+    boost::shared_ptr<boost::asio::io_service::work> work_source(boost::make_shared<boost::asio::io_service::work>(io_source));
+    boost::thread t_source([&io_source](){
+        io_source.run();
+    });
+
+    int runTime = 1*3*1000;
+    int width = 320, height = 240;
+    boost::shared_ptr<RawFrame> frame(boost::make_shared<ArgbFrame>(width,height));
+    std::string testVideoSource = resources_path+"/test-source-320x240.argb";
+    VideoSource source(io_source, testVideoSource, frame);
+    MockExternalCapturer capturer;
+    source.addCapturer(&capturer);
+
+    std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
+    boost::shared_ptr<Face> publisherFace(boost::make_shared<ThreadsafeFace>(io_source));
+    boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
+    publisherFace->setCommandSigningInfo(*keyChain, certName(keyName(appPrefix)));
+
+    MediaStreamSettings settings(io_source, getSampleVideoParams());
+    settings.face_ = publisherFace.get();
+    settings.keyChain_ = keyChain.get();
+    settings.storagePath_ = dbPath;
+    
+    LocalVideoStream localStream(appPrefix, settings);
+
+    boost::function<int(const unsigned int,const unsigned int, unsigned char*, unsigned int)>
+      incomingRawFrame =[&localStream](const unsigned int w,const unsigned int h, unsigned char* data, unsigned int size){
+          EXPECT_NO_THROW(localStream.incomingArgbFrame(w, h, data, size));
+          return 0;
+      };
+    EXPECT_CALL(capturer, incomingArgbFrame(width, height, _, _))
+        .WillRepeatedly(Invoke(incomingRawFrame));
+
+    source.start(30);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(runTime));
+    work_source.reset();
+    io_source.stop();
+    t_source.join();
+
+    std::vector<uint8_t> frameBuffer(width*height*4);
+    int nFetched = 0, lastFetchedFrames = -1;
+    std::vector<uint8_t> lastFrame;
+
+    OnBufferAllocate onBufferAllocate = 
+        [&frameBuffer](const boost::shared_ptr<IFrameFetcher>&, int w, int h)->uint8_t*
+        {
+            frameBuffer.resize(w*h*4);
+            return frameBuffer.data();
+        };
+    OnFrameFetched onFrameFetched = 
+        [&nFetched, &lastFetchedFrames, &lastFrame](const boost::shared_ptr<IFrameFetcher>&, const FrameInfo fi, 
+                    int nFetchedFrames, int w, int h, const uint8_t* buffer)
+        {
+            nFetched++;
+            lastFetchedFrames = nFetchedFrames;
+            lastFrame.assign(buffer, buffer+w*h*4);
+        };
+    OnFetchFailure onFetchFailure = 
+        [](const boost::shared_ptr<IFrameFetcher>& ff, std::string reason)
+        {
+            FAIL() << "Frame fetching failed (" << ff->getName() <<"): " << reason;
+        };
+
+    // both deltas belong to the first GOP
+    Name threadPrefix(localStream.getPrefix());
+    threadPrefix.append(localStream.getThreads()[0])
+                .append(NameComponents::NameComponentDelta);
+    Name frame10(threadPrefix), frame12(threadPrefix);
+    frame10.appendSequenceNumber(10);
+    frame12.appendSequenceNumber(12);
+
+    boost::shared_ptr<DecodedFrameCache> cache = FrameFetcher::createCache();
+    boost::shared_ptr<FrameFetcher> fetcher = boost::make_shared<FrameFetcher>(localStream.getStorage(), cache);
+
+    // GOP is fetched and decoded from its' Key frame
+    fetcher->fetch(frame10, onBufferAllocate, onFrameFetched, onFetchFailure);
+    ASSERT_EQ(1, nFetched);
+    // Key frame, preceding deltas and target frame
+    int nGopFrames10 = lastFetchedFrames;
+    EXPECT_LT(2, nGopFrames10);
+    std::vector<uint8_t> decoded10(lastFrame);
+
+    // cache hit: nothing is fetched
+    fetcher->fetch(frame10, onBufferAllocate, onFrameFetched, onFetchFailure);
+    ASSERT_EQ(2, nFetched);
+    EXPECT_EQ(0, lastFetchedFrames);
+    EXPECT_EQ(decoded10, lastFrame);
+
+    // GOP decoding resumes from delta 11
+    fetcher->fetch(frame12, onBufferAllocate, onFrameFetched, onFetchFailure);
+    ASSERT_EQ(3, nFetched);
+    EXPECT_EQ(2, lastFetchedFrames);
+    std::vector<uint8_t> decoded12(lastFrame);
+
+    {
+        // another fetcher sharing the cache gets frames without fetching
+        boost::shared_ptr<FrameFetcher> fetcher2 = boost::make_shared<FrameFetcher>(localStream.getStorage(), cache);
+        fetcher2->fetch(frame12, onBufferAllocate, onFrameFetched, onFetchFailure);
+        ASSERT_EQ(4, nFetched);
+        EXPECT_EQ(0, lastFetchedFrames);
+    }
+    {
+        // resumed decoding gives the same frame as decoding from Key frame
+        boost::shared_ptr<FrameFetcher> fetcher3 = boost::make_shared<FrameFetcher>(localStream.getStorage());
+        fetcher3->fetch(frame12, onBufferAllocate, onFrameFetched, onFetchFailure);
+        ASSERT_EQ(5, nFetched);
+        EXPECT_EQ(nGopFrames10 + 2, lastFetchedFrames);
+        EXPECT_EQ(decoded12, lastFrame);
+    }
+
+    db_namespace::Options options;
+    db_namespace::DestroyDB(dbPath, options);
+}
+
+TEST(TestPersistentStorage, TestFrameFetcherVp8)
+{
+#ifndef __ANDROID__
+    std::string dbPath("/tmp/testdb-vp8");
+#else
+    std::string dbPath("/data/local/tmp/testdb-vp8");
+#endif
+
+    boost::asio::io_service io_source;
+    boost::shared_ptr<boost::asio::io_service::work> work_source(boost::make_shared<boost::asio::io_service::work>(io_source));
+    boost::thread t_source([&io_source](){
+        io_source.run();
+    });
+
+    int runTime = 1*3*1000;
+    int width = 320, height = 240;
+    boost::shared_ptr<RawFrame> frame(boost::make_shared<ArgbFrame>(width,height));
+    std::string testVideoSource = resources_path+"/test-source-320x240.argb";
+    VideoSource source(io_source, testVideoSource, frame);
+    MockExternalCapturer capturer;
+    source.addCapturer(&capturer);
+
+    std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
+    boost::shared_ptr<Face> publisherFace(boost::make_shared<ThreadsafeFace>(io_source));
+    boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
+    publisherFace->setCommandSigningInfo(*keyChain, certName(keyName(appPrefix)));
+
+    // fetcher must pick decoder from thread meta, not the default one
+    MediaStreamSettings settings(io_source, getSampleVideoParams("vp8"));
+    settings.face_ = publisherFace.get();
+    settings.keyChain_ = keyChain.get();
+    settings.storagePath_ = dbPath;
+    
+    LocalVideoStream localStream(appPrefix, settings);
+
+    boost::function<int(const unsigned int,const unsigned int, unsigned char*, unsigned int)>
+      incomingRawFrame =[&localStream](const unsigned int w,const unsigned int h, unsigned char* data, unsigned int size){
+          EXPECT_NO_THROW(localStream.incomingArgbFrame(w, h, data, size));
+          return 0;
+      };
+    EXPECT_CALL(capturer, incomingArgbFrame(width, height, _, _))
+        .WillRepeatedly(Invoke(incomingRawFrame));
+
+    source.start(30);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(runTime));
+    work_source.reset();
+    io_source.stop();
+    t_source.join();
+
+    std::vector<uint8_t> frameBuffer(width*height*4);
+    int nFetched = 0;
+
+    OnBufferAllocate onBufferAllocate = 
+        [&frameBuffer](const boost::shared_ptr<IFrameFetcher>&, int w, int h)->uint8_t*
+        {
+            frameBuffer.resize(w*h*4);
+            return frameBuffer.data();
+        };
+    OnFrameFetched onFrameFetched = 
+        [&nFetched, width, height](const boost::shared_ptr<IFrameFetcher>&, const FrameInfo fi, 
+                    int nFetchedFrames, int w, int h, const uint8_t* buffer)
+        {
+            EXPECT_EQ(width, w);
+            EXPECT_EQ(height, h);
+            nFetched++;
+        };
+    OnFetchFailure onFetchFailure = 
+        [](const boost::shared_ptr<IFrameFetcher>& ff, std::string reason)
+        {
+            FAIL() << "Frame fetching failed (" << ff->getName() <<"): " << reason;
+        };
+
+    Name threadPrefix(localStream.getPrefix());
+    threadPrefix.append(localStream.getThreads()[0]);
+    Name keyFrame(threadPrefix), deltaFrame(threadPrefix);
+    keyFrame.append(NameComponents::NameComponentKey).appendSequenceNumber(1);
+    deltaFrame.append(NameComponents::NameComponentDelta).appendSequenceNumber(10);
+
+    boost::shared_ptr<FrameFetcher> fetcher = boost::make_shared<FrameFetcher>(localStream.getStorage());
+
+    fetcher->fetch(keyFrame, onBufferAllocate, onFrameFetched, onFetchFailure);
+    EXPECT_EQ(1, nFetched);
+    fetcher->fetch(deltaFrame, onBufferAllocate, onFrameFetched, onFetchFailure);
+    EXPECT_EQ(2, nFetched);
+
+    boost::shared_ptr<FrameFetcher> rangeFetcher = boost::make_shared<FrameFetcher>(localStream.getStorage());
+    rangeFetcher->fetchRange(deltaFrame, 10, 2, onBufferAllocate, onFrameFetched, onFetchFailure);
+    EXPECT_EQ(12, nFetched);
+    EXPECT_EQ(FrameFetcher::Completed, rangeFetcher->getState());
+
+    db_namespace::Options options;
+    db_namespace::DestroyDB(dbPath, options);
+}
+
+TEST(TestPersistentStorage, TestBenchmarkFrameRangeFetch)
+{
+#ifndef __ANDROID__
+    std::string dbPath("/tmp/testdb-range");
+#else
+    std::string dbPath("/data/local/tmp/testdb-range");
+#endif
+
+#ifdef ENABLE_LOGGING
+    ndnlog::new_api::Logger::initAsyncLogging();
+    ndnlog::new_api::Logger::getLoggerPtr("")->setLogLevel(ndnlog::NdnLoggerDetailLevelDefault);
+#endif
+
+    boost::asio::io_service io_source;
+    boost::shared_ptr<boost::asio::io_service::work> work_source(boost::make_shared<boost::asio::io_service::work>(io_source));
+    boost::thread t_source([&io_source](){
+        io_source.run();
+    });
+
+    int runTime = 1*10*1000;
+    int width = 320, height = 240;
+    boost::shared_ptr<RawFrame> frame(boost::make_shared<ArgbFrame>(width,height));
+    std::string testVideoSource = resources_path+"/test-source-320x240.argb";
+    VideoSource source(io_source, testVideoSource, frame);
+    MockExternalCapturer capturer;
+    source.addCapturer(&capturer);
+
+    std::string appPrefix = "/ndn/edu/ucla/remap/peter/app";
+    boost::shared_ptr<Face> publisherFace(boost::make_shared<ThreadsafeFace>(io_source));
+    boost::shared_ptr<KeyChain> keyChain = memoryKeyChain(appPrefix);
+    publisherFace->setCommandSigningInfo(*keyChain, certName(keyName(appPrefix)));
+
+    MediaStreamSettings settings(io_source, getSampleVideoParams());
+    settings.face_ = publisherFace.get();
+    settings.keyChain_ = keyChain.get();
+    settings.storagePath_ = dbPath;
+    
+    LocalVideoStream localStream(appPrefix, settings);
+
+    boost::function<int(const unsigned int,const unsigned int, unsigned char*, unsigned int)>
+      incomingRawFrame =[&localStream](const unsigned int w,const unsigned int h, unsigned char* data, unsigned int size){
+          EXPECT_NO_THROW(localStream.incomingArgbFrame(w, h, data, size));
+          return 0;
+      };
+    EXPECT_CALL(capturer, incomingArgbFrame(width, height, _, _))
+        .WillRepeatedly(Invoke(incomingRawFrame));
+
+    source.start(30);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(runTime));
+    work_source.reset();
+    io_source.stop();
+    t_source.join();
+
+    int nFrames = 200;
+    Name startFrameName(localStream.getPrefix());
+    startFrameName.append(localStream.getThreads()[0])
+                  .append(NameComponents::NameComponentDelta)
+                  .appendSequenceNumber(0);
+    std::vector<uint8_t> frameBuffer(width*height*4);
+    int nFetched = 0;
+    Name lastFrameName;
+
+    OnBufferAllocate onBufferAllocate = 
+        [&frameBuffer](const boost::shared_ptr<IFrameFetcher>&, int w, int h)->uint8_t*
+        {
+            frameBuffer.resize(w*h*4);
+            return frameBuffer.data();
+        };
+    OnFrameFetched onFrameFetched = 
+        [&nFetched](const boost::shared_ptr<IFrameFetcher>&, const FrameInfo fi, 
+                    int nFetchedFrames, int w, int h, const uint8_t* buffer)
+        {
+            nFetched++;
+        };
+    OnFetchFailure onFetchFailure = 
+        [](const boost::shared_ptr<IFrameFetcher>& ff, std::string reason)
+        {
+            FAIL() << "Frame fetching failed (" << ff->getName() <<"): " << reason;
+        };
+
+    {
+        // baseline: fetching frames one by one
+        boost::shared_ptr<FrameFetcher> fetcher = boost::make_shared<FrameFetcher>(localStream.getStorage());
+        boost::chrono::high_resolution_clock::time_point t1 = boost::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < nFrames; ++i)
+        {
+            Name frameName(startFrameName.getPrefix(-1));
+            frameName.appendSequenceNumber(i);
+            fetcher->fetch(frameName, onBufferAllocate, onFrameFetched, onFetchFailure);
+        }
+
+        boost::chrono::high_resolution_clock::time_point t2 = boost::chrono::high_resolution_clock::now();
+        int d = boost::chrono::duration_cast<boost::chrono::milliseconds>(t2 - t1).count();
+
+        EXPECT_EQ(nFrames, nFetched);
+        GT_PRINTF("single frame fetch: %d frames in %d ms (%.2f frames/sec)\n",
+                  nFetched, d, (d ? (double)nFetched/(double)d*1000. : 0.));
+    }
+
+    for (auto budget:{1, 10, 30})
+    {
+        // range fetching (new cache for each run, so GOPs are decoded again)
+        boost::shared_ptr<FrameFetcher> fetcher = boost::make_shared<FrameFetcher>(localStream.getStorage());
+        fetcher->setInFlightBudget(budget);
+        nFetched = 0;
+
+        boost::chrono::high_resolution_clock::time_point t1 = boost::chrono::high_resolution_clock::now();
+        fetcher->fetchRange(startFrameName, nFrames, 1, onBufferAllocate, onFrameFetched, onFetchFailure);
+        boost::chrono::high_resolution_clock::time_point t2 = boost::chrono::high_resolution_clock::now();
+        int d = boost::chrono::duration_cast<boost::chrono::milliseconds>(t2 - t1).count();
+
+        EXPECT_EQ(nFrames, nFetched);
+        EXPECT_EQ(FrameFetcher::Completed, fetcher->getState());
+        GT_PRINTF("range fetch (budget %d): %d frames in %d ms (%.2f frames/sec)\n",
+                  budget, nFetched, d, (d ? (double)nFetched/(double)d*1000. : 0.));
+    }
+
+    {
+        // range fetching with stride (thumbnails)
+        boost::shared_ptr<FrameFetcher> fetcher = boost::make_shared<FrameFetcher>(localStream.getStorage());
+        Name endFrameName(startFrameName.getPrefix(-1));
+        endFrameName.appendSequenceNumber(nFrames-1);
+        nFetched = 0;
+
+        boost::chrono::high_resolution_clock::time_point t1 = boost::chrono::high_resolution_clock::now();
+        fetcher->fetchRange(startFrameName, endFrameName, 10, onBufferAllocate, onFrameFetched, onFetchFailure);
+        boost::chrono::high_resolution_clock::time_point t2 = boost::chrono::high_resolution_clock::now();
+        int d = boost::chrono::duration_cast<boost::chrono::milliseconds>(t2 - t1).count();
+
+        EXPECT_EQ(nFrames/10, nFetched);
+        GT_PRINTF("range fetch (stride 10): %d frames in %d ms (%.2f frames/sec)\n",
+                  nFetched, d, (d ? (double)nFetched/(double)d*1000. : 0.));
+    }
+
+    db_namespace::Options options;
+    db_namespace::DestroyDB(dbPath, options);
+}
 #endif
 
+TEST(TestPersistentStorage, TestStorageEngineBatchPut)
+{
+#ifndef __ANDROID__
+    std::string dbPath("/tmp/testdb-batch");
+#else
+    std::string dbPath("/data/local/tmp/testdb-batch");
+#endif
+
+    {
+        StorageEngine storage(dbPath);
+        std::vector<boost::shared_ptr<const Data>> batch;
+        Name frameName("/ndn/edu/ucla/remap/peter/app/ndnrtc/%FD%03/video/camera/%FC%00%00%01c_%27%DE%D6/tiny/d/%FE%07");
+        int nSegments = 10;
+
+        for (int i = 0; i < nSegments; ++i)
+        {
+            boost::shared_ptr<Data> d = boost::make_shared<Data>(Name(frameName).appendSegment(i));
+            std::vector<uint8_t> content(1000, (uint8_t)i);
+            d->setContent(content);
+            batch.push_back(d);
+        }
+
+        EXPECT_TRUE(storage.put(batch));
+
+        for (int i = 0; i < nSegments; ++i)
+        {
+            boost::shared_ptr<Data> d = storage.get(Name(frameName).appendSegment(i));
+            ASSERT_TRUE(d.get());
+            EXPECT_EQ(1000, d->getContent().size());
+            EXPECT_EQ(i, d->getContent().buf()[0]);
+        }
+        EXPECT_FALSE(storage.get(Name(frameName).appendSegment(nSegments)));
+    }
+
+    db_namespace::Options options;
+    db_namespace::DestroyDB(dbPath, options);
+}
+
+TEST(TestPersistentStorage, TestSegmentLogStorage)
+{
+#ifndef __ANDROID__
+    std::string dbPath("/tmp/testdb-log");
+#else
+    std::string dbPath("/data/local/tmp/testdb-log");
+#endif
+
+    boost::filesystem::remove_all(dbPath);
+
+    Name frameName("/ndn/edu/ucla/remap/peter/app/ndnrtc/%FD%03/video/camera/%FC%00%00%01c_%27%DE%D6/tiny/d/%FE%07");
+    int nSegments = 10;
+
+    {
+        StorageEngine storage(dbPath, false, StorageEngine::SegmentLogBackend);
+        std::vector<boost::shared_ptr<const Data>> batch;
+
+        for (int i = 0; i < nSegments-1; ++i)
+        {
+            boost::shared_ptr<Data> d = boost::make_shared<Data>(Name(frameName).appendSegment(i));
+            std::vector<uint8_t> content(1000, (uint8_t)i);
+            d->setContent(content);
+            batch.push_back(d);
+        }
+
+        EXPECT_TRUE(storage.put(batch));
+        {
+            Data d(Name(frameName).appendSegment(nSegments-1));
+            std::vector<uint8_t> content(1000, (uint8_t)(nSegments-1));
+            d.setContent(content);
+            storage.put(d);
+        }
+
+        for (int i = 0; i < nSegments; ++i)
+        {
+            boost::shared_ptr<Data> d = storage.get(Name(frameName).appendSegment(i));
+            ASSERT_TRUE(d.get());
+            EXPECT_EQ(1000, d->getContent().size());
+            EXPECT_EQ(i, d->getContent().buf()[0]);
+        }
+        EXPECT_FALSE(storage.get(Name(frameName).appendSegment(nSegments)));
+    }
+
+    {
+        // reopen read-only: index is loaded from the index file
+        StorageEngine storage(dbPath, true, StorageEngine::SegmentLogBackend);
+        boost::shared_ptr<Data> d = storage.get(Name(frameName).appendSegment(5));
+        ASSERT_TRUE(d.get());
+        EXPECT_EQ(5, d->getContent().buf()[0]);
+
+        // prefix read returns the rightmost segment
+        Interest i(frameName);
+        i.setCanBePrefix(true);
+        d = storage.read(i);
+        ASSERT_TRUE(d.get());
+        EXPECT_EQ(Name(frameName).appendSegment(nSegments-1), d->getName());
+
+        // zero-copy read
+        size_t wireLength = 0;
+        Interest exact(Name(frameName).appendSegment(0));
+        EXPECT_TRUE(storage.read(exact, [&wireLength](const uint8_t* wire, size_t length){
+            wireLength = length;
+        }));
+        EXPECT_EQ(storage.get(exact.getName())->wireEncode().size(), wireLength);
+
+        bool scanned = false;
+        boost::asio::io_service io;
+        storage.scanForLongestPrefixes(io, [&scanned, frameName](const std::vector<Name>& prefixes){
+            ASSERT_EQ(1, prefixes.size());
+            EXPECT_EQ(frameName, prefixes[0]);
+            scanned = true;
+        });
+        io.run();
+        EXPECT_TRUE(scanned);
+        EXPECT_EQ(nSegments, storage.getKeysNum());
+    }
+
+    {
+        // index file is gone (i.e. crash) -- index is recovered from the log
+        boost::filesystem::remove(dbPath+"/segments.idx");
+        StorageEngine storage(dbPath, true, StorageEngine::SegmentLogBackend);
+
+        for (int i = 0; i < nSegments; ++i)
+            EXPECT_TRUE(storage.get(Name(frameName).appendSegment(i)).get());
+    }
+
+    boost::filesystem::remove_all(dbPath);
+}
+
+TEST(TestPersistentStorage, TestSegmentLogTornTail)
+{
+#ifndef __ANDROID__
+    std::string dbPath("/tmp/testdb-log-torn");
+#else
+    std::string dbPath("/data/local/tmp/testdb-log-torn");
+#endif
+
+    boost::filesystem::remove_all(dbPath);
+
+    Name frameName("/ndn/edu/ucla/remap/peter/app/ndnrtc/%FD%03/video/camera/%FC%00%00%01c_%27%DE%D6/tiny/d/%FE%07");
+    std::string logPath = dbPath+"/segments.log";
+    int nSegments = 5;
+    uintmax_t logSize = 0;
+
+    {
+        SegmentLog log(dbPath);
+        std::vector<boost::shared_ptr<const Data>> batch;
+
+        for (int i = 0; i < nSegments; ++i)
+        {
+            boost::shared_ptr<Data> d = boost::make_shared<Data>(Name(frameName).appendSegment(i));
+            std::vector<uint8_t> content(1000, (uint8_t)i);
+            d->setContent(content);
+            batch.push_back(d);
+        }
+        EXPECT_TRUE(log.append(batch));
+        EXPECT_FALSE(log.isFailed());
+    }
+    logSize = boost::filesystem::file_size(logPath);
+
+    for (bool withIndex:{true, false})
+    {
+        {
+            // interrupted write: record header and a part of the record
+            std::ofstream f(logPath, std::ios::binary|std::ios::app);
+            uint32_t hdr[3] = { 0x4e52534c, 10, 1000 };
+            std::vector<char> partial(500, 'x');
+            f.write((const char*)hdr, sizeof(hdr));
+            f.write(partial.data(), partial.size());
+        }
+        if (!withIndex)
+            boost::filesystem::remove(dbPath+"/segments.idx");
+
+        SegmentLog log(dbPath);
+
+        // log is truncated to the last whole record
+        EXPECT_EQ(logSize, boost::filesystem::file_size(logPath));
+        EXPECT_EQ(nSegments, log.getKeysNum());
+
+        int nFound = 0;
+        for (int i = 0; i < nSegments; ++i)
+            nFound += log.get(Name(frameName).appendSegment(i).toUri(), 
+                              [i](const uint8_t* wire, size_t length){
+                                Data d;
+                                d.wireDecode(wire, length);
+                                EXPECT_EQ(i, d.getContent().buf()[0]);
+                              });
+        EXPECT_EQ(nSegments, nFound);
+    }
+
+    {
+        // appends continue after the last whole record
+        SegmentLog log(dbPath);
+        boost::shared_ptr<Data> d = boost::make_shared<Data>(Name(frameName).appendSegment(nSegments));
+        d->setContent(std::vector<uint8_t>(1000, (uint8_t)nSegments));
+        EXPECT_TRUE(log.append({d}));
+    }
+    {
+        boost::filesystem::remove(dbPath+"/segments.idx");
+        SegmentLog log(dbPath, true);
+        EXPECT_EQ(nSegments+1, log.getKeysNum());
+    }
+
+    boost::filesystem::remove_all(dbPath);
+}
+
+TEST(TestPersistentStorage, TestDecodedFrameCache)
+{
+    int gopSize = 10, nGops = 3;
+    DecodedFrameCache cache(2*gopSize);
+    Name threadPrefix("/ndn/edu/ucla/remap/peter/app/ndnrtc/%FD%03/video/camera/%FC%00%00%01c_%27%DE%D6/tiny");
+    VideoCoderParams params = sampleVideoCoderParams();
+    std::vector<Name> keyNames;
+
+    for (int g = 0; g < nGops; ++g)
+    {
+        Name keyName = Name(threadPrefix).append(NameComponents::NameComponentKey).appendSequenceNumber(g);
+        boost::shared_ptr<DecodedFrameCache::GopEntry> gop = cache.addGop(keyName, params);
+        keyNames.push_back(keyName);
+
+        ASSERT_TRUE(gop.get());
+        EXPECT_EQ(gop, cache.getGop(keyName));
+
+        for (int i = 0; i < gopSize; ++i)
+        {
+            Name frameName = (i == 0 ? keyName : 
+                Name(threadPrefix).append(NameComponents::NameComponentDelta).appendSequenceNumber(g*gopSize+i));
+            FrameInfo fi({(uint64_t)i, g*gopSize+i, frameName.toUri(), i == 0});
+            WebRtcVideoFrame frame(WebRtcVideoFrameBuffer::Create(320, 240), webrtc::kVideoRotation_0, 0);
+
+            cache.addFrame(gop, frameName, fi, frame);
+            gop->nextDeltaNo_ = g*gopSize+i+1;
+        }
+    }
+
+    // least recently used GOP must have been evicted
+    EXPECT_EQ(2*gopSize, cache.getFramesNum());
+    EXPECT_EQ(2, cache.getGopsNum());
+    EXPECT_FALSE(cache.getGop(keyNames[0]).get());
+
+    DecodedFrameCache::CachedFrame cachedFrame;
+    Name deltaName = Name(threadPrefix).append(NameComponents::NameComponentDelta).appendSequenceNumber(2*gopSize+5);
+    EXPECT_TRUE(cache.getFrame(deltaName, cachedFrame));
+    EXPECT_EQ(2*gopSize+5, cachedFrame.frameInfo_.playbackNo_);
+
+    EXPECT_FALSE(cache.getFrame(keyNames[0], cachedFrame));
+    EXPECT_TRUE(cache.getFrame(keyNames[1], cachedFrame));
+    EXPECT_EQ(320, cachedFrame.frame_->width());
+    EXPECT_TRUE(cachedFrame.frameInfo_.isKey_);
+
+    // GOP #1 was accessed recently, thus GOP #2 is evicted next
+    {
+        Name keyName = Name(threadPrefix).append(NameComponents::NameComponentKey).appendSequenceNumber(nGops);
+        boost::shared_ptr<DecodedFrameCache::GopEntry> gop = cache.addGop(keyName, params);
+        WebRtcVideoFrame frame(WebRtcVideoFrameBuffer::Create(320, 240), webrtc::kVideoRotation_0, 0);
+        cache.addFrame(gop, keyName, FrameInfo({0, 0, keyName.toUri(), true}), frame);
+    }
+
+    EXPECT_TRUE(cache.getGop(keyNames[1]).get());
+    EXPECT_FALSE(cache.getGop(keyNames[2]).get());
+    EXPECT_EQ(gopSize+1, cache.getFramesNum());
+}
+
 void handler(int sig) {
   void *array[10];
   size_t size;
@@ -0,0 +1,344 @@
+//
+// test-producer-cache.cc
+//
+//  Created by Peter Gusev on 30 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include <stdlib.h>
+#include <boost/thread.hpp>
+#include <ndn-cpp/face.hpp>
+#include <ndn-cpp/digest-sha256-signature.hpp>
+
+#include "gtest/gtest.h"
+#include "src/producer-cache.hpp"
+
+using namespace ndnrtc;
+using namespace ndn;
+
+static const std::string StreamPrefix = "/ndn/edu/ucla/remap/peter/ndncon/instance1/ndnrtc/%FD%02/video/camera";
+static const std::string ThreadPrefix = StreamPrefix + "/%FC%00%00%01c_%27%DE%D6/hi";
+
+Data makeData(const Name &name, size_t payloadSize = 1000, double freshnessMs = 1000)
+{
+    std::vector<uint8_t> payload(payloadSize, 0);
+    uint8_t digest[ndn_SHA256_DIGEST_SIZE] = {0};
+
+    Data d(name);
+    d.setContent(payload.data(), payload.size());
+    d.getMetaInfo().setFreshnessPeriod(freshnessMs);
+    d.setSignature(DigestSha256Signature());
+    ((DigestSha256Signature *)d.getSignature())->setSignature(Blob(digest, sizeof(digest)));
+    return d;
+}
+
+Name segmentName(const std::string &cls, int seqNo, int segNo, bool parity = false)
+{
+    Name n(ThreadPrefix);
+    n.append(cls).appendSequenceNumber(seqNo);
+    if (parity)
+        n.append(NameComponents::NameComponentParity);
+    return n.appendSegment(segNo);
+}
+
+TEST(TestProducerCache, TestFindSegments)
+{
+    Face face("aleph.ndn.ucla.edu");
+    ProducerCache cache(&face);
+
+    for (int seqNo = 0; seqNo < 30; ++seqNo)
+        for (int segNo = 0; segNo < 5; ++segNo)
+        {
+            cache.add(makeData(segmentName("d", seqNo, segNo)));
+            if (segNo < 2)
+                cache.add(makeData(segmentName("d", seqNo, segNo, true)));
+        }
+    cache.add(makeData(segmentName("k", 0, 0)));
+
+    EXPECT_EQ(31, cache.getCachedSamplesNum());
+    EXPECT_LT(31 * 5 * 1000, cache.getCachedBytes());
+
+    for (int seqNo = 0; seqNo < 30; ++seqNo)
+        for (int segNo = 0; segNo < 5; ++segNo)
+        {
+            boost::shared_ptr<const Data> d = cache.find(Interest(segmentName("d", seqNo, segNo)));
+            ASSERT_TRUE(d.get());
+            EXPECT_EQ(segmentName("d", seqNo, segNo), d->getName());
+        }
+
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", 10, 1, true))).get());
+    EXPECT_TRUE(cache.find(Interest(segmentName("k", 0, 0))).get());
+
+    // sample prefix matches any segment of the sample
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", 10, 0).getPrefix(-1))).get());
+
+    EXPECT_FALSE(cache.find(Interest(segmentName("d", 10, 2, true))).get());
+    EXPECT_FALSE(cache.find(Interest(segmentName("d", 10, 5))).get());
+    EXPECT_FALSE(cache.find(Interest(segmentName("d", 30, 0))).get());
+    EXPECT_FALSE(cache.find(Interest(segmentName("k", 1, 0))).get());
+
+    // same sample of another stream instance
+    Name otherInstance(StreamPrefix);
+    otherInstance.append("%FC%00%00%01c_%27%DE%D7").append("hi").append("d")
+                 .appendSequenceNumber(0).appendSegment(0);
+    EXPECT_FALSE(cache.find(Interest(otherInstance)).get());
+}
+
+TEST(TestProducerCache, TestFindMeta)
+{
+    Face face("aleph.ndn.ucla.edu");
+    ProducerCache cache(&face);
+    Name metaPrefix(ThreadPrefix);
+    metaPrefix.append(NameComponents::NameComponentMeta);
+
+    for (int v = 0; v < 5; ++v)
+        cache.add(makeData(Name(metaPrefix).appendVersion(v).appendSegment(0), 100, 10));
+
+    EXPECT_EQ(0, cache.getCachedSamplesNum());
+
+    Interest i(metaPrefix);
+    i.setChildSelector(1);
+    boost::shared_ptr<const Data> d = cache.find(i);
+    ASSERT_TRUE(d.get());
+    EXPECT_EQ(Name(metaPrefix).appendVersion(4).appendSegment(0), d->getName());
+
+    i.setChildSelector(0);
+    d = cache.find(i);
+    ASSERT_TRUE(d.get());
+    EXPECT_EQ(Name(metaPrefix).appendVersion(0).appendSegment(0), d->getName());
+
+    // meta becomes stale after 10ms
+    i.setMustBeFresh(true);
+    EXPECT_TRUE(cache.find(i).get());
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(20));
+    EXPECT_FALSE(cache.find(i).get());
+    i.setMustBeFresh(false);
+    EXPECT_TRUE(cache.find(i).get());
+}
+
+TEST(TestProducerCache, TestPendingInterests)
+{
+    Face face("aleph.ndn.ucla.edu");
+    ProducerCache cache(&face);
+    ProducerCache::PendingInterests pending;
+
+    // consumers request ahead of producer
+    for (int seqNo = 0; seqNo < 10; ++seqNo)
+        for (int segNo = 0; segNo < 3; ++segNo)
+            cache.onInterest(boost::shared_ptr<const Name>(),
+                             boost::make_shared<Interest>(segmentName("d", seqNo, segNo), 2000),
+                             face, 0, boost::shared_ptr<const InterestFilter>());
+    cache.onInterest(boost::shared_ptr<const Name>(),
+                     boost::make_shared<Interest>(Name(ThreadPrefix).append(NameComponents::NameComponentMeta), 2000),
+                     face, 0, boost::shared_ptr<const InterestFilter>());
+
+    EXPECT_EQ(31, cache.getPendingInterestsNum());
+
+    cache.getPendingInterestsForName(segmentName("d", 5, 1), pending);
+    ASSERT_EQ(1, pending.size());
+    EXPECT_EQ(segmentName("d", 5, 1), pending[0]->getInterest()->getName());
+
+    cache.getPendingInterestsWithPrefix(segmentName("d", 5, 0).getPrefix(-1), pending);
+    EXPECT_EQ(3, pending.size());
+
+    cache.getPendingInterestsWithPrefix(Name(StreamPrefix), pending);
+    EXPECT_EQ(31, pending.size());
+
+    cache.getPendingInterestsForName(segmentName("d", 11, 0), pending);
+    EXPECT_EQ(0, pending.size());
+
+    // publishing data removes pending interests, face is not connected, so
+    // data is not actually sent
+    cache.add(makeData(segmentName("d", 5, 1)));
+    cache.getPendingInterestsForName(segmentName("d", 5, 1), pending);
+    EXPECT_EQ(0, pending.size());
+    EXPECT_EQ(30, cache.getPendingInterestsNum());
+
+    cache.add(makeData(Name(ThreadPrefix).append(NameComponents::NameComponentMeta).appendVersion(0).appendSegment(0)));
+    EXPECT_EQ(29, cache.getPendingInterestsNum());
+
+    // cached data is not stored as pending
+    cache.onInterest(boost::shared_ptr<const Name>(),
+                     boost::make_shared<Interest>(segmentName("d", 5, 1), 2000),
+                     face, 0, boost::shared_ptr<const InterestFilter>());
+    EXPECT_EQ(29, cache.getPendingInterestsNum());
+}
+
+TEST(TestProducerCache, TestPendingTimeout)
+{
+    Face face("aleph.ndn.ucla.edu");
+    ProducerCache cache(&face);
+    ProducerCache::PendingInterests pending;
+
+    for (int seqNo = 0; seqNo < 10; ++seqNo)
+        cache.onInterest(boost::shared_ptr<const Name>(),
+                         boost::make_shared<Interest>(segmentName("d", seqNo, 0), 50),
+                         face, 0, boost::shared_ptr<const InterestFilter>());
+    EXPECT_EQ(10, cache.getPendingInterestsNum());
+
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+
+    // timed out interests are not returned and removed on next interest
+    cache.getPendingInterestsWithPrefix(Name(ThreadPrefix), pending);
+    EXPECT_EQ(0, pending.size());
+
+    cache.onInterest(boost::shared_ptr<const Name>(),
+                     boost::make_shared<Interest>(segmentName("d", 10, 0), 2000),
+                     face, 0, boost::shared_ptr<const InterestFilter>());
+    EXPECT_EQ(1, cache.getPendingInterestsNum());
+}
+
+TEST(TestProducerCache, TestExtractPendingBefore)
+{
+    Face face("aleph.ndn.ucla.edu");
+    ProducerCache cache(&face);
+    ProducerCache::PendingInterests pending;
+
+    for (int seqNo = 0; seqNo < 10; ++seqNo)
+        for (int segNo = 0; segNo < 2; ++segNo)
+        {
+            cache.onInterest(boost::shared_ptr<const Name>(),
+                             boost::make_shared<Interest>(segmentName("d", seqNo, segNo), 2000),
+                             face, 0, boost::shared_ptr<const InterestFilter>());
+            cache.onInterest(boost::shared_ptr<const Name>(),
+                             boost::make_shared<Interest>(segmentName("k", seqNo, segNo), 2000),
+                             face, 0, boost::shared_ptr<const InterestFilter>());
+        }
+    EXPECT_EQ(40, cache.getPendingInterestsNum());
+
+    cache.extractPendingInterestsBefore(segmentName("d", 6, 0).getPrefix(-1), pending);
+    EXPECT_EQ(12, pending.size());
+    for (auto &pi : pending)
+    {
+        NamespaceInfo info;
+        ASSERT_TRUE(NameComponents::extractInfo(pi->getInterest()->getName(), info));
+        EXPECT_EQ(SampleClass::Delta, info.class_);
+        EXPECT_GT(6, info.sampleNo_);
+    }
+    EXPECT_EQ(28, cache.getPendingInterestsNum());
+
+    // nothing left before the same sample
+    cache.extractPendingInterestsBefore(segmentName("d", 6, 0).getPrefix(-1), pending);
+    EXPECT_EQ(0, pending.size());
+
+    // face is not connected, errors are caught
+    std::vector<boost::shared_ptr<const Data>> nacks;
+    cache.extractPendingInterestsBefore(segmentName("k", 3, 0).getPrefix(-1), pending);
+    EXPECT_EQ(6, pending.size());
+    for (auto &pi : pending)
+        nacks.push_back(boost::make_shared<Data>(makeData(pi->getInterest()->getName(), 4)));
+    EXPECT_NO_THROW(cache.putData(pending, nacks));
+    EXPECT_EQ(22, cache.getPendingInterestsNum());
+}
+
+TEST(TestProducerCache, TestEviction)
+{
+    Face face("aleph.ndn.ucla.edu");
+    size_t segSize = makeData(segmentName("d", 0, 0)).getDefaultWireEncoding().size();
+    // room for 10 samples of 3 segments
+    ProducerCache cache(&face, 200, 30 * segSize);
+
+    for (int seqNo = 0; seqNo < 50; ++seqNo)
+        for (int segNo = 0; segNo < 3; ++segNo)
+            cache.add(makeData(segmentName("d", seqNo, segNo)));
+
+    EXPECT_GE(30 * segSize, cache.getCachedBytes());
+    EXPECT_EQ(10, cache.getCachedSamplesNum());
+    EXPECT_FALSE(cache.find(Interest(segmentName("d", 39, 0))).get());
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", 40, 0))).get());
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", 49, 2))).get());
+
+    // samples older than lifetime are evicted on next add
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(300));
+    cache.add(makeData(segmentName("k", 0, 0)));
+
+    EXPECT_EQ(1, cache.getCachedSamplesNum());
+    EXPECT_EQ(segSize, cache.getCachedBytes());
+    EXPECT_FALSE(cache.find(Interest(segmentName("d", 49, 2))).get());
+
+    // rings restart after being emptied
+    cache.add(makeData(segmentName("d", 100, 0)));
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", 100, 0))).get());
+}
+
+TEST(TestProducerCache, TestUnindexedSegments)
+{
+    Face face("aleph.ndn.ucla.edu");
+    ProducerCache cache(&face);
+    size_t segSize = makeData(segmentName("d", 0, 0)).getDefaultWireEncoding().size();
+
+    for (int segNo = 0; segNo < 3; ++segNo)
+    {
+        Data d(makeData(segmentName("d", 0, segNo)));
+        d.getMetaInfo().setFinalBlockId(Name::Component::fromSegment(2));
+        cache.add(d);
+    }
+
+    // NACKs for segments requested by consumers (names come from interests)
+    Data nack(makeData(segmentName("d", 0, 0xffffffff), 4));
+    nack.getMetaInfo().setType(ndn_ContentType_NACK);
+    cache.add(nack);
+    Data parityNack(makeData(segmentName("d", 0, 1000000, true), 4));
+    parityNack.getMetaInfo().setType(ndn_ContentType_NACK);
+    cache.add(parityNack);
+    // segment beyond sample's final block
+    Data beyond(makeData(segmentName("d", 0, 5)));
+    beyond.getMetaInfo().setFinalBlockId(Name::Component::fromSegment(2));
+    cache.add(beyond);
+    // segment without final block id is indexed up to a limit
+    cache.add(makeData(segmentName("d", 0, 2000000)));
+
+    EXPECT_EQ(1, cache.getCachedSamplesNum());
+    // unindexed segments take no more than their own size
+    EXPECT_GE(6 * segSize, cache.getCachedBytes());
+
+    for (int segNo = 0; segNo < 3; ++segNo)
+        EXPECT_TRUE(cache.find(Interest(segmentName("d", 0, segNo))).get());
+
+    boost::shared_ptr<const Data> d = cache.find(Interest(segmentName("d", 0, 0xffffffff)));
+    ASSERT_TRUE(d.get());
+    EXPECT_EQ(ndn_ContentType_NACK, d->getMetaInfo().getType());
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", 0, 1000000, true))).get());
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", 0, 5))).get());
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", 0, 2000000))).get());
+    EXPECT_FALSE(cache.find(Interest(segmentName("d", 0, 4))).get());
+
+    // indexed segment takes precedence over a NACK with the same name
+    Data nack1(makeData(segmentName("d", 0, 1), 4));
+    nack1.getMetaInfo().setType(ndn_ContentType_NACK);
+    cache.add(nack1);
+    d = cache.find(Interest(segmentName("d", 0, 1)));
+    ASSERT_TRUE(d.get());
+    EXPECT_NE(ndn_ContentType_NACK, d->getMetaInfo().getType());
+}
+
+TEST(TestProducerCache, TestFarSample)
+{
+    Face face("aleph.ndn.ucla.edu");
+    ProducerCache cache(&face);
+
+    for (int seqNo = 0; seqNo < 10; ++seqNo)
+        cache.add(makeData(segmentName("d", seqNo, 0)));
+
+    // e.g. thread restarted its' sequence numbers while old samples are cached
+    int farSeqNo = 10 + 1024 + 100;
+    cache.add(makeData(segmentName("d", farSeqNo, 0)));
+    cache.add(makeData(segmentName("d", farSeqNo, 1)));
+
+    EXPECT_EQ(10, cache.getCachedSamplesNum());
+    for (int segNo = 0; segNo < 2; ++segNo)
+    {
+        boost::shared_ptr<const Data> d = cache.find(Interest(segmentName("d", farSeqNo, segNo)));
+        ASSERT_TRUE(d.get());
+        EXPECT_EQ(segmentName("d", farSeqNo, segNo), d->getName());
+    }
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", farSeqNo, 0).getPrefix(-1))).get());
+    EXPECT_FALSE(cache.find(Interest(segmentName("d", farSeqNo, 2))).get());
+    EXPECT_TRUE(cache.find(Interest(segmentName("d", 5, 0))).get());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,210 @@
+//
+// test-simple-log.cc
+//
+//  Created by Peter Gusev on 31 March 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include <stdlib.h>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "gtest/gtest.h"
+#include "simple-log.hpp"
+
+using namespace ndnlog;
+using namespace ndnlog::new_api;
+
+class LoggingObject : public ILoggingObject
+{
+  public:
+    LoggingObject() { description_ = "test-object"; }
+
+    int evaluated_ = 0;
+
+    int evaluate() { return ++evaluated_; }
+
+    void logAll(int i)
+    {
+        LogTraceC << "trace " << i << " " << evaluate() << std::endl;
+        LogDebugC << "debug " << i << " " << evaluate() << std::endl;
+        LogInfoC << "info " << i << " " << evaluate() << std::endl;
+        LogWarnC << "warn " << i << " " << evaluate() << std::endl;
+        LogErrorC << "error " << i << " " << evaluate() << std::endl;
+    }
+};
+
+class RecordsCollector
+{
+  public:
+    void onRecord(const char *record)
+    {
+        boost::lock_guard<boost::mutex> guard(mutex_);
+        records_.push_back(record);
+    }
+
+    std::vector<std::string> getRecords()
+    {
+        boost::lock_guard<boost::mutex> guard(mutex_);
+        return records_;
+    }
+
+  private:
+    boost::mutex mutex_;
+    std::vector<std::string> records_;
+};
+
+boost::shared_ptr<Logger> makeLogger(RecordsCollector &collector, NdnLoggerDetailLevel level)
+{
+    boost::shared_ptr<ILogRecordSink> sink =
+        boost::make_shared<CallbackSink>(LoggerSinkCallbackFun([&collector](const char *record) {
+            collector.onRecord(record);
+        }));
+    return boost::make_shared<Logger>(level, sink);
+}
+
+TEST(TestSimpleLog, TestDisabledLevels)
+{
+    Logger::initAsyncLogging();
+
+    RecordsCollector collector;
+    LoggingObject obj;
+
+    // no logger - nothing is evaluated
+    obj.logAll(0);
+    EXPECT_EQ(0, obj.evaluated_);
+
+    obj.setLogger(makeLogger(collector, NdnLoggerDetailLevelDefault));
+    obj.logAll(1);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+
+    // records of disabled levels (at run time or compile time) don't
+    // evaluate their arguments
+    int nEnabled = 0;
+#if defined(NDN_INFO)
+    nEnabled++;
+#endif
+#if defined(NDN_WARN)
+    nEnabled++;
+#endif
+#if defined(NDN_ERROR)
+    nEnabled++;
+#endif
+
+    EXPECT_EQ(nEnabled, obj.evaluated_);
+    ASSERT_EQ(nEnabled, collector.getRecords().size());
+#if defined(NDN_INFO) && defined(NDN_WARN) && defined(NDN_ERROR)
+    EXPECT_NE(std::string::npos, collector.getRecords()[0].find("info 1 1"));
+    EXPECT_NE(std::string::npos, collector.getRecords()[0].find("test-object"));
+    EXPECT_NE(std::string::npos, collector.getRecords()[2].find("[ERROR]"));
+#endif
+
+    obj.getLogger()->setLogLevel(NdnLoggerDetailLevelNone);
+    obj.logAll(2);
+    obj.getLogger()->log(NdnLoggerLevelError) << "not logged" << std::endl;
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+
+    EXPECT_EQ(nEnabled, obj.evaluated_);
+    EXPECT_EQ(nEnabled, collector.getRecords().size());
+
+    Logger::releaseAsyncLogging();
+}
+
+TEST(TestSimpleLog, TestMultipleThreads)
+{
+    Logger::initAsyncLogging();
+
+    RecordsCollector collector;
+    boost::shared_ptr<Logger> logger = makeLogger(collector, NdnLoggerDetailLevelAll);
+    int nThreads = 4, nRecords = 200;
+    std::vector<boost::thread> threads;
+
+    for (int t = 0; t < nThreads; ++t)
+        threads.push_back(boost::thread([logger, t, nRecords]() {
+            for (int i = 0; i < nRecords; ++i)
+            {
+                logger->log(NdnLoggerLevelInfo) << "thread " << t << " record " << i << std::endl;
+                if (i % 50 == 0)
+                    boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
+            }
+        }));
+
+    for (auto &t : threads)
+        t.join();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+
+    std::vector<std::string> records = collector.getRecords();
+    EXPECT_EQ(nThreads * nRecords, records.size());
+
+    // records are not interleaved and keep order within a thread
+    std::vector<int> last(nThreads, -1);
+    for (auto &r : records)
+    {
+        int t, i;
+        size_t pos = r.find("thread ");
+        ASSERT_NE(std::string::npos, pos);
+        ASSERT_EQ(2, sscanf(r.c_str() + pos, "thread %d record %d", &t, &i));
+        EXPECT_EQ('\n', r.back());
+        EXPECT_EQ(last[t] + 1, i);
+        last[t] = i;
+    }
+
+    Logger::releaseAsyncLogging();
+}
+
+TEST(TestSimpleLog, TestQueueOverflow)
+{
+    // log thread is not running, so queue is not drained
+    RecordsCollector collector;
+    boost::shared_ptr<Logger> logger = makeLogger(collector, NdnLoggerDetailLevelAll);
+
+    for (int i = 0; i < Logger::QueueCapacity + 10; ++i)
+        logger->log(NdnLoggerLevelInfo) << "record " << i << std::endl;
+
+    Logger::initAsyncLogging();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+
+    std::vector<std::string> records = collector.getRecords();
+    ASSERT_EQ(Logger::QueueCapacity + 1, records.size());
+    EXPECT_NE(std::string::npos, records.back().find("dropped 10 records"));
+
+    Logger::releaseAsyncLogging();
+}
+
+TEST(TestSimpleLog, TestRecordQueue)
+{
+    LogRecordQueue queue(4);
+    std::string record;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        record = std::to_string(i);
+        EXPECT_TRUE(queue.push(record));
+        EXPECT_TRUE(record.empty());
+    }
+
+    record = "4";
+    EXPECT_FALSE(queue.push(record));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue.pop(record));
+        EXPECT_EQ(std::to_string(i), record);
+    }
+    EXPECT_FALSE(queue.pop(record));
+
+    // wraps around
+    for (int i = 0; i < 10; ++i)
+    {
+        record = std::to_string(i);
+        EXPECT_TRUE(queue.push(record));
+        EXPECT_TRUE(queue.pop(record));
+        EXPECT_EQ(std::to_string(i), record);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -31,6 +31,82 @@ TEST(TestCoder, TestCreate)
     // delete vc;
 }
 
+TEST(TestCoder, TestCodecFactory)
+{
+    VideoCodecFactory &factory = VideoCodecFactory::getSharedInstance();
+    MockEncoderDelegate coderDelegate;
+
+    EXPECT_TRUE(factory.isSupported("vp8"));
+    EXPECT_TRUE(factory.isSupported("vp9"));
+    EXPECT_FALSE(factory.isSupported("theora"));
+    EXPECT_EQ(webrtc::kVideoCodecVP8, factory.getCodecType("vp8"));
+    EXPECT_ANY_THROW(factory.getCodecType("theora"));
+
+    for (auto codec : factory.getCodecs())
+    {
+        VideoCoderParams vcp(sampleVideoCoderParams());
+        vcp.codec_ = codec;
+        EXPECT_EQ(factory.getCodecType(codec), VideoCoder::codecFromSettings(vcp).codecType);
+        EXPECT_NO_THROW({ VideoCoder vc(vcp, &coderDelegate); });
+    }
+
+    {
+        VideoCoderParams vcp(sampleVideoCoderParams());
+        vcp.codec_ = "theora";
+        EXPECT_ANY_THROW({ VideoCoder vc(vcp, &coderDelegate); });
+    }
+}
+
+TEST(TestCoder, TestRetarget)
+{
+    VideoCoderParams vcp(sampleVideoCoderParams());
+    vcp.startBitrate_ = 1000;
+    vcp.maxBitrate_ = 1000;
+    vcp.encodeWidth_ = 1280;
+    vcp.encodeHeight_ = 720;
+    vcp.gop_ = 30;
+    MockEncoderDelegate coderDelegate;
+    VideoCoder vc(vcp, &coderDelegate);
+    WebRtcVideoFrame frame(std::move(getFrame(1280, 720)));
+    WebRtcVideoFrame scaledFrame(std::move(getFrame(640, 360)));
+    std::vector<std::pair<int, webrtc::FrameType>> encoded;
+
+    EXPECT_CALL(coderDelegate, onEncodingStarted())
+        .Times(AtLeast(1));
+    EXPECT_CALL(coderDelegate, onEncodedFrame(_))
+        .WillRepeatedly(Invoke([&encoded](const webrtc::EncodedImage &img) {
+            encoded.push_back(std::make_pair(img._encodedWidth, img._frameType));
+        }));
+    EXPECT_CALL(coderDelegate, onDroppedFrame())
+        .Times(AnyNumber());
+
+    EXPECT_TRUE(vc.isKeyFrameDue());
+    vc.onRawFrame(frame);
+    vc.onRawFrame(frame);
+    EXPECT_FALSE(vc.isKeyFrameDue());
+
+    // rate change does not restart GOP
+    vc.setRate(2000, 15);
+    EXPECT_EQ(2000u, vc.getParams().startBitrate_);
+    EXPECT_EQ(2000u, vc.getParams().maxBitrate_);
+    EXPECT_EQ(15, vc.getParams().codecFrameRate_);
+    EXPECT_FALSE(vc.isKeyFrameDue());
+    vc.onRawFrame(frame);
+
+    // resolution change starts new GOP
+    vc.setResolution(640, 360);
+    EXPECT_EQ(640u, vc.getParams().encodeWidth_);
+    EXPECT_EQ(360u, vc.getParams().encodeHeight_);
+    EXPECT_TRUE(vc.isKeyFrameDue());
+    vc.onRawFrame(scaledFrame);
+
+    ASSERT_EQ(4, encoded.size());
+    EXPECT_EQ(1280, encoded[2].first);
+    EXPECT_NE(webrtc::kVideoFrameKey, encoded[2].second);
+    EXPECT_EQ(640, encoded[3].first);
+    EXPECT_EQ(webrtc::kVideoFrameKey, encoded[3].second);
+}
+
 TEST(TestCoder, TestEncode)
 {
 #ifdef ENABLE_LOGGING
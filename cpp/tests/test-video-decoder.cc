@@ -9,8 +9,10 @@
 
 #include "gtest/gtest.h"
 #include "src/video-decoder.hpp"
+#include "src/decoder-worker.hpp"
 #include "tests-helpers.hpp"
 #include "mock-objects/encoder-delegate-mock.hpp"
+#include "mock-objects/external-renderer-mock.hpp"
 
 using namespace ::testing;
 using namespace ndnrtc;
@@ -68,6 +70,214 @@ TEST(TestDecoder, TestEncodeDecode2K)
 	EXPECT_EQ(nEncoded, nDecoded);
 }
 
+TEST(TestDecoderWorker, TestDecodeAhead)
+{
+	int nFrames = 30*2;
+	int width = 640;
+	int height = 360;
+	std::vector<WebRtcVideoFrame> frames = getFrameSequence(width, height, nFrames);
+
+	VideoCoderParams vcp(sampleVideoCoderParams());
+	vcp.startBitrate_ = 1000;
+	vcp.maxBitrate_ = 1000;
+	vcp.encodeWidth_ = width;
+	vcp.encodeHeight_ = height;
+	vcp.dropFramesOn_ = false;
+	MockEncoderDelegate coderDelegate;
+	coderDelegate.setDefaults();
+	VideoCoder vc(vcp, &coderDelegate);
+
+	// playout owns encoded frames only for the duration of processFrame call
+	std::vector<std::pair<webrtc::EncodedImage, boost::shared_ptr<std::vector<uint8_t>>>> encoded;
+	EXPECT_CALL(coderDelegate, onEncodedFrame(_))
+		.Times(AtLeast(1))
+		.WillRepeatedly(Invoke([&encoded](const webrtc::EncodedImage& img){
+			boost::shared_ptr<std::vector<uint8_t>> data = 
+				boost::make_shared<std::vector<uint8_t>>(img._buffer, img._buffer+img._length);
+			encoded.push_back(std::make_pair(img, data));
+		}));
+	EXPECT_CALL(coderDelegate, onEncodingStarted())
+		.Times(nFrames);
+	EXPECT_CALL(coderDelegate, onDroppedFrame())
+		.Times(AtLeast(0));
+
+	for (auto& f:frames) vc.onRawFrame(f);
+	ASSERT_LT(0, encoded.size());
+
+	std::vector<int> rendered;
+	DecoderWorker worker(vcp, [&rendered, width, height](const FrameInfo& fi, const WebRtcVideoFrame &f){
+		EXPECT_EQ(f.width(), width);
+		EXPECT_EQ(f.height(), height);
+		rendered.push_back(fi.playbackNo_);
+	});
+
+	// playout ticks: each tick queues next frame and renders a ready one
+	for (int i = 0; i < encoded.size(); ++i)
+	{
+		FrameInfo fi = { 0, i, "/phony/name", encoded[i].first._frameType == webrtc::kVideoFrameKey };
+		webrtc::EncodedImage img(encoded[i].first);
+		img._buffer = encoded[i].second->data();
+
+		worker.processFrame(fi, img);
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(30));
+	}
+
+	// first tick has nothing to render yet
+	EXPECT_EQ(encoded.size()-1, rendered.size());
+	for (int i = 1; i < rendered.size(); ++i)
+		EXPECT_EQ(rendered[i-1]+1, rendered[i]);
+	EXPECT_EQ(1, worker.getReadyNum());
+
+	worker.stop();
+	EXPECT_EQ(0, worker.getReadyNum());
+	EXPECT_EQ(0, worker.getQueueSize());
+}
+
+TEST(TestDecoderWorker, TestDecoderBehind)
+{
+	int nFrames = 30*2;
+	int width = 640;
+	int height = 360;
+	std::vector<WebRtcVideoFrame> frames = getFrameSequence(width, height, nFrames);
+
+	VideoCoderParams vcp(sampleVideoCoderParams());
+	vcp.encodeWidth_ = width;
+	vcp.encodeHeight_ = height;
+	vcp.gop_ = 15;
+	vcp.dropFramesOn_ = false;
+	MockEncoderDelegate coderDelegate;
+	coderDelegate.setDefaults();
+	VideoCoder vc(vcp, &coderDelegate);
+
+	std::vector<std::pair<webrtc::EncodedImage, boost::shared_ptr<std::vector<uint8_t>>>> encoded;
+	EXPECT_CALL(coderDelegate, onEncodedFrame(_))
+		.Times(AtLeast(1))
+		.WillRepeatedly(Invoke([&encoded](const webrtc::EncodedImage& img){
+			boost::shared_ptr<std::vector<uint8_t>> data = 
+				boost::make_shared<std::vector<uint8_t>>(img._buffer, img._buffer+img._length);
+			encoded.push_back(std::make_pair(img, data));
+		}));
+	EXPECT_CALL(coderDelegate, onEncodingStarted())
+		.Times(nFrames);
+	EXPECT_CALL(coderDelegate, onDroppedFrame())
+		.Times(AtLeast(0));
+
+	for (auto& f:frames) vc.onRawFrame(f);
+	ASSERT_EQ(nFrames, encoded.size());
+
+	// ready pictures are never dropped, thus gaps in rendered frames come
+	// from decoder queue overflows only
+	std::vector<FrameInfo> rendered;
+	DecoderWorker worker(vcp, [&rendered](const FrameInfo& fi, const WebRtcVideoFrame &f){
+		rendered.push_back(fi);
+	}, nFrames, 2);
+
+	for (int i = 0; i < encoded.size(); ++i)
+	{
+		FrameInfo fi = { 0, i, "/phony/name", encoded[i].first._frameType == webrtc::kVideoFrameKey };
+		webrtc::EncodedImage img(encoded[i].first);
+		img._buffer = encoded[i].second->data();
+
+		worker.processFrame(fi, img);
+		// first half of frames is queued much faster than it can be decoded
+		if (i >= nFrames/2)
+			boost::this_thread::sleep_for(boost::chrono::milliseconds(30));
+
+		EXPECT_LE(worker.getQueueSize(), 2);
+	}
+
+	ASSERT_LT(0, rendered.size());
+	EXPECT_TRUE(rendered.front().isKey_);
+
+	int nOverflows = 0;
+	for (int i = 1; i < rendered.size(); ++i)
+		if (rendered[i].playbackNo_ != rendered[i-1].playbackNo_+1)
+		{
+			// frames were dropped, decoding resumed from the next key frame
+			nOverflows++;
+			EXPECT_TRUE(rendered[i].isKey_) << rendered[i].playbackNo_ << "p";
+			EXPECT_EQ(webrtc::kVideoFrameKey, encoded[rendered[i].playbackNo_].first._frameType);
+		}
+
+	EXPECT_LT(0, nOverflows);
+	// paced frames were decoded after the overflow
+	EXPECT_LE(nFrames/2, rendered.back().playbackNo_);
+
+	worker.stop();
+}
+
+TEST(TestDecoderWorker, TestRenderI420)
+{
+	int width = 640;
+	int height = 360;
+	std::vector<WebRtcVideoFrame> frames = getFrameSequence(width, height, 1);
+
+	VideoCoderParams vcp(sampleVideoCoderParams());
+	vcp.encodeWidth_ = width;
+	vcp.encodeHeight_ = height;
+	MockEncoderDelegate coderDelegate;
+	coderDelegate.setDefaults();
+	VideoCoder vc(vcp, &coderDelegate);
+
+	MockExternalRenderer renderer;
+	std::vector<uint8_t> rgbBuffer(width*height*4);
+	int nDecoded = 0;
+	VideoDecoder vdc(vcp, [&](const FrameInfo& fi, const WebRtcVideoFrame &f){
+		nDecoded++;
+		rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer = f.video_frame_buffer();
+
+		{ // I420 renderer gets decoder's planes, even if it returns no buffer
+			EXPECT_CALL(renderer, getFrameBuffer(width, height, _))
+				.WillOnce(DoAll(SetArgPointee<2>(IExternalRenderer::kI420), Return(nullptr)));
+			EXPECT_CALL(renderer, renderFrame(_,_,_,_))
+				.Times(0);
+			EXPECT_CALL(renderer, renderI420Frame(_, width, height, _, _))
+				.WillOnce(Invoke([&buffer](const FrameInfo&, int, int,
+										   const uint8_t* const planes[3], const int strides[3]){
+					EXPECT_EQ(buffer->DataY(), planes[0]);
+					EXPECT_EQ(buffer->DataU(), planes[1]);
+					EXPECT_EQ(buffer->DataV(), planes[2]);
+					EXPECT_EQ(buffer->StrideY(), strides[0]);
+					EXPECT_EQ(buffer->StrideU(), strides[1]);
+					EXPECT_EQ(buffer->StrideV(), strides[2]);
+				}));
+			EXPECT_TRUE(renderDecodedFrame(&renderer, fi, f));
+			Mock::VerifyAndClearExpectations(&renderer);
+		}
+		{ // RGB renderer gets converted frame in its' buffer
+			EXPECT_CALL(renderer, getFrameBuffer(width, height, _))
+				.WillOnce(Return(rgbBuffer.data()));
+			EXPECT_CALL(renderer, renderI420Frame(_,_,_,_,_))
+				.Times(0);
+			EXPECT_CALL(renderer, renderFrame(_, width, height, rgbBuffer.data()))
+				.Times(1);
+			EXPECT_TRUE(renderDecodedFrame(&renderer, fi, f));
+			Mock::VerifyAndClearExpectations(&renderer);
+		}
+		{ // RGB renderer skips frame
+			EXPECT_CALL(renderer, getFrameBuffer(width, height, _))
+				.WillOnce(Return(nullptr));
+			EXPECT_CALL(renderer, renderFrame(_,_,_,_))
+				.Times(0);
+			EXPECT_FALSE(renderDecodedFrame(&renderer, fi, f));
+			Mock::VerifyAndClearExpectations(&renderer);
+		}
+	});
+
+	FrameInfo phony = { 0, 0, "/phony/name", true };
+	EXPECT_CALL(coderDelegate, onEncodedFrame(_))
+		.WillOnce(Invoke([&vdc, &phony](const webrtc::EncodedImage& img){
+			vdc.processFrame(phony, img);
+		}));
+	EXPECT_CALL(coderDelegate, onEncodingStarted())
+		.Times(1);
+	EXPECT_CALL(coderDelegate, onDroppedFrame())
+		.Times(0);
+
+	vc.onRawFrame(frames[0]);
+	EXPECT_EQ(1, nDecoded);
+}
+
 int main(int argc, char **argv) {
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
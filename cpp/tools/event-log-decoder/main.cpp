@@ -0,0 +1,142 @@
+//
+// main.cpp
+//
+//  Created by Peter Gusev on 1 April 2019.
+//  Copyright 2013-2019 Regents of the University of California
+//
+
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../contrib/docopt/docopt.h"
+#include "../../include/event-log.hpp"
+
+static const char USAGE[] =
+R"(Event Log Decoder.
+
+    Usage:
+      event-log-decoder <event_log> [ --format=<format> --output=<file_name> --unix-time ]
+
+    Arguments:
+      <event_log>          Binary event log file written by ndnrtc.
+
+    Options:
+      -f --format=<format>       Output format: csv or json (one object per line) [default: csv]
+      -o --output=<file_name>    Write output to a file instead of stdout
+      -u --unix-time             Convert timestamps to unix time (microseconds)
+)";
+
+using namespace std;
+using namespace ndnrtc::eventlog;
+
+// names of event arguments, as documented in event-log.hpp
+static const char *const *argNames(Event event)
+{
+    static const char *const stateTransition[] = {"from", "to", "event", "duration_ms", "arg4"};
+    static const char *const sampleRequested[] = {"key", "sample_no", "interests", "deadline", "arg4"};
+    static const char *const segment[] = {"key", "sample_no", "seg_no", "parity", "size"};
+    static const char *const networkNack[] = {"key", "sample_no", "seg_no", "parity", "reason"};
+    static const char *const slotRequested[] = {"key", "sample_no", "requested", "slots", "arg4"};
+    static const char *const slotAssembling[] = {"key", "sample_no", "fetched", "asm_level", "state"};
+    static const char *const slotReady[] = {"key", "sample_no", "fetched", "longest_drd_us", "arg4"};
+    static const char *const rtx[] = {"key", "sample_no", "pending", "playback_in_ms", "arg4"};
+    static const char *const generic[] = {"arg0", "arg1", "arg2", "arg3", "arg4"};
+
+    switch (event)
+    {
+    case Event::StateTransition:
+        return stateTransition;
+    case Event::SampleRequested:
+    case Event::SegmentsRerequested:
+        return sampleRequested;
+    case Event::SegmentArrived:
+    case Event::SegmentTimeout:
+    case Event::AppNack:
+        return segment;
+    case Event::NetworkNack:
+        return networkNack;
+    case Event::SlotRequested:
+        return slotRequested;
+    case Event::SlotAssembling:
+        return slotAssembling;
+    case Event::SlotReady:
+        return slotReady;
+    case Event::RtxRequired:
+        return rtx;
+    default:
+        return generic;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::map<std::string, docopt::value> args = docopt::docopt(USAGE, {argv + 1, argv + argc}, true,
+                                                               (string("Event Log Decoder ") + string(PACKAGE_VERSION)).c_str());
+
+    string format = args["--format"].asString();
+    bool unixTime = args["--unix-time"].asBool();
+
+    if (format != "csv" && format != "json")
+    {
+        cerr << "unsupported format " << format << endl;
+        return 1;
+    }
+
+    EventLogHeader header;
+    vector<EventRecord> records;
+
+    try
+    {
+        EventLog::read(args["<event_log>"].asString(), header, records);
+    }
+    catch (std::exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    ofstream outFile;
+    if (args["--output"])
+        outFile.open(args["--output"].asString());
+    ostream &out = (args["--output"] ? outFile : cout);
+
+    if (header.writePos_ > records.size())
+        cerr << header.writePos_ - records.size()
+             << " records were overwritten or incomplete" << endl;
+
+    if (format == "csv")
+        out << "seq_no,timestamp_us,component,event,instance,arg0,arg1,arg2,arg3,arg4" << endl;
+
+    for (auto &r : records)
+    {
+        int64_t ts = (unixTime ? header.startUnixUs_ + (r.timestampUs_ - header.startTimestampUs_)
+                               : r.timestampUs_);
+        const char *component = EventLog::toString((Component)r.component_);
+        const char *event = EventLog::toString((Event)r.event_);
+
+        if (format == "csv")
+        {
+            out << r.seqNo_ << "," << ts << "," << component << "," << event << ","
+                << r.instance_;
+            for (int i = 0; i < 5; ++i)
+                out << "," << r.args_[i];
+            out << "\n";
+        }
+        else
+        {
+            const char *const *names = argNames((Event)r.event_);
+
+            out << "{\"seq_no\":" << r.seqNo_ << ",\"timestamp_us\":" << ts
+                << ",\"component\":\"" << component << "\",\"event\":\"" << event
+                << "\",\"instance\":" << r.instance_;
+            for (int i = 0; i < 5; ++i)
+                out << ",\"" << names[i] << "\":" << r.args_[i];
+            out << "}\n";
+        }
+    }
+
+    out.flush();
+    return 0;
+}
@@ -32,12 +32,13 @@ static const char USAGE[] =
 R"(Networked Storage.
 
     Usage:
-      networked-storage <db_path> [--verbose]
+      networked-storage <db_path> [--segment-log] [--verbose]
 
     Arguments:
       <db_path>            Path to persistent storage DB
 
     Options:
+      --segment-log        Storage is a segment log (see stream-recorder)
       -v --verbose         Verbose output
 )";
 
@@ -106,7 +107,8 @@ int main(int argc, char **argv)
 
     // setup storage
     boost::shared_ptr<StorageEngine> storage = 
-        boost::make_shared<StorageEngine>(args["<db_path>"].asString(), true);
+        boost::make_shared<StorageEngine>(args["<db_path>"].asString(), true,
+            (args["--segment-log"].asBool() ? StorageEngine::SegmentLogBackend : StorageEngine::KeyValueBackend));
 
     // setup face and keychain
     boost::shared_ptr<Face> face = boost::make_shared<ThreadsafeFace>(io);
@@ -156,15 +158,14 @@ void registerPrefix(boost::shared_ptr<Face> &face, const Name &prefix,
                             Face &face, uint64_t, const boost::shared_ptr<const InterestFilter> &) 
                             {
                              LogTrace("") << "Incoming interest " << interest->getName() << std::endl;
-                             boost::shared_ptr<Data> d = storage->read(*interest);
-
-                             if (d)
-                             {
-                                LogTrace("") << "Retrieved data of size " << d->getContent().size() 
-                                             << ": " << d->getName() << std::endl;
-                                face.putData(*d);
-                             }
-                             else
+                             // data wire is sent as is, without decoding
+                             bool found = storage->read(*interest, 
+                                [&face](const uint8_t* wire, size_t wireLength){
+                                    LogTrace("") << "Retrieved data of size " << wireLength << std::endl;
+                                    face.send(wire, wireLength);
+                                });
+
+                             if (!found)
                                 LogTrace("") << "no data for " << interest->getName() << std::endl;
                          },
                          [](const boost::shared_ptr<const Name> &prefix) 
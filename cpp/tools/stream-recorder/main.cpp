@@ -33,21 +33,26 @@ static const char USAGE[] =
 R"(Stream Recorder.
 
     Usage:
-      stream-recorder <thread_prefix> [--db-path=<db_path> --direction=<dir> | --seed=<seed_frame> | --noverify | --limit=<n_frames> | --pipeline=<p_size> | --lifetime=<ms> | --verbose]
+      stream-recorder <prefix>... [--db-path=<db_path> --direction=<dir> | --seed=<seed_frame> | --noverify | --limit=<n_frames> | --pipeline=<p_size> | --budget=<n_frames> | --lifetime=<ms> | --write-queue=<n_batches> | --segment-log | --verbose]
 
     Arguments:
-      <thread_prefix>      ndnrtc (API v3) stream prefix WITH thread name. For example:
+      <prefix>             ndnrtc (API v3) stream prefix WITH thread name. For example:
                             /ndn/user/rtc/ndnrtc/%FD%03/video/camera/%FC%00%00%01fU%98%BBA/1080p
+                           If thread name is omitted (i.e. /ndn/user/rtc/ndnrtc/%FD%03/video/camera), 
+                           all threads of the stream are recorded. Several prefixes may be given.
                            See [ndnrtc namespace](https://github.com/remap/ndnrtc/blob/master/docs/namespace.pdf) for more info.
 
     Options:
       --db-path=<db_path>  Path for persistent storage DB [default: /tmp/ndnrtc-db]
+      --segment-log        Record into append-only segment log instead of RocksDB
       --direction=<dir>    Fetching direction: forward, backward, both [default: forward]
       --seed=<seed_frame>  Seed frame to start fetching from. If omitted or zero - starts from the most recent [default: 0]
       --noverify           Specifies, whether verification is not needed
       --limit=<n_frames>   Fetches only n_frames and quits. If omitted or zero - fetches all until stopped [default: 0]
       --lifetime=<ms>      Interests lifetime in milliseconds [default: 3000]
-      --pipeline=<p_size>  Specify pipeline size *in frames* [default: 5]
+      --pipeline=<p_size>  Specify pipeline size *in frames* per thread [default: 5]
+      --budget=<n_frames>  Maximum number of frames in flight across all threads. If zero - pipeline size times number of threads [default: 0]
+      --write-queue=<n_batches>  Maximum number of frames waiting to be written to storage before fetching pauses [default: 64]
       -v --verbose         Verbose output
 )";
 
@@ -96,12 +101,17 @@ int main(int argc, char **argv)
 
     ndnlog::new_api::Logger::getLogger("").setLogLevel(args["--verbose"].asBool() ? ndnlog::NdnLoggerDetailLevelAll : ndnlog::NdnLoggerDetailLevelDefault);
 
-    NamespaceInfo prefixInfo;
-    if (!NameComponents::extractInfo(args["<thread_prefix>"].asString(), prefixInfo) ||
-            prefixInfo.threadName_ == "")
+    vector<NamespaceInfo> targets;
+    for (auto& p:args["<prefix>"].asStringList())
     {
-        LogError("") << "Bad thread prefix provided" << endl;
-        exit(1);
+        NamespaceInfo prefixInfo;
+        if (!NameComponents::extractInfo(p, prefixInfo) ||
+                prefixInfo.streamName_ == "")
+        {
+            LogError("") << "Bad prefix provided: " << p << endl;
+            exit(1);
+        }
+        targets.push_back(prefixInfo);
     }
 
     int err = 0;
@@ -121,7 +131,8 @@ int main(int argc, char **argv)
 
     // setup storage
     boost::shared_ptr<StorageEngine> storage = 
-        boost::make_shared<StorageEngine>(args["--db-path"].asString());
+        boost::make_shared<StorageEngine>(args["--db-path"].asString(), false,
+            (args["--segment-log"].asBool() ? StorageEngine::SegmentLogBackend : StorageEngine::KeyValueBackend));
 
     // setup face and keychain
     // TODO: keychain setup for verification
@@ -134,17 +145,20 @@ int main(int argc, char **argv)
     // uint8_t directionMask;
     // StreamRecorder::FetchDirection::Forward
     {
-        StreamRecorder recorder(storage, prefixInfo, face, keyChain);
+        StreamRecorder recorder(storage, targets, face, keyChain);
         recorder.setLogger(ndnlog::new_api::Logger::getLoggerPtr(""));
 
-        LogInfo("") << "Will fetch stream " << prefixInfo.getPrefix(prefix_filter::Stream) 
-            << " (thread " << prefixInfo.threadName_ << ")" << endl;
+        for (auto& t:targets)
+            LogInfo("") << "Will fetch stream " << t.getPrefix(prefix_filter::Stream) 
+                << " (thread " << (t.threadName_ == "" ? "<all>" : t.threadName_) << ")" << endl;
 
         StreamRecorder::FetchSettings settings = StreamRecorder::Default;
         settings.pipelineSize_ = args["--pipeline"].asLong();
+        settings.inFlightBudget_ = args["--budget"].asLong();
         settings.lifetime_ = args["--lifetime"].asLong();
         settings.recordLength_ = args["--limit"].asLong();
         settings.seedFrame_ = args["--seed"].asLong();
+        settings.writeQueueSize_ = args["--write-queue"].asLong();
         if (args["--direction"].asString() == "forward")
             settings.direction_ = StreamRecorder::FetchDirection::Forward;
         if (args["--direction"].asString() == "backward")
@@ -173,6 +187,8 @@ int main(int argc, char **argv)
                      << " key #: " << stats.latestKeyFetched_
                      << " delta #: " << stats.latestDeltaFetched_
                      << " pp: " << stats.pendingFrames_
+                     << " wq: " << stats.writeQueueDepth_
+                     << " wlat: " << (int)stats.writeLatencyAvgUsec_ << "us"
                      << " ]" << flush;
             }
             usleep(30000);
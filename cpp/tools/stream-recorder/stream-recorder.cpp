@@ -7,12 +7,18 @@
 
 #include "stream-recorder.hpp"
 
+#include <deque>
+#include <set>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/atomic.hpp>
 #include <ndn-cpp/interest.hpp>
 #include <ndn-cpp/face.hpp>
 
 #include "../../include/name-components.hpp"
 #include "../../include/storage-engine.hpp"
 
+#include "../../src/clock.hpp"
 #include "../../src/frame-buffer.hpp"
 #include "../../src/network-data.hpp"
 #include "../../src/ndnrtc-object.hpp"
@@ -24,15 +30,61 @@ using namespace ndnrtc;
 using namespace ndn;
 
 const StreamRecorder::FetchSettings 
-StreamRecorder::Default = {3000, StreamRecorder::FetchDirection::Forward, 0, 0, 5, 100, 30};
+StreamRecorder::Default = {3000, StreamRecorder::FetchDirection::Forward, 0, 0, 5, 0, 100, 30, 64};
+
+// how often recorder re-checks write queue when it is saturated
+#define WRITE_QUEUE_RECHECK_MS 10
 
 namespace ndnrtc {
+    typedef std::vector<boost::shared_ptr<const Data>> DataBatch;
+
+    /**
+     * Commits batches of data packets into storage on a dedicated thread.
+     * The queue is soft-bounded: enqueue never blocks the caller (so face
+     * callbacks are never stalled), but isSaturated() tells the caller to 
+     * hold off issuing new requests until the writer catches up.
+     */
+    class StorageWriter {
+        public:
+            StorageWriter(const boost::shared_ptr<StorageEngine>& storage, size_t maxQueueSize);
+            ~StorageWriter();
+
+            void enqueue(const boost::shared_ptr<DataBatch>& batch);
+            bool isSaturated() const { return queueDepth_ >= maxQueueSize_; }
+            size_t getQueueDepth() const { return queueDepth_; }
+
+            /**
+             * Stops writer thread after all queued batches are written.
+             */
+            void stop();
+
+            /**
+             * Copies writer statistics into recorder stats.
+             */
+            void getStats(StreamRecorder::Stats& stats) const;
+
+        private:
+            boost::shared_ptr<StorageEngine> storage_;
+            size_t maxQueueSize_;
+            boost::thread thread_;
+            mutable boost::mutex mutex_;
+            boost::condition_variable queueCondition_;
+            std::deque<boost::shared_ptr<DataBatch>> queue_;
+            boost::atomic<size_t> queueDepth_;
+            bool stopped_;
+
+            uint64_t batchesWritten_, segmentsWritten_, writeErrors_;
+            double writeLatencyAvgUsec_, writeLatencyMaxUsec_;
+
+            void run();
+    };
+
     class StreamRecorderImpl : public NdnRtcComponent
     {
         friend class StreamRecorder;
         public:
             StreamRecorderImpl(const boost::shared_ptr<StorageEngine>& storageEngine, 
-                            const NamespaceInfo& ninfo,
+                            const std::vector<NamespaceInfo>& targets,
                             const boost::shared_ptr<Face>& face, 
                             const boost::shared_ptr<KeyChain> keyChain);
             ~StreamRecorderImpl(){}
@@ -44,31 +96,52 @@ namespace ndnrtc {
             void stop();
 
             bool isFetching() { return isFetching_; }
-            const string getStreamPrefix() const { return ninfo_.getPrefix(prefix_filter::Stream).toUri(); }
-            const string getThreadName() const { return ninfo_.threadName_; }
+            const string getStreamPrefix() const { return targets_.front().getPrefix(prefix_filter::Stream).toUri(); }
+            const string getThreadName() const { return targets_.front().threadName_; }
 
         private:
-            const NamespaceInfo ninfo_;
+            // recording state of one thread
+            typedef struct _ThreadRecord {
+                NamespaceInfo ninfo_;
+                bool isFetchingStream_, isKeyPending_;
+                pair<uint32_t, uint32_t> fetchIndex_;
+                size_t nPending_;
+                StreamRecorder::Stats stats_;
+            } ThreadRecord;
+
+            const std::vector<NamespaceInfo> targets_;
             boost::shared_ptr<StorageEngine> storage_;
             boost::shared_ptr<Face> face_;
             boost::shared_ptr<KeyChain> keyChain_;
-            bool isFetching_, isFetchingStream_;
+            bool isFetching_, isPipelineCheckScheduled_;
             StreamRecorder::FetchSettings settings_;
-            int32_t pipelineReserve_;
-            pair<uint32_t, uint32_t> fetchIndex_;
+            size_t inFlightBudget_, nPending_;
+
+            // threads are keyed by thread prefix (ThreadNT)
+            map<Name, boost::shared_ptr<ThreadRecord>> threads_;
+            // threads in the order they were added, for round-robin scheduling
+            vector<boost::shared_ptr<ThreadRecord>> threadQueue_;
+            size_t nextThreadIdx_;
 
             FetchingTask::Settings fetchTaskSettings_;
             boost::shared_ptr<IFetchMethod> frameFetchMethod_;
             map<Name, boost::shared_ptr<FrameFetchingTask>> fetchingTasks_;
+            boost::shared_ptr<StorageWriter> writer_;
             StreamRecorder::Stats stats_;
 
-            void fetchStreamMeta();
-            void fetchThreadMeta();
-            void initiateStreamFetching(const Blob& meta);
-            void requestFrame(const NamespaceInfo& frameInfo);
-            void requestNextFrame(const NamespaceInfo& fetchedFrame);
+            void fetchStreamMeta(const NamespaceInfo& streamInfo);
+            void fetchThreadMeta(const boost::shared_ptr<ThreadRecord>& thread);
+            void addThread(const NamespaceInfo& threadInfo);
+            void initiateStreamFetching(const boost::shared_ptr<ThreadRecord>& thread, const Blob& meta);
+            void requestFrame(const boost::shared_ptr<ThreadRecord>& thread, const NamespaceInfo& frameInfo);
+            void onFrameDone(const boost::shared_ptr<ThreadRecord>& thread, const NamespaceInfo& frameInfo);
 
-            void store(const boost::shared_ptr<const Data>&d);
+            boost::shared_ptr<ThreadRecord> nextThreadToFetch();
+            void fillPipeline();
+
+            void store(const boost::shared_ptr<DataBatch>& batch);
+            const StreamRecorder::Stats& getStats();
+            map<string, StreamRecorder::Stats> getThreadStats();
     };
 }
 
@@ -77,40 +150,60 @@ StreamRecorder::StreamRecorder(const boost::shared_ptr<StorageEngine>& storageEn
                         const NamespaceInfo& ninfo,
                         const boost::shared_ptr<Face>& face, 
                         const boost::shared_ptr<KeyChain> keyChain):
-pimpl_(boost::make_shared<StreamRecorderImpl>(storageEngine, ninfo, face, keyChain)){}
+pimpl_(boost::make_shared<StreamRecorderImpl>(storageEngine, std::vector<NamespaceInfo>({ninfo}), face, keyChain)){}
+StreamRecorder::StreamRecorder(const boost::shared_ptr<StorageEngine>& storageEngine, 
+                        const std::vector<NamespaceInfo>& targets,
+                        const boost::shared_ptr<Face>& face, 
+                        const boost::shared_ptr<KeyChain> keyChain):
+pimpl_(boost::make_shared<StreamRecorderImpl>(storageEngine, targets, face, keyChain)){}
 void StreamRecorder::start(const StreamRecorder::FetchSettings& settings) { pimpl_->start(settings); }
 void StreamRecorder::stop() { pimpl_->stop(); }
 bool StreamRecorder::isFetching() { return pimpl_->isFetching_; }
-const string StreamRecorder::getStreamPrefix() const { return pimpl_->ninfo_.getPrefix(prefix_filter::Stream).toUri(); }
-const string StreamRecorder::getThreadName() const { return pimpl_->ninfo_.threadName_; }
+const string StreamRecorder::getStreamPrefix() const { return pimpl_->getStreamPrefix(); }
+const string StreamRecorder::getThreadName() const { return pimpl_->getThreadName(); }
 void StreamRecorder::setLogger(const boost::shared_ptr<ndnlog::new_api::Logger>& logger) { pimpl_->setLogger(logger); }
-const StreamRecorder::Stats& StreamRecorder::getCurrentStats() const { return pimpl_->stats_; }
+const StreamRecorder::Stats& StreamRecorder::getCurrentStats() const { return pimpl_->getStats(); }
+map<string, StreamRecorder::Stats> StreamRecorder::getThreadStats() const { return pimpl_->getThreadStats(); }
 // ***
 
 StreamRecorderImpl::StreamRecorderImpl(const boost::shared_ptr<StorageEngine>& storageEngine, 
-                        const NamespaceInfo& ninfo,
+                        const std::vector<NamespaceInfo>& targets,
                         const boost::shared_ptr<Face>& face, 
                         const boost::shared_ptr<KeyChain> keyChain):
     storage_(storageEngine), face_(face), keyChain_(keyChain),
-    ninfo_(ninfo), isFetching_(false), isFetchingStream_(false)
+    targets_(targets), isFetching_(false), isPipelineCheckScheduled_(false),
+    inFlightBudget_(0), nPending_(0), nextThreadIdx_(0)
 {
-    if (ninfo_.streamType_ == MediaStreamParams::MediaStreamType::MediaStreamTypeAudio)
-        throw runtime_error("audio streams are not supported yet");
+    if (targets_.size() == 0)
+        throw runtime_error("no streams to record");
+
+    for (auto& t:targets_)
+        if (t.streamType_ == MediaStreamParams::MediaStreamType::MediaStreamTypeAudio)
+            throw runtime_error("audio streams are not supported yet");
+
+    description_ = "recorder-"+targets_.front().streamName_;
+    if (targets_.size() > 1)
+        description_ += "+"+boost::lexical_cast<string>(targets_.size()-1);
+    else if (targets_.front().threadName_ != "")
+        description_ += ":"+targets_.front().threadName_;
 
-    description_ = "recorder-"+ninfo.streamName_+":"+ninfo.threadName_;
     frameFetchMethod_ = boost::make_shared<FetchMethodRemote>(face_);
 }
 
 void 
 StreamRecorderImpl::start(const StreamRecorder::FetchSettings& settings)
 {
-    if (isFetching_ || isFetchingStream_)
+    if (isFetching_)
         throw runtime_error("Stream recorder is already fetching");
 
     settings_ = settings;
-    pipelineReserve_ = settings_.pipelineSize_;
     fetchTaskSettings_ = {3, settings_.lifetime_};
     memset((void*)&stats_, 0, sizeof(StreamRecorder::Stats));
+    writer_ = boost::make_shared<StorageWriter>(storage_, settings_.writeQueueSize_);
+    threads_.clear();
+    threadQueue_.clear();
+    nextThreadIdx_ = 0;
+    nPending_ = 0;
 
     LogInfoC << "recording direction: " 
         << ((settings_.direction_ & StreamRecorder::FetchDirection::Forward) && (settings_.direction_ & StreamRecorder::FetchDirection::Backward) ? "both" : 
@@ -118,135 +211,244 @@ StreamRecorderImpl::start(const StreamRecorder::FetchSettings& settings)
         << ", seed frame: " << settings_.seedFrame_
         << ", record length: " << settings_.recordLength_
         << ", interest lifetime: " << settings_.lifetime_
-        << ", pipeline: " << settings_.pipelineSize_ << endl;
+        << ", pipeline: " << (int)settings_.pipelineSize_
+        << ", in-flight budget: " << settings_.inFlightBudget_
+        << ", write queue: " << settings_.writeQueueSize_ << endl;
 
     isFetching_ = true;
-    fetchStreamMeta();
-    fetchThreadMeta();
+
+    // stream meta is fetched once per stream, even if several threads 
+    // of the same stream are recorded
+    set<Name> streams;
+    for (auto& t:targets_)
+    {
+        Name streamPrefix = t.getPrefix(prefix_filter::Stream);
+        if (streams.find(streamPrefix) == streams.end())
+        {
+            streams.insert(streamPrefix);
+            fetchStreamMeta(t);
+        }
+
+        if (t.threadName_ != "")
+            addThread(t);
+    }
 }
 
 void 
 StreamRecorderImpl::stop()
 {
     isFetching_ = false;
-    isFetchingStream_ = false;
     for (auto t:fetchingTasks_)
         t.second->cancel();
+
+    if (writer_)
+    {
+        writer_->stop();
+        writer_->getStats(stats_);
+    }
 }
 
 void 
-StreamRecorderImpl::fetchStreamMeta(){
-    Interest i(ninfo_.getPrefix(prefix_filter::Stream).append(NameComponents::NameComponentMeta), settings_.lifetime_);
+StreamRecorderImpl::fetchStreamMeta(const NamespaceInfo& streamInfo){
+    Interest i(streamInfo.getPrefix(prefix_filter::Stream).append(NameComponents::NameComponentMeta), settings_.lifetime_);
     boost::shared_ptr<StreamRecorderImpl> me = dynamic_pointer_cast<StreamRecorderImpl>(shared_from_this());
 
-    // LogDebugC << "fetching " << i.getName() << endl;
-
     SegmentFetcher::fetch(*face_, i, keyChain_.get(), 
-                        [me,this](const Blob &content,
+                        [me,this,streamInfo](const Blob &content,
                                   const vector<ValidationErrorInfo>&,
                                   const vector<boost::shared_ptr<Data>>& contentData){
-                                    for (auto d:contentData)
+                                    store(boost::make_shared<DataBatch>(contentData.begin(), contentData.end()));
+                                    stats_.streamMetaStored_++;
+
+                                    if (!isFetching_)
+                                        return;
+
+                                    // if whole stream is recorded, pick up all its threads
+                                    if (streamInfo.threadName_ == "")
                                     {
-                                        // LogTraceC << "store " << d->getName() << endl; 
-                                        store(d);
+                                        ImmutableHeaderPacket<DataSegmentHeader> packet(content);
+                                        NetworkData nd(packet.getPayload().size(), packet.getPayload().data());
+                                        MediaStreamMeta streamMeta(boost::move(nd));
+
+                                        for (auto& t:streamMeta.getThreads())
+                                        {
+                                            NamespaceInfo threadInfo = streamInfo;
+                                            threadInfo.threadName_ = t;
+                                            threadInfo.streamTimestamp_ = streamMeta.getStreamTimestamp();
+                                            addThread(threadInfo);
+                                        }
                                     }
-                                    stats_.streamMetaStored_++;
 
-                                    if (isFetching_)
-                                        face_->callLater(settings_.streamMetaFetchInterval_, 
-                                                         boost::bind(&StreamRecorderImpl::fetchStreamMeta, me));
+                                    face_->callLater(settings_.streamMetaFetchInterval_, 
+                                                     boost::bind(&StreamRecorderImpl::fetchStreamMeta, me, streamInfo));
                                   },
-                        [me, this](SegmentFetcher::ErrorCode code, 
+                        [me, this, streamInfo](SegmentFetcher::ErrorCode code, 
                                    const string& msg){
                                        LogErrorC << "failed to fetch stream meta: " << msg << endl;
                                        if (isFetching_) 
-                                            me->fetchStreamMeta();
+                                            me->fetchStreamMeta(streamInfo);
                                    });
 }
 
 void 
-StreamRecorderImpl::fetchThreadMeta(){
-    Interest i(ninfo_.getPrefix(prefix_filter::ThreadNT).append(NameComponents::NameComponentMeta), settings_.lifetime_);
+StreamRecorderImpl::fetchThreadMeta(const boost::shared_ptr<ThreadRecord>& thread){
+    Interest i(thread->ninfo_.getPrefix(prefix_filter::ThreadNT).append(NameComponents::NameComponentMeta), settings_.lifetime_);
     boost::shared_ptr<StreamRecorderImpl> me = dynamic_pointer_cast<StreamRecorderImpl>(shared_from_this());
 
-    // LogDebugC << "fetching " << i.getName() << endl;
-
     SegmentFetcher::fetch(*face_, i, keyChain_.get(), 
-                        [me,this](const Blob &content,
+                        [me,this,thread](const Blob &content,
                                   const vector<ValidationErrorInfo>&,
                                   const vector<boost::shared_ptr<Data>>& contentData){
-                                    for (auto d:contentData)
-                                    {
-                                        // LogTraceC << "store " << d->getName() << endl; 
-                                        store(d);
-                                    }
+                                    store(boost::make_shared<DataBatch>(contentData.begin(), contentData.end()));
                                     stats_.threadMetaStored_++;
+                                    thread->stats_.threadMetaStored_++;
 
                                     if (isFetching_)
                                     {
-                                        if (!isFetchingStream_)
-                                            initiateStreamFetching(content);
+                                        if (!thread->isFetchingStream_)
+                                            initiateStreamFetching(thread, content);
                                         face_->callLater(settings_.threadMetaFetchInterval_, 
-                                                         boost::bind(&StreamRecorderImpl::fetchThreadMeta, me));
+                                                         boost::bind(&StreamRecorderImpl::fetchThreadMeta, me, thread));
                                     }
                                   },
-                        [me, this](SegmentFetcher::ErrorCode code, 
+                        [me, this, thread](SegmentFetcher::ErrorCode code, 
                                    const string& msg){
-                                       LogErrorC << "failed to fetch stream meta: " << msg << endl;
+                                       LogErrorC << "failed to fetch thread meta for " 
+                                                 << thread->ninfo_.threadName_ << ": " << msg << endl;
                                        if (isFetching_) 
-                                            me->fetchStreamMeta();
+                                            me->fetchThreadMeta(thread);
                                    });
 }
 
 void
-StreamRecorderImpl::initiateStreamFetching(const Blob &metaBlob)
+StreamRecorderImpl::addThread(const NamespaceInfo& threadInfo)
+{
+    Name threadPrefix = threadInfo.getPrefix(prefix_filter::ThreadNT);
+    if (threads_.find(threadPrefix) != threads_.end())
+        return;
+
+    boost::shared_ptr<ThreadRecord> thread = boost::make_shared<ThreadRecord>();
+    thread->ninfo_ = threadInfo;
+    thread->isFetchingStream_ = false;
+    thread->isKeyPending_ = false;
+    thread->nPending_ = 0;
+    memset((void*)&thread->stats_, 0, sizeof(StreamRecorder::Stats));
+
+    threads_[threadPrefix] = thread;
+    threadQueue_.push_back(thread);
+
+    // global budget defaults to per-thread pipeline for every thread
+    inFlightBudget_ = (settings_.inFlightBudget_ ? settings_.inFlightBudget_ : 
+                        settings_.pipelineSize_ * threadQueue_.size());
+
+    LogInfoC << "recording thread " << threadPrefix 
+             << " (" << threads_.size() << " thread(s) total)" << endl;
+
+    fetchThreadMeta(thread);
+}
+
+void
+StreamRecorderImpl::initiateStreamFetching(const boost::shared_ptr<ThreadRecord>& thread, 
+                                           const Blob &metaBlob)
 {
-    isFetchingStream_ = true;
-    fetchIndex_.first = settings_.seedFrame_;
-    fetchIndex_.second = 0;
+    if (settings_.seedFrame_ != 0)
+        throw runtime_error("Seed frame is not supported yet!");
+
+    if (thread->ninfo_.streamType_ != MediaStreamParams::MediaStreamTypeVideo)
+        throw runtime_error("audio streams are not supported yet!");
 
-    if (fetchIndex_.first == 0)
+    // extract latest key and delta numbers from metadata
+    ImmutableHeaderPacket<DataSegmentHeader> packet(metaBlob);
+    NetworkData nd(packet.getPayload().size(), packet.getPayload().data());
+    VideoThreadMeta threadMeta(boost::move(nd));
+
+    thread->fetchIndex_.first = threadMeta.getSeqNo().second;
+    thread->fetchIndex_.second = threadMeta.getSeqNo().first;
+    thread->isFetchingStream_ = true;
+
+    fillPipeline();
+}
+
+boost::shared_ptr<StreamRecorderImpl::ThreadRecord> 
+StreamRecorderImpl::nextThreadToFetch()
+{
+    // round-robin over threads that have room in their own pipeline, 
+    // so that one busy thread can't starve the others
+    for (size_t i = 0; i < threadQueue_.size(); ++i)
     {
-        // extract latest key and delta numbers from metadata
-        if (ninfo_.streamType_ == MediaStreamParams::MediaStreamTypeVideo)
-        {
-            ImmutableHeaderPacket<DataSegmentHeader> packet(metaBlob);
-            NetworkData nd(packet.getPayload().size(), packet.getPayload().data());
-            VideoThreadMeta threadMeta(boost::move(nd));
+        boost::shared_ptr<ThreadRecord> t = threadQueue_[nextThreadIdx_];
+        nextThreadIdx_ = (nextThreadIdx_ + 1) % threadQueue_.size();
+
+        if (t->isFetchingStream_ && t->nPending_ < settings_.pipelineSize_)
+            return t;
+    }
 
-            fetchIndex_.first = threadMeta.getSeqNo().second;
-            fetchIndex_.second = threadMeta.getSeqNo().first;
+    return boost::shared_ptr<ThreadRecord>();
+}
 
-            NamespaceInfo frameInfo = ninfo_;
+void
+StreamRecorderImpl::fillPipeline()
+{
+    if (!isFetching_)
+        return;
+
+    if (writer_->isSaturated())
+    {
+        // storage can't keep up -- hold off fetching until write queue drains
+        if (!isPipelineCheckScheduled_)
+        {
+            boost::shared_ptr<StreamRecorderImpl> me = dynamic_pointer_cast<StreamRecorderImpl>(shared_from_this());
+            isPipelineCheckScheduled_ = true;
+            stats_.writeQueueStalls_++;
+            face_->callLater(WRITE_QUEUE_RECHECK_MS, [me, this](){
+                isPipelineCheckScheduled_ = false;
+                fillPipeline();
+            });
+        }
+        return;
+    }
+
+    while (nPending_ < inFlightBudget_)
+    {
+        boost::shared_ptr<ThreadRecord> thread = nextThreadToFetch();
+        if (!thread)
+            break;
+
+        // each thread keeps one key frame and the rest of its pipeline 
+        // as delta frames in flight
+        NamespaceInfo frameInfo = thread->ninfo_;
+        if (!thread->isKeyPending_)
+        {
             frameInfo.class_ = SampleClass::Key;
-            frameInfo.sampleNo_ = fetchIndex_.first;
-            fetchIndex_.first++;
-            requestFrame(frameInfo);
-
-            while (pipelineReserve_)
-            {
-                frameInfo.class_ = SampleClass::Delta;
-                frameInfo.sampleNo_ = fetchIndex_.second;
-                fetchIndex_.second++;
-                requestFrame(frameInfo);
-            }
+            frameInfo.sampleNo_ = thread->fetchIndex_.first++;
         }
         else
-            throw runtime_error("audio streams are not supported yet!");
+        {
+            frameInfo.class_ = SampleClass::Delta;
+            frameInfo.sampleNo_ = thread->fetchIndex_.second++;
+        }
+
+        requestFrame(thread, frameInfo);
     }
-    else
-        throw runtime_error("Seed frame is not supported yet!");
 }
 
-void StreamRecorderImpl::requestFrame(const NamespaceInfo& frameInfo)
+void StreamRecorderImpl::requestFrame(const boost::shared_ptr<ThreadRecord>& thread, 
+                                      const NamespaceInfo& frameInfo)
 {
     LogDebugC << "request " << frameInfo.getSuffix(suffix_filter::Thread) 
              << "(" << frameInfo.sampleNo_ << ")" << endl;
 
     if (frameInfo.class_ == SampleClass::Key)
+    {
         stats_.latestKeyRequested_ = frameInfo.sampleNo_;
+        thread->stats_.latestKeyRequested_ = frameInfo.sampleNo_;
+        thread->isKeyPending_ = true;
+    }
     else
+    {
         stats_.latestDeltaRequested_ = frameInfo.sampleNo_;
+        thread->stats_.latestDeltaRequested_ = frameInfo.sampleNo_;
+    }
 
     boost::shared_ptr<StreamRecorderImpl> me = dynamic_pointer_cast<StreamRecorderImpl>(shared_from_this());
     Name fName = frameInfo.getPrefix(prefix_filter::Sample);
@@ -254,48 +456,53 @@ void StreamRecorderImpl::requestFrame(const NamespaceInfo& frameInfo)
         boost::make_shared<FrameFetchingTask>(
             fName,
             frameFetchMethod_, 
-            [this, me, frameInfo](const boost::shared_ptr<const FetchingTask>& t, 
+            [this, me, thread, frameInfo](const boost::shared_ptr<const FetchingTask>& t, 
              const boost::shared_ptr<const BufferSlot>& slot)
             { // onComplete
-                fetchingTasks_.erase(frameInfo.getSuffix(suffix_filter::Thread));
-                pipelineReserve_++;
-
+                boost::shared_ptr<DataBatch> batch = boost::make_shared<DataBatch>();
                 for (auto s:slot->getFetchedSegments())
-                    store(s->getData()->getData());
+                    batch->push_back(s->getData()->getData());
+                store(batch);
 
                 if (frameInfo.class_ == SampleClass::Delta)
                 {
                     stats_.latestDeltaFetched_ = frameInfo.sampleNo_;
                     stats_.deltaStored_++;
+                    thread->stats_.latestDeltaFetched_ = frameInfo.sampleNo_;
+                    thread->stats_.deltaStored_++;
                 }
                 else
                 {
                     stats_.latestKeyFetched_ = frameInfo.sampleNo_;
                     stats_.keyStored_++;
+                    thread->stats_.latestKeyFetched_ = frameInfo.sampleNo_;
+                    thread->stats_.keyStored_++;
                 }
+                thread->stats_.totalSegmentsStored_ += batch->size();
 
                 LogDebugC << "stored frame " << frameInfo.getSuffix(suffix_filter::Thread) 
                          << "(" << frameInfo.sampleNo_ << ")" << endl;
 
-                if (isFetching_)
-                    requestNextFrame(frameInfo);
+                onFrameDone(thread, frameInfo);
             },
-            [this, me, frameInfo](const boost::shared_ptr<const FetchingTask>& t, 
+            [this, me, thread, frameInfo](const boost::shared_ptr<const FetchingTask>& t, 
              std::string msg)
             { // onFailed
                 LogErrorC << "couldn't fetch frame " << t->getFrameName() 
                             << ": " << msg << endl;
 
-                fetchingTasks_.erase(frameInfo.getSuffix(suffix_filter::Thread));
-                pipelineReserve_++;
-
                 if (frameInfo.class_ == SampleClass::Delta)
+                {
                     stats_.deltaFailed_++;
+                    thread->stats_.deltaFailed_++;
+                }
                 else
+                {
                     stats_.keyFailed_++;
+                    thread->stats_.keyFailed_++;
+                }
 
-                if (isFetching_)
-                    requestNextFrame(frameInfo);
+                onFrameDone(thread, frameInfo);
             },
             fetchTaskSettings_,
             [this, me]
@@ -304,21 +511,23 @@ void StreamRecorderImpl::requestFrame(const NamespaceInfo& frameInfo)
             { // onFirstSegment
                 
             });
-    fetchingTasks_[frameInfo.getSuffix(suffix_filter::Thread)] = task;
+    fetchingTasks_[fName] = task;
     task->setLogger(logger_);
     task->start();
-    pipelineReserve_--;
+    nPending_++;
+    thread->nPending_++;
     stats_.pendingFrames_ = fetchingTasks_.size();
+    thread->stats_.pendingFrames_ = thread->nPending_;
 
     // fetch manifest, too
-    Interest i(fName.append(NameComponents::NameComponentManifest), settings_.lifetime_);
+    Interest i(Name(fName).append(NameComponents::NameComponentManifest), settings_.lifetime_);
     SegmentFetcher::fetch(*face_, i, keyChain_.get(), 
-                        [me, this, frameInfo](const Blob &content,
+                        [me, this, thread, frameInfo](const Blob &content,
                                   const vector<ValidationErrorInfo>&,
                                   const vector<boost::shared_ptr<Data>>& contentData){
-                                    for (auto d:contentData)
-                                        store(d);
+                                    store(boost::make_shared<DataBatch>(contentData.begin(), contentData.end()));
                                     stats_.manifestsStored_++;
+                                    thread->stats_.manifestsStored_++;
 
                                     LogDebugC << "stored manifest for " << frameInfo.getSuffix(suffix_filter::Sample) << endl;
                                   },
@@ -330,20 +539,136 @@ void StreamRecorderImpl::requestFrame(const NamespaceInfo& frameInfo)
 }
 
 void
-StreamRecorderImpl::requestNextFrame(const NamespaceInfo& fetchedFrame)
+StreamRecorderImpl::onFrameDone(const boost::shared_ptr<ThreadRecord>& thread, 
+                                const NamespaceInfo& frameInfo)
 {
-    NamespaceInfo nextFrame(fetchedFrame);
-    if (nextFrame.class_ == SampleClass::Key)
-        nextFrame.sampleNo_ = fetchIndex_.first++;
-    else
-        nextFrame.sampleNo_ = fetchIndex_.second++;
+    fetchingTasks_.erase(frameInfo.getPrefix(prefix_filter::Sample));
+    nPending_--;
+    thread->nPending_--;
+    if (frameInfo.class_ == SampleClass::Key)
+        thread->isKeyPending_ = false;
 
-    requestFrame(nextFrame);
+    stats_.pendingFrames_ = fetchingTasks_.size();
+    thread->stats_.pendingFrames_ = thread->nPending_;
+
+    fillPipeline();
 }
 
 void
-StreamRecorderImpl::store(const boost::shared_ptr<const Data>&d)
+StreamRecorderImpl::store(const boost::shared_ptr<DataBatch>& batch)
+{
+    if (batch->size() == 0)
+        return;
+
+    writer_->enqueue(batch);
+}
+
+const StreamRecorder::Stats& 
+StreamRecorderImpl::getStats()
+{
+    if (writer_)
+        writer_->getStats(stats_);
+    return stats_;
+}
+
+map<string, StreamRecorder::Stats> 
+StreamRecorderImpl::getThreadStats()
+{
+    map<string, StreamRecorder::Stats> threadStats;
+    for (auto t:threadQueue_)
+        threadStats[t->ninfo_.getPrefix(prefix_filter::ThreadNT).toUri()] = t->stats_;
+    return threadStats;
+}
+
+//******************************************************************************
+StorageWriter::StorageWriter(const boost::shared_ptr<StorageEngine>& storage, size_t maxQueueSize):
+    storage_(storage), maxQueueSize_(maxQueueSize), queueDepth_(0), stopped_(false),
+    batchesWritten_(0), segmentsWritten_(0), writeErrors_(0),
+    writeLatencyAvgUsec_(0), writeLatencyMaxUsec_(0)
+{
+    thread_ = boost::thread(boost::bind(&StorageWriter::run, this));
+}
+
+StorageWriter::~StorageWriter()
 {
-    storage_->put(d);
-    stats_.totalSegmentsStored_++;
-}
\ No newline at end of file
+    stop();
+}
+
+void
+StorageWriter::enqueue(const boost::shared_ptr<DataBatch>& batch)
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        if (stopped_)
+            return;
+
+        queue_.push_back(batch);
+        queueDepth_ = queue_.size();
+    }
+    queueCondition_.notify_one();
+}
+
+void
+StorageWriter::stop()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        if (stopped_)
+            return;
+        stopped_ = true;
+    }
+    queueCondition_.notify_one();
+
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void
+StorageWriter::getStats(StreamRecorder::Stats& stats) const
+{
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    stats.writeQueueDepth_ = queue_.size();
+    stats.batchesWritten_ = batchesWritten_;
+    stats.totalSegmentsStored_ = segmentsWritten_;
+    stats.writeErrors_ = writeErrors_;
+    stats.writeLatencyAvgUsec_ = writeLatencyAvgUsec_;
+    stats.writeLatencyMaxUsec_ = writeLatencyMaxUsec_;
+}
+
+void
+StorageWriter::run()
+{
+    while (true)
+    {
+        boost::shared_ptr<DataBatch> batch;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while (queue_.empty() && !stopped_)
+                queueCondition_.wait(lock);
+
+            // drain the queue completely before exiting
+            if (queue_.empty())
+                break;
+
+            batch = queue_.front();
+            queue_.pop_front();
+        }
+
+        int64_t writeStart = clock::microsecondTimestamp();
+        bool ok = storage_->put(*batch);
+        double latency = (double)(clock::microsecondTimestamp() - writeStart);
+
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        queueDepth_ = queue_.size();
+
+        if (ok)
+        {
+            segmentsWritten_ += batch->size();
+            batchesWritten_++;
+            writeLatencyAvgUsec_ += (latency - writeLatencyAvgUsec_) / batchesWritten_;
+            if (latency > writeLatencyMaxUsec_)
+                writeLatencyMaxUsec_ = latency;
+        }
+        else
+            writeErrors_++;
+    }
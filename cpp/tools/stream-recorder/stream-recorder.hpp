@@ -8,6 +8,8 @@
 #ifndef __stream_recorder_hpp__
 #define __stream_recorder_hpp__
 
+#include <map>
+#include <vector>
 #include <boost/shared_ptr.hpp>
 
 namespace ndn {
@@ -40,6 +42,12 @@ namespace ndnrtc {
      * frame).
      * StreamRecroder can be intialized for fetching N frames. In this case, only
      * data packets associated with N frames (Key and Delta) will be fetched.
+     * One recorder may capture several threads and several streams at once. 
+     * All of them share one face and one storage writer; total number of frames
+     * in flight is limited by a global budget which is shared between threads 
+     * in round-robin fashion.
+     * Fetched data is grouped into batches (all segments of a frame, manifest
+     * or meta) which are committed to storage by a dedicated writer thread.
      */
     class StreamRecorder {
         public: 
@@ -54,8 +62,16 @@ namespace ndnrtc {
             uint8_t direction_;
             uint32_t seedFrame_;
             uint32_t recordLength_;
+            // maximum number of frames in flight per thread
             uint8_t pipelineSize_;
+            // maximum number of frames in flight across all recorded threads;
+            // if zero, equals pipelineSize_ times number of threads
+            uint16_t inFlightBudget_;
             uint32_t streamMetaFetchInterval_, threadMetaFetchInterval_;
+            // maximum number of write batches (one per frame, manifest or
+            // meta) waiting to be committed to storage; once reached,
+            // no new frames are requested until the writer catches up
+            uint32_t writeQueueSize_;
         } FetchSettings;
 
         typedef struct _Stats {
@@ -67,6 +83,9 @@ namespace ndnrtc {
             uint64_t totalSegmentsStored_;
             size_t deltaFailed_, keyFailed_;
             size_t pendingFrames_;
+            size_t writeQueueDepth_, writeQueueStalls_;
+            uint64_t batchesWritten_, writeErrors_;
+            double writeLatencyAvgUsec_, writeLatencyMaxUsec_;
         } Stats;
 
         static const FetchSettings Default;
@@ -84,6 +103,17 @@ namespace ndnrtc {
                         const NamespaceInfo& ninfo,
                         const boost::shared_ptr<ndn::Face>& face, 
                         const boost::shared_ptr<ndn::KeyChain> keyChain);
+
+        /**
+         * Constructs recorder for several threads and/or streams.
+         * @param targets List of thread or stream prefixes to record. If a
+         *                prefix has no thread name, all threads listed in 
+         *                the stream metadata will be recorded.
+         */
+        StreamRecorder(const boost::shared_ptr<StorageEngine>& storageEngine, 
+                        const std::vector<NamespaceInfo>& targets,
+                        const boost::shared_ptr<ndn::Face>& face, 
+                        const boost::shared_ptr<ndn::KeyChain> keyChain);
         ~StreamRecorder(){ pimpl_.reset(); }
 
         /**
@@ -100,6 +130,11 @@ namespace ndnrtc {
         const std::string getThreadName() const;
         void setLogger(const boost::shared_ptr<ndnlog::new_api::Logger>& logger);
         const Stats& getCurrentStats() const;
+        /**
+         * Returns recording statistics for each thread, keyed by thread prefix.
+         * Storage writer statistics are reported only in getCurrentStats().
+         */
+        std::map<std::string, Stats> getThreadStats() const;
 
         private:
         boost::shared_ptr<StreamRecorderImpl> pimpl_;